@@ -0,0 +1,734 @@
+///
+/// @author   GUSTAVO CAMPOS
+/// @author   GUSTAVO CAMPOS
+/// @date   28/05/2019 19:44
+/// @version  <#version#>
+///
+/// @copyright  (c) GUSTAVO CAMPOS, 2019
+/// @copyright  Licence
+///
+/// @see    ReadMe.txt for references
+///
+//               GNU GENERAL PUBLIC LICENSE
+//                Version 3, 29 June 2007
+//
+// Copyright (C) 2007 Free Software Foundation, Inc. <https://fsf.org/>
+// Everyone is permitted to copy and distribute verbatim copies
+// of this license document, but changing it is not allowed.
+//
+// Preamble
+//
+// The GNU General Public License is a free, copyleft license for
+// software and other kinds of works.
+//
+// The licenses for most software and other practical works are designed
+// to take away your freedom to share and change the works.  By contrast,
+// the GNU General Public License is intended to guarantee your freedom to
+// share and change all versions of a program--to make sure it remains free
+// software for all its users.  We, the Free Software Foundation, use the
+// GNU General Public License for most of our software; it applies also to
+// any other work released this way by its authors.  You can apply it to
+// your programs, too.
+//
+// See LICENSE file for the complete information
+
+#ifndef ALARMS_HPP
+#define ALARMS_HPP
+
+#include "Arduino.h"
+#include "CorePartition.h"
+
+#include <LittleFS.h>
+#include <stdlib.h>
+
+#include "Encoding.hpp"
+#include "BinaryLog.hpp"
+#include "Simulation.hpp"
+#include "Controller.hpp"
+#include "SensorPipeline.hpp"
+
+/// Alarm rules over the process values
+///
+/// A rule holds up to ALARM_TERMS terms, a signal above or below a
+/// threshold; it raises an alarm once all of them held for nDelay
+/// simulated seconds and clears when one of them is back past its
+/// threshold by nHysteresis.
+///
+/// Signals are sampled every control period and published only when
+/// they moved by their resolution. Compile sorts the terms of all
+/// rules by signal into one index, so a tick evaluates the rules of
+/// the signals that changed and the ones with a running timer, not
+/// the whole table; hundreds of rules cost little while the plant is
+/// steady. Transitions go to the binary log as warnings, to the
+/// ticker and to the "alarms" dashboard source.
+///
+/// The rules are saved to ALARM_FILE with "alarm save" and loaded at
+/// boot, the defaults otherwise; alarm states start clear.
+
+#ifndef ALARM_RULES
+#define ALARM_RULES 128
+#endif
+
+#define ALARM_TERMS 2
+
+#define ALARM_FILE "/alarms.bin"
+#define ALARM_MAGIC 0x4D4C4142 // "BALM"
+#define ALARM_VERSION 1
+
+/// Simulated seconds of the fermentation rate
+#define ALARM_RATE_WINDOW 3600
+
+/// Flat signal ids, a block per kind
+enum AlarmSignal : uint8_t
+{
+    ALARM_SIGNAL_TEMPERATURE = 0,                                 // C, per sensor channel
+    ALARM_SIGNAL_VOLUME = ALARM_SIGNAL_TEMPERATURE + SENSOR_CHANNELS, // L, per vessel
+    ALARM_SIGNAL_HEATER = ALARM_SIGNAL_VOLUME + SIMULATION_VESSELS, // % duty, per vessel
+    ALARM_SIGNAL_ERROR = ALARM_SIGNAL_HEATER + SIMULATION_VESSELS,  // C off the setpoint, per loop, 0 when off
+    ALARM_SIGNAL_FLOW = ALARM_SIGNAL_ERROR + CONTROL_LOOPS,         // L/min, per link
+    ALARM_SIGNAL_PUMP = ALARM_SIGNAL_FLOW + PLANT_LINKS,            // % speed, per link
+    ALARM_SIGNAL_GRAVITY = ALARM_SIGNAL_PUMP + PLANT_LINKS,         // points, 0 before pitching
+    ALARM_SIGNAL_RATE,                                              // points per day fermented
+    ALARM_SIGNALS
+};
+
+enum AlarmState : uint8_t
+{
+    ALARM_CLEAR = 0,
+    ALARM_PENDING, // holds, delay running
+    ALARM_ACTIVE,
+    ALARM_ACKED
+};
+
+const char* const alarmStateNames[] = {"clear", "pending", "ACTIVE", "acked"};
+
+/// Names of the default rules, 0 is a rule added on the terminal
+const char* const alarmNames[] = {"", "Mash over temperature", "Mash off setpoint", "Boil off setpoint", "Boil dry", "Fermenter over temperature", "Fermentation stalled", "Pump dry run"};
+
+#define ALARM_NAMES (sizeof (alarmNames) / sizeof (alarmNames[0]))
+
+const char* const alarmVesselNames[] = {"mash", "boil", "fermenter"};
+
+struct AlarmTerm
+{
+    uint8_t nSignal; // ALARM_SIGNALS when unused
+    uint8_t bAbove;  // holds above the threshold, else below
+    uint16_t nReserved;
+    Fixed nThreshold;
+};
+
+struct AlarmRule
+{
+    AlarmTerm terms[ALARM_TERMS];
+    Fixed nHysteresis;
+    uint32_t nDelay; // s
+    uint8_t nName;
+    uint8_t nState;
+    uint16_t nReserved;
+    uint32_t nSince; // simulated time pending or raised
+};
+
+struct AlarmFileHeader
+{
+    uint32_t nMagic;
+    uint16_t nVersion;
+    uint16_t nRules;
+    uint32_t nCrc; // of the rules
+};
+
+/// "mash.temp", "boil.error", "link2.flow", "fermenter.rate"...,
+/// ALARM_SIGNALS when unknown
+uint8_t Alarm_ParseSignal (const char* pszName)
+{
+    const char* pszField = strchr (pszName, '.');
+
+    if (pszField == NULL) return ALARM_SIGNALS;
+
+    size_t nObject = pszField++ - pszName;
+
+    if (nObject > 4 && strncmp (pszName, "link", 4) == 0)
+    {
+        char* pszEnd;
+        unsigned long nLink = strtoul (pszName + 4, &pszEnd, 10);
+
+        if (pszEnd != pszName + nObject || nLink >= PLANT_LINKS) return ALARM_SIGNALS;
+        if (strcmp (pszField, "flow") == 0) return ALARM_SIGNAL_FLOW + (uint8_t)nLink;
+        if (strcmp (pszField, "pump") == 0) return ALARM_SIGNAL_PUMP + (uint8_t)nLink;
+
+        return ALARM_SIGNALS;
+    }
+
+    for (uint8_t nVessel = 0; nVessel < SIMULATION_VESSELS && nVessel < 3; nVessel++)
+    {
+        if (strlen (alarmVesselNames[nVessel]) != nObject || strncmp (pszName, alarmVesselNames[nVessel], nObject) != 0) continue;
+
+        if (strcmp (pszField, "temp") == 0) return ALARM_SIGNAL_TEMPERATURE + nVessel;
+        if (strcmp (pszField, "volume") == 0) return ALARM_SIGNAL_VOLUME + nVessel;
+        if (strcmp (pszField, "heater") == 0) return ALARM_SIGNAL_HEATER + nVessel;
+        if (strcmp (pszField, "error") == 0 && nVessel < CONTROL_LOOPS) return ALARM_SIGNAL_ERROR + nVessel;
+        if (strcmp (pszField, "gravity") == 0 && nVessel == VESSEL_FERMENTER) return ALARM_SIGNAL_GRAVITY;
+        if (strcmp (pszField, "rate") == 0 && nVessel == VESSEL_FERMENTER) return ALARM_SIGNAL_RATE;
+    }
+
+    return ALARM_SIGNALS;
+}
+
+void Alarm_SignalName (uint8_t nSignal, char* pszName, size_t nSize)
+{
+    if (nSignal < ALARM_SIGNAL_VOLUME)
+        snprintf (pszName, nSize, "%s.temp", alarmVesselNames[(nSignal - ALARM_SIGNAL_TEMPERATURE) % 3]);
+    else if (nSignal < ALARM_SIGNAL_HEATER)
+        snprintf (pszName, nSize, "%s.volume", alarmVesselNames[(nSignal - ALARM_SIGNAL_VOLUME) % 3]);
+    else if (nSignal < ALARM_SIGNAL_ERROR)
+        snprintf (pszName, nSize, "%s.heater", alarmVesselNames[(nSignal - ALARM_SIGNAL_HEATER) % 3]);
+    else if (nSignal < ALARM_SIGNAL_FLOW)
+        snprintf (pszName, nSize, "%s.error", alarmVesselNames[(nSignal - ALARM_SIGNAL_ERROR) % 3]);
+    else if (nSignal < ALARM_SIGNAL_PUMP)
+        snprintf (pszName, nSize, "link%u.flow", nSignal - ALARM_SIGNAL_FLOW);
+    else if (nSignal < ALARM_SIGNAL_GRAVITY)
+        snprintf (pszName, nSize, "link%u.pump", nSignal - ALARM_SIGNAL_PUMP);
+    else if (nSignal == ALARM_SIGNAL_GRAVITY)
+        snprintf (pszName, nSize, "fermenter.gravity");
+    else
+        snprintf (pszName, nSize, "fermenter.rate");
+}
+
+class AlarmEngine
+{
+public:
+    AlarmEngine () : nRules (0), nActive (0), nUnacked (0), bSampled (false), nRateTime (0), nTicks (0), nChanges (0), nEvaluations (0), nTransitions (0)
+    {
+        memset (dirty, 0, sizeof (dirty));
+        memset (pending, 0, sizeof (pending));
+    }
+
+    /// Rules from ALARM_FILE, the defaults when there is none; at
+    /// boot, before the terminal can add any
+    void Begin ()
+    {
+        if (Load () == false) Defaults ();
+    }
+
+    /// Over temperature, loops off their setpoint, a dry kettle, a
+    /// stalled fermentation and a pump running without flow
+    void Defaults ()
+    {
+        nRules = 0;
+
+        Add (1, ALARM_SIGNAL_TEMPERATURE + VESSEL_MASH, true, Fixed (80), Fixed (1), 10);
+        Add (2, ALARM_SIGNAL_ERROR + 0, true, Fixed (5), Fixed (1), 3600);
+        Add (3, ALARM_SIGNAL_ERROR + 1, true, Fixed (5), Fixed (1), 3600);
+        Add (4, ALARM_SIGNAL_HEATER + VESSEL_BOIL, true, Fixed (0), Fixed (0), 5, ALARM_SIGNAL_VOLUME + VESSEL_BOIL, false, Fixed (2));
+        Add (5, ALARM_SIGNAL_TEMPERATURE + VESSEL_FERMENTER, true, Fixed (24), Fixed (0.5), 600);
+        Add (6, ALARM_SIGNAL_RATE, false, Fixed (1), Fixed (0.5), 24 * 3600, ALARM_SIGNAL_GRAVITY, true, Fixed (15));
+        Add (7, ALARM_SIGNAL_PUMP + 2, true, Fixed (0), Fixed (0), 30, ALARM_SIGNAL_FLOW + 2, false, Fixed (0.5));
+    }
+
+    /// Returns the rule number, -1 when the table is full or a term
+    /// is invalid
+    int Add (uint8_t nName, uint8_t nSignal, bool bAbove, Fixed nThreshold, Fixed nHysteresis, uint32_t nDelay, uint8_t nSignal2 = ALARM_SIGNALS, bool bAbove2 = false, Fixed nThreshold2 = Fixed (0))
+    {
+        if (nRules >= ALARM_RULES || nName >= ALARM_NAMES || nSignal >= ALARM_SIGNALS || nSignal2 > ALARM_SIGNALS || nHysteresis < Fixed (0)) return -1;
+
+        AlarmRule& rule = rules[nRules];
+
+        rule = AlarmRule ();
+
+        rule.terms[0] = {nSignal, bAbove, 0, nThreshold};
+        rule.terms[1] = {nSignal2, bAbove2, 0, nThreshold2};
+        rule.nHysteresis = nHysteresis;
+        rule.nDelay = nDelay;
+        rule.nName = nName;
+
+        nRules++;
+
+        Compile ();
+
+        return nRules - 1;
+    }
+
+    bool Remove (uint16_t nRule)
+    {
+        if (nRule >= nRules) return false;
+
+        memmove (&rules[nRule], &rules[nRule + 1], (nRules - nRule - 1) * sizeof (AlarmRule));
+        nRules--;
+
+        Compile ();
+
+        return true;
+    }
+
+    void Clear ()
+    {
+        nRules = 0;
+
+        Compile ();
+    }
+
+    /// Acknowledges one active alarm, ALARM_RULES for all of them
+    void Acknowledge (uint16_t nRule)
+    {
+        for (uint16_t nCount = 0; nCount < nRules; nCount++)
+        {
+            if ((nRule == ALARM_RULES || nRule == nCount) && rules[nCount].nState == ALARM_ACTIVE)
+            {
+                rules[nCount].nState = ALARM_ACKED;
+                nUnacked--;
+                nTransitions++;
+            }
+        }
+    }
+
+    /// Rebuilds the signal to rule index, a counting sort of the
+    /// terms; every rule is evaluated again on the next tick
+    void Compile ()
+    {
+        memset (indexStart, 0, sizeof (indexStart));
+
+        for (uint16_t nRule = 0; nRule < nRules; nRule++)
+        {
+            for (uint8_t nTerm = 0; nTerm < ALARM_TERMS; nTerm++)
+            {
+                if (Indexed (rules[nRule], nTerm)) indexStart[rules[nRule].terms[nTerm].nSignal + 1]++;
+            }
+        }
+
+        for (uint8_t nSignal = 0; nSignal < ALARM_SIGNALS; nSignal++) indexStart[nSignal + 1] += indexStart[nSignal];
+
+        uint16_t next[ALARM_SIGNALS];
+
+        memcpy (next, indexStart, sizeof (next));
+
+        for (uint16_t nRule = 0; nRule < nRules; nRule++)
+        {
+            for (uint8_t nTerm = 0; nTerm < ALARM_TERMS; nTerm++)
+            {
+                if (Indexed (rules[nRule], nTerm)) indexRules[next[rules[nRule].terms[nTerm].nSignal]++] = nRule;
+            }
+        }
+
+        memset (dirty, 0, sizeof (dirty));
+        memset (pending, 0, sizeof (pending));
+
+        nActive = 0;
+        nUnacked = 0;
+
+        for (uint16_t nRule = 0; nRule < nRules; nRule++)
+        {
+            Mark (dirty, nRule);
+
+            if (rules[nRule].nState == ALARM_PENDING) Mark (pending, nRule);
+            if (rules[nRule].nState >= ALARM_ACTIVE) nActive++;
+            if (rules[nRule].nState == ALARM_ACTIVE) nUnacked++;
+        }
+    }
+
+    /// Samples the signals and evaluates the rules that depend on the
+    /// ones that changed, and the pending ones
+    void Tick ()
+    {
+        uint32_t nTime = simulation.GetTime ();
+
+        Sample (nTime);
+
+        for (uint16_t nWord = 0; nWord < (nRules + 31) / 32; nWord++)
+        {
+            uint32_t nBits = dirty[nWord] | pending[nWord];
+
+            dirty[nWord] = 0;
+
+            while (nBits != 0)
+            {
+                uint8_t nBit = __builtin_ctz (nBits);
+
+                nBits &= nBits - 1;
+
+                Evaluate (nWord * 32 + nBit, nTime);
+            }
+        }
+
+        nTicks++;
+    }
+
+    uint16_t GetRules () const
+    {
+        return nRules;
+    }
+
+    const AlarmRule& Rule (uint16_t nRule) const
+    {
+        return rules[nRule];
+    }
+
+    /// Raised, acknowledged or not
+    uint16_t GetActive () const
+    {
+        return nActive;
+    }
+
+    uint16_t GetUnacked () const
+    {
+        return nUnacked;
+    }
+
+    /// Counts raises, clears and acknowledgements, for displays that
+    /// redraw on a change
+    uint32_t GetTransitions () const
+    {
+        return nTransitions;
+    }
+
+    Fixed GetValue (uint8_t nSignal) const
+    {
+        return values[nSignal];
+    }
+
+    /// First unacknowledged alarm, else the first active one, -1
+    /// when none
+    int GetFirst () const
+    {
+        int nFirst = -1;
+
+        for (uint16_t nRule = 0; nRule < nRules; nRule++)
+        {
+            if (rules[nRule].nState == ALARM_ACTIVE) return nRule;
+            if (rules[nRule].nState == ALARM_ACKED && nFirst < 0) nFirst = nRule;
+        }
+
+        return nFirst;
+    }
+
+    bool Save ()
+    {
+        AlarmFileHeader header = {ALARM_MAGIC, ALARM_VERSION, nRules, Crc32 (rules, nRules * sizeof (AlarmRule))};
+
+        if (LittleFS.begin () == false) return false;
+
+        File file = LittleFS.open (ALARM_FILE, "w");
+
+        if (!file) return false;
+
+        bool bWritten = file.write ((const uint8_t*)&header, sizeof (header)) == sizeof (header) && file.write ((const uint8_t*)rules, nRules * sizeof (AlarmRule)) == nRules * sizeof (AlarmRule);
+
+        file.close ();
+
+        return bWritten;
+    }
+
+    bool Load ()
+    {
+        AlarmFileHeader header;
+
+        if (LittleFS.begin () == false) return false;
+
+        File file = LittleFS.open (ALARM_FILE, "r");
+
+        if (!file) return false;
+
+        bool bRead = file.read ((uint8_t*)&header, sizeof (header)) == sizeof (header) && header.nMagic == ALARM_MAGIC && header.nVersion == ALARM_VERSION && header.nRules <= ALARM_RULES &&
+                     file.read ((uint8_t*)rules, header.nRules * sizeof (AlarmRule)) == header.nRules * sizeof (AlarmRule);
+
+        file.close ();
+
+        bRead = bRead && Crc32 (rules, header.nRules * sizeof (AlarmRule)) == header.nCrc;
+
+        for (uint16_t nRule = 0; bRead && nRule < header.nRules; nRule++)
+        {
+            AlarmRule& rule = rules[nRule];
+
+            bRead = rule.terms[0].nSignal < ALARM_SIGNALS && rule.terms[1].nSignal <= ALARM_SIGNALS && rule.nName < ALARM_NAMES;
+            rule.nState = ALARM_CLEAR;
+        }
+
+        nRules = bRead ? header.nRules : 0;
+
+        Compile ();
+
+        return bRead;
+    }
+
+    void List (Stream& client)
+    {
+        char szSignal[24];
+
+        client.println (F ("Rule\tState\tCondition"));
+
+        for (uint16_t nRule = 0; nRule < nRules; nRule++)
+        {
+            const AlarmRule& rule = rules[nRule];
+
+            client.printf ("%u\t%s\t", nRule, alarmStateNames[rule.nState]);
+
+            for (uint8_t nTerm = 0; nTerm < ALARM_TERMS && rule.terms[nTerm].nSignal < ALARM_SIGNALS; nTerm++)
+            {
+                Alarm_SignalName (rule.terms[nTerm].nSignal, szSignal, sizeof (szSignal));
+                client.printf ("%s%s %c ", nTerm > 0 ? " and " : "", szSignal, rule.terms[nTerm].bAbove ? '>' : '<');
+                PrintCenti (client, rule.terms[nTerm].nThreshold);
+            }
+
+            client.printf (" for %us hyst ", rule.nDelay);
+            PrintCenti (client, rule.nHysteresis);
+
+            if (rule.nName > 0) client.printf ("\t%s", alarmNames[rule.nName]);
+
+            client.println ();
+        }
+    }
+
+    /// Raised alarms and the counters
+    void Show (Stream& client)
+    {
+        uint32_t nTime = simulation.GetTime ();
+
+        client.printf ("Alarms: %u active, %u unacknowledged, %u rules of %u\r\n", nActive, nUnacked, nRules, ALARM_RULES);
+
+        for (uint16_t nRule = 0; nRule < nRules; nRule++)
+        {
+            const AlarmRule& rule = rules[nRule];
+
+            if (rule.nState < ALARM_ACTIVE) continue;
+
+            client.printf ("%u\t%s\t%us\t%s\r\n", nRule, alarmStateNames[rule.nState], nTime - rule.nSince, rule.nName > 0 ? alarmNames[rule.nName] : "rule");
+        }
+
+        uint64_t nFull = (uint64_t)nTicks * nRules;
+
+        client.printf ("Ticks: %u, signal changes: %u, evaluations: %u (%u.%u%% of every rule every tick), transitions: %u\r\n",
+                       nTicks,
+                       nChanges,
+                       nEvaluations,
+                       (uint32_t)(nFull > 0 ? nEvaluations * 100ULL / nFull : 0),
+                       (uint32_t)(nFull > 0 ? nEvaluations * 1000ULL / nFull % 10 : 0),
+                       nTransitions);
+    }
+
+private:
+    static void Mark (uint32_t* pBits, uint16_t nRule)
+    {
+        pBits[nRule / 32] |= 1UL << (nRule % 32);
+    }
+
+    static void Unmark (uint32_t* pBits, uint16_t nRule)
+    {
+        pBits[nRule / 32] &= ~(1UL << (nRule % 32));
+    }
+
+    /// A rule reading a signal twice is indexed once
+    static bool Indexed (const AlarmRule& rule, uint8_t nTerm)
+    {
+        uint8_t nSignal = rule.terms[nTerm].nSignal;
+
+        for (uint8_t nCount = 0; nCount < nTerm; nCount++)
+        {
+            if (rule.terms[nCount].nSignal == nSignal) return false;
+        }
+
+        return nSignal < ALARM_SIGNALS;
+    }
+
+    /// Current value of a signal
+    Fixed Read (uint8_t nSignal)
+    {
+        if (nSignal < ALARM_SIGNAL_VOLUME) return Sensor_Read (nSignal - ALARM_SIGNAL_TEMPERATURE);
+        if (nSignal < ALARM_SIGNAL_HEATER) return simulation.Vessel (nSignal - ALARM_SIGNAL_VOLUME).nVolume;
+        if (nSignal < ALARM_SIGNAL_ERROR) return simulation.Vessel (nSignal - ALARM_SIGNAL_HEATER).nDuty * Fixed (100);
+
+        if (nSignal < ALARM_SIGNAL_FLOW)
+        {
+            const ControlLoop& loop = controlLoops[nSignal - ALARM_SIGNAL_ERROR];
+
+            return loop.GetMode () == CONTROL_OFF ? Fixed (0) : Abs (loop.GetMeasurement () - loop.GetSetpoint ());
+        }
+
+        if (nSignal < ALARM_SIGNAL_PUMP)
+        {
+            uint8_t nLink = nSignal - ALARM_SIGNAL_FLOW;
+
+            return nLink < plant.GetLinks () ? plant.Link (nLink).nFlow * Fixed (60) : Fixed (0);
+        }
+
+        if (nSignal < ALARM_SIGNAL_GRAVITY)
+        {
+            uint8_t nLink = nSignal - ALARM_SIGNAL_PUMP;
+
+            return nLink < plant.GetLinks () && plant.Link (nLink).nHead != Fixed (0) ? plant.Link (nLink).nPump * Fixed (100) : Fixed (0);
+        }
+
+        if (nSignal == ALARM_SIGNAL_GRAVITY) return fermentation.GetGravity ();
+
+        return nRate;
+    }
+
+    /// Smallest change that publishes a signal
+    static Fixed Resolution (uint8_t nSignal)
+    {
+        if (nSignal >= ALARM_SIGNAL_HEATER && nSignal < ALARM_SIGNAL_ERROR) return Fixed (1);
+        if (nSignal >= ALARM_SIGNAL_PUMP && nSignal < ALARM_SIGNAL_GRAVITY) return Fixed (1);
+
+        return Fixed (0.05);
+    }
+
+    void Sample (uint32_t nTime)
+    {
+        // The rate steps once per window, a reset restarts it
+        if (bSampled == false || (int32_t)(nTime - nRateTime) < 0 || fermentation.IsActive () == false)
+        {
+            nRate = Fixed (0);
+            nRateGravity = fermentation.GetGravity ();
+            nRateTime = nTime;
+        }
+        else if (nTime - nRateTime >= ALARM_RATE_WINDOW)
+        {
+            nRate = (nRateGravity - fermentation.GetGravity ()) * Fixed (86400.0 / ALARM_RATE_WINDOW) / Fixed ((int)((nTime - nRateTime) / ALARM_RATE_WINDOW));
+            nRateGravity = fermentation.GetGravity ();
+            nRateTime = nTime;
+        }
+
+        for (uint8_t nSignal = 0; nSignal < ALARM_SIGNALS; nSignal++)
+        {
+            Fixed nValue = Read (nSignal);
+
+            if (bSampled && Abs (nValue - values[nSignal]) < Resolution (nSignal)) continue;
+
+            values[nSignal] = nValue;
+            nChanges++;
+
+            for (uint16_t nEntry = indexStart[nSignal]; nEntry < indexStart[nSignal + 1]; nEntry++) Mark (dirty, indexRules[nEntry]);
+        }
+
+        bSampled = true;
+    }
+
+    /// All terms hold, a raised alarm needs them past the hysteresis
+    bool Holds (const AlarmRule& rule) const
+    {
+        bool bRaised = rule.nState >= ALARM_ACTIVE;
+
+        for (uint8_t nTerm = 0; nTerm < ALARM_TERMS; nTerm++)
+        {
+            const AlarmTerm& term = rule.terms[nTerm];
+
+            if (term.nSignal >= ALARM_SIGNALS) continue;
+
+            Fixed nValue = values[term.nSignal];
+            Fixed nBand = bRaised ? rule.nHysteresis : Fixed (0);
+
+            if (term.bAbove ? nValue <= term.nThreshold - nBand : nValue >= term.nThreshold + nBand) return false;
+        }
+
+        return true;
+    }
+
+    void Evaluate (uint16_t nRule, uint32_t nTime)
+    {
+        AlarmRule& rule = rules[nRule];
+        bool bHolds = Holds (rule);
+
+        nEvaluations++;
+
+        if (rule.nState >= ALARM_ACTIVE)
+        {
+            if (bHolds) return;
+
+            if (rule.nState == ALARM_ACTIVE) nUnacked--;
+
+            nActive--;
+            nTransitions++;
+            rule.nState = ALARM_CLEAR;
+
+            LOG_INFO (LOG_ALARM_CLEARED, nRule, nTime - rule.nSince);
+            return;
+        }
+
+        if (bHolds == false)
+        {
+            rule.nState = ALARM_CLEAR;
+            Unmark (pending, nRule);
+            return;
+        }
+
+        // Pending from now, or since a plant clock that went back
+        if (rule.nState == ALARM_CLEAR || (int32_t)(nTime - rule.nSince) < 0)
+        {
+            rule.nState = ALARM_PENDING;
+            rule.nSince = nTime;
+        }
+
+        if (nTime - rule.nSince < rule.nDelay)
+        {
+            Mark (pending, nRule);
+            return;
+        }
+
+        Unmark (pending, nRule);
+
+        rule.nState = ALARM_ACTIVE;
+        rule.nSince = nTime;
+        nActive++;
+        nUnacked++;
+        nTransitions++;
+
+        LOG_WARNING (LOG_ALARM_RAISED, nRule, rule.nName, (uint32_t)values[rule.terms[0].nSignal].ToCenti ());
+    }
+
+    AlarmRule rules[ALARM_RULES];
+    uint16_t nRules;
+    uint16_t nActive;
+    uint16_t nUnacked;
+
+    uint16_t indexStart[ALARM_SIGNALS + 1];
+    uint16_t indexRules[ALARM_RULES * ALARM_TERMS];
+    uint32_t dirty[(ALARM_RULES + 31) / 32];
+    uint32_t pending[(ALARM_RULES + 31) / 32];
+
+    Fixed values[ALARM_SIGNALS];
+    bool bSampled;
+
+    Fixed nRate;
+    Fixed nRateGravity;
+    uint32_t nRateTime;
+
+    uint32_t nTicks;
+    uint32_t nChanges;
+    uint32_t nEvaluations;
+    uint32_t nTransitions;
+};
+
+AlarmEngine alarms;
+
+/// Ticker text of the first alarm, empty when there is none
+void Alarm_TickerText (char* pszText, size_t nSize)
+{
+    int nRule = alarms.GetFirst ();
+
+    if (nRule < 0)
+    {
+        pszText[0] = '\0';
+        return;
+    }
+
+    const AlarmRule& rule = alarms.Rule ((uint16_t)nRule);
+
+    if (rule.nName > 0)
+        snprintf (pszText, nSize, "ALARM %s", alarmNames[rule.nName]);
+    else
+        snprintf (pszText, nSize, "ALARM rule %d", nRule);
+
+    if (alarms.GetActive () > 1) snprintf (pszText + strlen (pszText), nSize - strlen (pszText), " +%u", alarms.GetActive () - 1);
+}
+
+/// Samples once per control period, the plant then moved about a step
+void Thread_Alarm (void* pValue)
+{
+    while (true)
+    {
+        alarms.Tick ();
+
+        uint32_t nPeriod = Control_GetPeriod () / 1000;
+
+        CorePartition_Sleep (nPeriod < 5 ? 5 : nPeriod);
+    }
+}
+
+#endif
@@ -0,0 +1,280 @@
+///
+/// @author   GUSTAVO CAMPOS
+/// @author   GUSTAVO CAMPOS
+/// @date   28/05/2019 19:44
+/// @version  <#version#>
+///
+/// @copyright  (c) GUSTAVO CAMPOS, 2019
+/// @copyright  Licence
+///
+/// @see    ReadMe.txt for references
+///
+//               GNU GENERAL PUBLIC LICENSE
+//                Version 3, 29 June 2007
+//
+// Copyright (C) 2007 Free Software Foundation, Inc. <https://fsf.org/>
+// Everyone is permitted to copy and distribute verbatim copies
+// of this license document, but changing it is not allowed.
+//
+// Preamble
+//
+// The GNU General Public License is a free, copyleft license for
+// software and other kinds of works.
+//
+// The licenses for most software and other practical works are designed
+// to take away your freedom to share and change the works.  By contrast,
+// the GNU General Public License is intended to guarantee your freedom to
+// share and change all versions of a program--to make sure it remains free
+// software for all its users.  We, the Free Software Foundation, use the
+// GNU General Public License for most of our software; it applies also to
+// any other work released this way by its authors.  You can apply it to
+// your programs, too.
+//
+// See LICENSE file for the complete information
+
+#ifndef BINARY_LOG_HPP
+#define BINARY_LOG_HPP
+
+#include "Arduino.h"
+#include "CorePartition.h"
+
+#include "Sync.hpp"
+
+/// Deferred formatting log
+///
+/// A log call stores the message ID, the tick and up to three 32 bit
+/// arguments in a RAM ring, nothing is formatted or sent at that
+/// moment. Thread_Logger (or "log show") formats the records later
+/// from the format table kept in flash, it waits on a semaphore the
+/// writes give, so it only runs when there is something to drain. The
+/// ring is never cleared, so the latest history is still there for
+/// post-mortem dumps.
+///
+/// To add a message append it to LOG_MESSAGES, arguments must be
+/// 32 bit integers (%u, %d, %x).
+
+#ifndef LOG_RING_SIZE
+#define LOG_RING_SIZE 64
+#endif
+
+#define LOG_MESSAGES(MESSAGE)                                           \
+    MESSAGE (LOG_BOOT, "System started, max threads: %u")              \
+    MESSAGE (LOG_STACK_OVERFLOW, "Stack overflow on thread #%u")        \
+    MESSAGE (LOG_TERMINAL_START, "Terminal started on serial")          \
+    MESSAGE (LOG_LEVEL_CHANGE, "Log level changed from %u to %u")      \
+    MESSAGE (LOG_POSTMORTEM_FOUND, "Post-mortem snapshot found, cause %u, thread #%u") \
+    MESSAGE (LOG_SIMULATION_START, "Simulation started, %u vessels")   \
+    MESSAGE (LOG_CONTROL_START, "Control started, %u loops every %u ms") \
+    MESSAGE (LOG_CONTROL_MODE, "Control loop %u mode %u -> %u")        \
+    MESSAGE (LOG_CONTROL_TUNED, "Auto-tune done, Kp %u/100, Ti %us, Td %us") \
+    MESSAGE (LOG_FLASHLOG_START, "Flash log started at log time %u")   \
+    MESSAGE (LOG_FLASHLOG_ERROR, "Flash log write failed, segment %u") \
+    MESSAGE (LOG_DASHBOARD_START, "Dashboard started, %u screens")    \
+    MESSAGE (LOG_DASHBOARD_ERROR, "Dashboard not started, layout of %u screens") \
+    MESSAGE (LOG_CHECKPOINT_RESTORED, "Checkpoint %u restored, %u sections, time %us") \
+    MESSAGE (LOG_CHECKPOINT_ERROR, "Checkpoint write failed, slot %u") \
+    MESSAGE (LOG_CHECKPOINT_OVERFLOW, "Checkpoint larger than %u bytes") \
+    MESSAGE (LOG_RECORD_START, "Recording started at time %us, snapshot %u bytes") \
+    MESSAGE (LOG_RECORD_STOP, "Recording stopped, %u ticks, %u bytes") \
+    MESSAGE (LOG_RECORD_ERROR, "Recording stopped, cause %u") \
+    MESSAGE (LOG_SCRIPT_START, "Script task %u started program %u") \
+    MESSAGE (LOG_SCRIPT_DONE, "Script task %u done, %u instructions") \
+    MESSAGE (LOG_SCRIPT_FAULT, "Script task %u fault %u at %u") \
+    MESSAGE (LOG_SCRIPT_LOG, "Script task %u log %u: %d/100") \
+    MESSAGE (LOG_ALARM_RAISED, "Alarm %u raised, name %u, value %d/100") \
+    MESSAGE (LOG_ALARM_CLEARED, "Alarm %u cleared after %us")
+
+#define LOG_MESSAGE_ENUM(ID, FORMAT) ID,
+#define LOG_MESSAGE_FORMAT(ID, FORMAT) static const char logFormat_##ID[] PROGMEM = FORMAT;
+#define LOG_MESSAGE_TABLE(ID, FORMAT) logFormat_##ID,
+
+enum LogMessageID : uint16_t
+{
+    LOG_MESSAGES (LOG_MESSAGE_ENUM) LOG_MESSAGE_COUNT
+};
+
+LOG_MESSAGES (LOG_MESSAGE_FORMAT)
+
+static const char* const logFormats[] PROGMEM = {LOG_MESSAGES (LOG_MESSAGE_TABLE)};
+
+enum LogLevel : uint8_t
+{
+    LOG_LEVEL_ERROR = 0,
+    LOG_LEVEL_WARNING,
+    LOG_LEVEL_INFO,
+    LOG_LEVEL_DEBUG
+};
+
+static const char logLevelNames[] = "EWID";
+
+struct LogRecord
+{
+    uint32_t nTick;
+    uint16_t nMessage;
+    uint8_t nLevel;
+    uint8_t nReserved;
+    uint32_t nArgs[3];
+};
+
+class BinaryLog
+{
+public:
+    BinaryLog () : pending ("log", 0, 1), nWritten (0), nRead (0), nDropped (0), nLevel (LOG_LEVEL_INFO), bFollow (false)
+    {
+    }
+
+    /// Stores a record, the only work done in the caller context
+    void Write (LogLevel nMsgLevel, LogMessageID nMessage, uint32_t nArg1 = 0, uint32_t nArg2 = 0, uint32_t nArg3 = 0)
+    {
+        if (nMsgLevel > nLevel) return;
+
+        LogRecord& record = ring[nWritten % LOG_RING_SIZE];
+
+        record.nTick = millis ();
+        record.nMessage = nMessage;
+        record.nLevel = nMsgLevel;
+        record.nArgs[0] = nArg1;
+        record.nArgs[1] = nArg2;
+        record.nArgs[2] = nArg3;
+
+        nWritten++;
+
+        pending.Give ();
+    }
+
+    void SetLevel (LogLevel nNewLevel)
+    {
+        Write (LOG_LEVEL_INFO, LOG_LEVEL_CHANGE, nLevel, nNewLevel);
+        nLevel = nNewLevel;
+    }
+
+    LogLevel GetLevel () const
+    {
+        return (LogLevel)nLevel;
+    }
+
+    /// Total records written since boot
+    uint32_t GetWritten () const
+    {
+        return nWritten;
+    }
+
+    /// Records overwritten before the logger thread got to them
+    uint32_t GetDropped () const
+    {
+        return nDropped;
+    }
+
+    /// Gets a record by its sequence number
+    /// @return NULL if already overwritten or not written yet
+    const LogRecord* Get (uint32_t nSequence) const
+    {
+        if (nSequence >= nWritten || (nWritten - nSequence) > LOG_RING_SIZE) return NULL;
+
+        return &ring[nSequence % LOG_RING_SIZE];
+    }
+
+    void Format (Stream& client, const LogRecord& record)
+    {
+        char szFormat[64];
+
+        if (record.nMessage >= LOG_MESSAGE_COUNT)
+        {
+            client.printf ("%10u [?] unknown message %u\r\n", record.nTick, record.nMessage);
+            return;
+        }
+
+        strncpy_P (szFormat, (const char*)pgm_read_ptr (&logFormats[record.nMessage]), sizeof (szFormat) - 1);
+        szFormat[sizeof (szFormat) - 1] = '\0';
+
+        client.printf ("%10u [%c] ", record.nTick, logLevelNames[record.nLevel & 0x3]);
+        client.printf (szFormat, record.nArgs[0], record.nArgs[1], record.nArgs[2]);
+        client.println ();
+    }
+
+    /// Formats the last nCount records
+    void Show (Stream& client, uint32_t nCount = LOG_RING_SIZE)
+    {
+        uint32_t nSequence = nWritten > nCount ? nWritten - nCount : 0;
+
+        if ((nWritten - nSequence) > LOG_RING_SIZE) nSequence = nWritten - LOG_RING_SIZE;
+
+        for (; nSequence < nWritten; nSequence++)
+        {
+            const LogRecord* pRecord = Get (nSequence);
+
+            if (pRecord != NULL)
+            {
+                Format (client, *pRecord);
+                CorePartition_Yield ();
+            }
+        }
+    }
+
+    /// Formats everything not yet drained, used by Thread_Logger
+    void Drain (Stream& client)
+    {
+        if ((nWritten - nRead) > LOG_RING_SIZE)
+        {
+            nDropped += (nWritten - nRead) - LOG_RING_SIZE;
+            nRead = nWritten - LOG_RING_SIZE;
+        }
+
+        while (nRead < nWritten)
+        {
+            LogRecord record = ring[nRead % LOG_RING_SIZE];
+
+            nRead++;
+
+            if (bFollow) Format (client, record);
+
+            CorePartition_Yield ();
+        }
+    }
+
+    void SetFollow (bool bState)
+    {
+        bFollow = bState;
+    }
+
+    bool IsFollowing () const
+    {
+        return bFollow;
+    }
+
+    /// Parks the logger until the next write
+    void WaitPending ()
+    {
+        pending.Take ();
+    }
+
+private:
+    SyncSemaphore pending;
+    LogRecord ring[LOG_RING_SIZE];
+    volatile uint32_t nWritten;
+    uint32_t nRead;
+    uint32_t nDropped;
+    uint8_t nLevel;
+    bool bFollow;
+};
+
+BinaryLog binaryLog;
+
+#define LOG_ERROR(...) binaryLog.Write (LOG_LEVEL_ERROR, __VA_ARGS__)
+#define LOG_WARNING(...) binaryLog.Write (LOG_LEVEL_WARNING, __VA_ARGS__)
+#define LOG_INFO(...) binaryLog.Write (LOG_LEVEL_INFO, __VA_ARGS__)
+#define LOG_DEBUG(...) binaryLog.Write (LOG_LEVEL_DEBUG, __VA_ARGS__)
+
+/// Low priority formatting thread, only prints when following
+void Thread_Logger (void* pValue)
+{
+    Stream& client = *((Stream*)pValue);
+
+    while (true)
+    {
+        binaryLog.Drain (client);
+        binaryLog.WaitPending ();
+    }
+}
+
+#endif
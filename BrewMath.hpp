@@ -0,0 +1,338 @@
+///
+/// @author   GUSTAVO CAMPOS
+/// @author   GUSTAVO CAMPOS
+/// @date   28/05/2019 19:44
+/// @version  <#version#>
+///
+/// @copyright  (c) GUSTAVO CAMPOS, 2019
+/// @copyright  Licence
+///
+/// @see    ReadMe.txt for references
+///
+//               GNU GENERAL PUBLIC LICENSE
+//                Version 3, 29 June 2007
+//
+// Copyright (C) 2007 Free Software Foundation, Inc. <https://fsf.org/>
+// Everyone is permitted to copy and distribute verbatim copies
+// of this license document, but changing it is not allowed.
+//
+// Preamble
+//
+// The GNU General Public License is a free, copyleft license for
+// software and other kinds of works.
+//
+// The licenses for most software and other practical works are designed
+// to take away your freedom to share and change the works.  By contrast,
+// the GNU General Public License is intended to guarantee your freedom to
+// share and change all versions of a program--to make sure it remains free
+// software for all its users.  We, the Free Software Foundation, use the
+// GNU General Public License for most of our software; it applies also to
+// any other work released this way by its authors.  You can apply it to
+// your programs, too.
+//
+// See LICENSE file for the complete information
+
+#ifndef BREW_MATH_HPP
+#define BREW_MATH_HPP
+
+#include <math.h>
+#include <stdint.h>
+
+#include <avr/pgmspace.h>
+
+#include "FixedPoint.hpp"
+
+/// Brewing calculations without floating point at run time
+///
+/// Bitterness (Tinseth), colour (Morey), water density and gravity
+/// conversions need exp, log and pow, each a soft-float library call
+/// of tens of microseconds on the ESP8266. Here every nonlinear curve
+/// is a table of Q16.16 samples on a uniform grid, filled by the
+/// compiler: BrewConst has constexpr exp and log (series after range
+/// reduction, double precision), BrewTable expands one sample per grid
+/// point into a PROGMEM array. A lookup is a shift, a mask, two flash
+/// reads and one multiply; outside the grid the curve is clamped.
+///
+/// Steps are powers of two in Q16.16 so no division is needed. The
+/// error bounds next to every curve are the largest differences to
+/// the double reference (BrewReference) over a dense sweep of the
+/// grid, quantization included; host/BrewMath.cpp measures them and
+/// fails when one is exceeded.
+
+namespace BrewConst
+{
+constexpr double nLn2 = 0.69314718055994531;
+
+constexpr double Square (double nValue)
+{
+    return nValue * nValue;
+}
+
+/// Taylor series, converges to double precision for |x| <= 1/16
+constexpr double ExpSeries (double nValue, double nTerm, int nOrder)
+{
+    return nOrder > 16 ? nTerm : nTerm + ExpSeries (nValue, nTerm * nValue / nOrder, nOrder + 1);
+}
+
+/// exp (x) = exp (x / 2)^2 until |x| <= 1/16
+constexpr double Exp (double nValue)
+{
+    return nValue > 0.0625 || nValue < -0.0625 ? Square (Exp (nValue / 2)) : ExpSeries (nValue, 1, 1);
+}
+
+/// 2 atanh (z), z = (x - 1) / (x + 1) is below 1/3 for x in [1, 2]
+constexpr double AtanhSeries (double nSquare, double nPower, int nOrder)
+{
+    return nOrder > 41 ? 0 : nPower / nOrder + AtanhSeries (nSquare, nPower * nSquare, nOrder + 2);
+}
+
+constexpr double LogReduced (double nRatio)
+{
+    return 2 * AtanhSeries (nRatio * nRatio, nRatio, 1);
+}
+
+/// Natural log of x > 0, reduced to [1, 2] by powers of two
+constexpr double Log (double nValue)
+{
+    return nValue > 2 ? Log (nValue / 2) + nLn2 : nValue < 1 ? Log (nValue * 2) - nLn2 : LogReduced ((nValue - 1) / (nValue + 1));
+}
+
+constexpr double Pow (double nBase, double nExponent)
+{
+    return nBase <= 0 ? 0 : Exp (nExponent * Log (nBase));
+}
+} // namespace BrewConst
+
+/// Curves: a constexpr Value, the grid start and its step as a power
+/// of two in Q16.16 (16 is 1 unit, 17 is 2), nIntervals steps long
+
+/// 0 to 128 minutes, step 0.5; max error 2.5e-5 (of 0.24)
+struct TimeFactorCurve
+{
+    static constexpr int32_t nMin = 0;
+    static constexpr uint32_t nShift = 15;
+    static constexpr uint32_t nIntervals = 256;
+
+    static constexpr double Value (double nMinutes)
+    {
+        return (1 - BrewConst::Exp (-0.04 * nMinutes)) / 4.15;
+    }
+};
+
+/// 0 to 128 points, step 0.5; max error 2.5e-5 (of 1.65)
+struct GravityFactorCurve
+{
+    static constexpr int32_t nMin = 0;
+    static constexpr uint32_t nShift = 15;
+    static constexpr uint32_t nIntervals = 256;
+
+    static constexpr double Value (double nPoints)
+    {
+        return 1.65 * BrewConst::Pow (0.000125, nPoints / 1000);
+    }
+};
+
+/// 0 to 512 MCU, step 1; max error 0.25 SRM below 4 MCU (the curve
+/// has no slope limit at 0), 0.008 SRM above
+struct SrmCurve
+{
+    static constexpr int32_t nMin = 0;
+    static constexpr uint32_t nShift = 16;
+    static constexpr uint32_t nIntervals = 512;
+
+    static constexpr double Value (double nMcu)
+    {
+        return 1.4922 * BrewConst::Pow (nMcu, 0.6859);
+    }
+};
+
+/// Kell (1975), kg/L, 0 to 128 C, step 1; max error 2e-5 kg/L
+struct WaterDensityCurve
+{
+    static constexpr int32_t nMin = 0;
+    static constexpr uint32_t nShift = 16;
+    static constexpr uint32_t nIntervals = 128;
+
+    static constexpr double Value (double t)
+    {
+        return (999.83952 + 16.945176 * t - 7.9870401e-3 * t * t - 46.170461e-6 * t * t * t + 105.56302e-9 * t * t * t * t - 280.54253e-12 * t * t * t * t * t) / (1 + 16.879850e-3 * t) / 1000;
+    }
+};
+
+/// Degrees Plato from gravity points (1.050 is 50), 0 to 128, step 2;
+/// max error 3e-4 P
+struct PlatoCurve
+{
+    static constexpr int32_t nMin = 0;
+    static constexpr uint32_t nShift = 17;
+    static constexpr uint32_t nIntervals = 64;
+
+    static constexpr double Value (double nPoints)
+    {
+        return -616.868 + 1111.14 * (1 + nPoints / 1000) - 630.272 * BrewConst::Square (1 + nPoints / 1000) + 135.997 * BrewConst::Square (1 + nPoints / 1000) * (1 + nPoints / 1000);
+    }
+};
+
+/// The curves in double with the C library, the reference the host
+/// compares the tables against; the polynomial ones share the
+/// expression and only test the table
+namespace BrewReference
+{
+/// Tinseth boil time factor, minutes in the boil
+inline double TimeFactor (double nMinutes)
+{
+    return (1 - exp (-0.04 * nMinutes)) / 4.15;
+}
+
+/// Tinseth bigness factor, wort gravity in points (1.050 is 50)
+inline double GravityFactor (double nPoints)
+{
+    return 1.65 * pow (0.000125, nPoints / 1000);
+}
+
+/// Morey, malt colour units (lb * Lovibond / US gal) to SRM
+inline double Srm (double nMcu)
+{
+    return nMcu <= 0 ? 0 : 1.4922 * pow (nMcu, 0.6859);
+}
+
+inline double WaterDensity (double nCelsius)
+{
+    return WaterDensityCurve::Value (nCelsius);
+}
+
+inline double Plato (double nPoints)
+{
+    return PlatoCurve::Value (nPoints);
+}
+} // namespace BrewReference
+
+/// Index packs for the table expansion, C++11 has no
+/// std::integer_sequence
+template <uint32_t... nIndex>
+struct BrewIndices
+{
+};
+
+template <uint32_t nCount, uint32_t... nIndex>
+struct BrewMakeIndices : BrewMakeIndices<nCount - 1, nCount - 1, nIndex...>
+{
+};
+
+template <uint32_t... nIndex>
+struct BrewMakeIndices<0, nIndex...>
+{
+    typedef BrewIndices<nIndex...> Type;
+};
+
+template <typename Curve, typename Indices>
+struct BrewTableData;
+
+template <typename Curve, uint32_t... nIndex>
+struct BrewTableData<Curve, BrewIndices<nIndex...>>
+{
+    /// Q16.16 raw sample at grid point nPoint
+    static constexpr int32_t Sample (uint32_t nPoint)
+    {
+        return Fixed (Curve::Value (Curve::nMin + (double)nPoint * (1 << Curve::nShift) / Fixed::nOne)).Raw ();
+    }
+
+    static const int32_t samples[sizeof... (nIndex)];
+};
+
+template <typename Curve, uint32_t... nIndex>
+const int32_t BrewTableData<Curve, BrewIndices<nIndex...>>::samples[sizeof... (nIndex)] PROGMEM = {BrewTableData<Curve, BrewIndices<nIndex...>>::Sample (nIndex)...};
+
+/// Linear interpolation over a curve table in flash
+template <typename Curve>
+class BrewTable
+{
+public:
+    typedef BrewTableData<Curve, typename BrewMakeIndices<Curve::nIntervals + 1>::Type> Data;
+
+    static Fixed Lookup (Fixed nValue)
+    {
+        int32_t nOffset = nValue.Raw () - Fixed (Curve::nMin).Raw ();
+
+        if (nOffset <= 0) return Fixed::FromRaw (Sample (0));
+
+        uint32_t nIndex = (uint32_t)nOffset >> Curve::nShift;
+
+        if (nIndex >= Curve::nIntervals) return Fixed::FromRaw (Sample (Curve::nIntervals));
+
+        int32_t nLow = Sample (nIndex);
+        int32_t nHigh = Sample (nIndex + 1);
+        int64_t nFraction = (uint32_t)nOffset & ((1UL << Curve::nShift) - 1);
+
+        return Fixed::FromRaw (nLow + (int32_t)(((nHigh - nLow) * nFraction + (1LL << (Curve::nShift - 1))) >> Curve::nShift));
+    }
+
+    static constexpr uint32_t GetSize ()
+    {
+        return sizeof (Data::samples);
+    }
+
+private:
+    static int32_t Sample (uint32_t nIndex)
+    {
+        return (int32_t)pgm_read_dword (&Data::samples[nIndex]);
+    }
+};
+
+// Evaluated by the compiler like the tables, against published values
+static_assert (TimeFactorCurve::Value (60) > 0.2190 && TimeFactorCurve::Value (60) < 0.2192, "Tinseth time factor at 60 minutes is 0.2191");
+static_assert (WaterDensityCurve::Value (20) > 0.99820 && WaterDensityCurve::Value (20) < 0.99822, "Water density at 20 C is 0.99821 kg/L");
+
+/// Tinseth utilisation, minutes in the boil and wort gravity points
+inline Fixed BrewMath_Utilisation (Fixed nMinutes, Fixed nPoints)
+{
+    return BrewTable<TimeFactorCurve>::Lookup (nMinutes) * BrewTable<GravityFactorCurve>::Lookup (nPoints);
+}
+
+/// IBU (mg/L of iso-alpha acids) of one hop addition: alpha acids in
+/// %, grams, minutes in the boil, wort litres and gravity points; the
+/// utilisation is good to 2.5e-5, within 0.15 IBU up to 30 g/L of 20%
+/// hops
+inline Fixed BrewMath_Ibu (Fixed nAlpha, Fixed nGrams, Fixed nMinutes, Fixed nLitres, Fixed nPoints)
+{
+    if (nLitres < Fixed (1)) nLitres = Fixed (1);
+
+    // Ordered to stay in range up to 1 kg of 30% hops
+    return BrewMath_Utilisation (nMinutes, nPoints) * nGrams / nLitres * nAlpha * Fixed (10);
+}
+
+/// Morey SRM of a grain bill: kg, average colour in Lovibond, litres;
+/// within 0.2 SRM, clamped above 512 MCU (about 120 SRM)
+inline Fixed BrewMath_Srm (Fixed nKg, Fixed nLovibond, Fixed nLitres)
+{
+    if (nLitres < Fixed (1)) nLitres = Fixed (1);
+
+    // lb / US gal from kg / L
+    return BrewTable<SrmCurve>::Lookup (nKg * nLovibond / nLitres * Fixed (8.3454));
+}
+
+/// kg/L at nCelsius
+inline Fixed BrewMath_WaterDensity (Fixed nCelsius)
+{
+    return BrewTable<WaterDensityCurve>::Lookup (nCelsius);
+}
+
+/// Volume the wort has once cooled to 20 C
+inline Fixed BrewMath_ColdVolume (Fixed nLitres, Fixed nCelsius)
+{
+    return nLitres * BrewMath_WaterDensity (nCelsius) / BrewMath_WaterDensity (Fixed (20));
+}
+
+/// Hydrometer reading in points taken at nCelsius, for an instrument
+/// calibrated at nCalibration; hot wort reads low
+inline Fixed BrewMath_CorrectGravity (Fixed nPoints, Fixed nCelsius, Fixed nCalibration)
+{
+    return (nPoints + Fixed (1000)) * BrewMath_WaterDensity (nCalibration) / BrewMath_WaterDensity (nCelsius) - Fixed (1000);
+}
+
+inline Fixed BrewMath_Plato (Fixed nPoints)
+{
+    return BrewTable<PlatoCurve>::Lookup (nPoints);
+}
+
+#endif
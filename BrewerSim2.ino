@@ -60,6 +60,45 @@ void setup ()
     assert (CorePartition_SetStackOverflowHandler (StackOverflowHandler));
 
     CorePartition_CreateThread (Thread_Serial, NULL, 256, 10);
+
+    CorePartition_CreateThread (Thread_Logger, &Serial, 384, 200);
+
+    CorePartition_CreateThread (Thread_Simulation, NULL, 512, 50);
+
+    CorePartition_CreateThread (Thread_Control, NULL, 256, 0);
+
+    CorePartition_CreateThread (Thread_Sensors, NULL, 256, 20);
+
+    CorePartition_CreateThread (Thread_FlashLog, NULL, 384, 200);
+
+    CorePartition_CreateThread (Thread_Matrix, NULL, 256, 20);
+
+    CorePartition_CreateThread (Thread_Ticker, NULL, 256, 0);
+
+    CorePartition_CreateThread (Thread_EPaper, NULL, 512, 100);
+
+    CorePartition_CreateThread (Thread_Checkpoint, NULL, 384, 100);
+
+    CorePartition_CreateThread (Thread_Recorder, NULL, 384, 50);
+
+    CorePartition_CreateThread (Thread_Script, NULL, 256, 0);
+
+    CorePartition_CreateThread (Thread_Alarm, NULL, 384, 0);
+
+    LOG_INFO (LOG_BOOT, CorePartition_GetMaxNumberOfThreads ());
+
+    if (postMortem.Load ())
+    {
+        LOG_WARNING (LOG_POSTMORTEM_FOUND, postMortem.GetCause (), postMortem.GetThreadID ());
+    }
+
+    // Before any thread runs, a reboot resumes where the plant was
+    if (checkpoint.Restore ())
+    {
+        LOG_INFO (LOG_CHECKPOINT_RESTORED, checkpoint.GetSequence (), checkpoint.GetRestored (), simulation.GetTime ());
+    }
+
+    alarms.Begin ();
 }
 
 /// Espcializing CorePartition Tick as Milleseconds
@@ -72,12 +111,21 @@ uint32_t CorePartition_GetCurrentTick ()
 /// @param nSleepTime How log the sleep will lest
 void CorePartition_SleepTicks (uint32_t nSleepTime)
 {
-    delay (nSleepTime);
+    // Idle time is free to sample the heap low-water mark
+    heapMonitor.Sample ();
+
+    // Timed waits end on time even with every thread parked
+    delay (Sync_Idle (nSleepTime));
 }
 
 /// Stack overflow Handler
 void StackOverflowHandler ()
 {
+    LOG_ERROR (LOG_STACK_OVERFLOW, CorePartition_GetID ());
+
+    postMortem.Capture (POSTMORTEM_STACK_OVERFLOW, CorePartition_GetID ());
+
+    // Printed directly, Thread_Logger never runs again to expand the record
     while (!Serial)
         ;
 
@@ -0,0 +1,624 @@
+///
+/// @author   GUSTAVO CAMPOS
+/// @author   GUSTAVO CAMPOS
+/// @date   28/05/2019 19:44
+/// @version  <#version#>
+///
+/// @copyright  (c) GUSTAVO CAMPOS, 2019
+/// @copyright  Licence
+///
+/// @see    ReadMe.txt for references
+///
+//               GNU GENERAL PUBLIC LICENSE
+//                Version 3, 29 June 2007
+//
+// Copyright (C) 2007 Free Software Foundation, Inc. <https://fsf.org/>
+// Everyone is permitted to copy and distribute verbatim copies
+// of this license document, but changing it is not allowed.
+//
+// Preamble
+//
+// The GNU General Public License is a free, copyleft license for
+// software and other kinds of works.
+//
+// The licenses for most software and other practical works are designed
+// to take away your freedom to share and change the works.  By contrast,
+// the GNU General Public License is intended to guarantee your freedom to
+// share and change all versions of a program--to make sure it remains free
+// software for all its users.  We, the Free Software Foundation, use the
+// GNU General Public License for most of our software; it applies also to
+// any other work released this way by its authors.  You can apply it to
+// your programs, too.
+//
+// See LICENSE file for the complete information
+
+#ifndef CHECKPOINT_HPP
+#define CHECKPOINT_HPP
+
+#include "Arduino.h"
+#include "CorePartition.h"
+
+#include <LittleFS.h>
+
+#include "Encoding.hpp"
+#include "BinaryLog.hpp"
+#include "Simulation.hpp"
+#include "Controller.hpp"
+#include "FlashLogger.hpp"
+
+/// Process state checkpoints on flash
+///
+/// The simulation, the event queue, the fermentation, the control
+/// loops, the plant graph and the flash log records not yet written
+/// are captured in one RAM snapshot: a header and a list of sections,
+/// each section the fields its owner visits in Checkpoint (archive),
+/// so saving and restoring share one field list per class. Capture
+/// runs in one slice, nothing yields in between, so the snapshot is
+/// consistent.
+///
+/// Thread_Checkpoint then writes it in chunks, yielding between them,
+/// alternately to two slot files. The slot being written is the older
+/// one, a reset in the middle leaves the other slot intact and the
+/// torn one fails its CRC. At boot Restore picks the valid slot with
+/// the highest sequence number and applies it before any thread runs.
+///
+/// Any change to a visited field list must bump CHECKPOINT_VERSION;
+/// a section whose size does not match the running firmware (build
+/// options changed) is skipped rather than half applied.
+
+#define CHECKPOINT_MAGIC 0x54504B43 // "CKPT"
+#define CHECKPOINT_VERSION 3
+
+#define CHECKPOINT_DIR "/ckpt"
+#define CHECKPOINT_SLOTS 2
+
+#ifndef CHECKPOINT_SIZE
+#define CHECKPOINT_SIZE 2048
+#endif
+
+/// Bytes written per slice
+#ifndef CHECKPOINT_CHUNK
+#define CHECKPOINT_CHUNK 256
+#endif
+
+#ifndef CHECKPOINT_INTERVAL_MS
+#define CHECKPOINT_INTERVAL_MS 10000
+#endif
+
+enum CheckpointSection : uint16_t
+{
+    CHECKPOINT_SIMULATION = 1, // vessels, clock, pacing and mode
+    CHECKPOINT_EVENTS,         // event queue and thermostats
+    CHECKPOINT_FERMENTATION,   // kinetics and its coupling clock
+    CHECKPOINT_CONTROL,        // every control loop
+    CHECKPOINT_PLANT,          // pipes, pumps and valves
+    CHECKPOINT_HISTORY,        // flash log page not yet on flash
+    CHECKPOINT_SECTION_END
+};
+
+struct CheckpointHeader
+{
+    uint32_t nMagic;
+    uint16_t nVersion;
+    uint16_t nSections;
+    uint32_t nSize;     // whole snapshot
+    uint32_t nSequence; // the highest valid one is restored
+    uint32_t nTime;     // simulated seconds at capture
+    uint32_t nCrc;      // whole snapshot with nCrc = 0
+};
+
+struct CheckpointSectionHeader
+{
+    uint16_t nSection;
+    uint16_t nSize; // payload after this header
+};
+
+/// Archive that appends the visited fields to a buffer
+class CheckpointWriter
+{
+public:
+    CheckpointWriter (uint8_t* pBuffer, uint32_t nCapacity) : pBuffer (pBuffer), nCapacity (nCapacity), nSize (0), bOverflow (false)
+    {
+    }
+
+    template <typename Type>
+    void operator() (const Type& value)
+    {
+        if (nSize + sizeof (Type) > nCapacity)
+        {
+            bOverflow = true;
+            return;
+        }
+
+        memcpy (pBuffer + nSize, &value, sizeof (Type));
+        nSize += sizeof (Type);
+    }
+
+    static bool IsReading ()
+    {
+        return false;
+    }
+
+    uint32_t GetSize () const
+    {
+        return nSize;
+    }
+
+    bool IsOverflow () const
+    {
+        return bOverflow;
+    }
+
+private:
+    uint8_t* pBuffer;
+    uint32_t nCapacity;
+    uint32_t nSize;
+    bool bOverflow;
+};
+
+/// Archive that only counts, the size a section has in this firmware
+class CheckpointSizer
+{
+public:
+    CheckpointSizer () : nSize (0)
+    {
+    }
+
+    template <typename Type>
+    void operator() (const Type& value)
+    {
+        nSize += sizeof (Type);
+    }
+
+    static bool IsReading ()
+    {
+        return false;
+    }
+
+    uint32_t GetSize () const
+    {
+        return nSize;
+    }
+
+private:
+    uint32_t nSize;
+};
+
+/// Archive that copies the visited fields back from a buffer
+class CheckpointReader
+{
+public:
+    CheckpointReader (const uint8_t* pBuffer) : pBuffer (pBuffer), nSize (0)
+    {
+    }
+
+    template <typename Type>
+    void operator() (Type& value)
+    {
+        memcpy (&value, pBuffer + nSize, sizeof (Type));
+        nSize += sizeof (Type);
+    }
+
+    static bool IsReading ()
+    {
+        return true;
+    }
+
+private:
+    const uint8_t* pBuffer;
+    uint32_t nSize;
+};
+
+/// The fields of one section, for any archive
+template <typename Archive>
+void Checkpoint_Visit (CheckpointSection nSection, Archive& archive)
+{
+    // Static, thread stacks are small
+    static FlashLogPage historyPage;
+
+    switch (nSection)
+    {
+        case CHECKPOINT_SIMULATION:
+            simulation.Checkpoint (archive);
+            archive (nSimulationSpeed);
+            archive (bSimulationEvents);
+            break;
+
+        case CHECKPOINT_EVENTS:
+            simulationEvents.Checkpoint (archive);
+            break;
+
+        case CHECKPOINT_FERMENTATION:
+            fermentation.Checkpoint (archive);
+            archive (nFermentationTime);
+            break;
+
+        case CHECKPOINT_CONTROL:
+            for (uint8_t nCount = 0; nCount < CONTROL_LOOPS; nCount++)
+            {
+                controlLoops[nCount].Checkpoint (archive);
+            }
+            break;
+
+        case CHECKPOINT_PLANT:
+            plant.Checkpoint (archive);
+            break;
+
+        case CHECKPOINT_HISTORY:
+            if (archive.IsReading () == false) flashLogger.GetSealedPage (historyPage);
+
+            archive (historyPage);
+
+            if (archive.IsReading ()) flashLogger.RestorePage (historyPage);
+            break;
+
+        default:
+            break;
+    }
+}
+
+/// Applies a list of sections (section header, payload, padding to
+/// 4 bytes), returns how many matched this firmware and were applied
+uint8_t Checkpoint_Apply (const uint8_t* pSections, uint32_t nSize)
+{
+    uint8_t nApplied = 0;
+
+    for (uint32_t nOffset = 0; nOffset + sizeof (CheckpointSectionHeader) <= nSize;)
+    {
+        const CheckpointSectionHeader& section = *(const CheckpointSectionHeader*)&pSections[nOffset];
+        CheckpointSizer sizer;
+
+        if (nOffset + sizeof (section) + section.nSize > nSize) break;
+
+        Checkpoint_Visit ((CheckpointSection)section.nSection, sizer);
+
+        if (section.nSection > 0 && section.nSection < CHECKPOINT_SECTION_END && sizer.GetSize () == section.nSize)
+        {
+            CheckpointReader reader (&pSections[nOffset + sizeof (section)]);
+
+            Checkpoint_Visit ((CheckpointSection)section.nSection, reader);
+            nApplied++;
+        }
+
+        nOffset += (sizeof (section) + section.nSize + 3) & ~3;
+    }
+
+    return nApplied;
+}
+
+class CheckpointStore
+{
+public:
+    CheckpointStore () : nSequence (0), nSize (0), nLastCrc (0), bEnabled (true), bRequested (false), bWriting (false), nWrites (0), nSkipped (0), nErrors (0), nCaptureUs (0), nWriteMs (0), nRestoreUs (0), nRestored (0)
+    {
+    }
+
+    /// Serializes every section into the RAM snapshot, false if it
+    /// does not fit CHECKPOINT_SIZE
+    bool Capture ()
+    {
+        uint32_t nStart = micros ();
+        CheckpointHeader& header = *(CheckpointHeader*)buffer;
+
+        // Zeroed so alignment padding never changes the CRC
+        memset (buffer, 0, sizeof (buffer));
+
+        nSize = sizeof (CheckpointHeader);
+        header.nSections = 0;
+
+        for (uint16_t nSection = CHECKPOINT_SIMULATION; nSection < CHECKPOINT_SECTION_END; nSection++)
+        {
+            CheckpointSectionHeader& section = *(CheckpointSectionHeader*)&buffer[nSize];
+            CheckpointWriter writer (&buffer[nSize + sizeof (section)], sizeof (buffer) - nSize - sizeof (section));
+
+            Checkpoint_Visit ((CheckpointSection)nSection, writer);
+
+            if (writer.IsOverflow () || writer.GetSize () > 0xFFFF)
+            {
+                nSize = 0;
+                return false;
+            }
+
+            section.nSection = nSection;
+            section.nSize = (uint16_t)writer.GetSize ();
+
+            // Sections stay 4 byte aligned
+            nSize += (sizeof (section) + section.nSize + 3) & ~3;
+            header.nSections++;
+        }
+
+        header.nMagic = CHECKPOINT_MAGIC;
+        header.nVersion = CHECKPOINT_VERSION;
+        header.nSize = nSize;
+        header.nSequence = nSequence + 1;
+        header.nTime = simulation.GetTime ();
+        header.nCrc = 0;
+        header.nCrc = Crc32 (buffer, nSize);
+
+        nCaptureUs = micros () - nStart;
+
+        return true;
+    }
+
+    /// Writes the captured snapshot to the older slot, yielding every
+    /// CHECKPOINT_CHUNK bytes; skipped when nothing changed
+    bool Write ()
+    {
+        const CheckpointHeader& header = *(const CheckpointHeader*)buffer;
+
+        if (nSize == 0) return false;
+
+        // Same state as the last write but for the sequence number
+        uint32_t nCrc = Crc32 (buffer + sizeof (header), nSize - sizeof (header));
+
+        if (nWrites > 0 && nCrc == nLastCrc)
+        {
+            nSkipped++;
+            return true;
+        }
+
+        uint32_t nStart = millis ();
+        char szPath[16];
+
+        LittleFS.mkdir (CHECKPOINT_DIR);
+        SlotPath (szPath, header.nSequence % CHECKPOINT_SLOTS);
+
+        File file = LittleFS.open (szPath, "w");
+        bool bWritten = (bool)file;
+
+        bWriting = true;
+
+        for (uint32_t nOffset = 0; bWritten && nOffset < nSize; nOffset += CHECKPOINT_CHUNK)
+        {
+            uint32_t nChunk = nSize - nOffset < CHECKPOINT_CHUNK ? nSize - nOffset : CHECKPOINT_CHUNK;
+
+            bWritten = file.write (&buffer[nOffset], nChunk) == nChunk;
+
+            CorePartition_Yield ();
+        }
+
+        if (file) file.close ();
+
+        bWriting = false;
+
+        if (bWritten == false)
+        {
+            nErrors++;
+            LOG_ERROR (LOG_CHECKPOINT_ERROR, header.nSequence % CHECKPOINT_SLOTS);
+
+            return false;
+        }
+
+        nSequence = header.nSequence;
+        nLastCrc = nCrc;
+        nWrites++;
+        nWriteMs = millis () - nStart;
+
+        return true;
+    }
+
+    /// Loads the newest valid slot and applies it, call before the
+    /// threads run; refused while Write is yielded between chunks, it
+    /// would load over the snapshot being written
+    bool Restore ()
+    {
+        uint32_t nStart = micros ();
+        uint8_t nTried = 0;
+
+        if (bWriting || LittleFS.begin () == false) return false;
+
+        // Newest first, a torn newest slot falls back to the other one
+        while (true)
+        {
+            int8_t nBest = -1;
+            uint32_t nBestSequence = 0;
+
+            for (uint8_t nSlot = 0; nSlot < CHECKPOINT_SLOTS; nSlot++)
+            {
+                CheckpointHeader header;
+
+                if ((nTried & (1 << nSlot)) == 0 && ReadSlot (nSlot, header) && (nBest < 0 || header.nSequence > nBestSequence))
+                {
+                    nBest = nSlot;
+                    nBestSequence = header.nSequence;
+                }
+            }
+
+            if (nBest < 0) return false;
+
+            nTried |= 1 << nBest;
+
+            if (Load (nBest)) break;
+        }
+
+        const CheckpointHeader& header = *(const CheckpointHeader*)buffer;
+
+        nRestored = Checkpoint_Apply (buffer + sizeof (header), header.nSize - sizeof (header));
+
+        // The next write goes to the other slot, torn or older
+        nSequence = header.nSequence;
+        nLastCrc = Crc32 (buffer + sizeof (header), header.nSize - sizeof (header));
+        nSize = 0;
+        nRestoreUs = micros () - nStart;
+
+        return true;
+    }
+
+    void Erase ()
+    {
+        char szPath[16];
+
+        for (uint8_t nSlot = 0; nSlot < CHECKPOINT_SLOTS; nSlot++)
+        {
+            SlotPath (szPath, nSlot);
+            LittleFS.remove (szPath);
+        }
+
+        nLastCrc = 0;
+        nWrites = 0;
+    }
+
+    void SetEnabled (bool bValue)
+    {
+        bEnabled = bValue;
+    }
+
+    bool IsEnabled () const
+    {
+        return bEnabled;
+    }
+
+    /// Asks the thread for a checkpoint now, enabled or not
+    void Request ()
+    {
+        bRequested = true;
+    }
+
+    bool TakeRequest ()
+    {
+        bool bValue = bRequested;
+
+        bRequested = false;
+
+        return bValue;
+    }
+
+    bool IsWriting () const
+    {
+        return bWriting;
+    }
+
+    uint32_t GetSequence () const
+    {
+        return nSequence;
+    }
+
+    uint8_t GetRestored () const
+    {
+        return nRestored;
+    }
+
+    void Show (Stream& client)
+    {
+        client.printf ("%-20s: [%s]\r\n", "Enabled", bEnabled ? "yes" : "no");
+        client.printf ("%-20s: [%u ms]\r\n", "Interval", CHECKPOINT_INTERVAL_MS);
+        client.printf ("%-20s: [%u]\r\n", "Sequence", nSequence);
+
+        for (uint8_t nSlot = 0; nSlot < CHECKPOINT_SLOTS; nSlot++)
+        {
+            CheckpointHeader header;
+            char szName[16];
+
+            snprintf (szName, sizeof (szName), "Slot %u", nSlot);
+
+            if (ReadSlot (nSlot, header))
+                client.printf ("%-20s: [sequence %u, %u bytes, time %us]\r\n", szName, header.nSequence, header.nSize, header.nTime);
+            else
+                client.printf ("%-20s: [empty or invalid]\r\n", szName);
+        }
+
+        client.printf ("%-20s: [%u]\r\n", "Writes", nWrites);
+        client.printf ("%-20s: [%u]\r\n", "Unchanged, skipped", nSkipped);
+        client.printf ("%-20s: [%u]\r\n", "Write errors", nErrors);
+        client.printf ("%-20s: [%u bytes of %u]\r\n", "Snapshot", nSize, CHECKPOINT_SIZE);
+        client.printf ("%-20s: [%u us / %u ms]\r\n", "Capture / write", nCaptureUs, nWriteMs);
+        client.printf ("%-20s: [%u sections, %u us]\r\n", "Restored", nRestored, nRestoreUs);
+    }
+
+private:
+    static void SlotPath (char* pszPath, uint8_t nSlot)
+    {
+        snprintf (pszPath, 16, CHECKPOINT_DIR "/%u", nSlot);
+    }
+
+    /// Header of a slot, only checks magic, version and size
+    static bool ReadSlot (uint8_t nSlot, CheckpointHeader& header)
+    {
+        char szPath[16];
+        SlotPath (szPath, nSlot);
+
+        File file = LittleFS.open (szPath, "r");
+
+        if (!file) return false;
+
+        bool bRead = file.read ((uint8_t*)&header, sizeof (header)) == sizeof (header) && file.size () >= header.nSize;
+
+        file.close ();
+
+        return bRead && header.nMagic == CHECKPOINT_MAGIC && header.nVersion == CHECKPOINT_VERSION && header.nSize >= sizeof (header) && header.nSize <= CHECKPOINT_SIZE;
+    }
+
+    /// Reads a whole slot into the buffer and checks its CRC
+    bool Load (uint8_t nSlot)
+    {
+        CheckpointHeader header;
+        char szPath[16];
+
+        if (ReadSlot (nSlot, header) == false) return false;
+
+        SlotPath (szPath, nSlot);
+
+        File file = LittleFS.open (szPath, "r");
+
+        if (!file) return false;
+
+        bool bRead = file.read (buffer, header.nSize) == header.nSize;
+
+        file.close ();
+
+        CheckpointHeader& loaded = *(CheckpointHeader*)buffer;
+        uint32_t nCrc = loaded.nCrc;
+
+        loaded.nCrc = 0;
+
+        bool bValid = bRead && Crc32 (buffer, header.nSize) == nCrc;
+
+        loaded.nCrc = nCrc;
+
+        return bValid;
+    }
+
+    uint8_t buffer[CHECKPOINT_SIZE] __attribute__ ((aligned (4)));
+
+    uint32_t nSequence;
+    uint32_t nSize;
+    uint32_t nLastCrc;
+    bool bEnabled;
+    bool bRequested;
+    bool bWriting;
+
+    uint32_t nWrites;
+    uint32_t nSkipped;
+    uint32_t nErrors;
+    uint32_t nCaptureUs;
+    uint32_t nWriteMs;
+    uint32_t nRestoreUs;
+    uint8_t nRestored;
+};
+
+CheckpointStore checkpoint;
+
+/// Captures and writes every CHECKPOINT_INTERVAL_MS, or on request
+void Thread_Checkpoint (void* pValue)
+{
+    uint32_t nLast = millis ();
+
+    while (true)
+    {
+        bool bRequested = checkpoint.TakeRequest ();
+
+        if (bRequested || (checkpoint.IsEnabled () && millis () - nLast >= CHECKPOINT_INTERVAL_MS))
+        {
+            nLast = millis ();
+
+            if (checkpoint.Capture () == false)
+                LOG_ERROR (LOG_CHECKPOINT_OVERFLOW, CHECKPOINT_SIZE);
+            else
+                checkpoint.Write ();
+        }
+
+        CorePartition_Sleep (100);
+    }
+}
+
+#endif
@@ -46,6 +46,23 @@
 #include "CorePartition.h"
 #include "Util.hpp"
 #include "Terminal.hpp"
+#include "HeapMonitor.hpp"
+#include "MemoryPool.hpp"
+#include "Sync.hpp"
+#include "BinaryLog.hpp"
+#include "PostMortem.hpp"
+#include "Simulation.hpp"
+#include "Controller.hpp"
+#include "SensorPipeline.hpp"
+#include "FlashLogger.hpp"
+#include "Recipe.hpp"
+#include "MatrixDisplay.hpp"
+#include "MatrixTicker.hpp"
+#include "Dashboard.hpp"
+#include "Checkpoint.hpp"
+#include "Recorder.hpp"
+#include "Script.hpp"
+#include "Alarms.hpp"
 
 
 class TStream : public TerminalStream
@@ -73,6 +90,74 @@ public:
 
 TStream tstream = TStream (Serial);
 
+#ifndef COMMAND_ARGS
+#define COMMAND_ARGS 12
+#endif
+
+/// Command arguments split in place in a pool buffer, one copy of the
+/// line instead of a heap String per argument
+class CommandArgs
+{
+public:
+    /// @param nFirst words to skip, the command and its option
+    CommandArgs (const String& strCommandLine, uint8_t nFirst) : buffer (strCommandLine.length () + 1), nCount (0)
+    {
+        char* pszLine = buffer ();
+        uint8_t nWord = 0;
+
+        if (pszLine == NULL) return;
+
+        memcpy (pszLine, strCommandLine.c_str (), strCommandLine.length () + 1);
+
+        while (*pszLine != '\0' && nCount < COMMAND_ARGS)
+        {
+            while (isspace (*pszLine)) *pszLine++ = '\0';
+
+            if (*pszLine == '\0') break;
+
+            if (nWord++ >= nFirst) pszArgs[nCount++] = pszLine;
+
+            while (*pszLine != '\0' && isspace (*pszLine) == false) pszLine++;
+        }
+    }
+
+    /// @return "" past the last argument
+    const char* operator[] (uint8_t nIndex) const
+    {
+        return nIndex < nCount ? pszArgs[nIndex] : "";
+    }
+
+    uint8_t Count () const
+    {
+        return nCount;
+    }
+
+    bool Has (uint8_t nIndex) const
+    {
+        return nIndex < nCount;
+    }
+
+    bool Is (uint8_t nIndex, const char* pszValue) const
+    {
+        return strcmp ((*this)[nIndex], pszValue) == 0;
+    }
+
+    long Int (uint8_t nIndex) const
+    {
+        return atol ((*this)[nIndex]);
+    }
+
+    double Float (uint8_t nIndex) const
+    {
+        return atof ((*this)[nIndex]);
+    }
+
+private:
+    PoolBuffer buffer;
+    const char* pszArgs[COMMAND_ARGS];
+    uint8_t nCount;
+};
+
 class StatusCommand : public TerminalCommand
 {
 public:
@@ -101,10 +186,18 @@ public:
             }
             else if (strOption == "memory")
             {
-                client().print ("free heap: ");
-                client().print (system_get_free_heap_size () / 1024);
-                client().println ("Kb");
+                heapMonitor.Show (client());
+            }
+            else if (strOption == "pools")
+            {
+                memoryPools.Show (client());
             }
+#ifdef HEAP_TRACK_CALLSITES
+            else if (strOption == "allocations")
+            {
+                heapMonitor.ShowCallSites (client());
+            }
+#endif
             else if (strOption == "system")
             {
                 client().println ("ESP8266 System ------------------");
@@ -144,13 +237,1136 @@ public:
     void HelpMessage (TerminalStream& client)
     {
         client ().println ("Show status of the terminal");
-        client ().println ("\tUse:\nstatus thread|memory|system");   
+#ifdef HEAP_TRACK_CALLSITES
+        client ().println ("\tUse:\nstatus thread|memory|pools|allocations|system");
+#else
+        client ().println ("\tUse:\nstatus thread|memory|pools|system");
+#endif   
         client ().println ("");
     }
 };
 
 StatusCommand statusCommand;
 
+class LogCommand : public TerminalCommand
+{
+public:
+    LogCommand ()
+    {
+    }
+
+    bool Execute (Terminal& terminal, TerminalStream& client, const String& strCommandLine)
+    {
+        String strOption;
+        String strValue;
+
+        if (ParseOption (strCommandLine, 1, strOption, true) == 0)
+        {
+            HelpMessage (client);
+            return false;
+        }
+
+        ParseOption (strCommandLine, 2, strValue, true);
+
+        if (strOption == "show")
+        {
+            binaryLog.Show (client (), strValue.length () > 0 ? (uint32_t)strValue.toInt () : LOG_RING_SIZE);
+        }
+        else if (strOption == "level" && strValue.length () > 0)
+        {
+            binaryLog.SetLevel ((LogLevel)constrain (strValue.toInt (), LOG_LEVEL_ERROR, LOG_LEVEL_DEBUG));
+        }
+        else if (strOption == "follow")
+        {
+            binaryLog.SetFollow (strValue == "on");
+        }
+        else if (strOption == "stats")
+        {
+            client ().printf ("%-20s: [%u]\r\n", "Level", binaryLog.GetLevel ());
+            client ().printf ("%-20s: [%u]\r\n", "Written", binaryLog.GetWritten ());
+            client ().printf ("%-20s: [%u]\r\n", "Dropped", binaryLog.GetDropped ());
+            client ().printf ("%-20s: [%s]\r\n", "Follow", binaryLog.IsFollowing () ? "on" : "off");
+        }
+        else
+        {
+            client ().printf ("Error, invalid option: [%s]\n", strOption.c_str ());
+            HelpMessage (client);
+            return false;
+        }
+
+        return true;
+    }
+
+    void HelpMessage (TerminalStream& client)
+    {
+        client ().println ("Show and control the system log");
+        client ().println ("\tUse:\nlog show [count]|level 0-3|follow on|off|stats");
+        client ().println ("");
+    }
+};
+
+LogCommand logCommand;
+
+class PostMortemCommand : public TerminalCommand
+{
+public:
+    PostMortemCommand ()
+    {
+    }
+
+    bool Execute (Terminal& terminal, TerminalStream& client, const String& strCommandLine)
+    {
+        String strOption;
+
+        if (ParseOption (strCommandLine, 1, strOption, true) == 0 || strOption == "show")
+        {
+            postMortem.Show (client ());
+        }
+        else if (strOption == "clear")
+        {
+            postMortem.Clear ();
+        }
+        else
+        {
+            client ().printf ("Error, invalid option: [%s]\n", strOption.c_str ());
+            HelpMessage (client);
+            return false;
+        }
+
+        return true;
+    }
+
+    void HelpMessage (TerminalStream& client)
+    {
+        client ().println ("Show the crash snapshot left by the previous run");
+        client ().println ("\tUse:\npostmortem [show|clear]");
+        client ().println ("");
+    }
+};
+
+PostMortemCommand postMortemCommand;
+
+class SimulationCommand : public TerminalCommand
+{
+public:
+    SimulationCommand ()
+    {
+    }
+
+    bool Execute (Terminal& terminal, TerminalStream& client, const String& strCommandLine)
+    {
+        String strOption;
+
+        if (ParseOption (strCommandLine, 1, strOption, true) == 0 || strOption == "status")
+        {
+            Simulation_Show (client ());
+            return true;
+        }
+
+        // Before it runs, a replay applies it to the same state
+        recorder.Command (RECORD_SOURCE_SIM, strCommandLine);
+
+        CommandArgs args (strCommandLine, 2);
+        uint8_t nVessel = (uint8_t)args.Int (0);
+
+        if (strOption == "reset")
+        {
+            simulation.Reset ();
+            simulationEvents.Clear ();
+            fermentation.Reset ();
+            plant.Stop ();
+            Script_StopAll ();
+        }
+        else if (strOption == "pitch" && args.Has (2))
+        {
+            fermentation.Pitch (Fixed (args.Float (0)), Fixed (args.Float (1) / 100.0), Fixed (args.Float (2)));
+            nFermentationTime = simulation.GetTime ();
+        }
+        else if (strOption == "mode" && (args.Is (0, "step") || args.Is (0, "event")))
+        {
+            bSimulationEvents = args.Is (0, "event");
+        }
+        else if (strOption == "events")
+        {
+            ShowEvents (client ());
+        }
+        else if (strOption == "in" && args.Has (3))
+        {
+            return Schedule (client, args);
+        }
+        else if (strOption == "speed" && args.Has (0))
+        {
+            nSimulationSpeed = args.Is (0, "max") ? 0 : (uint32_t)args.Int (0);
+        }
+        else if (strOption == "heater" && args.Has (1))
+        {
+            simulation.SetDuty (nVessel, Fixed (args.Float (1) / 100.0));
+        }
+        else if (strOption == "fill" && args.Has (2))
+        {
+            VesselReset (simulation.Vessel (nVessel), simulation.Params (nVessel), Fixed (args.Float (1)), Fixed (args.Float (2)));
+        }
+        else if (strOption == "add" && args.Has (3))
+        {
+            simulation.Add (nVessel, ParseIngredient (args[1]), Fixed (args.Float (2)), Fixed (args.Float (3)));
+        }
+        else
+        {
+            client ().printf ("Error, invalid option: [%s]\n", strOption.c_str ());
+            HelpMessage (client);
+            return false;
+        }
+
+        return true;
+    }
+
+    void HelpMessage (TerminalStream& client)
+    {
+        client ().println ("Brewing simulation, vessels: 0 mash, 1 boil, 2 fermenter");
+        client ().println ("\tUse:\nsim [status]|reset|speed <n|max>|heater <vessel> <0-100%>|fill <vessel> <litres> <C>|add <vessel> water|grain|hops <kg> <C>");
+        client ().println ("sim events|mode step|event|pitch <gravity points> <attenuation %> <yeast g/L>");
+        client ().println ("sim in <seconds> duty <vessel> <0-100%>|power <vessel> <kW>|setpoint <vessel> <C> <band K, 0 off>|add <vessel> water|grain|hops <kg> <C>");
+        client ().println ("");
+    }
+
+private:
+    static IngredientType ParseIngredient (const char* pszName)
+    {
+        return strcmp (pszName, "water") == 0 ? INGREDIENT_WATER : strcmp (pszName, "grain") == 0 ? INGREDIENT_GRAIN : strcmp (pszName, "hops") == 0 ? INGREDIENT_HOPS : INGREDIENT_OTHER;
+    }
+
+    /// sim in <seconds> <type> <vessel> <values>, relative to now
+    bool Schedule (TerminalStream& client, const CommandArgs& args)
+    {
+        uint32_t nTime = simulation.GetTime () + (uint32_t)args.Int (0);
+        uint8_t nVessel = (uint8_t)args.Int (2);
+        bool bQueued = false;
+
+        if (args.Is (1, "duty"))
+        {
+            bQueued = simulationEvents.Schedule (nTime, SIMULATION_EVENT_DUTY, nVessel, Fixed (args.Float (3) / 100.0));
+        }
+        else if (args.Is (1, "power"))
+        {
+            bQueued = simulationEvents.Schedule (nTime, SIMULATION_EVENT_POWER, nVessel, Fixed (args.Float (3)));
+        }
+        else if (args.Is (1, "setpoint") && args.Has (4))
+        {
+            bQueued = simulationEvents.Schedule (nTime, SIMULATION_EVENT_SETPOINT, nVessel, Fixed (args.Float (3)), Fixed (args.Float (4)));
+        }
+        else if (args.Is (1, "add") && args.Has (5))
+        {
+            bQueued = simulationEvents.Schedule (nTime, SIMULATION_EVENT_ADD, nVessel, Fixed (args.Float (4)), Fixed (args.Float (5)), ParseIngredient (args[3]));
+        }
+        else
+        {
+            client ().printf ("Error, invalid event: [%s]\n", args[1]);
+            HelpMessage (client);
+            return false;
+        }
+
+        if (bQueued == false)
+        {
+            client ().printf ("Error, event queue full (%u)\n", SIMULATION_EVENTS);
+            return false;
+        }
+
+        return true;
+    }
+
+    static void ShowEvents (Stream& client)
+    {
+        static const char* const typeNames[] = {"duty", "power", "setpoint", "add"};
+
+        client.println (F ("Time s\tVessel\tEvent\t\tValue\tArgument"));
+
+        for (uint8_t nCount = 0; nCount < simulationEvents.GetCount (); nCount++)
+        {
+            const SimulationEvent<Fixed>& event = simulationEvents.Event (nCount);
+
+            client.printf ("%u\t%u\t%-8s\t", event.nTime, event.nVessel, typeNames[event.nType % 4]);
+            PrintCenti (client, event.nValue);
+            client.print (F ("\t"));
+            PrintCenti (client, event.nArgument);
+            client.println ();
+        }
+
+        for (uint8_t nCount = 0; nCount < SIMULATION_VESSELS; nCount++)
+        {
+            const SimulationThermostat<Fixed>& thermostat = simulationEvents.Thermostat (nCount);
+
+            if (thermostat.bEnabled == false) continue;
+
+            client.printf ("Thermostat %u: ", nCount);
+            PrintCenti (client, thermostat.nSetpoint);
+            client.print (F (" +/- "));
+            PrintCenti (client, thermostat.nBand);
+            client.print (F (" C, next crossing: "));
+
+            if (thermostat.nCrossing == SIMULATION_NEVER)
+                client.println (F ("none"));
+            else
+                client.printf ("%us\r\n", thermostat.nCrossing);
+        }
+    }
+};
+
+SimulationCommand simulationCommand;
+
+class ControlCommand : public TerminalCommand
+{
+public:
+    ControlCommand ()
+    {
+    }
+
+    bool Execute (Terminal& terminal, TerminalStream& client, const String& strCommandLine)
+    {
+        String strOption;
+
+        if (ParseOption (strCommandLine, 1, strOption, true) == 0 || strOption == "status")
+        {
+            Control_Show (client ());
+            return true;
+        }
+
+        if (strOption == "reset")
+        {
+            controlTimer.ResetStats ();
+            return true;
+        }
+
+        recorder.Command (RECORD_SOURCE_CONTROL, strCommandLine);
+
+        CommandArgs args (strCommandLine, 2);
+        ControlLoop& loop = controlLoops[(uint8_t)strOption.toInt () % CONTROL_LOOPS];
+
+        if (args.Is (0, "off"))
+        {
+            loop.SetMode (CONTROL_OFF);
+        }
+        else if (args.Is (0, "bangbang"))
+        {
+            loop.SetMode (CONTROL_BANGBANG);
+        }
+        else if (args.Is (0, "pid"))
+        {
+            loop.SetMode (CONTROL_PID);
+        }
+        else if (args.Is (0, "autotune"))
+        {
+            loop.SetMode (CONTROL_AUTOTUNE);
+        }
+        else if (args.Is (0, "setpoint") && args.Has (1))
+        {
+            loop.SetSetpoint (Fixed (args.Float (1)));
+        }
+        else if (args.Is (0, "tune") && args.Has (3))
+        {
+            loop.pid.SetTuning (Fixed (args.Float (1)), Fixed (args.Float (2)), Fixed (args.Float (3)));
+        }
+        else
+        {
+            client ().printf ("Error, invalid option: [%s]\n", strOption.c_str ());
+            HelpMessage (client);
+            return false;
+        }
+
+        return true;
+    }
+
+    void HelpMessage (TerminalStream& client)
+    {
+        client ().println ("Temperature control loops: 0 mash, 1 boil");
+        client ().println ("\tUse:\ncontrol [status]|reset|<loop> off|bangbang|pid|autotune|setpoint <C>|tune <Kp> <Ti s> <Td s>");
+        client ().println ("");
+    }
+};
+
+ControlCommand controlCommand;
+
+class PlantCommand : public TerminalCommand
+{
+public:
+    PlantCommand ()
+    {
+    }
+
+    bool Execute (Terminal& terminal, TerminalStream& client, const String& strCommandLine)
+    {
+        String strOption;
+
+        if (ParseOption (strCommandLine, 1, strOption, true) == 0 || strOption == "status")
+        {
+            Plant_Show (client ());
+            return true;
+        }
+
+        recorder.Command (RECORD_SOURCE_PLANT, strCommandLine);
+
+        CommandArgs args (strCommandLine, 2);
+        uint8_t nIndex = (uint8_t)args.Int (0);
+        bool bDone = true;
+
+        if (strOption == "valve" && args.Has (1))
+        {
+            bDone = plant.SetValve (nIndex, Fixed (args.Float (1) / 100.0));
+        }
+        else if (strOption == "pump" && args.Has (1))
+        {
+            bDone = plant.SetPump (nIndex, Fixed (args.Float (1) / 100.0));
+        }
+        else if (strOption == "stop")
+        {
+            plant.Stop ();
+        }
+        else if (strOption == "vessel" && args.Has (2))
+        {
+            bDone = plant.SetVessel (nIndex, Fixed (args.Float (1)), Fixed (args.Float (2)));
+        }
+        else if (strOption == "junction" && args.Has (0))
+        {
+            uint8_t nNode = plant.AddJunction (Fixed (args.Float (0)), Fixed (args.Float (1)));
+
+            if ((bDone = nNode != PLANT_NONE)) client ().printf ("Junction: node %u\r\n", nNode);
+        }
+        else if (strOption == "link" && args.Has (2))
+        {
+            uint8_t nLink = plant.AddLink (nIndex, (uint8_t)args.Int (1), Fixed (args.Float (2)), Fixed (args.Float (3)));
+
+            if ((bDone = nLink != PLANT_NONE)) client ().printf ("Link: %u\r\n", nLink);
+        }
+        else if (strOption == "clear")
+        {
+            plant.Clear ();
+        }
+        else if (strOption == "default")
+        {
+            plant.Reset ();
+        }
+        else
+        {
+            client ().printf ("Error, invalid option: [%s]\n", strOption.c_str ());
+            HelpMessage (client);
+            return false;
+        }
+
+        if (bDone == false)
+        {
+            client ().printf ("Error, invalid %s: [%s]\n", strOption.c_str (), strCommandLine.c_str ());
+            return false;
+        }
+
+        return true;
+    }
+
+    void HelpMessage (TerminalStream& client)
+    {
+        client ().println ("Pipes, pumps and valves between the vessels, nodes: vessels then junctions");
+        client ().println ("\tUse:\nplant [status]|valve <link> <0-100%>|pump <link> <0-100%>|stop|vessel <vessel> <area m2> <elevation m>");
+        client ().println ("plant junction <litres> [kW/K]|link <from> <to> <L/s per m> [pump head m]|clear|default");
+        client ().println ("");
+    }
+};
+
+PlantCommand plantCommand;
+
+class SensorsCommand : public TerminalCommand
+{
+public:
+    SensorsCommand ()
+    {
+    }
+
+    bool Execute (Terminal& terminal, TerminalStream& client, const String& strCommandLine)
+    {
+        String strOption;
+        String strSpan;
+        String strPoints;
+
+        if (ParseOption (strCommandLine, 1, strOption, true) == 0 || strOption == "status")
+        {
+            Sensor_Show (client ());
+            return true;
+        }
+
+        if (ParseOption (strCommandLine, 2, strSpan, true) == 0)
+        {
+            client ().printf ("Error, invalid option: [%s]\n", strOption.c_str ());
+            HelpMessage (client);
+            return false;
+        }
+
+        uint16_t nPoints = ParseOption (strCommandLine, 3, strPoints, true) > 0 ? (uint16_t)strPoints.toInt () : 20;
+
+        Sensor_ShowHistory (client (), (uint8_t)strOption.toInt (), (uint32_t)strSpan.toInt (), nPoints);
+
+        return true;
+    }
+
+    void HelpMessage (TerminalStream& client)
+    {
+        client ().println ("Sensor history, min/max/avg at 1s, 1min and 10min");
+        client ().println ("\tUse:\nsensors [status]|<channel> <span seconds> [points]");
+        client ().println ("");
+    }
+};
+
+SensorsCommand sensorsCommand;
+
+class FlashLogCommand : public TerminalCommand
+{
+public:
+    FlashLogCommand ()
+    {
+    }
+
+    bool Execute (Terminal& terminal, TerminalStream& client, const String& strCommandLine)
+    {
+        String strOption;
+
+        if (ParseOption (strCommandLine, 1, strOption, true) == 0 || strOption == "status")
+        {
+            flashLogger.Show (client ());
+            return true;
+        }
+
+        CommandArgs args (strCommandLine, 2);
+
+        if (strOption == "show")
+        {
+            FlashLog_ShowRecords (client (), (uint32_t)args.Int (0), args.Has (1) ? (uint32_t)args.Int (1) : 20);
+        }
+        else if (strOption == "export")
+        {
+            FlashLog_Export (client (), (uint32_t)args.Int (0));
+        }
+        else if (strOption == "sync")
+        {
+            flashLogger.Seal ();
+        }
+        else if (strOption == "erase")
+        {
+            flashLogger.Erase ();
+        }
+        else
+        {
+            client ().printf ("Error, invalid option: [%s]\n", strOption.c_str ());
+            HelpMessage (client);
+            return false;
+        }
+
+        return true;
+    }
+
+    void HelpMessage (TerminalStream& client)
+    {
+        client ().println ("Brew log on flash, times in log seconds");
+        client ().println ("\tUse:\nflashlog [status]|show [from] [records]|export [from]|sync|erase");
+        client ().println ("");
+    }
+};
+
+FlashLogCommand flashLogCommand;
+
+class RecipeCommand : public TerminalCommand
+{
+public:
+    RecipeCommand ()
+    {
+    }
+
+    bool Execute (Terminal& terminal, TerminalStream& client, const String& strCommandLine)
+    {
+        String strOption;
+        String strValue;
+
+        if (ParseOption (strCommandLine, 1, strOption, true) == 0 || strOption == "show")
+        {
+            Recipe_Show (client ());
+            return true;
+        }
+
+        if (strOption == "list")
+        {
+            Recipe_List (client ());
+        }
+        else if (strOption == "select" && ParseOption (strCommandLine, 2, strValue, true) > 0)
+        {
+            if (Recipe_Select ((uint8_t)strValue.toInt ()) == false)
+            {
+                client ().println ("Error, invalid recipe");
+                return false;
+            }
+        }
+        else if (strOption == "verify")
+        {
+            client ().println (currentRecipe.Verify () ? "Recipe CRC ok" : "Recipe CRC mismatch");
+        }
+        else
+        {
+            client ().printf ("Error, invalid option: [%s]\n", strOption.c_str ());
+            HelpMessage (client);
+            return false;
+        }
+
+        return true;
+    }
+
+    void HelpMessage (TerminalStream& client)
+    {
+        client ().println ("Recipes built into flash");
+        client ().println ("\tUse:\nrecipe [show]|list|select <n>|verify");
+        client ().println ("");
+    }
+};
+
+RecipeCommand recipeCommand;
+
+class MatrixCommand : public TerminalCommand
+{
+public:
+    MatrixCommand ()
+    {
+    }
+
+    bool Execute (Terminal& terminal, TerminalStream& client, const String& strCommandLine)
+    {
+        String strOption;
+
+        if (ParseOption (strCommandLine, 1, strOption, true) == 0 || strOption == "status")
+        {
+            matrixDisplay.Show (client ());
+            return true;
+        }
+
+        CommandArgs args (strCommandLine, 2);
+
+        // Drawing takes the matrix over from the ticker until it runs again
+        if (strOption == "clear" || strOption == "test" || (strOption == "pixel" && args.Has (2))) matrixTicker.SetRunning (false);
+
+        if (strOption == "clear")
+        {
+            matrixDisplay.Clear ();
+            matrixDisplay.Post (MATRIX_DISPLAY_CHANGE);
+        }
+        else if (strOption == "test")
+        {
+            for (uint16_t nX = 0; nX < MATRIX_WIDTH; nX++)
+            {
+                matrixDisplay.SetColumn (nX, (nX & 1) ? 0xAA : 0x55);
+            }
+
+            matrixDisplay.Post (MATRIX_DISPLAY_CHANGE);
+        }
+        else if (strOption == "pixel" && args.Has (2))
+        {
+            matrixDisplay.SetPixel ((uint16_t)args.Int (0), (uint8_t)args.Int (1), args.Is (2, "on"));
+            matrixDisplay.Post (MATRIX_DISPLAY_CHANGE);
+        }
+        else if (strOption == "intensity" && args.Has (0))
+        {
+            matrixDisplay.Post (MATRIX_DISPLAY_INTENSITY, (uint32_t)args.Int (0));
+        }
+        else if (strOption == "reset")
+        {
+            matrixDisplay.Post (MATRIX_DISPLAY_RESET);
+        }
+        else
+        {
+            client ().printf ("Error, invalid option: [%s]\n", strOption.c_str ());
+            HelpMessage (client);
+            return false;
+        }
+
+        return true;
+    }
+
+    void HelpMessage (TerminalStream& client)
+    {
+        client ().println ("MAX7219 LED matrix");
+        client ().println ("\tUse:\nmatrix [status]|clear|test|pixel <x> <y> on|off|intensity <0-15>|reset");
+        client ().println ("clear, test and pixel stop the ticker, ticker auto starts it again");
+        client ().println ("");
+    }
+};
+
+MatrixCommand matrixCommand;
+
+class TickerCommand : public TerminalCommand
+{
+public:
+    TickerCommand ()
+    {
+    }
+
+    bool Execute (Terminal& terminal, TerminalStream& client, const String& strCommandLine)
+    {
+        String strOption;
+        String strValue;
+
+        if (ParseOption (strCommandLine, 1, strOption, true) == 0 || strOption == "status")
+        {
+            matrixTicker.Show (client ());
+            return true;
+        }
+
+        ParseOption (strCommandLine, 2, strValue, true);
+
+        if (strOption == "text" && strValue.length () > 0)
+        {
+            // Everything after the option, spaces included
+            int nStart = strCommandLine.indexOf (strValue, strCommandLine.indexOf (strOption) + strOption.length ());
+
+            matrixTicker.SetStatus (false);
+            matrixTicker.SetText (strCommandLine.substring (nStart).c_str ());
+            matrixTicker.SetRunning (true);
+        }
+        else if (strOption == "auto")
+        {
+            matrixTicker.SetStatus (true);
+            matrixTicker.SetRunning (true);
+        }
+        else if (strOption == "stop" || strOption == "off")
+        {
+            matrixTicker.SetRunning (false);
+        }
+        else if (strOption == "speed" && strValue.length () > 0)
+        {
+            matrixTicker.SetStepMs ((uint32_t)strValue.toInt ());
+        }
+        else
+        {
+            client ().printf ("Error, invalid option: [%s]\n", strOption.c_str ());
+            HelpMessage (client);
+            return false;
+        }
+
+        return true;
+    }
+
+    void HelpMessage (TerminalStream& client)
+    {
+        client ().println ("Scrolling text on the LED matrix, auto shows the vessels");
+        client ().println ("\tUse:\nticker [status]|text <message>|auto|stop|off|speed <ms per column>");
+        client ().println ("");
+    }
+};
+
+TickerCommand tickerCommand;
+
+class DashboardCommand : public TerminalCommand
+{
+public:
+    DashboardCommand ()
+    {
+    }
+
+    bool Execute (Terminal& terminal, TerminalStream& client, const String& strCommandLine)
+    {
+        String strOption;
+        String strValue;
+
+        if (ParseOption (strCommandLine, 1, strOption, true) == 0 || strOption == "status")
+        {
+            dashboard.Show (client ());
+            return true;
+        }
+
+        if (strOption == "list")
+        {
+            dashboard.List (client ());
+        }
+        else if (strOption == "screen" && ParseOption (strCommandLine, 2, strValue, true) > 0)
+        {
+            if (dashboard.SetScreen ((uint8_t)strValue.toInt ()) == false)
+            {
+                client ().printf ("Error, no screen [%s]\n", strValue.c_str ());
+                return false;
+            }
+        }
+        else if (strOption == "redraw")
+        {
+            dashboard.Invalidate ();
+        }
+        else
+        {
+            client ().printf ("Error, invalid option: [%s]\n", strOption.c_str ());
+            HelpMessage (client);
+            return false;
+        }
+
+        return true;
+    }
+
+    void HelpMessage (TerminalStream& client)
+    {
+        client ().println ("e-paper dashboard, screens come from the compiled layout");
+        client ().println ("\tUse:\ndashboard [status]|list|screen <n>|redraw");
+        client ().println ("");
+    }
+};
+
+DashboardCommand dashboardCommand;
+
+class CheckpointCommand : public TerminalCommand
+{
+public:
+    CheckpointCommand ()
+    {
+    }
+
+    bool Execute (Terminal& terminal, TerminalStream& client, const String& strCommandLine)
+    {
+        String strOption;
+
+        if (ParseOption (strCommandLine, 1, strOption, true) == 0 || strOption == "status")
+        {
+            checkpoint.Show (client ());
+            return true;
+        }
+
+        if (strOption == "save")
+        {
+            checkpoint.Request ();
+        }
+        else if (strOption == "restore")
+        {
+            if (checkpoint.IsWriting ())
+            {
+                client ().println ("Checkpoint write in progress, try again");
+                return false;
+            }
+
+            // The state jumps outside of the recorded inputs
+            recorder.Stop ();
+
+            if (checkpoint.Restore () == false)
+            {
+                client ().println ("No valid checkpoint");
+                return false;
+            }
+        }
+        else if (strOption == "erase")
+        {
+            checkpoint.Erase ();
+        }
+        else if (strOption == "on" || strOption == "off")
+        {
+            checkpoint.SetEnabled (strOption == "on");
+        }
+        else
+        {
+            client ().printf ("Error, invalid option: [%s]\n", strOption.c_str ());
+            HelpMessage (client);
+            return false;
+        }
+
+        return true;
+    }
+
+    void HelpMessage (TerminalStream& client)
+    {
+        client ().println ("Process state checkpoints, two slots on flash, restored at boot");
+        client ().println ("\tUse:\ncheckpoint [status]|save|restore|erase|on|off");
+        client ().println ("");
+    }
+};
+
+CheckpointCommand checkpointCommand;
+
+class RecordCommand : public TerminalCommand
+{
+public:
+    RecordCommand ()
+    {
+    }
+
+    bool Execute (Terminal& terminal, TerminalStream& client, const String& strCommandLine)
+    {
+        String strOption;
+
+        if (ParseOption (strCommandLine, 1, strOption, true) == 0 || strOption == "status")
+        {
+            recorder.Show (client ());
+            return true;
+        }
+
+        if (strOption == "start")
+        {
+            if (recorder.Start () == false)
+            {
+                client ().println ("Error, could not start the recording");
+                return false;
+            }
+        }
+        else if (strOption == "stop")
+        {
+            recorder.Stop ();
+        }
+        else
+        {
+            client ().printf ("Error, invalid option: [%s]\n", strOption.c_str ());
+            HelpMessage (client);
+            return false;
+        }
+
+        return true;
+    }
+
+    void HelpMessage (TerminalStream& client)
+    {
+        client ().println ("Input recording for host replays (" RECORD_FILE ")");
+        client ().println ("\tUse:\nrecord [status]|start|stop");
+        client ().println ("");
+    }
+};
+
+RecordCommand recordCommand;
+
+class ScriptCommand : public TerminalCommand
+{
+public:
+    ScriptCommand ()
+    {
+    }
+
+    bool Execute (Terminal& terminal, TerminalStream& client, const String& strCommandLine)
+    {
+        String strOption;
+        String strValue;
+
+        if (ParseOption (strCommandLine, 1, strOption, true) == 0 || strOption == "status")
+        {
+            Script_Show (client ());
+            return true;
+        }
+
+        ParseOption (strCommandLine, 2, strValue, true);
+
+        if (strOption == "list")
+        {
+            Script_List (client ());
+        }
+        else if (strOption == "run" && strValue.length () > 0)
+        {
+            int nTask = Script_Start ((uint8_t)strValue.toInt ());
+
+            if (nTask < 0)
+            {
+                client ().println ("Error, invalid program or no free task");
+                return false;
+            }
+
+            client ().printf ("Script: task %d\r\n", nTask);
+        }
+        else if (strOption == "stop" && strValue.length () > 0)
+        {
+            if (strValue == "all")
+                Script_StopAll ();
+            else if ((uint8_t)strValue.toInt () < SCRIPT_TASKS)
+                scriptTasks[(uint8_t)strValue.toInt ()].Stop ();
+        }
+        else if (strOption == "load" && strValue.length () > 0)
+        {
+            if (Script_Load (strValue.c_str ()) == false)
+            {
+                client ().printf ("Error, [%s] is not a script of up to %u bytes\n", strValue.c_str (), SCRIPT_LOAD_SIZE);
+                return false;
+            }
+
+            client ().printf ("Script: program %u\r\n", (unsigned)SCRIPT_BUILTINS);
+        }
+        else if (strOption == "verify" && strValue.length () > 0)
+        {
+            ScriptView view = Script_Open ((uint8_t)strValue.toInt ());
+
+            client ().println (view.IsValid () && view.Verify () ? "Script CRC ok" : "Script invalid or CRC mismatch");
+        }
+        else
+        {
+            client ().printf ("Error, invalid option: [%s]\n", strOption.c_str ());
+            HelpMessage (client);
+            return false;
+        }
+
+        return true;
+    }
+
+    void HelpMessage (TerminalStream& client)
+    {
+        client ().println ("Automation scripts, built in or loaded from flash (host/ScriptCompiler)");
+        client ().println ("\tUse:\nscript [status]|list|run <program>|stop <task>|all|load <file>|verify <program>");
+        client ().println ("");
+    }
+};
+
+ScriptCommand scriptCommand;
+
+class AlarmCommand : public TerminalCommand
+{
+public:
+    AlarmCommand ()
+    {
+    }
+
+    bool Execute (Terminal& terminal, TerminalStream& client, const String& strCommandLine)
+    {
+        String strOption;
+        String strValue;
+
+        if (ParseOption (strCommandLine, 1, strOption, true) == 0 || strOption == "status")
+        {
+            alarms.Show (client ());
+            return true;
+        }
+
+        ParseOption (strCommandLine, 2, strValue, true);
+
+        if (strOption == "list")
+        {
+            alarms.List (client ());
+        }
+        else if (strOption == "add")
+        {
+            int nRule = Add (strCommandLine);
+
+            if (nRule < 0)
+            {
+                client ().printf ("Error, invalid rule or table full: [%s]\n", strCommandLine.c_str ());
+                return false;
+            }
+
+            client ().printf ("Alarm: rule %d\r\n", nRule);
+        }
+        else if (strOption == "remove" && strValue.length () > 0)
+        {
+            if (alarms.Remove ((uint16_t)strValue.toInt ()) == false)
+            {
+                client ().println ("Error, invalid rule");
+                return false;
+            }
+        }
+        else if (strOption == "ack" && strValue.length () > 0)
+        {
+            alarms.Acknowledge (strValue == "all" ? ALARM_RULES : (uint16_t)strValue.toInt ());
+        }
+        else if (strOption == "clear")
+        {
+            alarms.Clear ();
+        }
+        else if (strOption == "default")
+        {
+            alarms.Defaults ();
+        }
+        else if (strOption == "save")
+        {
+            if (alarms.Save () == false)
+            {
+                client ().println ("Error, could not write " ALARM_FILE);
+                return false;
+            }
+        }
+        else
+        {
+            client ().printf ("Error, invalid option: [%s]\n", strOption.c_str ());
+            HelpMessage (client);
+            return false;
+        }
+
+        return true;
+    }
+
+    void HelpMessage (TerminalStream& client)
+    {
+        client ().println ("Alarm rules over the process values, signals <vessel>.temp|volume|heater|error, link<n>.flow|pump, fermenter.gravity|rate");
+        client ().println ("\tUse:\nalarm [status]|list|remove <rule>|ack <rule>|all|clear|default|save");
+        client ().println ("alarm add <signal> <|> <value> [and <signal> <|> <value>] [for <s>] [hyst <band>]");
+        client ().println ("");
+    }
+
+private:
+    /// "add" options from the third word on, returns the rule or -1
+    int Add (const String& strCommandLine)
+    {
+        CommandArgs words (strCommandLine, 2);
+        uint8_t nSignals[ALARM_TERMS] = {ALARM_SIGNALS, ALARM_SIGNALS};
+        bool bAbove[ALARM_TERMS] = {false, false};
+        Fixed nThresholds[ALARM_TERMS];
+        Fixed nHysteresis;
+        uint32_t nDelay = 0;
+        uint8_t nTerms = 0;
+        uint8_t nWords = words.Count ();
+
+        for (uint8_t nWord = 0; nWord < nWords;)
+        {
+            if (words.Is (nWord, "for") && nWord + 1 < nWords)
+            {
+                nDelay = (uint32_t)words.Int (nWord + 1);
+                nWord += 2;
+            }
+            else if (words.Is (nWord, "hyst") && nWord + 1 < nWords)
+            {
+                nHysteresis = Fixed (words.Float (nWord + 1));
+                nWord += 2;
+            }
+            else
+            {
+                // Terms after the first are joined by "and"
+                if (nTerms > 0 && words.Is (nWord++, "and") == false) return -1;
+
+                if (nTerms == ALARM_TERMS || nWord + 2 >= nWords || (words.Is (nWord + 1, ">") == false && words.Is (nWord + 1, "<") == false)) return -1;
+
+                nSignals[nTerms] = Alarm_ParseSignal (words[nWord]);
+                bAbove[nTerms] = words.Is (nWord + 1, ">");
+                nThresholds[nTerms] = Fixed (words.Float (nWord + 2));
+
+                if (nSignals[nTerms++] == ALARM_SIGNALS) return -1;
+
+                nWord += 3;
+            }
+        }
+
+        if (nTerms == 0) return -1;
+
+        return alarms.Add (0, nSignals[0], bAbove[0], nThresholds[0], nHysteresis, nDelay, nSignals[1], bAbove[1], nThresholds[1]);
+    }
+};
+
+AlarmCommand alarmCommand;
+
+class SyncCommand : public TerminalCommand
+{
+public:
+    SyncCommand ()
+    {
+    }
+
+    bool Execute (Terminal& terminal, TerminalStream& client, const String& strCommandLine)
+    {
+        String strOption;
+
+        if (ParseOption (strCommandLine, 1, strOption, true) == 0 || strOption == "status")
+        {
+            Sync_Show (client ());
+            return true;
+        }
+
+        client ().printf ("Error, invalid option: [%s]\n", strOption.c_str ());
+        HelpMessage (client);
+        return false;
+    }
+
+    void HelpMessage (TerminalStream& client)
+    {
+        client ().println ("Mutexes, semaphores, events and conditions, state and contention");
+        client ().println ("\tUse:\nsync [status]");
+        client ().println ("");
+    }
+};
+
+SyncCommand syncCommand;
+
 void MOTDFunction (TerminalStream& stdio)
 {
     stdio ().println ("---------------------------------");
@@ -172,11 +1388,27 @@ void Thread_Serial (void* pValue)
 
         Terminal terminal (tstream);
 
-        Serial.println ("Terminal Demo");
+        LOG_INFO (LOG_TERMINAL_START);
 
         terminal.AttachMOTD (MOTDFunction);
 
         terminal.AttachCommand ("Status", statusCommand);
+        terminal.AttachCommand ("Log", logCommand);
+        terminal.AttachCommand ("PostMortem", postMortemCommand);
+        terminal.AttachCommand ("Sim", simulationCommand);
+        terminal.AttachCommand ("Control", controlCommand);
+        terminal.AttachCommand ("Plant", plantCommand);
+        terminal.AttachCommand ("Sensors", sensorsCommand);
+        terminal.AttachCommand ("FlashLog", flashLogCommand);
+        terminal.AttachCommand ("Recipe", recipeCommand);
+        terminal.AttachCommand ("Matrix", matrixCommand);
+        terminal.AttachCommand ("Ticker", tickerCommand);
+        terminal.AttachCommand ("Dashboard", dashboardCommand);
+        terminal.AttachCommand ("Checkpoint", checkpointCommand);
+        terminal.AttachCommand ("Record", recordCommand);
+        terminal.AttachCommand ("Script", scriptCommand);
+        terminal.AttachCommand ("Alarm", alarmCommand);
+        terminal.AttachCommand ("Sync", syncCommand);
 
         terminal.Start ();
     }
@@ -0,0 +1,738 @@
+///
+/// @author   GUSTAVO CAMPOS
+/// @author   GUSTAVO CAMPOS
+/// @date   28/05/2019 19:44
+/// @version  <#version#>
+///
+/// @copyright  (c) GUSTAVO CAMPOS, 2019
+/// @copyright  Licence
+///
+/// @see    ReadMe.txt for references
+///
+//               GNU GENERAL PUBLIC LICENSE
+//                Version 3, 29 June 2007
+//
+// Copyright (C) 2007 Free Software Foundation, Inc. <https://fsf.org/>
+// Everyone is permitted to copy and distribute verbatim copies
+// of this license document, but changing it is not allowed.
+//
+// Preamble
+//
+// The GNU General Public License is a free, copyleft license for
+// software and other kinds of works.
+//
+// The licenses for most software and other practical works are designed
+// to take away your freedom to share and change the works.  By contrast,
+// the GNU General Public License is intended to guarantee your freedom to
+// share and change all versions of a program--to make sure it remains free
+// software for all its users.  We, the Free Software Foundation, use the
+// GNU General Public License for most of our software; it applies also to
+// any other work released this way by its authors.  You can apply it to
+// your programs, too.
+//
+// See LICENSE file for the complete information
+
+#ifndef CONTROLLER_HPP
+#define CONTROLLER_HPP
+
+#include "Arduino.h"
+#include "CorePartition.h"
+
+#include "FixedPoint.hpp"
+#include "BinaryLog.hpp"
+#include "Simulation.hpp"
+
+/// Control library
+///
+/// PID in ISA form (Kp, Ti, Td) with conditional integration as
+/// anti-windup and a first order filter on the derivative of the
+/// measurement, bang-bang with hysteresis and a relay auto-tuner
+/// (Astrom-Hagglund) feeding Ziegler-Nichols gains back to the PID.
+/// Everything is templated on the numeric type like the vessel model,
+/// Fixed on the device.
+///
+/// The loops are driven by FixedRateTimer, deadlines sit on an
+/// absolute grid so a late start shortens the next wait instead of
+/// shifting every following period.
+
+template <typename Number>
+class PidController
+{
+public:
+    PidController () : nKp (0.3), nTi (600), nTd (30), nMin (0), nMax (1), nFilter (8), nIntegral (0), nDerivative (0), nLast (0), bFirst (true)
+    {
+    }
+
+    void SetTuning (Number nNewKp, Number nNewTi, Number nNewTd)
+    {
+        nKp = nNewKp;
+        nTi = nNewTi;
+        nTd = nNewTd;
+    }
+
+    void SetLimits (Number nNewMin, Number nNewMax)
+    {
+        nMin = nNewMin;
+        nMax = nNewMax;
+    }
+
+    void Reset ()
+    {
+        nIntegral = Number (0);
+        nDerivative = Number (0);
+        bFirst = true;
+    }
+
+    /// One control step of nStep seconds
+    Number Compute (Number nSetpoint, Number nMeasurement, Number nStep)
+    {
+        Number nError = nSetpoint - nMeasurement;
+
+        if (bFirst)
+        {
+            nLast = nMeasurement;
+            bFirst = false;
+        }
+
+        // Derivative on measurement, no kick on setpoint changes,
+        // low passed with time constant Td/N
+        if (nTd > Number (0))
+        {
+            Number nRaw = (nLast - nMeasurement) / nStep;
+            Number nAlpha = nStep / (nTd / nFilter + nStep);
+
+            nDerivative += nAlpha * (nRaw - nDerivative);
+        }
+
+        nLast = nMeasurement;
+
+        Number nProportional = nError;
+        Number nIntegralTerm = nTi > Number (0) ? nIntegral / nTi : Number (0);
+        Number nOutput = nKp * (nProportional + nIntegralTerm + nTd * nDerivative);
+
+        // Conditional integration, only when it does not push further
+        // into saturation
+        if (nTi > Number (0))
+        {
+            bool bHigh = nOutput >= nMax && nError > Number (0);
+            bool bLow = nOutput <= nMin && nError < Number (0);
+
+            if (bHigh == false && bLow == false)
+            {
+                nIntegral += nError * nStep;
+                nOutput = nKp * (nProportional + nIntegral / nTi + nTd * nDerivative);
+            }
+        }
+
+        return Clamp (nOutput, nMin, nMax);
+    }
+
+    Number GetKp () const
+    {
+        return nKp;
+    }
+
+    Number GetTi () const
+    {
+        return nTi;
+    }
+
+    Number GetTd () const
+    {
+        return nTd;
+    }
+
+    Number GetIntegral () const
+    {
+        return nIntegral;
+    }
+
+    /// Visits the state a checkpoint keeps (Checkpoint.hpp), the same
+    /// call saves and restores
+    template <typename Archive>
+    void Checkpoint (Archive& archive)
+    {
+        archive (nKp);
+        archive (nTi);
+        archive (nTd);
+        archive (nIntegral);
+        archive (nDerivative);
+        archive (nLast);
+        archive (bFirst);
+    }
+
+private:
+    Number nKp;
+    Number nTi;
+    Number nTd;
+    Number nMin;
+    Number nMax;
+    Number nFilter;
+
+    Number nIntegral;
+    Number nDerivative;
+    Number nLast;
+    bool bFirst;
+};
+
+template <typename Number>
+class BangBangController
+{
+public:
+    BangBangController () : nHysteresis (0.25), nOutput (0)
+    {
+    }
+
+    void SetHysteresis (Number nValue)
+    {
+        nHysteresis = nValue;
+    }
+
+    Number Compute (Number nSetpoint, Number nMeasurement)
+    {
+        if (nMeasurement < nSetpoint - nHysteresis)
+            nOutput = Number (1);
+        else if (nMeasurement > nSetpoint + nHysteresis)
+            nOutput = Number (0);
+
+        return nOutput;
+    }
+
+    /// Visits the state a checkpoint keeps (Checkpoint.hpp), the same
+    /// call saves and restores
+    template <typename Archive>
+    void Checkpoint (Archive& archive)
+    {
+        archive (nHysteresis);
+        archive (nOutput);
+    }
+
+private:
+    Number nHysteresis;
+    Number nOutput;
+};
+
+/// Relay auto-tune: a relay with hysteresis makes the loop oscillate,
+/// the amplitude a and period Tu give the ultimate gain
+/// Ku = 4d / (pi a), then Ziegler-Nichols: Kp = 0.6 Ku, Ti = Tu / 2,
+/// Td = Tu / 8.
+template <typename Number>
+class RelayAutoTune
+{
+public:
+    static const uint8_t nCycles = 4;
+
+    RelayAutoTune () : nBias (0.5), nAmplitude (0.5), nHysteresis (0.2)
+    {
+        Reset ();
+    }
+
+    void Reset ()
+    {
+        bHigh = true;
+        bDone = false;
+        nCrossings = 0;
+        nPeakHigh = Number (-1000);
+        nPeakLow = Number (1000);
+        nSumAmplitude = Number (0);
+        nFirstCrossing = 0;
+        nLastCrossing = 0;
+    }
+
+    /// @param nTime    seconds, the loop's own clock
+    Number Compute (Number nSetpoint, Number nMeasurement, uint32_t nTime)
+    {
+        if (bDone) return nBias;
+
+        if (nMeasurement > nPeakHigh) nPeakHigh = nMeasurement;
+        if (nMeasurement < nPeakLow) nPeakLow = nMeasurement;
+
+        if (bHigh && nMeasurement > nSetpoint + nHysteresis)
+        {
+            bHigh = false;
+            Crossing (nTime);
+        }
+        else if (bHigh == false && nMeasurement < nSetpoint - nHysteresis)
+        {
+            bHigh = true;
+            Crossing (nTime);
+        }
+
+        return bHigh ? nBias + nAmplitude : nBias - nAmplitude;
+    }
+
+    bool IsDone () const
+    {
+        return bDone;
+    }
+
+    /// Only valid once IsDone ()
+    void GetTuning (Number& nKp, Number& nTi, Number& nTd) const
+    {
+        Number nA = nSumAmplitude / Number ((int)(nCycles * 2 - 2));
+        Number nKu = Number (4.0 / 3.14159265358979) * nAmplitude / nA;
+        Number nTu = Number ((int)((nLastCrossing - nFirstCrossing) / (nCycles - 1)));
+
+        nKp = Number (0.6) * nKu;
+        nTi = nTu / Number (2);
+        nTd = nTu / Number (8);
+    }
+
+    /// Visits the state a checkpoint keeps (Checkpoint.hpp), the same
+    /// call saves and restores
+    template <typename Archive>
+    void Checkpoint (Archive& archive)
+    {
+        archive (bHigh);
+        archive (bDone);
+        archive (nCrossings);
+        archive (nPeakHigh);
+        archive (nPeakLow);
+        archive (nSumAmplitude);
+        archive (nFirstCrossing);
+        archive (nLastCrossing);
+    }
+
+private:
+    void Crossing (uint32_t nTime)
+    {
+        nCrossings++;
+
+        // The first half cycle starts from rest, skip it
+        if (nCrossings > 2)
+        {
+            nSumAmplitude += (nPeakHigh - nPeakLow) / Number (2);
+        }
+
+        // Period measured between rising crossings (relay turning off)
+        if (bHigh == false)
+        {
+            if (nFirstCrossing == 0)
+                nFirstCrossing = nTime;
+            else
+                nLastCrossing = nTime;
+        }
+
+        // Restart tracking the peak the coming half cycle will reach
+        if (bHigh)
+            nPeakLow = Number (1000);
+        else
+            nPeakHigh = Number (-1000);
+
+        if (nCrossings >= nCycles * 2) bDone = true;
+    }
+
+    Number nBias;
+    Number nAmplitude;
+    Number nHysteresis;
+
+    bool bHigh;
+    bool bDone;
+    uint8_t nCrossings;
+    Number nPeakHigh;
+    Number nPeakLow;
+    Number nSumAmplitude;
+    uint32_t nFirstCrossing;
+    uint32_t nLastCrossing;
+};
+
+/// Period, jitter and compute time of a fixed rate loop, microseconds
+struct LoopTiming
+{
+    uint32_t nRuns;
+    uint32_t nOverruns;
+    int32_t nJitterMin;
+    int32_t nJitterMax;
+    uint64_t nJitterSum;
+    uint32_t nComputeMax;
+    uint64_t nComputeSum;
+};
+
+class FixedRateTimer
+{
+public:
+    FixedRateTimer (uint32_t nPeriodUs) : nPeriod (nPeriodUs), nNext (0), nStarted (0)
+    {
+        ResetStats ();
+    }
+
+    void SetPeriod (uint32_t nPeriodUs)
+    {
+        nPeriod = nPeriodUs;
+    }
+
+    uint32_t GetPeriod () const
+    {
+        return nPeriod;
+    }
+
+    /// Blocks the calling thread until the next deadline, sleeping
+    /// the bulk of it and yielding the last millisecond
+    void Wait ()
+    {
+        uint32_t nNow = micros ();
+
+        if (nNext == 0) nNext = nNow + nPeriod;
+
+        int32_t nRemaining = (int32_t)(nNext - nNow);
+
+        if (nRemaining > 2000)
+        {
+            CorePartition_Sleep ((nRemaining - 1000) / 1000);
+        }
+
+        while ((int32_t)(nNext - micros ()) > 0)
+        {
+            CorePartition_Yield ();
+        }
+
+        nStarted = micros ();
+
+        int32_t nJitter = (int32_t)(nStarted - nNext);
+
+        if (timing.nRuns == 0 || nJitter < timing.nJitterMin) timing.nJitterMin = nJitter;
+        if (timing.nRuns == 0 || nJitter > timing.nJitterMax) timing.nJitterMax = nJitter;
+        timing.nJitterSum += nJitter < 0 ? -nJitter : nJitter;
+
+        nNext += nPeriod;
+
+        // More than a full period late, skip the missed deadlines
+        if ((int32_t)(nStarted - nNext) > 0)
+        {
+            uint32_t nMissed = (nStarted - nNext) / nPeriod + 1;
+
+            timing.nOverruns += nMissed;
+            nNext += nMissed * nPeriod;
+        }
+    }
+
+    /// Closes the current run, accounts its compute time
+    void Done ()
+    {
+        uint32_t nCompute = micros () - nStarted;
+
+        timing.nRuns++;
+        timing.nComputeSum += nCompute;
+        if (nCompute > timing.nComputeMax) timing.nComputeMax = nCompute;
+    }
+
+    const LoopTiming& GetTiming () const
+    {
+        return timing;
+    }
+
+    void ResetStats ()
+    {
+        memset (&timing, 0, sizeof (timing));
+    }
+
+    void Show (Stream& client)
+    {
+        uint32_t nRuns = timing.nRuns > 0 ? timing.nRuns : 1;
+
+        client.printf ("%-20s: [%u us]\r\n", "Period", nPeriod);
+        client.printf ("%-20s: [%u]\r\n", "Runs", timing.nRuns);
+        client.printf ("%-20s: [%u]\r\n", "Overruns", timing.nOverruns);
+        client.printf ("%-20s: [%d / %d / %u us]\r\n", "Jitter min/max/avg", timing.nJitterMin, timing.nJitterMax, (uint32_t)(timing.nJitterSum / nRuns));
+        client.printf ("%-20s: [%u / %u us]\r\n", "Compute max/avg", timing.nComputeMax, (uint32_t)(timing.nComputeSum / nRuns));
+    }
+
+private:
+    uint32_t nPeriod;
+    uint32_t nNext;
+    uint32_t nStarted;
+    LoopTiming timing;
+};
+
+/// Process side of a loop, the same controller drives the simulated
+/// plant or a real sensor and heater through this interface
+class ControlPlant
+{
+public:
+    /// Seconds on the plant clock, the loop derives its step from it
+    virtual uint32_t GetTime () = 0;
+    virtual Fixed Read () = 0;
+    virtual void Write (Fixed nOutput) = 0;
+};
+
+/// A simulated vessel, measurement is the temperature, output the
+/// heater duty; time is simulated time so the loop keeps its gains
+/// at any simulation speed
+class SimulatedPlant : public ControlPlant
+{
+public:
+    SimulatedPlant (uint8_t nVessel) : nVessel (nVessel)
+    {
+    }
+
+    uint32_t GetTime () override
+    {
+        return simulation.GetTime ();
+    }
+
+    Fixed Read () override
+    {
+        return simulation.Vessel (nVessel).nTemperature;
+    }
+
+    void Write (Fixed nOutput) override
+    {
+        simulation.SetDuty (nVessel, nOutput);
+    }
+
+    uint8_t GetVessel () const
+    {
+        return nVessel;
+    }
+
+private:
+    uint8_t nVessel;
+};
+
+/// Plant seconds one PID step integrates at most, ten nominal control
+/// periods; event mode and a slow control thread hand it longer gaps,
+/// which would wind the integral up and overflow nError * nStep
+#ifndef CONTROL_MAX_STEP
+#define CONTROL_MAX_STEP 10
+#endif
+
+enum ControlMode : uint8_t
+{
+    CONTROL_OFF = 0,
+    CONTROL_BANGBANG,
+    CONTROL_PID,
+    CONTROL_AUTOTUNE
+};
+
+class ControlLoop
+{
+public:
+    ControlLoop () : nLoop (0), pPlant (NULL), nMode (CONTROL_OFF), nSetpoint (66), nMeasurement (0), nOutput (0), nTime (0)
+    {
+    }
+
+    void Attach (uint8_t nLoopID, ControlPlant& plant)
+    {
+        nLoop = nLoopID;
+        pPlant = &plant;
+        nTime = plant.GetTime ();
+    }
+
+    void SetMode (ControlMode nNewMode)
+    {
+        LOG_INFO (LOG_CONTROL_MODE, nLoop, nMode, nNewMode);
+
+        nMode = nNewMode;
+
+        pid.Reset ();
+        autoTune.Reset ();
+
+        if (pPlant != NULL)
+        {
+            nTime = pPlant->GetTime ();
+
+            if (nMode == CONTROL_OFF) pPlant->Write (Fixed (0));
+        }
+    }
+
+    void SetSetpoint (Fixed nValue)
+    {
+        nSetpoint = nValue;
+    }
+
+    /// Runs when the plant clock moved, the step is the elapsed time
+    void Step ()
+    {
+        if (pPlant == NULL || nMode == CONTROL_OFF) return;
+
+        uint32_t nNow = pPlant->GetTime ();
+        int32_t nElapsed = (int32_t)(nNow - nTime);
+
+        if (nElapsed == 0) return;
+
+        nTime = nNow;
+
+        // The clock went back (sim reset, checkpoint restore): the
+        // history of the controllers belongs to another timeline
+        if (nElapsed < 0)
+        {
+            pid.Reset ();
+            autoTune.Reset ();
+            return;
+        }
+
+        uint32_t nStep = nElapsed > CONTROL_MAX_STEP ? CONTROL_MAX_STEP : (uint32_t)nElapsed;
+
+        nMeasurement = pPlant->Read ();
+
+        switch (nMode)
+        {
+            case CONTROL_BANGBANG:
+                nOutput = bangBang.Compute (nSetpoint, nMeasurement);
+                break;
+
+            case CONTROL_PID:
+                nOutput = pid.Compute (nSetpoint, nMeasurement, Fixed (nStep));
+                break;
+
+            case CONTROL_AUTOTUNE:
+                nOutput = autoTune.Compute (nSetpoint, nMeasurement, nTime);
+
+                if (autoTune.IsDone ())
+                {
+                    Fixed nKp, nTi, nTd;
+
+                    autoTune.GetTuning (nKp, nTi, nTd);
+                    pid.SetTuning (nKp, nTi, nTd);
+
+                    LOG_INFO (LOG_CONTROL_TUNED, nKp.ToCenti (), nTi.ToInt (), nTd.ToInt ());
+
+                    nMode = CONTROL_PID;
+                    pid.Reset ();
+                }
+                break;
+        }
+
+        pPlant->Write (nOutput);
+    }
+
+    ControlMode GetMode () const
+    {
+        return (ControlMode)nMode;
+    }
+
+    Fixed GetSetpoint () const
+    {
+        return nSetpoint;
+    }
+
+    Fixed GetMeasurement () const
+    {
+        return nMeasurement;
+    }
+
+    Fixed GetOutput () const
+    {
+        return nOutput;
+    }
+
+    /// Visits the state a checkpoint keeps (Checkpoint.hpp), the same
+    /// call saves and restores
+    template <typename Archive>
+    void Checkpoint (Archive& archive)
+    {
+        archive (nMode);
+        archive (nSetpoint);
+        archive (nMeasurement);
+        archive (nOutput);
+        archive (nTime);
+
+        pid.Checkpoint (archive);
+        bangBang.Checkpoint (archive);
+        autoTune.Checkpoint (archive);
+    }
+
+    PidController<Fixed> pid;
+    BangBangController<Fixed> bangBang;
+    RelayAutoTune<Fixed> autoTune;
+
+private:
+    uint8_t nLoop;
+    ControlPlant* pPlant;
+    uint8_t nMode;
+    Fixed nSetpoint;
+    Fixed nMeasurement;
+    Fixed nOutput;
+    uint32_t nTime;
+};
+
+/// Mash tun and kettle
+#ifndef CONTROL_LOOPS
+#define CONTROL_LOOPS 2
+#endif
+
+/// Nominal period at simulation speed 1
+#ifndef CONTROL_PERIOD_US
+#define CONTROL_PERIOD_US 1000000
+#endif
+
+/// Floor for fast or max simulation speed
+#ifndef CONTROL_MIN_PERIOD_US
+#define CONTROL_MIN_PERIOD_US 5000
+#endif
+
+SimulatedPlant controlPlants[CONTROL_LOOPS] = {SimulatedPlant (VESSEL_MASH), SimulatedPlant (VESSEL_BOIL)};
+
+ControlLoop controlLoops[CONTROL_LOOPS];
+
+FixedRateTimer controlTimer (CONTROL_PERIOD_US);
+
+const char* const controlModeNames[] = {"off", "bangbang", "pid", "autotune"};
+
+/// Period follows the simulation speed so every run sees about one
+/// simulated step
+uint32_t Control_GetPeriod ()
+{
+    uint32_t nPeriod = nSimulationSpeed == 0 ? CONTROL_MIN_PERIOD_US : CONTROL_PERIOD_US / nSimulationSpeed;
+
+    return nPeriod < CONTROL_MIN_PERIOD_US ? CONTROL_MIN_PERIOD_US : nPeriod;
+}
+
+void Control_Show (Stream& client)
+{
+    client.println (F ("Loop\tMode\t\tSP C\tPV C\tOut\tKp\tTi s\tTd s"));
+
+    for (uint8_t nCount = 0; nCount < CONTROL_LOOPS; nCount++)
+    {
+        ControlLoop& loop = controlLoops[nCount];
+
+        client.printf ("%u\t%-8s\t", nCount, controlModeNames[loop.GetMode ()]);
+        PrintCenti (client, loop.GetSetpoint ());
+        client.print (F ("\t"));
+        PrintCenti (client, loop.GetMeasurement ());
+        client.print (F ("\t"));
+        PrintCenti (client, loop.GetOutput ());
+        client.print (F ("\t"));
+        PrintCenti (client, loop.pid.GetKp ());
+        client.print (F ("\t"));
+        PrintCenti (client, loop.pid.GetTi ());
+        client.print (F ("\t"));
+        PrintCenti (client, loop.pid.GetTd ());
+        client.println ();
+    }
+
+    client.println ();
+    controlTimer.Show (client);
+}
+
+/// Input recorder, defined in Recorder.hpp
+void Recorder_Tick ();
+
+/// Control thread, woken by the fixed rate timer rather than a
+/// relative delay
+void Thread_Control (void* pValue)
+{
+    for (uint8_t nCount = 0; nCount < CONTROL_LOOPS; nCount++)
+    {
+        controlLoops[nCount].Attach (nCount, controlPlants[nCount]);
+    }
+
+    LOG_INFO (LOG_CONTROL_START, CONTROL_LOOPS, CONTROL_PERIOD_US / 1000);
+
+    while (true)
+    {
+        controlTimer.SetPeriod (Control_GetPeriod ());
+        controlTimer.Wait ();
+
+        for (uint8_t nCount = 0; nCount < CONTROL_LOOPS; nCount++)
+        {
+            controlLoops[nCount].Step ();
+        }
+
+        Recorder_Tick ();
+
+        controlTimer.Done ();
+    }
+}
+
+#endif
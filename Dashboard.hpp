@@ -0,0 +1,554 @@
+///
+/// @author   GUSTAVO CAMPOS
+/// @author   GUSTAVO CAMPOS
+/// @date   28/05/2019 19:44
+/// @version  <#version#>
+///
+/// @copyright  (c) GUSTAVO CAMPOS, 2019
+/// @copyright  Licence
+///
+/// @see    ReadMe.txt for references
+///
+//               GNU GENERAL PUBLIC LICENSE
+//                Version 3, 29 June 2007
+//
+// Copyright (C) 2007 Free Software Foundation, Inc. <https://fsf.org/>
+// Everyone is permitted to copy and distribute verbatim copies
+// of this license document, but changing it is not allowed.
+//
+// Preamble
+//
+// The GNU General Public License is a free, copyleft license for
+// software and other kinds of works.
+//
+// The licenses for most software and other practical works are designed
+// to take away your freedom to share and change the works.  By contrast,
+// the GNU General Public License is intended to guarantee your freedom to
+// share and change all versions of a program--to make sure it remains free
+// software for all its users.  We, the Free Software Foundation, use the
+// GNU General Public License for most of our software; it applies also to
+// any other work released this way by its authors.  You can apply it to
+// your programs, too.
+//
+// See LICENSE file for the complete information
+
+#ifndef DASHBOARD_HPP
+#define DASHBOARD_HPP
+
+#include "Arduino.h"
+#include "CorePartition.h"
+
+#include "epd4in2.h"
+#include "epdpaint.h"
+
+#include "Alarms.hpp"
+#include "BinaryLog.hpp"
+#include "Controller.hpp"
+#include "LayoutFormat.hpp"
+#include "Recipe.hpp"
+#include "Simulation.hpp"
+
+// Built in layout, generated by host/LayoutCompiler (make -C host layouts)
+#include "LayoutDashboard.h"
+
+/// e-paper dashboard
+///
+/// Runs a compiled layout (LayoutFormat.hpp) on the 4.2" panel. Each
+/// update passes the source of every widget through its binding and
+/// redraws only the widgets whose shown text changed: the widget is
+/// rendered in bands through a small buffer and sent with
+/// SetPartialWindow, then the panel refreshes just the rectangle
+/// around what was drawn.
+///
+/// A binding rounds the value to its resolution and keeps the shown
+/// one until the value moves half a step plus the hysteresis away,
+/// and at most once per interval; the formatted text is cached, so
+/// jitter in the last digit costs a compare, not a refresh. A screen change, or every
+/// DASHBOARD_FULL_REFRESH partial refreshes, repaints and refreshes
+/// the whole panel, which also clears the ghosting.
+///
+/// The panel busy time is spent in CorePartition_Sleep, the library
+/// DisplayFrame would hold every thread for seconds.
+
+#ifndef DASHBOARD_BAND_BYTES
+#define DASHBOARD_BAND_BYTES 1600 // 400 x 32 pixels
+#endif
+
+#ifndef DASHBOARD_UPDATE_MS
+#define DASHBOARD_UPDATE_MS 1000 // the bindings pace the redraws
+#endif
+
+#ifndef DASHBOARD_FULL_REFRESH
+#define DASHBOARD_FULL_REFRESH 20
+#endif
+
+#define DASHBOARD_PADDING 4
+
+// Paint colors, as in the panel examples
+#define DASHBOARD_COLORED 0
+#define DASHBOARD_UNCOLORED 1
+
+/// Current value of a source, hundredths of the unit shown
+int32_t Dashboard_Read (uint32_t nSource)
+{
+    switch (nSource)
+    {
+        case LAYOUT_SOURCE_TIME:
+            return (int32_t)simulation.GetTime () * 100;
+
+        case LAYOUT_SOURCE_MASH_TEMPERATURE:
+            return ToCenti (simulation.Vessel (VESSEL_MASH).nTemperature);
+
+        case LAYOUT_SOURCE_MASH_DUTY:
+            return ToCenti (simulation.Vessel (VESSEL_MASH).nDuty * Fixed (100));
+
+        case LAYOUT_SOURCE_MASH_VOLUME:
+            return ToCenti (simulation.Vessel (VESSEL_MASH).nVolume);
+
+        case LAYOUT_SOURCE_BOIL_TEMPERATURE:
+            return ToCenti (simulation.Vessel (VESSEL_BOIL).nTemperature);
+
+        case LAYOUT_SOURCE_BOIL_DUTY:
+            return ToCenti (simulation.Vessel (VESSEL_BOIL).nDuty * Fixed (100));
+
+        case LAYOUT_SOURCE_BOIL_VOLUME:
+            return ToCenti (simulation.Vessel (VESSEL_BOIL).nVolume);
+
+        case LAYOUT_SOURCE_BOIL_EVAPORATED:
+            return ToCenti (simulation.Vessel (VESSEL_BOIL).nEvaporated);
+
+        case LAYOUT_SOURCE_FERMENTER_TEMPERATURE:
+            return ToCenti (simulation.Vessel (VESSEL_FERMENTER).nTemperature);
+
+        case LAYOUT_SOURCE_FERMENTER_DUTY:
+            return ToCenti (simulation.Vessel (VESSEL_FERMENTER).nDuty * Fixed (100));
+
+        case LAYOUT_SOURCE_LOOP0_SETPOINT:
+            return ToCenti (controlLoops[0].GetSetpoint ());
+
+        case LAYOUT_SOURCE_LOOP1_SETPOINT:
+            return ToCenti (controlLoops[1].GetSetpoint ());
+
+        case LAYOUT_SOURCE_SPEED:
+            return (int32_t)nSimulationSpeed * 100;
+
+        // Brewing math from the flash tables of BrewMath.hpp, a few
+        // microseconds per widget
+
+        case LAYOUT_SOURCE_BOIL_COLD_VOLUME:
+            return ToCenti (BrewMath_ColdVolume (simulation.Vessel (VESSEL_BOIL).nVolume, simulation.Vessel (VESSEL_BOIL).nTemperature));
+
+        case LAYOUT_SOURCE_FERMENTER_GRAVITY:
+            return ToCenti (fermentation.GetGravity ());
+
+        case LAYOUT_SOURCE_FERMENTER_PLATO:
+            return ToCenti (BrewMath_Plato (fermentation.GetGravity ()));
+
+        case LAYOUT_SOURCE_FERMENTER_ABV:
+            return ToCenti (fermentation.GetAbv ());
+
+        // Into the wort in the kettle
+        case LAYOUT_SOURCE_RECIPE_IBU:
+            return ToCenti (Recipe_Ibu (simulation.Vessel (VESSEL_BOIL).nVolume));
+
+        case LAYOUT_SOURCE_RECIPE_SRM:
+            return ToCenti (Recipe_Srm (simulation.Vessel (VESSEL_BOIL).nVolume));
+
+        // Raised alarms, acknowledged or not
+        case LAYOUT_SOURCE_ALARMS:
+            return (int32_t)alarms.GetActive () * 100;
+
+        default:
+            return 0;
+    }
+}
+
+sFONT* Dashboard_Font (uint32_t nHeight)
+{
+    switch (nHeight)
+    {
+        case 8: return &Font8;
+        case 12: return &Font12;
+        case 20: return &Font20;
+        case 24: return &Font24;
+        default: return &Font16;
+    }
+}
+
+/// What a value or bar widget shows, rebuilt only when it changes
+struct DashboardBinding
+{
+    int32_t nShown;    // rounded value behind szText
+    uint32_t nChanged; // millis of the last redraw
+    char szText[24];
+};
+
+class Dashboard
+{
+public:
+    Dashboard () : bStarted (false), nScreen (0), nRequested (0), bInvalid (true), nPartial (0), nDrawn (0), nSkippedInterval (0), nSkippedHysteresis (0), nSkippedText (0), nFullRefreshes (0), nPartialRefreshes (0), nLastCost (0), nMaxCost (0)
+    {
+        memset (bindings, 0, sizeof (bindings));
+    }
+
+    bool Begin (const void* pLayout, size_t nSize)
+    {
+        view = LayoutView::Open (pLayout, nSize);
+
+        if (view.IsValid () == false || view.GetScreens () == 0) return false;
+
+        if (epd.Init () != 0) return false;
+
+        bStarted = true;
+
+        return true;
+    }
+
+    /// Applied by the next update, with a full refresh
+    bool SetScreen (uint8_t nNewScreen)
+    {
+        if (view.IsValid () == false || nNewScreen >= view.GetScreens ()) return false;
+
+        nRequested = nNewScreen;
+
+        return true;
+    }
+
+    void Invalidate ()
+    {
+        bInvalid = true;
+    }
+
+    /// Redraws what changed, returns the number of widgets drawn
+    uint32_t Update ()
+    {
+        if (bStarted == false) return 0;
+
+        uint32_t nStart = micros ();
+        bool bFull = bInvalid || nScreen != nRequested;
+
+        nScreen = nRequested;
+        bInvalid = false;
+
+        const LayoutScreen& screen = view.Screen (nScreen);
+        uint32_t nCount = 0;
+        uint32_t nX0 = UINT32_MAX, nY0 = UINT32_MAX, nX1 = 0, nY1 = 0;
+
+        if (bFull) Blank ();
+
+        for (uint32_t nWidget = 0; nWidget < screen.nCount; nWidget++)
+        {
+            const LayoutWidget& widget = view.Widget (screen, nWidget);
+            DashboardBinding& binding = bindings[nWidget];
+
+            if (widget.nType == LAYOUT_WIDGET_TEXT)
+            {
+                if (bFull == false) continue;
+
+                binding.szText[0] = '\0';
+            }
+            else if (Bind (widget, binding, bFull) == false)
+            {
+                continue;
+            }
+
+            Draw (widget, binding);
+
+            nX0 = min (nX0, widget.nX);
+            nY0 = min (nY0, widget.nY);
+            nX1 = max (nX1, widget.nX + widget.nWidth);
+            nY1 = max (nY1, widget.nY + widget.nHeight);
+
+            nCount++;
+        }
+
+        nDrawn += nCount;
+
+        nLastCost = micros () - nStart;
+        if (nLastCost > nMaxCost) nMaxCost = nLastCost;
+
+        if (nCount == 0) return 0;
+
+        if (bFull || nPartial >= DASHBOARD_FULL_REFRESH)
+        {
+            Refresh ();
+
+            nPartial = 0;
+            nFullRefreshes++;
+        }
+        else
+        {
+            Refresh (nX0, nY0, nX1 - nX0, nY1 - nY0);
+
+            nPartial++;
+            nPartialRefreshes++;
+        }
+
+        return nCount;
+    }
+
+    uint32_t GetScreens () const
+    {
+        return view.IsValid () ? view.GetScreens () : 0;
+    }
+
+    void List (Stream& client)
+    {
+        for (uint32_t nCount = 0; nCount < GetScreens (); nCount++)
+        {
+            client.printf ("%u\t%s", nCount, nCount == nScreen ? "* " : "  ");
+            client.println ((const __FlashStringHelper*)view.Text (view.Screen (nCount).nName));
+        }
+    }
+
+    void Show (Stream& client)
+    {
+        if (view.IsValid () == false)
+        {
+            client.println (F ("No valid layout"));
+            return;
+        }
+
+        client.printf ("%-20s: [%u screens, %u bytes, crc %s]\r\n", "Layout", view.GetScreens (), view.Header ().nSize, view.Verify () ? "ok" : "bad");
+        client.printf ("%-20s: [%u] ", "Screen", nScreen);
+        client.println ((const __FlashStringHelper*)view.Text (view.Screen (nScreen).nName));
+        client.printf ("%-20s: [%s]\r\n", "Panel", bStarted ? "started" : "not started");
+        client.printf ("%-20s: [%u drawn]\r\n", "Widgets", nDrawn);
+        client.printf ("%-20s: [%u interval, %u hysteresis, %u same text]\r\n", "Redraws skipped", nSkippedInterval, nSkippedHysteresis, nSkippedText);
+        client.printf ("%-20s: [%u full, %u partial]\r\n", "Refreshes", nFullRefreshes, nPartialRefreshes);
+        client.printf ("%-20s: [%u / %u us]\r\n", "Draw last/max", nLastCost, nMaxCost);
+    }
+
+private:
+    /// Returns true when the widget has to be redrawn, cheap tests first
+    bool Bind (const LayoutWidget& widget, DashboardBinding& binding, bool bFull)
+    {
+        uint32_t nNow = millis ();
+        int32_t nValue = Dashboard_Read (widget.nSource);
+
+        if (bFull == false)
+        {
+            if (nNow - binding.nChanged < widget.nInterval)
+            {
+                nSkippedInterval++;
+                return false;
+            }
+
+            if (Abs (nValue - binding.nShown) < widget.nResolution / 2 + widget.nHysteresis)
+            {
+                nSkippedHysteresis++;
+                return false;
+            }
+        }
+
+        char szValue[sizeof (binding.szText)];
+
+        binding.nShown = Round (nValue, widget.nResolution);
+
+        Format (szValue, sizeof (szValue), widget, binding.nShown);
+
+        if (bFull == false && strcmp (szValue, binding.szText) == 0)
+        {
+            nSkippedText++;
+            return false;
+        }
+
+        memcpy (binding.szText, szValue, sizeof (szValue));
+        binding.nChanged = nNow;
+
+        return true;
+    }
+
+    /// Nearest multiple of nStep
+    static int32_t Round (int32_t nValue, int32_t nStep)
+    {
+        int32_t nRounded = (Abs (nValue) + nStep / 2) / nStep * nStep;
+
+        return nValue < 0 ? -nRounded : nRounded;
+    }
+
+    /// Renders the widget band by band into the panel memory
+    void Draw (const LayoutWidget& widget, const DashboardBinding& binding)
+    {
+        char szText[32];
+
+        // Strings live in flash, Paint reads them a byte at a time
+        strncpy_P (szText, view.Text (widget.nText), sizeof (szText) - 1);
+        szText[sizeof (szText) - 1] = '\0';
+
+        uint32_t nRows = DASHBOARD_BAND_BYTES / (widget.nWidth / 8);
+        Paint paint (band, widget.nWidth, nRows);
+
+        for (uint32_t nTop = 0; nTop < widget.nHeight; nTop += nRows)
+        {
+            uint32_t nHeight = min (nRows, widget.nHeight - nTop);
+
+            paint.SetHeight (nHeight);
+            Render (paint, widget, (int)nTop, szText, binding.szText, binding.nShown);
+
+            epd.SetPartialWindow (band, widget.nX, widget.nY + nTop, widget.nWidth, nHeight);
+        }
+    }
+
+    /// Draws the rows of the widget from nTop on, Paint clips the rest
+    void Render (Paint& paint, const LayoutWidget& widget, int nTop, const char* pszText, const char* pszValue, int32_t nValue)
+    {
+        int nInk = widget.nFlags & LAYOUT_INVERT ? DASHBOARD_UNCOLORED : DASHBOARD_COLORED;
+        int nWidth = (int)widget.nWidth;
+        int nHeight = (int)widget.nHeight;
+        int nY = -nTop;
+        int nCaption = 0;
+        sFONT* pFont = Dashboard_Font (widget.nFont);
+
+        // Paint::Clear a byte instead of a pixel at a time
+        memset (band, nInk == DASHBOARD_COLORED ? 0xFF : 0x00, nWidth / 8 * paint.GetHeight ());
+
+        if (widget.nFlags & LAYOUT_BORDER) paint.DrawRectangle (0, nY, nWidth - 1, nY + nHeight - 1, nInk);
+
+        if (widget.nType != LAYOUT_WIDGET_TEXT && pszText[0] != '\0')
+        {
+            paint.DrawStringAt (DASHBOARD_PADDING, nY + DASHBOARD_PADDING, pszText, &Font12, nInk);
+            nCaption = Font12.Height + 2;
+        }
+
+        switch (widget.nType)
+        {
+            case LAYOUT_WIDGET_TEXT:
+                paint.DrawStringAt (DASHBOARD_PADDING, nY + (nHeight - pFont->Height) / 2, pszText, pFont, nInk);
+                break;
+
+            case LAYOUT_WIDGET_VALUE:
+                paint.DrawStringAt (DASHBOARD_PADDING, nY + DASHBOARD_PADDING + nCaption + (nHeight - 2 * DASHBOARD_PADDING - nCaption - pFont->Height) / 2, pszValue, pFont, nInk);
+                break;
+
+            case LAYOUT_WIDGET_BAR:
+            {
+                int nLeft = DASHBOARD_PADDING;
+                int nRight = nWidth - 1 - DASHBOARD_PADDING;
+                int nBarTop = nY + DASHBOARD_PADDING + nCaption;
+                int nBarBottom = nY + nHeight - 1 - DASHBOARD_PADDING;
+                int32_t nClamped = Clamp (nValue, widget.nMin, widget.nMax);
+                int nFill = (int)((int64_t)(nClamped - widget.nMin) * (nRight - nLeft) / (widget.nMax - widget.nMin));
+
+                // Value on the caption line, right aligned
+                paint.DrawStringAt (nRight + 1 - (int)strlen (pszValue) * Font12.Width, nY + DASHBOARD_PADDING, pszValue, &Font12, nInk);
+
+                paint.DrawRectangle (nLeft, nBarTop, nRight, nBarBottom, nInk);
+
+                if (nFill > 0) paint.DrawFilledRectangle (nLeft, nBarTop, nLeft + nFill, nBarBottom, nInk);
+            }
+            break;
+        }
+    }
+
+    void Format (char* pszValue, size_t nSize, const LayoutWidget& widget, int32_t nValue)
+    {
+        char szUnit[8];
+
+        strncpy_P (szUnit, view.Text (widget.nUnit), sizeof (szUnit) - 1);
+        szUnit[sizeof (szUnit) - 1] = '\0';
+
+        if (widget.nFlags & LAYOUT_DURATION)
+        {
+            uint32_t nSeconds = (uint32_t)max (nValue, (int32_t)0) / 100;
+
+            if (widget.nResolution >= 60 * 100)
+                snprintf (pszValue, nSize, "%u:%02u%s", nSeconds / 3600, nSeconds / 60 % 60, szUnit);
+            else
+                snprintf (pszValue, nSize, "%u:%02u:%02u%s", nSeconds / 3600, nSeconds / 60 % 60, nSeconds % 60, szUnit);
+            return;
+        }
+
+        static const int32_t scales[] = {1, 10, 100};
+
+        uint32_t nDecimals = min (widget.nDecimals, (uint32_t)2);
+        int32_t nDivisor = 100 / scales[nDecimals];
+        int32_t nScaled = (Abs (nValue) + nDivisor / 2) / nDivisor;
+        const char* pszSign = nValue < 0 && nScaled > 0 ? "-" : "";
+
+        if (nDecimals == 0)
+            snprintf (pszValue, nSize, "%s%d %s", pszSign, (int)nScaled, szUnit);
+        else
+            snprintf (pszValue, nSize, "%s%d.%0*d %s", pszSign, (int)(nScaled / scales[nDecimals]), (int)nDecimals, (int)(nScaled % scales[nDecimals]), szUnit);
+    }
+
+    /// White panel memory, Epd::ClearFrame would also refresh
+    void Blank ()
+    {
+        epd.SendCommand (DATA_START_TRANSMISSION_1);
+
+        for (uint32_t nCount = 0; nCount < EPD_WIDTH / 8 * EPD_HEIGHT; nCount++) epd.SendData (0xFF);
+
+        epd.SendCommand (DATA_START_TRANSMISSION_2);
+
+        for (uint32_t nCount = 0; nCount < EPD_WIDTH / 8 * EPD_HEIGHT; nCount++) epd.SendData (0xFF);
+    }
+
+    /// Whole panel
+    void Refresh ()
+    {
+        epd.SetLut ();
+        epd.SendCommand (DISPLAY_REFRESH);
+
+        WaitIdle ();
+    }
+
+    /// Only the rectangle, the rest of the panel does not flash
+    void Refresh (uint32_t nX, uint32_t nY, uint32_t nWidth, uint32_t nHeight)
+    {
+        epd.SetLut ();
+        epd.SendCommand (PARTIAL_IN);
+
+        // Same window encoding as Epd::SetPartialWindow
+        epd.SendCommand (PARTIAL_WINDOW);
+        epd.SendData (nX >> 8);
+        epd.SendData (nX & 0xF8);
+        epd.SendData ((nX + nWidth - 1) >> 8);
+        epd.SendData (((nX + nWidth - 1) & 0xFF) | 0x07);
+        epd.SendData (nY >> 8);
+        epd.SendData (nY & 0xFF);
+        epd.SendData ((nY + nHeight - 1) >> 8);
+        epd.SendData ((nY + nHeight - 1) & 0xFF);
+        epd.SendData (0x01);
+
+        epd.SendCommand (DISPLAY_REFRESH);
+
+        WaitIdle ();
+
+        epd.SendCommand (PARTIAL_OUT);
+    }
+
+    /// BUSY is low while the panel refreshes
+    void WaitIdle ()
+    {
+        do
+        {
+            CorePartition_Sleep (100);
+        } while (digitalRead (BUSY_PIN) == LOW);
+    }
+
+    Epd epd;
+    LayoutView view;
+
+    uint8_t band[DASHBOARD_BAND_BYTES];
+    DashboardBinding bindings[LAYOUT_MAX_WIDGETS];
+
+    bool bStarted;
+    uint8_t nScreen;
+    uint8_t nRequested;
+    bool bInvalid;
+    uint32_t nPartial;
+
+    uint32_t nDrawn;
+    uint32_t nSkippedInterval;
+    uint32_t nSkippedHysteresis;
+    uint32_t nSkippedText;
+    uint32_t nFullRefreshes;
+    uint32_t nPartialRefreshes;
+    uint32_t nLastCost;
+    uint32_t nMaxCost;
+};
+
+Dashboard dashboard;
+
+#endif
@@ -0,0 +1,146 @@
+///
+/// @author   GUSTAVO CAMPOS
+/// @author   GUSTAVO CAMPOS
+/// @date   28/05/2019 19:44
+/// @version  <#version#>
+///
+/// @copyright  (c) GUSTAVO CAMPOS, 2019
+/// @copyright  Licence
+///
+/// @see    ReadMe.txt for references
+///
+//               GNU GENERAL PUBLIC LICENSE
+//                Version 3, 29 June 2007
+//
+// Copyright (C) 2007 Free Software Foundation, Inc. <https://fsf.org/>
+// Everyone is permitted to copy and distribute verbatim copies
+// of this license document, but changing it is not allowed.
+//
+// Preamble
+//
+// The GNU General Public License is a free, copyleft license for
+// software and other kinds of works.
+//
+// The licenses for most software and other practical works are designed
+// to take away your freedom to share and change the works.  By contrast,
+// the GNU General Public License is intended to guarantee your freedom to
+// share and change all versions of a program--to make sure it remains free
+// software for all its users.  We, the Free Software Foundation, use the
+// GNU General Public License for most of our software; it applies also to
+// any other work released this way by its authors.  You can apply it to
+// your programs, too.
+//
+// See LICENSE file for the complete information
+
+#ifndef ENCODING_HPP
+#define ENCODING_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+
+/// Checksums and integer encodings shared by the device and the host
+/// tools, no Arduino dependencies
+
+/// CRC-32 (IEEE 802.3), nibble table to keep flash usage small
+uint32_t Crc32 (const void* pData, size_t nSize, uint32_t nCrc = 0)
+{
+    static const uint32_t crcTable[16] = {
+        0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+        0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C};
+
+    const uint8_t* pBuffer = (const uint8_t*)pData;
+
+    nCrc = ~nCrc;
+
+    while (nSize--)
+    {
+        nCrc = crcTable[(nCrc ^ *pBuffer) & 0x0F] ^ (nCrc >> 4);
+        nCrc = crcTable[(nCrc ^ (*pBuffer >> 4)) & 0x0F] ^ (nCrc >> 4);
+        pBuffer++;
+    }
+
+    return ~nCrc;
+}
+
+/// CRC-32 of a word sized blob read 32 bits at a time, so it also runs
+/// on flash mapped memory; word nSkip (the blob's own CRC) counts as 0
+uint32_t Crc32_Words (const void* pData, uint32_t nSize, uint32_t nSkip)
+{
+    const uint32_t* pWords = (const uint32_t*)pData;
+    uint32_t nCrc = 0;
+
+    for (uint32_t nIndex = 0; nIndex < nSize / 4; nIndex++)
+    {
+        uint32_t nWord = nIndex == nSkip ? 0 : pWords[nIndex];
+
+        nCrc = Crc32 (&nWord, sizeof (nWord), nCrc);
+    }
+
+    return nCrc;
+}
+
+/// Table of nCount records of nRecordSize bytes at nOffset in a blob
+/// of nSize bytes whose header takes nHeaderSize: word aligned, after
+/// the header and inside the blob. Written as a subtraction, a sum
+/// could wrap past nSize. Shared by the recipe, layout and script
+/// readers.
+inline bool Blob_CheckTable (uint32_t nHeaderSize, uint32_t nSize, uint32_t nOffset, uint32_t nCount, uint32_t nRecordSize, uint32_t nMaxCount)
+{
+    return nCount <= nMaxCount && (nOffset & 3) == 0 && nOffset >= nHeaderSize && nOffset <= nSize &&
+           (uint64_t)nCount * nRecordSize <= nSize - nOffset;
+}
+
+/// String offset into the same blob, its pool ends in a NUL
+inline bool Blob_CheckText (uint32_t nHeaderSize, uint32_t nSize, uint32_t nOffset)
+{
+    return nOffset >= nHeaderSize && nOffset < nSize;
+}
+
+/// LEB128 varint, returns bytes written (at most 5)
+uint8_t Varint_Write (uint8_t* pBuffer, uint32_t nValue)
+{
+    uint8_t nCount = 0;
+
+    while (nValue >= 0x80)
+    {
+        pBuffer[nCount++] = (uint8_t)(nValue | 0x80);
+        nValue >>= 7;
+    }
+
+    pBuffer[nCount++] = (uint8_t)nValue;
+
+    return nCount;
+}
+
+/// Returns bytes read, 0 if the varint runs past nSize
+uint8_t Varint_Read (const uint8_t* pBuffer, size_t nSize, uint32_t& nValue)
+{
+    uint8_t nCount = 0;
+
+    nValue = 0;
+
+    while (nCount < nSize && nCount < 5)
+    {
+        uint8_t nByte = pBuffer[nCount];
+
+        nValue |= (uint32_t)(nByte & 0x7F) << (7 * nCount);
+        nCount++;
+
+        if ((nByte & 0x80) == 0) return nCount;
+    }
+
+    return 0;
+}
+
+/// Signed to unsigned so small negative deltas stay short as varints
+inline uint32_t ZigZag_Encode (int32_t nValue)
+{
+    return ((uint32_t)nValue << 1) ^ (uint32_t)(nValue >> 31);
+}
+
+inline int32_t ZigZag_Decode (uint32_t nValue)
+{
+    return (int32_t)(nValue >> 1) ^ -(int32_t)(nValue & 1);
+}
+
+#endif
@@ -0,0 +1,408 @@
+///
+/// @author   GUSTAVO CAMPOS
+/// @author   GUSTAVO CAMPOS
+/// @date   28/05/2019 19:44
+/// @version  <#version#>
+///
+/// @copyright  (c) GUSTAVO CAMPOS, 2019
+/// @copyright  Licence
+///
+/// @see    ReadMe.txt for references
+///
+//               GNU GENERAL PUBLIC LICENSE
+//                Version 3, 29 June 2007
+//
+// Copyright (C) 2007 Free Software Foundation, Inc. <https://fsf.org/>
+// Everyone is permitted to copy and distribute verbatim copies
+// of this license document, but changing it is not allowed.
+//
+// Preamble
+//
+// The GNU General Public License is a free, copyleft license for
+// software and other kinds of works.
+//
+// The licenses for most software and other practical works are designed
+// to take away your freedom to share and change the works.  By contrast,
+// the GNU General Public License is intended to guarantee your freedom to
+// share and change all versions of a program--to make sure it remains free
+// software for all its users.  We, the Free Software Foundation, use the
+// GNU General Public License for most of our software; it applies also to
+// any other work released this way by its authors.  You can apply it to
+// your programs, too.
+//
+// See LICENSE file for the complete information
+
+#ifndef EVENT_SIMULATION_HPP
+#define EVENT_SIMULATION_HPP
+
+#include "Arduino.h"
+
+#include "VesselModel.hpp"
+
+/// Discrete event mode of the brewing simulation
+///
+/// Long phases, a fermentation runs for days, change inputs only a
+/// few times, so instead of one fixed step per second the simulation
+/// jumps from event to event with the exact solution for constant
+/// inputs (VesselAdvance). Events are timed inputs kept in a binary
+/// heap ordered by time, then by scheduling order: duty, extra power,
+/// thermostat setpoints and additions. A thermostat vessel also has
+/// one threshold crossing pending, the time the current curve reaches
+/// the band edge (VesselTimeTo), rounded up to the next second and
+/// recomputed whenever the vessel inputs change, so a crossing is
+/// never stale and needs no slot in the heap.
+///
+/// A 14 day ferment is a few hundred spans whatever the simulated
+/// time, the cost is per event, not per second.
+
+#ifndef SIMULATION_EVENTS
+#define SIMULATION_EVENTS 32
+#endif
+
+static_assert (SIMULATION_EVENTS < 128, "Event heap indexes are 8 bit");
+
+#define SIMULATION_NEVER 0xFFFFFFFF
+
+enum SimulationEventType : uint8_t
+{
+    SIMULATION_EVENT_DUTY = 0, // heater duty 0..1, turns the thermostat off
+    SIMULATION_EVENT_POWER,    // extra power in kW, fermentation heat, a jacket
+    SIMULATION_EVENT_SETPOINT, // thermostat at nValue C +/- nArgument K, band 0 turns it off
+    SIMULATION_EVENT_ADD       // nValue kg of nIngredient at nArgument C
+};
+
+template <typename Number>
+struct SimulationEvent
+{
+    uint32_t nTime;     // simulated seconds
+    uint32_t nSequence; // keeps events of the same second in order
+    uint8_t nType;
+    uint8_t nVessel;
+    uint8_t nIngredient;
+    Number nValue;
+    Number nArgument;
+};
+
+/// On/off heater control with hysteresis, the heater turns on at the
+/// low edge of the band and off at the high edge
+template <typename Number>
+struct SimulationThermostat
+{
+    bool bEnabled;
+    Number nSetpoint;
+    Number nBand;
+    uint32_t nCrossing; // next band edge, SIMULATION_NEVER if none
+};
+
+template <typename Number>
+class EventSimulation
+{
+public:
+    explicit EventSimulation (Simulation<Number>& simulationRef) : simulation (simulationRef), nCount (0), nSequence (0), nProcessed (0), nCrossings (0), nSpans (0), nDropped (0)
+    {
+        Clear ();
+    }
+
+    /// Queues an input for the simulated second nTime, false when full
+    bool Schedule (uint32_t nTime, SimulationEventType nType, uint8_t nVessel, Number nValue, Number nArgument = Number (0), IngredientType nIngredient = INGREDIENT_WATER)
+    {
+        if (nCount >= SIMULATION_EVENTS)
+        {
+            nDropped++;
+            return false;
+        }
+
+        SimulationEvent<Number>& event = events[nCount];
+
+        event.nTime = nTime;
+        event.nSequence = nSequence++;
+        event.nType = nType;
+        event.nVessel = nVessel % SIMULATION_VESSELS;
+        event.nIngredient = nIngredient;
+        event.nValue = nValue;
+        event.nArgument = nArgument;
+
+        SiftUp (nCount++);
+
+        return true;
+    }
+
+    /// Drops pending events and turns every thermostat off
+    void Clear ()
+    {
+        nCount = 0;
+
+        for (uint8_t nVessel = 0; nVessel < SIMULATION_VESSELS; nVessel++)
+        {
+            thermostats[nVessel].bEnabled = false;
+            thermostats[nVessel].nSetpoint = Number (0);
+            thermostats[nVessel].nBand = Number (0);
+            thermostats[nVessel].nCrossing = SIMULATION_NEVER;
+        }
+    }
+
+    /// Applies every event and crossing due up to nUntil, integrating
+    /// the spans in between, and ends at nUntil. Crossings are planned
+    /// again first, the inputs may have been changed from outside.
+    /// While the plant flows the spans take fixed steps, after
+    /// nMaxSteps of them it stops short and returns false, the next
+    /// call resumes from there
+    bool Run (uint32_t nUntil, uint32_t nMaxSteps = UINT32_MAX)
+    {
+        for (uint8_t nVessel = 0; nVessel < SIMULATION_VESSELS; nVessel++)
+        {
+            Plan (nVessel);
+        }
+
+        while (true)
+        {
+            uint8_t nVessel = 0;
+            uint32_t nCrossing = NextCrossing (nVessel);
+            uint32_t nEvent = nCount > 0 ? events[0].nTime : SIMULATION_NEVER;
+            uint32_t nNext = min (nCrossing, nEvent);
+
+            if (nNext == SIMULATION_NEVER || nNext > nUntil) break;
+
+            if (AdvanceTo (nNext, nMaxSteps) == false) return false;
+
+            // Events first on a tie, they may move the setpoint
+            if (nEvent <= nCrossing)
+            {
+                Apply (Pop ());
+                nProcessed++;
+            }
+            else
+            {
+                Regulate (nVessel);
+                nCrossings++;
+            }
+        }
+
+        return AdvanceTo (nUntil, nMaxSteps);
+    }
+
+    /// Next event or crossing, SIMULATION_NEVER when nothing is due
+    uint32_t GetNext () const
+    {
+        uint8_t nVessel = 0;
+        uint32_t nCrossing = NextCrossing (nVessel);
+
+        return nCount > 0 && events[0].nTime < nCrossing ? events[0].nTime : nCrossing;
+    }
+
+    uint8_t GetCount () const
+    {
+        return nCount;
+    }
+
+    /// Pending events in heap order, not sorted
+    const SimulationEvent<Number>& Event (uint8_t nIndex) const
+    {
+        return events[nIndex];
+    }
+
+    const SimulationThermostat<Number>& Thermostat (uint8_t nVessel) const
+    {
+        return thermostats[nVessel % SIMULATION_VESSELS];
+    }
+
+    uint32_t GetProcessed () const
+    {
+        return nProcessed;
+    }
+
+    uint32_t GetCrossings () const
+    {
+        return nCrossings;
+    }
+
+    uint32_t GetSpans () const
+    {
+        return nSpans;
+    }
+
+    uint32_t GetDropped () const
+    {
+        return nDropped;
+    }
+
+    /// Visits the state a checkpoint keeps (Checkpoint.hpp), the same
+    /// call saves and restores
+    template <typename Archive>
+    void Checkpoint (Archive& archive)
+    {
+        archive (events);
+        archive (nCount);
+        archive (nSequence);
+        archive (thermostats);
+        archive (nProcessed);
+        archive (nCrossings);
+        archive (nSpans);
+        archive (nDropped);
+    }
+
+private:
+    /// False when the step budget ran out before nTime
+    bool AdvanceTo (uint32_t nTime, uint32_t& nMaxSteps)
+    {
+        if (nTime <= simulation.GetTime ()) return true;
+
+        nMaxSteps -= simulation.Skip (nTime - simulation.GetTime (), nMaxSteps);
+        nSpans++;
+
+        return simulation.GetTime () >= nTime;
+    }
+
+    void Apply (const SimulationEvent<Number>& event)
+    {
+        SimulationThermostat<Number>& thermostat = thermostats[event.nVessel];
+
+        switch (event.nType)
+        {
+            case SIMULATION_EVENT_DUTY:
+                thermostat.bEnabled = false;
+                simulation.SetDuty (event.nVessel, event.nValue);
+                break;
+
+            case SIMULATION_EVENT_POWER:
+                simulation.Vessel (event.nVessel).nExtraPower = event.nValue;
+                break;
+
+            case SIMULATION_EVENT_SETPOINT:
+                thermostat.bEnabled = event.nArgument > Number (0);
+                thermostat.nSetpoint = event.nValue;
+                thermostat.nBand = event.nArgument;
+
+                if (thermostat.bEnabled == false) simulation.SetDuty (event.nVessel, Number (0));
+                break;
+
+            case SIMULATION_EVENT_ADD:
+                simulation.Add (event.nVessel, (IngredientType)event.nIngredient, event.nValue, event.nArgument);
+                break;
+        }
+
+        Regulate (event.nVessel);
+    }
+
+    /// Switches the heater at the band edges and plans the next crossing
+    void Regulate (uint8_t nVessel)
+    {
+        SimulationThermostat<Number>& thermostat = thermostats[nVessel];
+
+        if (thermostat.bEnabled)
+        {
+            Number nTemperature = simulation.Vessel (nVessel).nTemperature;
+
+            if (nTemperature <= thermostat.nSetpoint - thermostat.nBand)
+                simulation.SetDuty (nVessel, Number (1));
+            else if (nTemperature >= thermostat.nSetpoint + thermostat.nBand)
+                simulation.SetDuty (nVessel, Number (0));
+        }
+
+        Plan (nVessel);
+    }
+
+    /// Time the vessel reaches the band edge it is heading to, at
+    /// least one second ahead so a crossing always makes progress
+    void Plan (uint8_t nVessel)
+    {
+        SimulationThermostat<Number>& thermostat = thermostats[nVessel];
+        const VesselState<Number>& vessel = simulation.Vessel (nVessel);
+
+        thermostat.nCrossing = SIMULATION_NEVER;
+
+        if (thermostat.bEnabled == false) return;
+
+        Number nEdge = vessel.nDuty > Number (0) ? thermostat.nSetpoint + thermostat.nBand : thermostat.nSetpoint - thermostat.nBand;
+        double nTime = VesselTimeTo (vessel, simulation.Params (nVessel), ToDouble (nEdge));
+
+        if (nTime < 0 || nTime >= (double)(SIMULATION_NEVER - simulation.GetTime ())) return;
+
+        thermostat.nCrossing = simulation.GetTime () + max ((uint32_t)1, (uint32_t)ceil (nTime));
+    }
+
+    uint32_t NextCrossing (uint8_t& nVessel) const
+    {
+        uint32_t nNext = SIMULATION_NEVER;
+
+        for (uint8_t nCount = 0; nCount < SIMULATION_VESSELS; nCount++)
+        {
+            if (thermostats[nCount].nCrossing < nNext)
+            {
+                nNext = thermostats[nCount].nCrossing;
+                nVessel = nCount;
+            }
+        }
+
+        return nNext;
+    }
+
+    static bool Before (const SimulationEvent<Number>& first, const SimulationEvent<Number>& second)
+    {
+        return first.nTime != second.nTime ? first.nTime < second.nTime : (int32_t)(first.nSequence - second.nSequence) < 0;
+    }
+
+    SimulationEvent<Number> Pop ()
+    {
+        SimulationEvent<Number> event = events[0];
+
+        events[0] = events[--nCount];
+        SiftDown (0);
+
+        return event;
+    }
+
+    void SiftUp (uint8_t nIndex)
+    {
+        while (nIndex > 0)
+        {
+            uint8_t nParent = (nIndex - 1) / 2;
+
+            if (Before (events[nIndex], events[nParent]) == false) break;
+
+            Swap (nIndex, nParent);
+            nIndex = nParent;
+        }
+    }
+
+    void SiftDown (uint8_t nIndex)
+    {
+        while (true)
+        {
+            uint8_t nFirst = nIndex;
+            uint8_t nLeft = nIndex * 2 + 1;
+            uint8_t nRight = nLeft + 1;
+
+            if (nLeft < nCount && Before (events[nLeft], events[nFirst])) nFirst = nLeft;
+            if (nRight < nCount && Before (events[nRight], events[nFirst])) nFirst = nRight;
+
+            if (nFirst == nIndex) break;
+
+            Swap (nIndex, nFirst);
+            nIndex = nFirst;
+        }
+    }
+
+    void Swap (uint8_t nFirst, uint8_t nSecond)
+    {
+        SimulationEvent<Number> event = events[nFirst];
+
+        events[nFirst] = events[nSecond];
+        events[nSecond] = event;
+    }
+
+    Simulation<Number>& simulation;
+
+    SimulationEvent<Number> events[SIMULATION_EVENTS];
+    uint8_t nCount;
+    uint32_t nSequence;
+
+    SimulationThermostat<Number> thermostats[SIMULATION_VESSELS];
+
+    uint32_t nProcessed;
+    uint32_t nCrossings;
+    uint32_t nSpans;
+    uint32_t nDropped;
+};
+
+#endif
@@ -0,0 +1,231 @@
+///
+/// @author   GUSTAVO CAMPOS
+/// @author   GUSTAVO CAMPOS
+/// @date   28/05/2019 19:44
+/// @version  <#version#>
+///
+/// @copyright  (c) GUSTAVO CAMPOS, 2019
+/// @copyright  Licence
+///
+/// @see    ReadMe.txt for references
+///
+//               GNU GENERAL PUBLIC LICENSE
+//                Version 3, 29 June 2007
+//
+// Copyright (C) 2007 Free Software Foundation, Inc. <https://fsf.org/>
+// Everyone is permitted to copy and distribute verbatim copies
+// of this license document, but changing it is not allowed.
+//
+// Preamble
+//
+// The GNU General Public License is a free, copyleft license for
+// software and other kinds of works.
+//
+// The licenses for most software and other practical works are designed
+// to take away your freedom to share and change the works.  By contrast,
+// the GNU General Public License is intended to guarantee your freedom to
+// share and change all versions of a program--to make sure it remains free
+// software for all its users.  We, the Free Software Foundation, use the
+// GNU General Public License for most of our software; it applies also to
+// any other work released this way by its authors.  You can apply it to
+// your programs, too.
+//
+// See LICENSE file for the complete information
+
+#ifndef FERMENTATION_HPP
+#define FERMENTATION_HPP
+
+#include "Arduino.h"
+
+#include "FixedPoint.hpp"
+#include "OdeSolver.hpp"
+
+/// Fermentation kinetics
+///
+/// Yeast X, fermentable sugar S and ethanol E in g/L, time in hours
+/// so rates stay inside Q16.16. Sugar uptake is Monod in S, linear in
+/// X, inhibited by ethanol and scaled by temperature (doubling every
+/// 10 K around 20 C); a share of it becomes new yeast up to a ceiling
+/// and the rest splits into ethanol and CO2 by the Gay-Lussac
+/// balance. Every gram of sugar fermented releases heat, which is fed
+/// back into the fermenter as extra power.
+///
+/// Temperature is held constant over an Advance call (the vessel
+/// model and the kinetics are coupled once per call) and the ODE is
+/// integrated by Rk23 with step control, Fixed on the device, double
+/// on the host.
+
+namespace Kinetics
+{
+    const double nUptake = 2.0;             // g sugar / g yeast / h at 20 C
+    const double nSaturation = 5.0;         // g/L, Monod constant for sugar
+    const double nInhibition = 100.0;       // g/L ethanol that stops uptake
+    const double nYield = 0.1;              // g yeast / g sugar
+    const double nYeastCeiling = 1.0;       // g/L
+    const double nDecay = 0.002;            // 1/h
+    const double nEthanolShare = 0.511;     // g ethanol / g sugar, the rest is CO2
+    const double nHeat = 0.586;             // kJ / g sugar
+    const double nTemperatureRate = 0.0693; // 1/K, ln 2 / 10
+    const double nExtract = 0.385;          // gravity points per g/L of extract
+};
+
+template <typename Number>
+class Fermentation
+{
+public:
+    enum
+    {
+        FERMENTATION_YEAST = 0,
+        FERMENTATION_SUGAR,
+        FERMENTATION_ETHANOL,
+        FERMENTATION_SIZE
+    };
+
+    Fermentation () : nUnfermentable (Number (0)), nFactor (Number (1)), nHeat (Number (0)), bActive (false)
+    {
+        static const Number tolerance[FERMENTATION_SIZE] = {Number (0.005), Number (0.05), Number (0.05)};
+
+        solver.Configure (tolerance, Number (1.0 / 64), Number (4.0));
+
+        Reset ();
+    }
+
+    void Reset ()
+    {
+        for (uint8_t nCount = 0; nCount < FERMENTATION_SIZE; nCount++)
+        {
+            state[nCount] = Number (0);
+        }
+
+        nUnfermentable = Number (0);
+        nHeat = Number (0);
+        bActive = false;
+    }
+
+    /// Starts a batch: original gravity in points (50 for 1.050), the
+    /// fermentable share of the extract and the pitch in g/L dry yeast
+    void Pitch (Number nGravity, Number nAttenuation, Number nYeast)
+    {
+        Number nTotal = nGravity / Number (Kinetics::nExtract);
+
+        state[FERMENTATION_YEAST] = nYeast;
+        state[FERMENTATION_SUGAR] = nTotal * Clamp (nAttenuation, Number (0), Number (1));
+        state[FERMENTATION_ETHANOL] = Number (0);
+        nUnfermentable = nTotal - state[FERMENTATION_SUGAR];
+        nHeat = Number (0);
+        bActive = true;
+    }
+
+    /// Integrates nSeconds at nTemperature, returns the heat released
+    /// by a batch of nVolume litres in kW at the end of the span
+    Number Advance (uint32_t nSeconds, Number nTemperature, Number nVolume)
+    {
+        if (bActive == false || nSeconds == 0) return nHeat;
+
+        // Once per call, in double: no exp in the derivatives
+        nFactor = Number (Kinetics::nUptake * exp (Kinetics::nTemperatureRate * (ToDouble (nTemperature) - 20.0)));
+
+        solver.Integrate (*this, state, Number (nSeconds / 3600.0));
+
+        nHeat = Uptake (state) * nVolume * Number (Kinetics::nHeat) / Number (3600);
+
+        return nHeat;
+    }
+
+    /// Right hand side for Rk23, g/L/h
+    void Derivatives (const Number* pState, Number* pRate) const
+    {
+        Number nUptake = Uptake (pState);
+        Number nRoom = Number (1) - pState[FERMENTATION_YEAST] / Number (Kinetics::nYeastCeiling);
+
+        if (nRoom < Number (0)) nRoom = Number (0);
+
+        pRate[FERMENTATION_YEAST] = Number (Kinetics::nYield) * nUptake * nRoom - Number (Kinetics::nDecay) * pState[FERMENTATION_YEAST];
+        pRate[FERMENTATION_SUGAR] = -nUptake;
+        pRate[FERMENTATION_ETHANOL] = Number (Kinetics::nEthanolShare) * nUptake;
+    }
+
+    bool IsActive () const
+    {
+        return bActive;
+    }
+
+    Number GetYeast () const
+    {
+        return state[FERMENTATION_YEAST];
+    }
+
+    Number GetSugar () const
+    {
+        return state[FERMENTATION_SUGAR];
+    }
+
+    Number GetEthanol () const
+    {
+        return state[FERMENTATION_ETHANOL];
+    }
+
+    /// g/L released since pitching
+    Number GetCo2 () const
+    {
+        return state[FERMENTATION_ETHANOL] * Number ((1 - Kinetics::nEthanolShare) / Kinetics::nEthanolShare);
+    }
+
+    /// Real extract in gravity points, ethanol not accounted
+    Number GetGravity () const
+    {
+        return (state[FERMENTATION_SUGAR] + nUnfermentable) * Number (Kinetics::nExtract);
+    }
+
+    /// % by volume, ethanol density 789 g/L
+    Number GetAbv () const
+    {
+        return state[FERMENTATION_ETHANOL] / Number (7.89);
+    }
+
+    /// kW at the end of the last span
+    Number GetHeat () const
+    {
+        return nHeat;
+    }
+
+    const Rk23<Number, FERMENTATION_SIZE>& Solver () const
+    {
+        return solver;
+    }
+
+    /// Visits the state a checkpoint keeps (Checkpoint.hpp), the same
+    /// call saves and restores
+    template <typename Archive>
+    void Checkpoint (Archive& archive)
+    {
+        archive (state);
+        archive (nUnfermentable);
+        archive (nFactor);
+        archive (nHeat);
+        archive (bActive);
+
+        solver.Checkpoint (archive);
+    }
+
+private:
+    Number Uptake (const Number* pState) const
+    {
+        Number nSugar = pState[FERMENTATION_SUGAR];
+        Number nInhibition = Number (1) - pState[FERMENTATION_ETHANOL] / Number (Kinetics::nInhibition);
+
+        if (nSugar <= Number (0) || nInhibition <= Number (0) || pState[FERMENTATION_YEAST] <= Number (0)) return Number (0);
+
+        return nFactor * nSugar / (Number (Kinetics::nSaturation) + nSugar) * pState[FERMENTATION_YEAST] * nInhibition;
+    }
+
+    Number state[FERMENTATION_SIZE];
+    Number nUnfermentable;
+    Number nFactor; // uptake at the current temperature
+    Number nHeat;
+    bool bActive;
+
+    Rk23<Number, FERMENTATION_SIZE> solver;
+};
+
+#endif
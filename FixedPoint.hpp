@@ -0,0 +1,231 @@
+///
+/// @author   GUSTAVO CAMPOS
+/// @author   GUSTAVO CAMPOS
+/// @date   28/05/2019 19:44
+/// @version  <#version#>
+///
+/// @copyright  (c) GUSTAVO CAMPOS, 2019
+/// @copyright  Licence
+///
+/// @see    ReadMe.txt for references
+///
+//               GNU GENERAL PUBLIC LICENSE
+//                Version 3, 29 June 2007
+//
+// Copyright (C) 2007 Free Software Foundation, Inc. <https://fsf.org/>
+// Everyone is permitted to copy and distribute verbatim copies
+// of this license document, but changing it is not allowed.
+//
+// Preamble
+//
+// The GNU General Public License is a free, copyleft license for
+// software and other kinds of works.
+//
+// The licenses for most software and other practical works are designed
+// to take away your freedom to share and change the works.  By contrast,
+// the GNU General Public License is intended to guarantee your freedom to
+// share and change all versions of a program--to make sure it remains free
+// software for all its users.  We, the Free Software Foundation, use the
+// GNU General Public License for most of our software; it applies also to
+// any other work released this way by its authors.  You can apply it to
+// your programs, too.
+//
+// See LICENSE file for the complete information
+
+#ifndef FIXED_POINT_HPP
+#define FIXED_POINT_HPP
+
+#include <stdint.h>
+
+/// Q16.16 fixed point
+///
+/// The ESP8266 has no FPU, every float operation is a library call.
+/// Fixed keeps 16 bits of integer and 16 bits of fraction in an
+/// int32_t, range is about +/-32767 with 1/65536 resolution.
+/// Construction from a double is constexpr so literal constants fold
+/// at compile time; the same model code is instantiated with Fixed on
+/// the device and with double on the host.
+class Fixed
+{
+public:
+    static const int32_t nOne = 65536;
+
+    constexpr Fixed () : nRaw (0)
+    {
+    }
+
+    /// Integers saturate outside -32768..32767 like doubles do
+    constexpr Fixed (int nValue) : nRaw (nValue > 32767 ? INT32_MAX : nValue < -32768 ? INT32_MIN : (int32_t)nValue * nOne)
+    {
+    }
+
+    constexpr Fixed (unsigned int nValue) : nRaw (nValue > 32767 ? INT32_MAX : (int32_t)nValue * nOne)
+    {
+    }
+
+    /// Saturates outside +/-32768, NaN is 0
+    constexpr Fixed (double nValue) : nRaw (Saturate (nValue * nOne + (nValue >= 0 ? 0.5 : -0.5)))
+    {
+    }
+
+    static constexpr Fixed FromRaw (int32_t nRawValue)
+    {
+        return Fixed (nRawValue, true);
+    }
+
+    constexpr int32_t Raw () const
+    {
+        return nRaw;
+    }
+
+    /// Rounded to nearest integer
+    constexpr int32_t ToInt () const
+    {
+        return (nRaw + (nRaw >= 0 ? nOne / 2 : -nOne / 2)) / nOne;
+    }
+
+    /// Value * 100 rounded, used to print and log without floats
+    int32_t ToCenti () const
+    {
+        int64_t nValue = (int64_t)nRaw * 100;
+
+        return (int32_t)((nValue + (nValue >= 0 ? nOne / 2 : -nOne / 2)) / nOne);
+    }
+
+    double ToDouble () const
+    {
+        return (double)nRaw / nOne;
+    }
+
+    constexpr Fixed operator- () const
+    {
+        return FromRaw (-nRaw);
+    }
+
+    constexpr Fixed operator+ (Fixed nValue) const
+    {
+        return FromRaw (nRaw + nValue.nRaw);
+    }
+
+    constexpr Fixed operator- (Fixed nValue) const
+    {
+        return FromRaw (nRaw - nValue.nRaw);
+    }
+
+    constexpr Fixed operator* (Fixed nValue) const
+    {
+        return FromRaw ((int32_t)(((int64_t)nRaw * nValue.nRaw + nOne / 2) >> 16));
+    }
+
+    Fixed operator/ (Fixed nValue) const
+    {
+        if (nValue.nRaw == 0) return FromRaw (nRaw >= 0 ? INT32_MAX : INT32_MIN);
+
+        // Multiplied, a left shift of a negative value is undefined
+        int64_t nQuotient = (int64_t)nRaw * nOne / nValue.nRaw;
+
+        return FromRaw (nQuotient > INT32_MAX ? INT32_MAX : nQuotient < INT32_MIN ? INT32_MIN : (int32_t)nQuotient);
+    }
+
+    Fixed& operator+= (Fixed nValue)
+    {
+        nRaw += nValue.nRaw;
+        return *this;
+    }
+
+    Fixed& operator-= (Fixed nValue)
+    {
+        nRaw -= nValue.nRaw;
+        return *this;
+    }
+
+    Fixed& operator*= (Fixed nValue)
+    {
+        *this = *this * nValue;
+        return *this;
+    }
+
+    Fixed& operator/= (Fixed nValue)
+    {
+        *this = *this / nValue;
+        return *this;
+    }
+
+    constexpr bool operator== (Fixed nValue) const
+    {
+        return nRaw == nValue.nRaw;
+    }
+
+    constexpr bool operator!= (Fixed nValue) const
+    {
+        return nRaw != nValue.nRaw;
+    }
+
+    constexpr bool operator< (Fixed nValue) const
+    {
+        return nRaw < nValue.nRaw;
+    }
+
+    constexpr bool operator<= (Fixed nValue) const
+    {
+        return nRaw <= nValue.nRaw;
+    }
+
+    constexpr bool operator> (Fixed nValue) const
+    {
+        return nRaw > nValue.nRaw;
+    }
+
+    constexpr bool operator>= (Fixed nValue) const
+    {
+        return nRaw >= nValue.nRaw;
+    }
+
+private:
+    constexpr Fixed (int32_t nRawValue, bool) : nRaw (nRawValue)
+    {
+    }
+
+    static constexpr int32_t Saturate (double nScaled)
+    {
+        return nScaled != nScaled ? 0 : nScaled >= 2147483647.0 ? INT32_MAX : nScaled <= -2147483648.0 ? INT32_MIN : (int32_t)nScaled;
+    }
+
+    int32_t nRaw;
+};
+
+/// Helpers shared by Fixed and double instantiations
+
+inline double ToDouble (double nValue)
+{
+    return nValue;
+}
+
+inline double ToDouble (Fixed nValue)
+{
+    return nValue.ToDouble ();
+}
+
+inline int32_t ToCenti (double nValue)
+{
+    return (int32_t)(nValue * 100.0 + (nValue >= 0 ? 0.5 : -0.5));
+}
+
+inline int32_t ToCenti (Fixed nValue)
+{
+    return nValue.ToCenti ();
+}
+
+template <typename Number>
+inline Number Clamp (Number nValue, Number nMin, Number nMax)
+{
+    return nValue < nMin ? nMin : (nValue > nMax ? nMax : nValue);
+}
+
+template <typename Number>
+inline Number Abs (Number nValue)
+{
+    return nValue < Number (0) ? -nValue : nValue;
+}
+
+#endif
@@ -0,0 +1,140 @@
+///
+/// @author   GUSTAVO CAMPOS
+/// @author   GUSTAVO CAMPOS
+/// @date   28/05/2019 19:44
+/// @version  <#version#>
+///
+/// @copyright  (c) GUSTAVO CAMPOS, 2019
+/// @copyright  Licence
+///
+/// @see    ReadMe.txt for references
+///
+//               GNU GENERAL PUBLIC LICENSE
+//                Version 3, 29 June 2007
+//
+// Copyright (C) 2007 Free Software Foundation, Inc. <https://fsf.org/>
+// Everyone is permitted to copy and distribute verbatim copies
+// of this license document, but changing it is not allowed.
+//
+// Preamble
+//
+// The GNU General Public License is a free, copyleft license for
+// software and other kinds of works.
+//
+// The licenses for most software and other practical works are designed
+// to take away your freedom to share and change the works.  By contrast,
+// the GNU General Public License is intended to guarantee your freedom to
+// share and change all versions of a program--to make sure it remains free
+// software for all its users.  We, the Free Software Foundation, use the
+// GNU General Public License for most of our software; it applies also to
+// any other work released this way by its authors.  You can apply it to
+// your programs, too.
+//
+// See LICENSE file for the complete information
+
+#ifndef FLASH_LOG_FORMAT_HPP
+#define FLASH_LOG_FORMAT_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "Encoding.hpp"
+
+/// Flash log page format
+///
+/// A page is FLASH_LOG_PAGE bytes: the header below, then nBytes of
+/// payload holding nRecords records, the rest zero. All fields are
+/// little endian. A record is
+///
+///   varint   time delta, seconds since the previous record
+///   varint   zigzag delta of channel 0, hundredths
+///   ...      one per channel, nChannels in all
+///
+/// The first record of a page is absolute: its time delta is 0 from
+/// nFirstTime and its values are deltas from 0, so any page decodes
+/// alone. nCrc is the CRC-32 of the header with nCrc = 0 followed by
+/// the nBytes of payload. "flashlog export" prints every page as one
+/// line, ':' and the page in hex; host/flashlog decodes that.
+///
+/// No Arduino dependencies, shared with the host tools.
+
+#ifndef FLASH_LOG_PAGE
+#define FLASH_LOG_PAGE 256
+#endif
+
+#define FLASH_LOG_MAGIC 0xB10C
+
+/// Most channels a decoder accepts in a page
+#define FLASH_LOG_MAX_CHANNELS 16
+
+struct FlashLogHeader
+{
+    uint16_t nMagic;
+    uint8_t nChannels;
+    uint8_t nRecords;
+    uint16_t nBytes; // payload used
+    uint16_t nReserved;
+    uint32_t nFirstTime;
+    uint32_t nLastTime;
+    uint32_t nCrc; // header with nCrc = 0, then nBytes of payload
+};
+
+struct FlashLogPage : FlashLogHeader
+{
+    uint8_t payload[FLASH_LOG_PAGE - sizeof (FlashLogHeader)];
+};
+
+static_assert (sizeof (FlashLogPage) == FLASH_LOG_PAGE, "Flash log page must fill FLASH_LOG_PAGE");
+
+inline uint32_t FlashLog_PageCrc (const FlashLogPage& source)
+{
+    FlashLogHeader header = source;
+
+    header.nCrc = 0;
+
+    return Crc32 (source.payload, source.nBytes, Crc32 (&header, sizeof (header)));
+}
+
+/// Calls pFunction (nTime, pnValues) for every record in a page,
+/// pnValues holds nChannels values in hundredths; false on a bad page
+template <typename Function>
+bool FlashLog_Decode (const FlashLogPage& source, Function pFunction)
+{
+    if (source.nMagic != FLASH_LOG_MAGIC || source.nChannels > FLASH_LOG_MAX_CHANNELS || source.nBytes > sizeof (source.payload) ||
+        source.nCrc != FlashLog_PageCrc (source))
+    {
+        return false;
+    }
+
+    uint32_t nTime = source.nFirstTime;
+    int32_t nValues[FLASH_LOG_MAX_CHANNELS] = {};
+    uint16_t nOffset = 0;
+
+    for (uint8_t nRecord = 0; nRecord < source.nRecords; nRecord++)
+    {
+        uint32_t nValue;
+        uint8_t nRead = Varint_Read (&source.payload[nOffset], source.nBytes - nOffset, nValue);
+
+        if (nRead == 0) return false;
+
+        nOffset += nRead;
+        nTime += nValue;
+
+        for (uint8_t nChannel = 0; nChannel < source.nChannels; nChannel++)
+        {
+            nRead = Varint_Read (&source.payload[nOffset], source.nBytes - nOffset, nValue);
+
+            if (nRead == 0) return false;
+
+            nOffset += nRead;
+            nValues[nChannel] += ZigZag_Decode (nValue);
+        }
+
+        pFunction (nTime, nValues);
+    }
+
+    return true;
+}
+
+#endif
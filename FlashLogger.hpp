@@ -0,0 +1,603 @@
+///
+/// @author   GUSTAVO CAMPOS
+/// @author   GUSTAVO CAMPOS
+/// @date   28/05/2019 19:44
+/// @version  <#version#>
+///
+/// @copyright  (c) GUSTAVO CAMPOS, 2019
+/// @copyright  Licence
+///
+/// @see    ReadMe.txt for references
+///
+//               GNU GENERAL PUBLIC LICENSE
+//                Version 3, 29 June 2007
+//
+// Copyright (C) 2007 Free Software Foundation, Inc. <https://fsf.org/>
+// Everyone is permitted to copy and distribute verbatim copies
+// of this license document, but changing it is not allowed.
+//
+// Preamble
+//
+// The GNU General Public License is a free, copyleft license for
+// software and other kinds of works.
+//
+// The licenses for most software and other practical works are designed
+// to take away your freedom to share and change the works.  By contrast,
+// the GNU General Public License is intended to guarantee your freedom to
+// share and change all versions of a program--to make sure it remains free
+// software for all its users.  We, the Free Software Foundation, use the
+// GNU General Public License for most of our software; it applies also to
+// any other work released this way by its authors.  You can apply it to
+// your programs, too.
+//
+// See LICENSE file for the complete information
+
+#ifndef FLASH_LOGGER_HPP
+#define FLASH_LOGGER_HPP
+
+#include "Arduino.h"
+#include "CorePartition.h"
+
+#include <LittleFS.h>
+
+#include "Util.hpp"
+#include "BinaryLog.hpp"
+#include "SensorPipeline.hpp"
+#include "FlashLogFormat.hpp"
+
+/// Append-only brew log on flash
+///
+/// Records are encoded into a RAM page: time as a varint delta and
+/// every channel as a zigzag varint delta of its value in hundredths,
+/// a steady temperature costs one byte. Full pages get a CRC-32 and
+/// are handed to Thread_FlashLog, which appends them to segment files
+/// on LittleFS; LittleFS spreads the writes over the flash blocks and
+/// the oldest segment is removed once the store is full, so the log
+/// wraps without rewriting live data.
+///
+/// Every page is self contained (first record is absolute), the RAM
+/// index keeps the first timestamp of each segment, so a seek is a
+/// binary search over segments plus a scan of at most
+/// FLASH_LOG_SEGMENT_PAGES page headers. Export sends pages as they
+/// sit on flash, host/flashlog decodes them; the page layout is in
+/// FlashLogFormat.hpp.
+///
+/// Timestamps are log seconds: plant time, kept monotonic across
+/// simulation resets and reboots.
+
+#ifndef FLASH_LOG_SEGMENT_PAGES
+#define FLASH_LOG_SEGMENT_PAGES 16
+#endif
+
+#ifndef FLASH_LOG_SEGMENTS
+#define FLASH_LOG_SEGMENTS 32
+#endif
+
+/// Plant seconds between records
+#ifndef FLASH_LOG_INTERVAL
+#define FLASH_LOG_INTERVAL 10
+#endif
+
+/// A partial page older than this is written anyway, bounds the loss
+/// on a power cut
+#ifndef FLASH_LOG_SYNC
+#define FLASH_LOG_SYNC 600
+#endif
+
+#define FLASH_LOG_CHANNELS SENSOR_CHANNELS
+
+static_assert (FLASH_LOG_CHANNELS <= FLASH_LOG_MAX_CHANNELS, "Too many flash log channels for the page format");
+
+#define FLASH_LOG_DIR "/log"
+
+/// Largest encoded record: time plus one varint per channel
+#define FLASH_LOG_MAX_RECORD (5 + 5 * FLASH_LOG_CHANNELS)
+
+struct FlashLogSegment
+{
+    uint32_t nNumber;
+    uint32_t nFirstTime;
+};
+
+struct FlashLogCursor
+{
+    uint8_t nSegment; // position in the index
+    uint16_t nPage;
+};
+
+class FlashLogger
+{
+public:
+    FlashLogger () : nSegments (0), nCurrentPages (0), bPending (false), bMounted (false), nPagesWritten (0), nDropped (0), nErrors (0)
+    {
+        Clear (page);
+    }
+
+    /// Mounts the file system and rebuilds the segment index
+    bool Begin ()
+    {
+        if (LittleFS.begin () == false) return false;
+
+        LittleFS.mkdir (FLASH_LOG_DIR);
+
+        nSegments = 0;
+
+        Dir dir = LittleFS.openDir (FLASH_LOG_DIR);
+
+        while (dir.next ())
+        {
+            uint32_t nNumber = (uint32_t)strtoul (dir.fileName ().c_str (), NULL, 10);
+            FlashLogHeader header;
+
+            if (ReadHeader (nNumber, 0, header) == false) continue;
+
+            // Insertion keeps the index sorted by segment number
+            uint8_t nPosition = nSegments;
+
+            if (nSegments == FLASH_LOG_SEGMENTS) break;
+
+            while (nPosition > 0 && segments[nPosition - 1].nNumber > nNumber)
+            {
+                segments[nPosition] = segments[nPosition - 1];
+                nPosition--;
+            }
+
+            segments[nPosition].nNumber = nNumber;
+            segments[nPosition].nFirstTime = header.nFirstTime;
+            nSegments++;
+        }
+
+        nLastTime = 0;
+        nCurrentPages = 0;
+
+        if (nSegments > 0)
+        {
+            nCurrentPages = SegmentPages (segments[nSegments - 1].nNumber);
+
+            FlashLogHeader header;
+
+            if (nCurrentPages > 0 && ReadHeader (segments[nSegments - 1].nNumber, nCurrentPages - 1, header)) nLastTime = header.nLastTime;
+        }
+
+        // A page restored from a checkpoint is newer than the flash
+        if (page.nRecords > 0 && page.nLastTime > nLastTime) nLastTime = page.nLastTime;
+
+        bMounted = true;
+
+        return true;
+    }
+
+    /// Encodes one record, nTime in log seconds, values in hundredths
+    bool Append (uint32_t nTime, const int32_t* pnValues)
+    {
+        uint8_t record[FLASH_LOG_MAX_RECORD];
+
+        if (page.nRecords > 0 && (nTime < page.nLastTime || page.nRecords == 0xFF)) Seal ();
+
+        uint8_t nSize = Encode (record, nTime, pnValues);
+
+        if (page.nBytes + nSize > sizeof (page.payload))
+        {
+            Seal ();
+            nSize = Encode (record, nTime, pnValues);
+        }
+
+        if (page.nRecords == 0) page.nFirstTime = nTime;
+
+        memcpy (&page.payload[page.nBytes], record, nSize);
+        page.nBytes += nSize;
+        page.nRecords++;
+        page.nLastTime = nTime;
+
+        memcpy (nLastValues, pnValues, sizeof (nLastValues));
+        nLastTime = nTime;
+
+        return true;
+    }
+
+    /// Closes the RAM page and queues it for the writer
+    void Seal ()
+    {
+        if (page.nRecords == 0) return;
+
+        if (bPending)
+        {
+            nDropped++;
+        }
+        else
+        {
+            page.nCrc = FlashLog_PageCrc (page);
+            pending = page;
+            bPending = true;
+        }
+
+        Clear (page);
+    }
+
+    /// Writer side, appends the queued page to the current segment
+    bool Flush ()
+    {
+        if (bPending == false || bMounted == false) return false;
+
+        if (nSegments == 0 || nCurrentPages >= FLASH_LOG_SEGMENT_PAGES)
+        {
+            NewSegment (pending.nFirstTime);
+        }
+
+        char szPath[24];
+        SegmentPath (szPath, segments[nSegments - 1].nNumber);
+
+        File file = LittleFS.open (szPath, "a");
+
+        if (!file || file.write ((const uint8_t*)&pending, sizeof (pending)) != sizeof (pending))
+        {
+            if (file) file.close ();
+
+            nErrors++;
+            LOG_ERROR (LOG_FLASHLOG_ERROR, segments[nSegments - 1].nNumber);
+
+            return false;
+        }
+
+        file.close ();
+
+        nCurrentPages++;
+        nPagesWritten++;
+        bPending = false;
+
+        return true;
+    }
+
+    /// First page holding records at or after nTime
+    bool Seek (uint32_t nTime, FlashLogCursor& cursor)
+    {
+        if (nSegments == 0) return false;
+
+        // Last segment starting at or before nTime
+        uint8_t nLow = 0;
+        uint8_t nHigh = nSegments;
+
+        while (nHigh - nLow > 1)
+        {
+            uint8_t nMiddle = (nLow + nHigh) / 2;
+
+            if (segments[nMiddle].nFirstTime <= nTime)
+                nLow = nMiddle;
+            else
+                nHigh = nMiddle;
+        }
+
+        cursor.nSegment = nLow;
+        cursor.nPage = 0;
+
+        FlashLogHeader header;
+
+        while (ReadHeader (segments[cursor.nSegment].nNumber, cursor.nPage, header))
+        {
+            if (header.nLastTime >= nTime) return true;
+
+            if (Next (cursor) == false) return false;
+        }
+
+        return false;
+    }
+
+    /// Reads the page under the cursor and moves it forward
+    bool Read (FlashLogCursor& cursor, FlashLogPage& output)
+    {
+        if (cursor.nSegment >= nSegments) return false;
+
+        char szPath[24];
+        SegmentPath (szPath, segments[cursor.nSegment].nNumber);
+
+        File file = LittleFS.open (szPath, "r");
+
+        if (!file) return false;
+
+        bool bRead = file.seek (cursor.nPage * FLASH_LOG_PAGE) && file.read ((uint8_t*)&output, sizeof (output)) == sizeof (output);
+
+        file.close ();
+
+        if (bRead) Next (cursor);
+
+        return bRead;
+    }
+
+    void Erase ()
+    {
+        char szPath[24];
+
+        for (uint8_t nCount = 0; nCount < nSegments; nCount++)
+        {
+            SegmentPath (szPath, segments[nCount].nNumber);
+            LittleFS.remove (szPath);
+        }
+
+        nSegments = 0;
+        nCurrentPages = 0;
+        bPending = false;
+        Clear (page);
+    }
+
+    const FlashLogPage& GetPage () const
+    {
+        return page;
+    }
+
+    /// Copy of the RAM page with its CRC, as Seal would write it
+    void GetSealedPage (FlashLogPage& output) const
+    {
+        output = page;
+        output.nCrc = FlashLog_PageCrc (page);
+    }
+
+    /// Takes back a page saved by GetSealedPage, a checkpoint keeps
+    /// the records not yet on flash; false if it does not decode
+    bool RestorePage (const FlashLogPage& source)
+    {
+        int32_t nValues[FLASH_LOG_CHANNELS];
+
+        if (source.nRecords == 0 || source.nChannels != FLASH_LOG_CHANNELS || FlashLog_Decode (source, [&] (uint32_t nTime, const int32_t* pnValues) { memcpy (nValues, pnValues, sizeof (nValues)); }) == false) return false;
+
+        page = source;
+        page.nCrc = 0;
+
+        memcpy (nLastValues, nValues, sizeof (nLastValues));
+        if (page.nLastTime > nLastTime) nLastTime = page.nLastTime;
+
+        return true;
+    }
+
+    uint32_t GetLastTime () const
+    {
+        return nLastTime;
+    }
+
+    void Show (Stream& client)
+    {
+        client.printf ("%-20s: [%s]\r\n", "Mounted", bMounted ? "yes" : "no");
+        client.printf ("%-20s: [%u of %u]\r\n", "Segments", nSegments, FLASH_LOG_SEGMENTS);
+        client.printf ("%-20s: [%u]\r\n", "Oldest time", nSegments > 0 ? segments[0].nFirstTime : 0);
+        client.printf ("%-20s: [%u]\r\n", "Last time", nLastTime);
+        client.printf ("%-20s: [%u of %u]\r\n", "Current pages", nCurrentPages, FLASH_LOG_SEGMENT_PAGES);
+        client.printf ("%-20s: [%u records, %u bytes]\r\n", "RAM page", page.nRecords, page.nBytes);
+        client.printf ("%-20s: [%u]\r\n", "Pages written", nPagesWritten);
+        client.printf ("%-20s: [%u]\r\n", "Pages dropped", nDropped);
+        client.printf ("%-20s: [%u]\r\n", "Write errors", nErrors);
+    }
+
+private:
+    static void Clear (FlashLogPage& target)
+    {
+        memset (&target, 0, sizeof (target));
+
+        target.nMagic = FLASH_LOG_MAGIC;
+        target.nChannels = FLASH_LOG_CHANNELS;
+    }
+
+    /// Encodes relative to the RAM page, the first record is absolute
+    uint8_t Encode (uint8_t* pBuffer, uint32_t nTime, const int32_t* pnValues)
+    {
+        uint8_t nSize = Varint_Write (pBuffer, page.nRecords == 0 ? 0 : nTime - page.nLastTime);
+
+        for (uint8_t nChannel = 0; nChannel < FLASH_LOG_CHANNELS; nChannel++)
+        {
+            int32_t nBase = page.nRecords == 0 ? 0 : nLastValues[nChannel];
+
+            nSize += Varint_Write (&pBuffer[nSize], ZigZag_Encode (pnValues[nChannel] - nBase));
+        }
+
+        return nSize;
+    }
+
+    static void SegmentPath (char* pszPath, uint32_t nNumber)
+    {
+        snprintf (pszPath, 24, FLASH_LOG_DIR "/%08u", nNumber);
+    }
+
+    static bool ReadHeader (uint32_t nNumber, uint16_t nPage, FlashLogHeader& header)
+    {
+        char szPath[24];
+        SegmentPath (szPath, nNumber);
+
+        File file = LittleFS.open (szPath, "r");
+
+        if (!file) return false;
+
+        bool bRead = file.seek (nPage * FLASH_LOG_PAGE) && file.read ((uint8_t*)&header, sizeof (FlashLogHeader)) == sizeof (FlashLogHeader);
+
+        file.close ();
+
+        return bRead && header.nMagic == FLASH_LOG_MAGIC;
+    }
+
+    static uint16_t SegmentPages (uint32_t nNumber)
+    {
+        char szPath[24];
+        SegmentPath (szPath, nNumber);
+
+        File file = LittleFS.open (szPath, "r");
+
+        if (!file) return 0;
+
+        uint16_t nPages = (uint16_t)(file.size () / FLASH_LOG_PAGE);
+
+        file.close ();
+
+        return nPages;
+    }
+
+    bool Next (FlashLogCursor& cursor)
+    {
+        uint16_t nPages = cursor.nSegment == nSegments - 1 ? nCurrentPages : FLASH_LOG_SEGMENT_PAGES;
+
+        if (++cursor.nPage < nPages) return true;
+
+        cursor.nPage = 0;
+
+        return ++cursor.nSegment < nSegments;
+    }
+
+    void NewSegment (uint32_t nFirstTime)
+    {
+        uint32_t nNumber = nSegments > 0 ? segments[nSegments - 1].nNumber + 1 : 0;
+
+        if (nSegments == FLASH_LOG_SEGMENTS)
+        {
+            char szPath[24];
+            SegmentPath (szPath, segments[0].nNumber);
+            LittleFS.remove (szPath);
+
+            memmove (&segments[0], &segments[1], sizeof (segments[0]) * (FLASH_LOG_SEGMENTS - 1));
+            nSegments--;
+        }
+
+        segments[nSegments].nNumber = nNumber;
+        segments[nSegments].nFirstTime = nFirstTime;
+        nSegments++;
+
+        nCurrentPages = 0;
+    }
+
+    FlashLogSegment segments[FLASH_LOG_SEGMENTS];
+    uint8_t nSegments;
+    uint16_t nCurrentPages;
+
+    FlashLogPage page;
+    FlashLogPage pending;
+    bool bPending;
+    bool bMounted;
+
+    int32_t nLastValues[FLASH_LOG_CHANNELS];
+    uint32_t nLastTime;
+
+    uint32_t nPagesWritten;
+    uint32_t nDropped;
+    uint32_t nErrors;
+};
+
+FlashLogger flashLogger;
+
+/// Decodes and prints nRecords records starting at nTime, the RAM
+/// page included
+void FlashLog_ShowRecords (Stream& client, uint32_t nTime, uint32_t nRecords)
+{
+    // Static, thread stacks are small
+    static FlashLogPage buffer;
+    FlashLogCursor cursor;
+    uint32_t nShown = 0;
+
+    auto ShowRecord = [&] (uint32_t nRecordTime, const int32_t* pnValues) {
+        if (nRecordTime < nTime || nShown >= nRecords) return;
+
+        client.printf ("%10u", nRecordTime);
+
+        for (uint8_t nChannel = 0; nChannel < FLASH_LOG_CHANNELS; nChannel++)
+        {
+            client.printf ("\t%s%d.%02d", pnValues[nChannel] < 0 ? "-" : "", (int)(Abs (pnValues[nChannel]) / 100), (int)(Abs (pnValues[nChannel]) % 100));
+        }
+
+        client.println ();
+        nShown++;
+    };
+
+    if (flashLogger.Seek (nTime, cursor))
+    {
+        while (nShown < nRecords && flashLogger.Read (cursor, buffer))
+        {
+            if (FlashLog_Decode (buffer, ShowRecord) == false) client.println (F ("Bad page, skipped"));
+        }
+    }
+
+    if (nShown < nRecords)
+    {
+        flashLogger.GetSealedPage (buffer);
+        FlashLog_Decode (buffer, ShowRecord);
+    }
+}
+
+/// Streams raw pages from nTime on as hex, one page per line, no
+/// decoding on the device
+void FlashLog_Export (Stream& client, uint32_t nTime)
+{
+    static FlashLogPage buffer;
+    FlashLogCursor cursor;
+    uint32_t nPages = 0;
+
+    if (flashLogger.Seek (nTime, cursor))
+    {
+        while (flashLogger.Read (cursor, buffer))
+        {
+            const uint8_t* pBuffer = (const uint8_t*)&buffer;
+            char szHex[65];
+
+            client.print (F (":"));
+
+            for (uint16_t nOffset = 0; nOffset < sizeof (buffer); nOffset += 32)
+            {
+                for (uint8_t nByte = 0; nByte < 32; nByte++)
+                {
+                    snprintf (&szHex[nByte * 2], 3, "%02X", pBuffer[nOffset + nByte]);
+                }
+
+                client.write ((const uint8_t*)szHex, 64);
+            }
+
+            client.println ();
+            nPages++;
+
+            CorePartition_Yield ();
+        }
+    }
+
+    client.printf ("End, %u pages\r\n", nPages);
+}
+
+/// Samples the sensor channels every FLASH_LOG_INTERVAL plant
+/// seconds and writes sealed pages
+void Thread_FlashLog (void* pValue)
+{
+    if (flashLogger.Begin () == false)
+    {
+        LOG_ERROR (LOG_FLASHLOG_ERROR, 0);
+    }
+
+    uint32_t nLogTime = flashLogger.GetLastTime () + FLASH_LOG_INTERVAL;
+    uint32_t nPlantTime = Sensor_GetTime ();
+    uint32_t nNextRecord = nLogTime;
+
+    LOG_INFO (LOG_FLASHLOG_START, nLogTime);
+
+    while (true)
+    {
+        uint32_t nNow = Sensor_GetTime ();
+
+        // Plant clock restarted, carry on from where the log was
+        nLogTime += nNow >= nPlantTime ? nNow - nPlantTime : FLASH_LOG_INTERVAL;
+        nPlantTime = nNow;
+
+        if (nLogTime >= nNextRecord)
+        {
+            int32_t nValues[FLASH_LOG_CHANNELS];
+
+            for (uint8_t nChannel = 0; nChannel < FLASH_LOG_CHANNELS; nChannel++)
+            {
+                nValues[nChannel] = Sensor_Read (nChannel).ToCenti ();
+            }
+
+            flashLogger.Append (nLogTime, nValues);
+
+            nNextRecord = nLogTime + FLASH_LOG_INTERVAL;
+        }
+
+        const FlashLogPage& page = flashLogger.GetPage ();
+
+        if (page.nRecords > 0 && nLogTime - page.nFirstTime >= FLASH_LOG_SYNC) flashLogger.Seal ();
+
+        flashLogger.Flush ();
+
+        CorePartition_Yield ();
+    }
+}
+
+#endif
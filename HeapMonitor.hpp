@@ -0,0 +1,305 @@
+///
+/// @author   GUSTAVO CAMPOS
+/// @author   GUSTAVO CAMPOS
+/// @date   28/05/2019 19:44
+/// @version  <#version#>
+///
+/// @copyright  (c) GUSTAVO CAMPOS, 2019
+/// @copyright  Licence
+///
+/// @see    ReadMe.txt for references
+///
+//               GNU GENERAL PUBLIC LICENSE
+//                Version 3, 29 June 2007
+//
+// Copyright (C) 2007 Free Software Foundation, Inc. <https://fsf.org/>
+// Everyone is permitted to copy and distribute verbatim copies
+// of this license document, but changing it is not allowed.
+//
+// Preamble
+//
+// The GNU General Public License is a free, copyleft license for
+// software and other kinds of works.
+//
+// The licenses for most software and other practical works are designed
+// to take away your freedom to share and change the works.  By contrast,
+// the GNU General Public License is intended to guarantee your freedom to
+// share and change all versions of a program--to make sure it remains free
+// software for all its users.  We, the Free Software Foundation, use the
+// GNU General Public License for most of our software; it applies also to
+// any other work released this way by its authors.  You can apply it to
+// your programs, too.
+//
+// See LICENSE file for the complete information
+
+#ifndef HEAP_MONITOR_HPP
+#define HEAP_MONITOR_HPP
+
+#include "Arduino.h"
+#include "CorePartition.h"
+
+#include <stdlib.h>
+#include <new>
+
+/// Heap instrumentation
+///
+/// Reports free heap, largest free block, fragmentation and the
+/// low-water marks since boot. Sampling is cheap enough to be
+/// called from the idle hook (CorePartition_SleepTicks).
+///
+/// Per call-site counters are optional, define HEAP_TRACK_CALLSITES
+/// before including this file to replace operator new/delete. Every
+/// tracked block carries a small header with its call-site slot so
+/// frees are credited back to the allocator that churns.
+///
+/// malloc call sites go through TRACKED_MALLOC/TRACKED_FREE, in the
+/// default build too: there they only update the low-water mark,
+/// the idle hook alone misses the troughs inside busy slices.
+
+#ifndef HEAP_SAMPLE_INTERVAL
+#define HEAP_SAMPLE_INTERVAL 250
+#endif
+
+#ifndef HEAP_CALLSITE_SLOTS
+#define HEAP_CALLSITE_SLOTS 32
+#endif
+
+struct HeapCallSite
+{
+    uintptr_t nSite;
+    uint32_t nAllocs;
+    uint32_t nFrees;
+    uint32_t nBytes;
+    int32_t nLiveBytes;
+};
+
+class HeapMonitor
+{
+public:
+    HeapMonitor () : nFree (0), nMaxBlock (0), nFragmentation (0), nLowWater (UINT32_MAX), nLowMaxBlock (UINT32_MAX), nLastSample (0)
+    {
+    }
+
+    /// Collects a new sample, rate limited by HEAP_SAMPLE_INTERVAL
+    /// @param bForce   ignore the rate limit
+    void Sample (bool bForce = false)
+    {
+        uint32_t nNow = millis ();
+
+        if (bForce == false && nLastSample != 0 && (nNow - nLastSample) < HEAP_SAMPLE_INTERVAL)
+        {
+            return;
+        }
+
+        nLastSample = nNow == 0 ? 1 : nNow;
+
+        uint16_t nMax = 0;
+
+        ESP.getHeapStats (&nFree, &nMax, &nFragmentation);
+        nMaxBlock = nMax;
+
+        if (nFree < nLowWater) nLowWater = nFree;
+        if (nMaxBlock < nLowMaxBlock) nLowMaxBlock = nMaxBlock;
+    }
+
+    /// Cheap low-water update, used from the allocation path
+    void Touch (uint32_t nCurrentFree)
+    {
+        if (nCurrentFree < nLowWater) nLowWater = nCurrentFree;
+    }
+
+    uint32_t GetFree () const
+    {
+        return nFree;
+    }
+
+    uint32_t GetMaxBlock () const
+    {
+        return nMaxBlock;
+    }
+
+    uint8_t GetFragmentation () const
+    {
+        return nFragmentation;
+    }
+
+    uint32_t GetLowWater () const
+    {
+        return nLowWater;
+    }
+
+    uint32_t GetLowMaxBlock () const
+    {
+        return nLowMaxBlock;
+    }
+
+    void Show (Stream& client)
+    {
+        Sample (true);
+
+        client.printf ("%-20s: [%u Bytes]\r\n", "Free heap", nFree);
+        client.printf ("%-20s: [%u Bytes]\r\n", "Largest block", nMaxBlock);
+        client.printf ("%-20s: [%u%%]\r\n", "Fragmentation", nFragmentation);
+        client.printf ("%-20s: [%u Bytes]\r\n", "Low water", nLowWater);
+        client.printf ("%-20s: [%u Bytes]\r\n", "Low largest block", nLowMaxBlock);
+    }
+
+#ifdef HEAP_TRACK_CALLSITES
+    /// Records an allocation and returns its call-site slot
+    uint8_t Track (uintptr_t nSite, size_t nSize)
+    {
+        uint8_t nSlot = Lookup (nSite);
+
+        sites[nSlot].nAllocs++;
+        sites[nSlot].nBytes += nSize;
+        sites[nSlot].nLiveBytes += nSize;
+
+        return nSlot;
+    }
+
+    void Untrack (uint8_t nSlot, size_t nSize)
+    {
+        if (nSlot > HEAP_CALLSITE_SLOTS) return;
+
+        sites[nSlot].nFrees++;
+        sites[nSlot].nLiveBytes -= nSize;
+    }
+
+    void ShowCallSites (Stream& client)
+    {
+        client.println (F ("Site\t\tAllocs\tFrees\tBytes\tLive"));
+        client.println (F ("--------------------------------------"));
+
+        for (uint8_t nCount = 0; nCount <= HEAP_CALLSITE_SLOTS; nCount++)
+        {
+            if (sites[nCount].nAllocs == 0) continue;
+
+            if (nCount == HEAP_CALLSITE_SLOTS)
+                client.print (F ("(other)\t"));
+            else
+                client.printf ("0x%08lX", (unsigned long)sites[nCount].nSite);
+
+            client.printf ("\t%u\t%u\t%u\t%d\r\n", sites[nCount].nAllocs, sites[nCount].nFrees, sites[nCount].nBytes, sites[nCount].nLiveBytes);
+            client.flush ();
+            CorePartition_Yield ();
+        }
+    }
+
+private:
+    /// Open addressing with linear probe, the extra last slot
+    /// absorbs call sites once the table is full.
+    uint8_t Lookup (uintptr_t nSite)
+    {
+        uint8_t nSlot = (uint8_t)(((uint32_t)nSite * 2654435761UL) >> 24) % HEAP_CALLSITE_SLOTS;
+
+        for (uint8_t nProbe = 0; nProbe < HEAP_CALLSITE_SLOTS; nProbe++)
+        {
+            if (sites[nSlot].nSite == nSite) return nSlot;
+
+            if (sites[nSlot].nSite == 0)
+            {
+                sites[nSlot].nSite = nSite;
+                return nSlot;
+            }
+
+            nSlot = (nSlot + 1) % HEAP_CALLSITE_SLOTS;
+        }
+
+        return HEAP_CALLSITE_SLOTS;
+    }
+
+    HeapCallSite sites[HEAP_CALLSITE_SLOTS + 1] = {};
+#endif
+
+private:
+    uint32_t nFree;
+    uint32_t nMaxBlock;
+    uint8_t nFragmentation;
+    uint32_t nLowWater;
+    uint32_t nLowMaxBlock;
+    uint32_t nLastSample;
+};
+
+HeapMonitor heapMonitor;
+
+#ifdef HEAP_TRACK_CALLSITES
+
+/// Header prepended to every tracked block, 8 bytes to keep alignment
+struct HeapBlockHeader
+{
+    uint32_t nSize;
+    uint32_t nSlot;
+};
+
+void* HeapMonitor_AllocateAt (size_t nSize, uintptr_t nSite)
+{
+    HeapBlockHeader* pHeader = (HeapBlockHeader*)malloc (nSize + sizeof (HeapBlockHeader));
+
+    if (pHeader == NULL) return NULL;
+
+    pHeader->nSize = nSize;
+    pHeader->nSlot = heapMonitor.Track (nSite, nSize);
+
+    heapMonitor.Touch (ESP.getFreeHeap ());
+
+    return pHeader + 1;
+}
+
+void HeapMonitor_Release (void* pBlock)
+{
+    if (pBlock == NULL) return;
+
+    HeapBlockHeader* pHeader = ((HeapBlockHeader*)pBlock) - 1;
+
+    heapMonitor.Untrack (pHeader->nSlot, pHeader->nSize);
+
+    free (pHeader);
+}
+
+/// malloc replacement for C style call sites, never inlined so the
+/// return address is the caller
+__attribute__ ((noinline)) void* HeapMonitor_Allocate (size_t nSize)
+{
+    return HeapMonitor_AllocateAt (nSize, (uintptr_t)__builtin_return_address (0));
+}
+
+#define TRACKED_MALLOC(nSize) HeapMonitor_Allocate (nSize)
+#define TRACKED_FREE(pBlock) HeapMonitor_Release (pBlock)
+
+__attribute__ ((noinline)) void* operator new (size_t nSize)
+{
+    return HeapMonitor_AllocateAt (nSize, (uintptr_t)__builtin_return_address (0));
+}
+
+__attribute__ ((noinline)) void* operator new[] (size_t nSize)
+{
+    return HeapMonitor_AllocateAt (nSize, (uintptr_t)__builtin_return_address (0));
+}
+
+void operator delete (void* pBlock) noexcept
+{
+    HeapMonitor_Release (pBlock);
+}
+
+void operator delete[] (void* pBlock) noexcept
+{
+    HeapMonitor_Release (pBlock);
+}
+
+#else
+
+inline void* HeapMonitor_Allocate (size_t nSize)
+{
+    void* pBlock = malloc (nSize);
+
+    heapMonitor.Touch (ESP.getFreeHeap ());
+
+    return pBlock;
+}
+
+#define TRACKED_MALLOC(nSize) HeapMonitor_Allocate (nSize)
+#define TRACKED_FREE(pBlock) free (pBlock)
+
+#endif
+
+#endif
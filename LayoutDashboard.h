@@ -0,0 +1,169 @@
+///
+/// Generated by host/LayoutCompiler from ../layouts/dashboard.layout, do not edit
+///
+
+#pragma once
+
+static const uint8_t layoutDashboard[] PROGMEM __attribute__ ((aligned (4))) = {
+    0x42, 0x4C, 0x41, 0x59, 0x02, 0x00, 0x00, 0x00, 0x2C, 0x00, 0x00, 0x00,
+    0x88, 0x07, 0x00, 0x00, 0x01, 0xAF, 0xD7, 0x92, 0x90, 0x01, 0x00, 0x00,
+    0x2C, 0x01, 0x00, 0x00, 0x2C, 0x00, 0x00, 0x00, 0x03, 0x00, 0x00, 0x00,
+    0x50, 0x00, 0x00, 0x00, 0x18, 0x00, 0x00, 0x00, 0x50, 0x06, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x0C, 0x00, 0x00, 0x00, 0xE2, 0x06, 0x00, 0x00,
+    0x0C, 0x00, 0x00, 0x00, 0x07, 0x00, 0x00, 0x00, 0x3F, 0x07, 0x00, 0x00,
+    0x13, 0x00, 0x00, 0x00, 0x05, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x08, 0x00, 0x00, 0x00, 0x04, 0x00, 0x00, 0x00,
+    0xB8, 0x00, 0x00, 0x00, 0x2D, 0x00, 0x00, 0x00, 0x18, 0x00, 0x00, 0x00,
+    0x02, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x5A, 0x06, 0x00, 0x00,
+    0x65, 0x06, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10, 0x27, 0x00, 0x00,
+    0x64, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x01, 0x00, 0x00, 0x00, 0x14, 0x00, 0x00, 0x00, 0xD0, 0x00, 0x00, 0x00,
+    0x04, 0x00, 0x00, 0x00, 0xB8, 0x00, 0x00, 0x00, 0x2D, 0x00, 0x00, 0x00,
+    0x14, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x66, 0x06, 0x00, 0x00, 0x6D, 0x06, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x10, 0x27, 0x00, 0x00, 0x64, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00,
+    0x08, 0x00, 0x00, 0x00, 0x35, 0x00, 0x00, 0x00, 0xB8, 0x00, 0x00, 0x00,
+    0x2E, 0x00, 0x00, 0x00, 0x14, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00,
+    0x01, 0x00, 0x00, 0x00, 0x6E, 0x06, 0x00, 0x00, 0x73, 0x06, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x10, 0x27, 0x00, 0x00, 0x0A, 0x00, 0x00, 0x00,
+    0x05, 0x00, 0x00, 0x00, 0x10, 0x27, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00,
+    0x05, 0x00, 0x00, 0x00, 0xD0, 0x00, 0x00, 0x00, 0x35, 0x00, 0x00, 0x00,
+    0xB8, 0x00, 0x00, 0x00, 0x2E, 0x00, 0x00, 0x00, 0x14, 0x00, 0x00, 0x00,
+    0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x75, 0x06, 0x00, 0x00,
+    0x7A, 0x06, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10, 0x27, 0x00, 0x00,
+    0x0A, 0x00, 0x00, 0x00, 0x05, 0x00, 0x00, 0x00, 0x10, 0x27, 0x00, 0x00,
+    0x01, 0x00, 0x00, 0x00, 0x0B, 0x00, 0x00, 0x00, 0x08, 0x00, 0x00, 0x00,
+    0x67, 0x00, 0x00, 0x00, 0xB8, 0x00, 0x00, 0x00, 0x2D, 0x00, 0x00, 0x00,
+    0x14, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00,
+    0x7C, 0x06, 0x00, 0x00, 0x8A, 0x06, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x10, 0x27, 0x00, 0x00, 0x0A, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x0C, 0x00, 0x00, 0x00,
+    0xD0, 0x00, 0x00, 0x00, 0x67, 0x00, 0x00, 0x00, 0xB8, 0x00, 0x00, 0x00,
+    0x2D, 0x00, 0x00, 0x00, 0x14, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00,
+    0x01, 0x00, 0x00, 0x00, 0x8C, 0x06, 0x00, 0x00, 0x9A, 0x06, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x10, 0x27, 0x00, 0x00, 0x0A, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00,
+    0x03, 0x00, 0x00, 0x00, 0x08, 0x00, 0x00, 0x00, 0x98, 0x00, 0x00, 0x00,
+    0xB8, 0x00, 0x00, 0x00, 0x2D, 0x00, 0x00, 0x00, 0x10, 0x00, 0x00, 0x00,
+    0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x9C, 0x06, 0x00, 0x00,
+    0xA8, 0x06, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10, 0x27, 0x00, 0x00,
+    0xF4, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x88, 0x13, 0x00, 0x00,
+    0x02, 0x00, 0x00, 0x00, 0x06, 0x00, 0x00, 0x00, 0xD0, 0x00, 0x00, 0x00,
+    0x98, 0x00, 0x00, 0x00, 0xB8, 0x00, 0x00, 0x00, 0x2D, 0x00, 0x00, 0x00,
+    0x10, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0xAA, 0x06, 0x00, 0x00, 0xB6, 0x06, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x10, 0x27, 0x00, 0x00, 0xF4, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x88, 0x13, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x04, 0x00, 0x00, 0x00,
+    0x08, 0x00, 0x00, 0x00, 0xC9, 0x00, 0x00, 0x00, 0xB8, 0x00, 0x00, 0x00,
+    0x2E, 0x00, 0x00, 0x00, 0x10, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00,
+    0x01, 0x00, 0x00, 0x00, 0xB8, 0x06, 0x00, 0x00, 0xC4, 0x06, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x10, 0x27, 0x00, 0x00, 0x0A, 0x00, 0x00, 0x00,
+    0x05, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00,
+    0x08, 0x00, 0x00, 0x00, 0xD0, 0x00, 0x00, 0x00, 0xC9, 0x00, 0x00, 0x00,
+    0xB8, 0x00, 0x00, 0x00, 0x2E, 0x00, 0x00, 0x00, 0x10, 0x00, 0x00, 0x00,
+    0x01, 0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0xC6, 0x06, 0x00, 0x00,
+    0xD1, 0x06, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10, 0x27, 0x00, 0x00,
+    0x05, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x08, 0x00, 0x00, 0x00,
+    0xFB, 0x00, 0x00, 0x00, 0xB8, 0x00, 0x00, 0x00, 0x2D, 0x00, 0x00, 0x00,
+    0x14, 0x00, 0x00, 0x00, 0x05, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0xD4, 0x06, 0x00, 0x00, 0xD9, 0x06, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x10, 0x27, 0x00, 0x00, 0x70, 0x17, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x0D, 0x00, 0x00, 0x00,
+    0xD0, 0x00, 0x00, 0x00, 0xFB, 0x00, 0x00, 0x00, 0xB8, 0x00, 0x00, 0x00,
+    0x2D, 0x00, 0x00, 0x00, 0x14, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0xDA, 0x06, 0x00, 0x00, 0xE0, 0x06, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x10, 0x27, 0x00, 0x00, 0x64, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x08, 0x00, 0x00, 0x00, 0x04, 0x00, 0x00, 0x00,
+    0x80, 0x01, 0x00, 0x00, 0x37, 0x00, 0x00, 0x00, 0x18, 0x00, 0x00, 0x00,
+    0x02, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xEC, 0x06, 0x00, 0x00,
+    0xF9, 0x06, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10, 0x27, 0x00, 0x00,
+    0x64, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x01, 0x00, 0x00, 0x00, 0x09, 0x00, 0x00, 0x00, 0x08, 0x00, 0x00, 0x00,
+    0x3F, 0x00, 0x00, 0x00, 0x80, 0x01, 0x00, 0x00, 0x37, 0x00, 0x00, 0x00,
+    0x18, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00,
+    0xFA, 0x06, 0x00, 0x00, 0x04, 0x07, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x10, 0x27, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00,
+    0x30, 0x75, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x0A, 0x00, 0x00, 0x00,
+    0x08, 0x00, 0x00, 0x00, 0x7A, 0x00, 0x00, 0x00, 0x80, 0x01, 0x00, 0x00,
+    0x38, 0x00, 0x00, 0x00, 0x10, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x06, 0x07, 0x00, 0x00, 0x17, 0x07, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x10, 0x27, 0x00, 0x00, 0xF4, 0x01, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x88, 0x13, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00,
+    0x0F, 0x00, 0x00, 0x00, 0x08, 0x00, 0x00, 0x00, 0xB6, 0x00, 0x00, 0x00,
+    0xB8, 0x00, 0x00, 0x00, 0x37, 0x00, 0x00, 0x00, 0x14, 0x00, 0x00, 0x00,
+    0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x19, 0x07, 0x00, 0x00,
+    0x21, 0x07, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10, 0x27, 0x00, 0x00,
+    0x0A, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x60, 0xEA, 0x00, 0x00,
+    0x01, 0x00, 0x00, 0x00, 0x10, 0x00, 0x00, 0x00, 0xD0, 0x00, 0x00, 0x00,
+    0xB6, 0x00, 0x00, 0x00, 0xB8, 0x00, 0x00, 0x00, 0x37, 0x00, 0x00, 0x00,
+    0x14, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00,
+    0x25, 0x07, 0x00, 0x00, 0x2D, 0x07, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x10, 0x27, 0x00, 0x00, 0x0A, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x60, 0xEA, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x11, 0x00, 0x00, 0x00,
+    0x08, 0x00, 0x00, 0x00, 0xF1, 0x00, 0x00, 0x00, 0xB8, 0x00, 0x00, 0x00,
+    0x37, 0x00, 0x00, 0x00, 0x14, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00,
+    0x02, 0x00, 0x00, 0x00, 0x2F, 0x07, 0x00, 0x00, 0x37, 0x07, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x10, 0x27, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x60, 0xEA, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00,
+    0x01, 0x00, 0x00, 0x00, 0xD0, 0x00, 0x00, 0x00, 0xF1, 0x00, 0x00, 0x00,
+    0xB8, 0x00, 0x00, 0x00, 0x37, 0x00, 0x00, 0x00, 0x14, 0x00, 0x00, 0x00,
+    0x05, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x39, 0x07, 0x00, 0x00,
+    0x3E, 0x07, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10, 0x27, 0x00, 0x00,
+    0x70, 0x17, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x08, 0x00, 0x00, 0x00,
+    0x04, 0x00, 0x00, 0x00, 0x80, 0x01, 0x00, 0x00, 0x5F, 0x00, 0x00, 0x00,
+    0x18, 0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x46, 0x07, 0x00, 0x00, 0x57, 0x07, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x10, 0x27, 0x00, 0x00, 0x64, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x12, 0x00, 0x00, 0x00,
+    0x08, 0x00, 0x00, 0x00, 0x67, 0x00, 0x00, 0x00, 0xB8, 0x00, 0x00, 0x00,
+    0x5E, 0x00, 0x00, 0x00, 0x18, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00,
+    0x01, 0x00, 0x00, 0x00, 0x58, 0x07, 0x00, 0x00, 0x63, 0x07, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x10, 0x27, 0x00, 0x00, 0x0A, 0x00, 0x00, 0x00,
+    0x0A, 0x00, 0x00, 0x00, 0x10, 0x27, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00,
+    0x13, 0x00, 0x00, 0x00, 0xD0, 0x00, 0x00, 0x00, 0x67, 0x00, 0x00, 0x00,
+    0xB8, 0x00, 0x00, 0x00, 0x5E, 0x00, 0x00, 0x00, 0x18, 0x00, 0x00, 0x00,
+    0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x67, 0x07, 0x00, 0x00,
+    0x6E, 0x07, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10, 0x27, 0x00, 0x00,
+    0x0A, 0x00, 0x00, 0x00, 0x0A, 0x00, 0x00, 0x00, 0x10, 0x27, 0x00, 0x00,
+    0x01, 0x00, 0x00, 0x00, 0x07, 0x00, 0x00, 0x00, 0x08, 0x00, 0x00, 0x00,
+    0xC9, 0x00, 0x00, 0x00, 0xB8, 0x00, 0x00, 0x00, 0x5F, 0x00, 0x00, 0x00,
+    0x14, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00,
+    0x72, 0x07, 0x00, 0x00, 0x79, 0x07, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x10, 0x27, 0x00, 0x00, 0x0A, 0x00, 0x00, 0x00, 0x05, 0x00, 0x00, 0x00,
+    0x10, 0x27, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x0E, 0x00, 0x00, 0x00,
+    0xD0, 0x00, 0x00, 0x00, 0xC9, 0x00, 0x00, 0x00, 0xB8, 0x00, 0x00, 0x00,
+    0x5F, 0x00, 0x00, 0x00, 0x14, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00,
+    0x01, 0x00, 0x00, 0x00, 0x7B, 0x07, 0x00, 0x00, 0x83, 0x07, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x10, 0x27, 0x00, 0x00, 0x0A, 0x00, 0x00, 0x00,
+    0x05, 0x00, 0x00, 0x00, 0x10, 0x27, 0x00, 0x00, 0x42, 0x72, 0x65, 0x77,
+    0x68, 0x6F, 0x75, 0x73, 0x65, 0x00, 0x42, 0x72, 0x65, 0x77, 0x65, 0x72,
+    0x53, 0x69, 0x6D, 0x32, 0x00, 0x00, 0x41, 0x6C, 0x61, 0x72, 0x6D, 0x73,
+    0x00, 0x00, 0x4D, 0x61, 0x73, 0x68, 0x00, 0x43, 0x00, 0x42, 0x6F, 0x69,
+    0x6C, 0x00, 0x43, 0x00, 0x4D, 0x61, 0x73, 0x68, 0x20, 0x73, 0x65, 0x74,
+    0x70, 0x6F, 0x69, 0x6E, 0x74, 0x00, 0x43, 0x00, 0x42, 0x6F, 0x69, 0x6C,
+    0x20, 0x73, 0x65, 0x74, 0x70, 0x6F, 0x69, 0x6E, 0x74, 0x00, 0x43, 0x00,
+    0x4D, 0x61, 0x73, 0x68, 0x20, 0x68, 0x65, 0x61, 0x74, 0x65, 0x72, 0x00,
+    0x25, 0x00, 0x42, 0x6F, 0x69, 0x6C, 0x20, 0x68, 0x65, 0x61, 0x74, 0x65,
+    0x72, 0x00, 0x25, 0x00, 0x4D, 0x61, 0x73, 0x68, 0x20, 0x76, 0x6F, 0x6C,
+    0x75, 0x6D, 0x65, 0x00, 0x4C, 0x00, 0x45, 0x76, 0x61, 0x70, 0x6F, 0x72,
+    0x61, 0x74, 0x65, 0x64, 0x00, 0x6B, 0x67, 0x00, 0x54, 0x69, 0x6D, 0x65,
+    0x00, 0x00, 0x53, 0x70, 0x65, 0x65, 0x64, 0x00, 0x78, 0x00, 0x46, 0x65,
+    0x72, 0x6D, 0x65, 0x6E, 0x74, 0x65, 0x72, 0x00, 0x46, 0x65, 0x72, 0x6D,
+    0x65, 0x6E, 0x74, 0x61, 0x74, 0x69, 0x6F, 0x6E, 0x00, 0x00, 0x46, 0x65,
+    0x72, 0x6D, 0x65, 0x6E, 0x74, 0x65, 0x72, 0x00, 0x43, 0x00, 0x46, 0x65,
+    0x72, 0x6D, 0x65, 0x6E, 0x74, 0x65, 0x72, 0x20, 0x68, 0x65, 0x61, 0x74,
+    0x65, 0x72, 0x00, 0x25, 0x00, 0x47, 0x72, 0x61, 0x76, 0x69, 0x74, 0x79,
+    0x00, 0x70, 0x74, 0x73, 0x00, 0x45, 0x78, 0x74, 0x72, 0x61, 0x63, 0x74,
+    0x00, 0x50, 0x00, 0x41, 0x6C, 0x63, 0x6F, 0x68, 0x6F, 0x6C, 0x00, 0x25,
+    0x00, 0x54, 0x69, 0x6D, 0x65, 0x00, 0x00, 0x52, 0x65, 0x63, 0x69, 0x70,
+    0x65, 0x00, 0x52, 0x65, 0x63, 0x69, 0x70, 0x65, 0x20, 0x65, 0x73, 0x74,
+    0x69, 0x6D, 0x61, 0x74, 0x65, 0x73, 0x00, 0x00, 0x42, 0x69, 0x74, 0x74,
+    0x65, 0x72, 0x6E, 0x65, 0x73, 0x73, 0x00, 0x49, 0x42, 0x55, 0x00, 0x43,
+    0x6F, 0x6C, 0x6F, 0x75, 0x72, 0x00, 0x53, 0x52, 0x4D, 0x00, 0x4B, 0x65,
+    0x74, 0x74, 0x6C, 0x65, 0x00, 0x4C, 0x00, 0x41, 0x74, 0x20, 0x32, 0x30,
+    0x20, 0x43, 0x00, 0x4C, 0x00, 0x00, 0x00, 0x00,
+};
@@ -0,0 +1,280 @@
+///
+/// @author   GUSTAVO CAMPOS
+/// @author   GUSTAVO CAMPOS
+/// @date   28/05/2019 19:44
+/// @version  <#version#>
+///
+/// @copyright  (c) GUSTAVO CAMPOS, 2019
+/// @copyright  Licence
+///
+/// @see    ReadMe.txt for references
+///
+//               GNU GENERAL PUBLIC LICENSE
+//                Version 3, 29 June 2007
+//
+// Copyright (C) 2007 Free Software Foundation, Inc. <https://fsf.org/>
+// Everyone is permitted to copy and distribute verbatim copies
+// of this license document, but changing it is not allowed.
+//
+// Preamble
+//
+// The GNU General Public License is a free, copyleft license for
+// software and other kinds of works.
+//
+// The licenses for most software and other practical works are designed
+// to take away your freedom to share and change the works.  By contrast,
+// the GNU General Public License is intended to guarantee your freedom to
+// share and change all versions of a program--to make sure it remains free
+// software for all its users.  We, the Free Software Foundation, use the
+// GNU General Public License for most of our software; it applies also to
+// any other work released this way by its authors.  You can apply it to
+// your programs, too.
+//
+// See LICENSE file for the complete information
+
+#ifndef LAYOUT_FORMAT_HPP
+#define LAYOUT_FORMAT_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "Encoding.hpp"
+
+/// Binary dashboard layout format
+///
+/// Screens for the e-paper panel are written as text (grid and box
+/// layout, widgets bound to data sources) and compiled on the host by
+/// host/LayoutCompiler.cpp into one flat blob, laid out like the
+/// recipes (RecipeFormat.hpp): header, fixed size tables, string pool,
+/// byte offsets from the start of the blob, 32 bit fields only so it
+/// is read in place from flash.
+///
+/// The compiler resolves the layout, so every widget carries its final
+/// rectangle on the panel, x and width multiples of 8 as the panel
+/// partial window needs. The device only binds, renders and diffs.
+///
+/// Versioning follows RecipeFormat.hpp: nVersion is bumped on
+/// incompatible changes, sources and widget types are only appended.
+
+#define LAYOUT_MAGIC 0x59414C42 // "BLAY"
+#define LAYOUT_VERSION 2
+
+#define LAYOUT_MAX_SCREENS 8
+#define LAYOUT_MAX_WIDGETS 32 // per screen
+
+/// Data sources a widget can bind to, values are hundredths of the
+/// unit shown (C, %, litres, kg, gravity points, Plato, IBU, SRM); the
+/// compiler maps NAME to ID
+#define LAYOUT_SOURCES(SOURCE)                                           \
+    SOURCE (LAYOUT_SOURCE_NONE, "none")                                  \
+    SOURCE (LAYOUT_SOURCE_TIME, "time")                                  \
+    SOURCE (LAYOUT_SOURCE_MASH_TEMPERATURE, "mash.temperature")          \
+    SOURCE (LAYOUT_SOURCE_MASH_DUTY, "mash.duty")                        \
+    SOURCE (LAYOUT_SOURCE_MASH_VOLUME, "mash.volume")                    \
+    SOURCE (LAYOUT_SOURCE_BOIL_TEMPERATURE, "boil.temperature")          \
+    SOURCE (LAYOUT_SOURCE_BOIL_DUTY, "boil.duty")                        \
+    SOURCE (LAYOUT_SOURCE_BOIL_VOLUME, "boil.volume")                    \
+    SOURCE (LAYOUT_SOURCE_BOIL_EVAPORATED, "boil.evaporated")            \
+    SOURCE (LAYOUT_SOURCE_FERMENTER_TEMPERATURE, "fermenter.temperature") \
+    SOURCE (LAYOUT_SOURCE_FERMENTER_DUTY, "fermenter.duty")              \
+    SOURCE (LAYOUT_SOURCE_LOOP0_SETPOINT, "loop0.setpoint")              \
+    SOURCE (LAYOUT_SOURCE_LOOP1_SETPOINT, "loop1.setpoint")              \
+    SOURCE (LAYOUT_SOURCE_SPEED, "speed")                                \
+    SOURCE (LAYOUT_SOURCE_BOIL_COLD_VOLUME, "boil.volume20")             \
+    SOURCE (LAYOUT_SOURCE_FERMENTER_GRAVITY, "fermenter.gravity")        \
+    SOURCE (LAYOUT_SOURCE_FERMENTER_PLATO, "fermenter.plato")            \
+    SOURCE (LAYOUT_SOURCE_FERMENTER_ABV, "fermenter.abv")                \
+    SOURCE (LAYOUT_SOURCE_RECIPE_IBU, "recipe.ibu")                      \
+    SOURCE (LAYOUT_SOURCE_RECIPE_SRM, "recipe.srm")                      \
+    SOURCE (LAYOUT_SOURCE_ALARMS, "alarms")
+
+#define LAYOUT_SOURCE_ENUM(ID, NAME) ID,
+
+enum LayoutSource : uint32_t
+{
+    LAYOUT_SOURCES (LAYOUT_SOURCE_ENUM) LAYOUT_SOURCE_COUNT
+};
+
+enum LayoutWidgetType : uint32_t
+{
+    LAYOUT_WIDGET_TEXT = 0, // static text, drawn once per screen
+    LAYOUT_WIDGET_VALUE,    // caption, value and unit
+    LAYOUT_WIDGET_BAR       // caption and a bar from nMin to nMax
+};
+
+/// Widget flags
+#define LAYOUT_BORDER 0x01
+#define LAYOUT_INVERT 0x02
+#define LAYOUT_DURATION 0x04 // value shown as h:mm:ss
+
+struct LayoutTable
+{
+    uint32_t nOffset;
+    uint32_t nCount;
+};
+
+struct LayoutWidget
+{
+    uint32_t nType;
+    uint32_t nSource;
+    uint32_t nX;
+    uint32_t nY;
+    uint32_t nWidth;
+    uint32_t nHeight;
+    uint32_t nFont; // glyph height: 8, 12, 16, 20 or 24
+    uint32_t nFlags;
+    uint32_t nDecimals;
+    uint32_t nText; // string offset, caption or static text
+    uint32_t nUnit; // string offset
+    int32_t nMin;   // bar range, source units
+    int32_t nMax;
+
+    // Binding, see Dashboard.hpp
+    int32_t nResolution; // source units the value is rounded to
+    int32_t nHysteresis; // source units past a rounding step
+    uint32_t nInterval;  // ms between two redraws at least
+};
+
+struct LayoutScreen
+{
+    uint32_t nName; // string offset
+    uint32_t nFirst; // index into the widget table
+    uint32_t nCount;
+};
+
+struct LayoutHeader
+{
+    uint32_t nMagic;
+    uint32_t nVersion;
+    uint32_t nHeaderSize;
+    uint32_t nSize; // whole blob
+    uint32_t nCrc;  // whole blob with nCrc = 0
+
+    uint32_t nWidth; // panel the layout was resolved for
+    uint32_t nHeight;
+
+    LayoutTable screens;
+    LayoutTable widgets;
+};
+
+/// Typed view over a validated blob, only pointer arithmetic
+class LayoutView
+{
+public:
+    LayoutView () : pHeader (NULL)
+    {
+    }
+
+    /// Bounds checks every table and widget, NULL view if invalid
+    static LayoutView Open (const void* pData, size_t nSize)
+    {
+        LayoutView view;
+        const LayoutHeader* pHeader = (const LayoutHeader*)pData;
+
+        if (pData == NULL || ((uintptr_t)pData & 3) != 0 || nSize < sizeof (LayoutHeader)) return view;
+
+        if (pHeader->nMagic != LAYOUT_MAGIC || pHeader->nVersion != LAYOUT_VERSION) return view;
+
+        if (pHeader->nHeaderSize < sizeof (LayoutHeader) || pHeader->nSize > nSize || pHeader->nSize < pHeader->nHeaderSize || (pHeader->nSize & 3) != 0) return view;
+
+        // Same rule as the recipes, the string pool ends in a NUL
+        if ((((const uint32_t*)pData)[pHeader->nSize / 4 - 1] >> 24) != 0) return view;
+
+        if (CheckTable (pHeader, pHeader->screens, sizeof (LayoutScreen), LAYOUT_MAX_SCREENS) == false ||
+            CheckTable (pHeader, pHeader->widgets, sizeof (LayoutWidget), LAYOUT_MAX_SCREENS * LAYOUT_MAX_WIDGETS) == false)
+        {
+            return view;
+        }
+
+        view.pHeader = pHeader;
+
+        for (uint32_t nCount = 0; nCount < pHeader->screens.nCount; nCount++)
+        {
+            const LayoutScreen& screen = view.Screen (nCount);
+
+            if (Blob_CheckText (pHeader->nHeaderSize, pHeader->nSize, screen.nName) == false || screen.nCount > LAYOUT_MAX_WIDGETS ||
+                screen.nCount > pHeader->widgets.nCount || screen.nFirst > pHeader->widgets.nCount - screen.nCount)
+            {
+                return LayoutView ();
+            }
+        }
+
+        for (uint32_t nCount = 0; nCount < pHeader->widgets.nCount; nCount++)
+        {
+            const LayoutWidget& widget = view.Table<LayoutWidget> (pHeader->widgets)[nCount];
+
+            if (widget.nSource >= LAYOUT_SOURCE_COUNT || Blob_CheckText (pHeader->nHeaderSize, pHeader->nSize, widget.nText) == false ||
+                Blob_CheckText (pHeader->nHeaderSize, pHeader->nSize, widget.nUnit) == false ||
+                widget.nResolution <= 0 || widget.nHysteresis < 0 ||
+                (widget.nX & 7) != 0 || (widget.nWidth & 7) != 0 || widget.nWidth == 0 || widget.nHeight == 0 ||
+                widget.nX > pHeader->nWidth || widget.nWidth > pHeader->nWidth - widget.nX ||
+                widget.nY > pHeader->nHeight || widget.nHeight > pHeader->nHeight - widget.nY ||
+                (widget.nType == LAYOUT_WIDGET_BAR && widget.nMin >= widget.nMax))
+            {
+                return LayoutView ();
+            }
+        }
+
+        return view;
+    }
+
+    bool Verify () const
+    {
+        if (pHeader == NULL) return false;
+
+        return Checksum (pHeader, pHeader->nSize) == pHeader->nCrc;
+    }
+
+    static uint32_t Checksum (const void* pData, uint32_t nSize)
+    {
+        return Crc32_Words (pData, nSize, offsetof (LayoutHeader, nCrc) / 4);
+    }
+
+    bool IsValid () const
+    {
+        return pHeader != NULL;
+    }
+
+    const LayoutHeader& Header () const
+    {
+        return *pHeader;
+    }
+
+    /// Points into the blob, flash on the device
+    const char* Text (uint32_t nOffset) const
+    {
+        return (const char*)pHeader + nOffset;
+    }
+
+    uint32_t GetScreens () const
+    {
+        return pHeader->screens.nCount;
+    }
+
+    const LayoutScreen& Screen (uint32_t nIndex) const
+    {
+        return Table<LayoutScreen> (pHeader->screens)[nIndex];
+    }
+
+    /// nIndex counts from the first widget of the screen
+    const LayoutWidget& Widget (const LayoutScreen& screen, uint32_t nIndex) const
+    {
+        return Table<LayoutWidget> (pHeader->widgets)[screen.nFirst + nIndex];
+    }
+
+private:
+    static bool CheckTable (const LayoutHeader* pHeader, const LayoutTable& table, size_t nRecordSize, uint32_t nMaxCount)
+    {
+        return Blob_CheckTable (pHeader->nHeaderSize, pHeader->nSize, table.nOffset, table.nCount, (uint32_t)nRecordSize, nMaxCount);
+    }
+
+    template <typename Type>
+    const Type* Table (const LayoutTable& table) const
+    {
+        return (const Type*)((const uint8_t*)pHeader + table.nOffset);
+    }
+
+    const LayoutHeader* pHeader;
+};
+
+#endif
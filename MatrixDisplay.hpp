@@ -0,0 +1,353 @@
+///
+/// @author   GUSTAVO CAMPOS
+/// @author   GUSTAVO CAMPOS
+/// @date   28/05/2019 19:44
+/// @version  <#version#>
+///
+/// @copyright  (c) GUSTAVO CAMPOS, 2019
+/// @copyright  Licence
+///
+/// @see    ReadMe.txt for references
+///
+//               GNU GENERAL PUBLIC LICENSE
+//                Version 3, 29 June 2007
+//
+// Copyright (C) 2007 Free Software Foundation, Inc. <https://fsf.org/>
+// Everyone is permitted to copy and distribute verbatim copies
+// of this license document, but changing it is not allowed.
+//
+// Preamble
+//
+// The GNU General Public License is a free, copyleft license for
+// software and other kinds of works.
+//
+// The licenses for most software and other practical works are designed
+// to take away your freedom to share and change the works.  By contrast,
+// the GNU General Public License is intended to guarantee your freedom to
+// share and change all versions of a program--to make sure it remains free
+// software for all its users.  We, the Free Software Foundation, use the
+// GNU General Public License for most of our software; it applies also to
+// any other work released this way by its authors.  You can apply it to
+// your programs, too.
+//
+// See LICENSE file for the complete information
+
+#ifndef MATRIX_DISPLAY_HPP
+#define MATRIX_DISPLAY_HPP
+
+#include "Arduino.h"
+#include "CorePartition.h"
+
+#include <SPI.h>
+
+#include "Util.hpp"
+#include "Ring.hpp"
+#include "Sync.hpp"
+
+/// MAX7219 LED matrix
+///
+/// Cascaded 8x8 devices share the SPI bus with the e-paper panel,
+/// with their own chip select, and run at its clock and mode so
+/// neither side has to reconfigure the bus. Drawing goes to a frame
+/// buffer; Update compares it row by row with a shadow of what the
+/// devices show and sends only the rows that changed. A changed row
+/// is one chip select frame for the whole chain, devices whose row
+/// did not change get a NOOP, so one row costs 2 * MATRIX_DEVICES
+/// bytes on the bus instead of one transaction per device.
+///
+/// Thread_Matrix owns the bus side, other threads draw and post
+/// MATRIX_DISPLAY_CHANGE to the mailbox; messages posted before an
+/// update are coalesced into it. Post sets MATRIX_EVENT_MAIL, the
+/// thread waits for it instead of polling the mailbox.
+
+#ifndef MATRIX_DEVICES
+#define MATRIX_DEVICES 4
+#endif
+
+#ifndef MATRIX_CS_PIN
+#define MATRIX_CS_PIN D3 // must be high at boot, the idle state of CS
+#endif
+
+#ifndef MATRIX_INTENSITY
+#define MATRIX_INTENSITY 2
+#endif
+
+#define MATRIX_WIDTH (MATRIX_DEVICES * 8)
+#define MATRIX_HEIGHT 8
+
+/// Messages besides MATRIX_DISPLAY_CHANGE (Util.hpp)
+#define MATRIX_DISPLAY_INTENSITY 2
+#define MATRIX_DISPLAY_RESET 3
+
+/// Event flag set by Post
+#define MATRIX_EVENT_MAIL 0x01
+
+enum Max7219Register : uint8_t
+{
+    MAX7219_NOOP = 0x00,
+    MAX7219_ROW0 = 0x01,
+    MAX7219_DECODE = 0x09,
+    MAX7219_INTENSITY = 0x0A,
+    MAX7219_SCAN_LIMIT = 0x0B,
+    MAX7219_SHUTDOWN = 0x0C,
+    MAX7219_TEST = 0x0F
+};
+
+struct DisplayMessage
+{
+    uint8_t nType;
+    uint8_t nReserved[3];
+    uint32_t nValue;
+};
+
+class MatrixDisplay
+{
+public:
+    MatrixDisplay () : events ("matrix"), bStarted (false), nUpdates (0), nRowsSent (0), nRowsSkipped (0), nBytes (0), nLastCost (0), nMaxCost (0)
+    {
+        memset (frame, 0, sizeof (frame));
+        memset (shadow, 0, sizeof (shadow));
+    }
+
+    void Begin ()
+    {
+        pinMode (MATRIX_CS_PIN, OUTPUT);
+        digitalWrite (MATRIX_CS_PIN, HIGH);
+
+        SPI.begin ();
+
+        Reset ();
+
+        bStarted = true;
+    }
+
+    /// Reprograms every device and repaints, e.g. after a brown out
+    void Reset ()
+    {
+        SendAll (MAX7219_TEST, 0);
+        SendAll (MAX7219_DECODE, 0);
+        SendAll (MAX7219_SCAN_LIMIT, 7);
+        SendAll (MAX7219_INTENSITY, MATRIX_INTENSITY);
+        SendAll (MAX7219_SHUTDOWN, 1);
+
+        // Shadow no longer trusted, every row differs from its inverse
+        for (uint8_t nDevice = 0; nDevice < MATRIX_DEVICES; nDevice++)
+        {
+            for (uint8_t nRow = 0; nRow < MATRIX_HEIGHT; nRow++)
+            {
+                shadow[nDevice][nRow] = ~frame[nDevice][nRow];
+            }
+        }
+    }
+
+    void SetIntensity (uint8_t nIntensity)
+    {
+        SendAll (MAX7219_INTENSITY, nIntensity & 0x0F);
+    }
+
+    void Clear ()
+    {
+        memset (frame, 0, sizeof (frame));
+    }
+
+    /// x from the left of device 0, bit 7 is the leftmost column
+    void SetPixel (uint16_t nX, uint8_t nY, bool bOn)
+    {
+        if (nX >= MATRIX_WIDTH || nY >= MATRIX_HEIGHT) return;
+
+        uint8_t nMask = 0x80 >> (nX & 7);
+
+        if (bOn)
+            frame[nX >> 3][nY] |= nMask;
+        else
+            frame[nX >> 3][nY] &= ~nMask;
+    }
+
+    void SetRow (uint8_t nDevice, uint8_t nRow, uint8_t nBits)
+    {
+        if (nDevice < MATRIX_DEVICES && nRow < MATRIX_HEIGHT) frame[nDevice][nRow] = nBits;
+    }
+
+    /// Column nX as a byte, bit 0 is the top row
+    void SetColumn (uint16_t nX, uint8_t nBits)
+    {
+        for (uint8_t nRow = 0; nRow < MATRIX_HEIGHT; nRow++)
+        {
+            SetPixel (nX, nRow, (nBits >> nRow) & 1);
+        }
+    }
+
+    /// Sends the changed rows, returns how many were sent
+    uint8_t Update ()
+    {
+        uint32_t nStart = micros ();
+        uint8_t nSent = 0;
+
+        for (uint8_t nRow = 0; nRow < MATRIX_HEIGHT; nRow++)
+        {
+            uint8_t buffer[MATRIX_DEVICES * 2];
+            bool bChanged = false;
+
+            // The first word shifted out ends in the last device
+            for (uint8_t nDevice = 0; nDevice < MATRIX_DEVICES; nDevice++)
+            {
+                uint8_t nIndex = (MATRIX_DEVICES - 1 - nDevice) * 2;
+
+                if (frame[nDevice][nRow] != shadow[nDevice][nRow])
+                {
+                    buffer[nIndex] = MAX7219_ROW0 + nRow;
+                    buffer[nIndex + 1] = frame[nDevice][nRow];
+                    shadow[nDevice][nRow] = frame[nDevice][nRow];
+                    bChanged = true;
+                }
+                else
+                {
+                    buffer[nIndex] = MAX7219_NOOP;
+                    buffer[nIndex + 1] = 0;
+                }
+            }
+
+            if (bChanged == false)
+            {
+                nRowsSkipped++;
+                continue;
+            }
+
+            Transfer (buffer, sizeof (buffer));
+
+            nSent++;
+        }
+
+        nRowsSent += nSent;
+        nUpdates++;
+
+        nLastCost = micros () - nStart;
+        if (nLastCost > nMaxCost) nMaxCost = nLastCost;
+
+        return nSent;
+    }
+
+    bool Post (uint8_t nType, uint32_t nValue = 0)
+    {
+        DisplayMessage message = {nType, {0, 0, 0}, nValue};
+
+        if (mailbox.Push (message) == false) return false;
+
+        events.Set (MATRIX_EVENT_MAIL);
+        return true;
+    }
+
+    /// Parks the caller until something is posted
+    void WaitMail ()
+    {
+        events.Wait (MATRIX_EVENT_MAIL, SYNC_EVENT_CLEAR);
+    }
+
+    bool Receive (DisplayMessage& message)
+    {
+        return mailbox.Pop (message);
+    }
+
+    bool IsStarted () const
+    {
+        return bStarted;
+    }
+
+    void Show (Stream& client)
+    {
+        client.printf ("%-20s: [%u x %u, %u devices]\r\n", "Size", MATRIX_WIDTH, MATRIX_HEIGHT, MATRIX_DEVICES);
+        client.printf ("%-20s: [%u]\r\n", "Updates", nUpdates);
+        client.printf ("%-20s: [%u sent, %u skipped]\r\n", "Rows", nRowsSent, nRowsSkipped);
+        client.printf ("%-20s: [%u]\r\n", "Bytes on bus", nBytes);
+        client.printf ("%-20s: [%u / %u us]\r\n", "Update last/max", nLastCost, nMaxCost);
+        client.printf ("%-20s: [%u]\r\n", "Mailbox dropped", mailbox.GetDropped ());
+
+        for (uint8_t nRow = 0; nRow < MATRIX_HEIGHT; nRow++)
+        {
+            for (uint16_t nX = 0; nX < MATRIX_WIDTH; nX++)
+            {
+                client.print ((frame[nX >> 3][nRow] & (0x80 >> (nX & 7))) ? '#' : '.');
+            }
+
+            client.println ();
+        }
+    }
+
+private:
+    /// One chip select frame, the chain latches on the rising edge
+    void Transfer (const uint8_t* pBuffer, uint8_t nSize)
+    {
+        digitalWrite (MATRIX_CS_PIN, LOW);
+        SPI.writeBytes ((uint8_t*)pBuffer, nSize);
+        digitalWrite (MATRIX_CS_PIN, HIGH);
+
+        nBytes += nSize;
+    }
+
+    void SendAll (uint8_t nRegister, uint8_t nValue)
+    {
+        uint8_t buffer[MATRIX_DEVICES * 2];
+
+        for (uint8_t nDevice = 0; nDevice < MATRIX_DEVICES; nDevice++)
+        {
+            buffer[nDevice * 2] = nRegister;
+            buffer[nDevice * 2 + 1] = nValue;
+        }
+
+        Transfer (buffer, sizeof (buffer));
+    }
+
+    uint8_t frame[MATRIX_DEVICES][MATRIX_HEIGHT];
+    uint8_t shadow[MATRIX_DEVICES][MATRIX_HEIGHT];
+
+    LockFreeRing<DisplayMessage, 8> mailbox;
+    SyncEvent events;
+
+    bool bStarted;
+    uint32_t nUpdates;
+    uint32_t nRowsSent;
+    uint32_t nRowsSkipped;
+    uint32_t nBytes;
+    uint32_t nLastCost;
+    uint32_t nMaxCost;
+};
+
+MatrixDisplay matrixDisplay;
+
+/// Owns the matrix side of the bus, sleeps on an empty mailbox
+void Thread_Matrix (void* pValue)
+{
+    DisplayMessage message;
+
+    matrixDisplay.Begin ();
+
+    while (true)
+    {
+        bool bChanged = false;
+
+        while (matrixDisplay.Receive (message))
+        {
+            switch (message.nType)
+            {
+                case MATRIX_DISPLAY_CHANGE:
+                    bChanged = true;
+                    break;
+
+                case MATRIX_DISPLAY_INTENSITY:
+                    matrixDisplay.SetIntensity ((uint8_t)message.nValue);
+                    break;
+
+                case MATRIX_DISPLAY_RESET:
+                    matrixDisplay.Reset ();
+                    bChanged = true;
+                    break;
+            }
+        }
+
+        if (bChanged) matrixDisplay.Update ();
+
+        matrixDisplay.WaitMail ();
+    }
+}
+
+#endif
@@ -0,0 +1,325 @@
+///
+/// @author   GUSTAVO CAMPOS
+/// @author   GUSTAVO CAMPOS
+/// @date   28/05/2019 19:44
+/// @version  <#version#>
+///
+/// @copyright  (c) GUSTAVO CAMPOS, 2019
+/// @copyright  Licence
+///
+/// @see    ReadMe.txt for references
+///
+//               GNU GENERAL PUBLIC LICENSE
+//                Version 3, 29 June 2007
+//
+// Copyright (C) 2007 Free Software Foundation, Inc. <https://fsf.org/>
+// Everyone is permitted to copy and distribute verbatim copies
+// of this license document, but changing it is not allowed.
+//
+// Preamble
+//
+// The GNU General Public License is a free, copyleft license for
+// software and other kinds of works.
+//
+// The licenses for most software and other practical works are designed
+// to take away your freedom to share and change the works.  By contrast,
+// the GNU General Public License is intended to guarantee your freedom to
+// share and change all versions of a program--to make sure it remains free
+// software for all its users.  We, the Free Software Foundation, use the
+// GNU General Public License for most of our software; it applies also to
+// any other work released this way by its authors.  You can apply it to
+// your programs, too.
+//
+// See LICENSE file for the complete information
+
+#ifndef MATRIX_TICKER_HPP
+#define MATRIX_TICKER_HPP
+
+#include "Arduino.h"
+#include "CorePartition.h"
+
+#include "fonts.h"
+
+#include "MatrixDisplay.hpp"
+#include "Simulation.hpp"
+#include "Alarms.hpp"
+#include "Sync.hpp"
+
+/// Scrolling text on the LED matrix
+///
+/// Glyphs come from Font8 (5x8, row-major, PROGMEM) and are
+/// rasterized column by column, each column once, into a window of
+/// eight row bit planes. A scroll step only moves the window offset
+/// and copies eight bits per row and device out of the planes, then
+/// the matrix driver sends the rows that changed. The window is a
+/// ring of TICKER_WINDOW columns filled just ahead of the visible
+/// area, so the message length does not change RAM or step cost.
+///
+/// A stopped ticker leaves the matrix to the matrix command, its
+/// thread is parked on an event until the ticker runs again.
+
+#ifndef TICKER_WINDOW
+#define TICKER_WINDOW 128 // columns, power of two
+#endif
+
+#ifndef TICKER_TEXT
+#define TICKER_TEXT 64
+#endif
+
+/// Milliseconds per one column step
+#ifndef TICKER_STEP_MS
+#define TICKER_STEP_MS 40
+#endif
+
+/// Glyph cell: font width plus one blank column
+#define TICKER_CELL 6
+
+/// Event flag set when the ticker runs again
+#define TICKER_EVENT_RUN 0x01
+
+static_assert ((TICKER_WINDOW & (TICKER_WINDOW - 1)) == 0, "Ticker window must be a power of two");
+static_assert (TICKER_WINDOW >= MATRIX_WIDTH + 8, "Ticker window must cover the matrix plus one byte");
+
+class MatrixTicker
+{
+public:
+    MatrixTicker () : nLength (0), nPosition (0), nGenerated (0), nStepMs (TICKER_STEP_MS), bStatus (true), bRunning (true), nSteps (0), nLastCost (0), nMaxCost (0), events ("ticker")
+    {
+        szText[0] = '\0';
+        memset (planes, 0, sizeof (planes));
+    }
+
+    void SetText (const char* pszText)
+    {
+        strncpy (szText, pszText, sizeof (szText) - 1);
+        szText[sizeof (szText) - 1] = '\0';
+
+        nLength = (uint16_t)strlen (szText);
+        nPosition = 0;
+        nGenerated = 0;
+    }
+
+    /// Status mode refreshes the text from the plant after every pass
+    void SetStatus (bool bEnable)
+    {
+        bStatus = bEnable;
+    }
+
+    void SetStepMs (uint32_t nValue)
+    {
+        nStepMs = nValue > 0 ? nValue : 1;
+    }
+
+    uint32_t GetStepMs () const
+    {
+        return nStepMs;
+    }
+
+    /// Stopped, Thread_Ticker stops drawing until it runs again
+    void SetRunning (bool bEnable)
+    {
+        bRunning = bEnable;
+
+        if (bEnable)
+            events.Set (TICKER_EVENT_RUN);
+        else
+            events.Clear (TICKER_EVENT_RUN);
+    }
+
+    bool IsRunning () const
+    {
+        return bRunning;
+    }
+
+    /// Parks the caller until the ticker runs again
+    void WaitRunning ()
+    {
+        while (bRunning == false)
+        {
+            events.Wait (TICKER_EVENT_RUN, SYNC_EVENT_CLEAR);
+        }
+    }
+
+    /// Advances one column and draws the visible window, returns true
+    /// when a pass ended
+    bool Step (MatrixDisplay& display)
+    {
+        uint32_t nStart = micros ();
+
+        // Fill just ahead of what is visible after this step
+        while (nGenerated < nPosition + MATRIX_WIDTH + 8)
+        {
+            Generate (nGenerated++);
+        }
+
+        uint16_t nOffset = nPosition & (TICKER_WINDOW - 1);
+        uint8_t nShift = nOffset & 7;
+
+        for (uint8_t nDevice = 0; nDevice < MATRIX_DEVICES; nDevice++)
+        {
+            uint16_t nByte = ((nOffset >> 3) + nDevice) & (TICKER_WINDOW / 8 - 1);
+            uint16_t nNext = (nByte + 1) & (TICKER_WINDOW / 8 - 1);
+
+            for (uint8_t nRow = 0; nRow < MATRIX_HEIGHT; nRow++)
+            {
+                display.SetRow (nDevice, nRow, (uint8_t)((planes[nRow][nByte] << nShift) | (nShift > 0 ? planes[nRow][nNext] >> (8 - nShift) : 0)));
+            }
+        }
+
+        nPosition++;
+        nSteps++;
+
+        bool bWrapped = nPosition >= PassLength ();
+
+        if (bWrapped)
+        {
+            // Restart the pass, the screen is blank on both sides of it
+            nPosition = 0;
+            nGenerated = 0;
+        }
+
+        nLastCost = micros () - nStart;
+        if (nLastCost > nMaxCost) nMaxCost = nLastCost;
+
+        return bWrapped;
+    }
+
+    bool IsStatus () const
+    {
+        return bStatus;
+    }
+
+    void Show (Stream& client)
+    {
+        client.printf ("%-20s: [%s]\r\n", "State", bRunning ? "running" : "stopped");
+        client.printf ("%-20s: [%s]\r\n", "Text", szText);
+        client.printf ("%-20s: [%s]\r\n", "Status mode", bStatus ? "on" : "off");
+        client.printf ("%-20s: [%u ms]\r\n", "Step", nStepMs);
+        client.printf ("%-20s: [%u of %u]\r\n", "Position", nPosition, PassLength ());
+        client.printf ("%-20s: [%u]\r\n", "Steps", nSteps);
+        client.printf ("%-20s: [%u / %u us]\r\n", "Step last/max", nLastCost, nMaxCost);
+    }
+
+private:
+    /// A pass is a blank screen width, so the text enters from the
+    /// right, followed by the text until it has left on the left
+    uint32_t PassLength () const
+    {
+        return (uint32_t)nLength * TICKER_CELL + MATRIX_WIDTH;
+    }
+
+    /// Column nColumn of the pass, bit 0 is the top row
+    uint8_t Rasterize (uint32_t nColumn) const
+    {
+        if (nColumn < MATRIX_WIDTH) return 0;
+
+        uint32_t nChar = (nColumn - MATRIX_WIDTH) / TICKER_CELL;
+        uint8_t nX = (nColumn - MATRIX_WIDTH) % TICKER_CELL;
+
+        if (nChar >= nLength || nX >= Font8.Width) return 0;
+
+        uint8_t chValue = (uint8_t)szText[nChar];
+
+        if (chValue < ' ' || chValue > '~') chValue = '?';
+
+        const uint8_t* pGlyph = Font8.table + (chValue - ' ') * Font8.Height;
+        uint8_t nBits = 0;
+
+        for (uint8_t nRow = 0; nRow < MATRIX_HEIGHT; nRow++)
+        {
+            if (pgm_read_byte (pGlyph + nRow) & (0x80 >> nX)) nBits |= 1 << nRow;
+        }
+
+        return nBits;
+    }
+
+    /// Writes pass column nColumn into the window planes
+    void Generate (uint32_t nColumn)
+    {
+        uint8_t nBits = Rasterize (nColumn);
+        uint16_t nSlot = nColumn & (TICKER_WINDOW - 1);
+        uint8_t nMask = 0x80 >> (nSlot & 7);
+
+        for (uint8_t nRow = 0; nRow < MATRIX_HEIGHT; nRow++)
+        {
+            if (nBits & (1 << nRow))
+                planes[nRow][nSlot >> 3] |= nMask;
+            else
+                planes[nRow][nSlot >> 3] &= ~nMask;
+        }
+    }
+
+    char szText[TICKER_TEXT];
+    uint16_t nLength;
+
+    uint8_t planes[MATRIX_HEIGHT][TICKER_WINDOW / 8];
+    uint32_t nPosition;
+    uint32_t nGenerated;
+
+    uint32_t nStepMs;
+    bool bStatus;
+    bool bRunning;
+
+    uint32_t nSteps;
+    uint32_t nLastCost;
+    uint32_t nMaxCost;
+
+    SyncEvent events;
+};
+
+MatrixTicker matrixTicker;
+
+/// Plant summary for the status mode, the first alarm ahead of it
+void Ticker_StatusText (char* pszText, size_t nSize)
+{
+    int32_t nMash = ToCenti (simulation.Vessel (VESSEL_MASH).nTemperature);
+    int32_t nBoil = ToCenti (simulation.Vessel (VESSEL_BOIL).nTemperature);
+
+    Alarm_TickerText (pszText, nSize);
+
+    size_t nAlarm = strlen (pszText);
+
+    // Sign printed apart, nMash / 100 is 0 from -0.99 to -0.01
+    snprintf (pszText + nAlarm, nSize - nAlarm, "%sMash %s%d.%dC  Boil %s%d.%dC", nAlarm > 0 ? "  " : "",
+              nMash < 0 ? "-" : "", (int)(Abs (nMash) / 100), (int)(Abs (nMash) % 100 / 10),
+              nBoil < 0 ? "-" : "", (int)(Abs (nBoil) / 100), (int)(Abs (nBoil) % 100 / 10));
+}
+
+/// One column per TICKER_STEP_MS, sleeps in between
+void Thread_Ticker (void* pValue)
+{
+    // Static, thread stacks are small
+    static char szText[TICKER_TEXT];
+
+    uint32_t nAlarms = alarms.GetTransitions ();
+
+    // A "ticker text" typed before this thread first ran is kept
+    if (matrixTicker.IsStatus ())
+    {
+        Ticker_StatusText (szText, sizeof (szText));
+        matrixTicker.SetText (szText);
+    }
+
+    while (true)
+    {
+        // Stopped, the matrix belongs to the matrix command
+        matrixTicker.WaitRunning ();
+
+        // A raised or cleared alarm restarts the text at once
+        bool bAlarms = nAlarms != alarms.GetTransitions ();
+
+        if ((matrixTicker.Step (matrixDisplay) || bAlarms) && matrixTicker.IsStatus ())
+        {
+            nAlarms = alarms.GetTransitions ();
+
+            Ticker_StatusText (szText, sizeof (szText));
+            matrixTicker.SetText (szText);
+        }
+
+        matrixDisplay.Post (MATRIX_DISPLAY_CHANGE);
+
+        CorePartition_Sleep (matrixTicker.GetStepMs ());
+    }
+}
+
+#endif
@@ -0,0 +1,400 @@
+///
+/// @author   GUSTAVO CAMPOS
+/// @author   GUSTAVO CAMPOS
+/// @date   28/05/2019 19:44
+/// @version  <#version#>
+///
+/// @copyright  (c) GUSTAVO CAMPOS, 2019
+/// @copyright  Licence
+///
+/// @see    ReadMe.txt for references
+///
+//               GNU GENERAL PUBLIC LICENSE
+//                Version 3, 29 June 2007
+//
+// Copyright (C) 2007 Free Software Foundation, Inc. <https://fsf.org/>
+// Everyone is permitted to copy and distribute verbatim copies
+// of this license document, but changing it is not allowed.
+//
+// Preamble
+//
+// The GNU General Public License is a free, copyleft license for
+// software and other kinds of works.
+//
+// The licenses for most software and other practical works are designed
+// to take away your freedom to share and change the works.  By contrast,
+// the GNU General Public License is intended to guarantee your freedom to
+// share and change all versions of a program--to make sure it remains free
+// software for all its users.  We, the Free Software Foundation, use the
+// GNU General Public License for most of our software; it applies also to
+// any other work released this way by its authors.  You can apply it to
+// your programs, too.
+//
+// See LICENSE file for the complete information
+
+#ifndef MEMORY_POOL_HPP
+#define MEMORY_POOL_HPP
+
+#include "Arduino.h"
+#include "HeapMonitor.hpp"
+
+#include <stdlib.h>
+#include <new>
+#include <utility>
+
+/// Fixed-block pools
+///
+/// Size classed pools reserved statically at boot, allocation and
+/// release are O(1) through an intrusive free list and never touch
+/// the general heap, so long running units do not fragment it.
+
+#ifndef POOL_16_BLOCKS
+#define POOL_16_BLOCKS 32
+#endif
+
+#ifndef POOL_32_BLOCKS
+#define POOL_32_BLOCKS 24
+#endif
+
+#ifndef POOL_64_BLOCKS
+#define POOL_64_BLOCKS 16
+#endif
+
+#ifndef POOL_128_BLOCKS
+#define POOL_128_BLOCKS 8
+#endif
+
+struct PoolStats
+{
+    uint16_t nBlockSize;
+    uint16_t nBlocks;
+    uint16_t nUsed;
+    uint16_t nPeak;
+    uint32_t nAllocs;
+    uint32_t nFailures;
+    uint32_t nBadReleases;
+};
+
+template <uint16_t nBlockSize, uint16_t nBlocks>
+class FixedBlockPool
+{
+public:
+    FixedBlockPool () : pFree (NULL)
+    {
+        stats.nBlockSize = nBlockSize;
+        stats.nBlocks = nBlocks;
+        stats.nUsed = 0;
+        stats.nPeak = 0;
+        stats.nAllocs = 0;
+        stats.nFailures = 0;
+        stats.nBadReleases = 0;
+
+        memset (nInUse, 0, sizeof (nInUse));
+
+        for (uint16_t nCount = nBlocks; nCount > 0; nCount--)
+        {
+            blocks[nCount - 1].pNext = pFree;
+            pFree = &blocks[nCount - 1];
+        }
+    }
+
+    /// @return NULL when exhausted, the caller counts the failure
+    void* Allocate ()
+    {
+        Block* pBlock = pFree;
+
+        if (pBlock == NULL) return NULL;
+
+        pFree = pBlock->pNext;
+
+        SetInUse (pBlock - blocks, true);
+
+        stats.nAllocs++;
+        if (++stats.nUsed > stats.nPeak) stats.nPeak = stats.nUsed;
+
+        return pBlock->data;
+    }
+
+    /// Pointers inside a block and blocks already free are refused,
+    /// they would corrupt the free list
+    /// @return false if refused
+    bool Release (void* pData)
+    {
+        size_t nOffset = (const uint8_t*)pData - (const uint8_t*)blocks;
+
+        if (Owns (pData) == false || nOffset % sizeof (Block) != 0 || IsInUse (nOffset / sizeof (Block)) == false)
+        {
+            stats.nBadReleases++;
+            return false;
+        }
+
+        Block* pBlock = (Block*)pData;
+
+        SetInUse (pBlock - blocks, false);
+
+        pBlock->pNext = pFree;
+        pFree = pBlock;
+
+        stats.nUsed--;
+
+        return true;
+    }
+
+    bool Owns (const void* pData) const
+    {
+        return (const uint8_t*)pData >= (const uint8_t*)blocks && (const uint8_t*)pData < (const uint8_t*)(blocks + nBlocks);
+    }
+
+    const PoolStats& GetStats () const
+    {
+        return stats;
+    }
+
+    void CountFailure ()
+    {
+        stats.nFailures++;
+    }
+
+private:
+    bool IsInUse (size_t nBlock) const
+    {
+        return (nInUse[nBlock / 32] >> (nBlock % 32)) & 1;
+    }
+
+    void SetInUse (size_t nBlock, bool bInUse)
+    {
+        if (bInUse)
+            nInUse[nBlock / 32] |= (uint32_t)1 << (nBlock % 32);
+        else
+            nInUse[nBlock / 32] &= ~((uint32_t)1 << (nBlock % 32));
+    }
+
+    union Block
+    {
+        Block* pNext;
+        uint32_t nAlign;
+        uint8_t data[nBlockSize];
+    };
+
+    Block blocks[nBlocks];
+    Block* pFree;
+    uint32_t nInUse[(nBlocks + 31) / 32];
+    PoolStats stats;
+};
+
+class MemoryPools
+{
+public:
+    static const uint16_t nMaxBlockSize = 128;
+
+    /// Allocates from the smallest class that fits, spilling to a
+    /// larger class when the best fit is exhausted. A failure is
+    /// counted once, on the best fit class, and only when no class
+    /// could serve the request.
+    /// @return NULL if no class can hold nSize
+    void* Allocate (size_t nSize)
+    {
+        void* pData = NULL;
+
+        if (nSize <= 16 && (pData = pool16.Allocate ()) != NULL) return pData;
+        if (nSize <= 32 && (pData = pool32.Allocate ()) != NULL) return pData;
+        if (nSize <= 64 && (pData = pool64.Allocate ()) != NULL) return pData;
+        if (nSize <= 128 && (pData = pool128.Allocate ()) != NULL) return pData;
+
+        if (nSize <= 16)
+            pool16.CountFailure ();
+        else if (nSize <= 32)
+            pool32.CountFailure ();
+        else if (nSize <= 64)
+            pool64.CountFailure ();
+        else if (nSize <= 128)
+            pool128.CountFailure ();
+
+        return NULL;
+    }
+
+    /// A bad pointer inside a pool is refused and counted, never freed
+    /// @return false if pData does not belong to any pool
+    bool Release (void* pData)
+    {
+        if (pool16.Owns (pData))
+            pool16.Release (pData);
+        else if (pool32.Owns (pData))
+            pool32.Release (pData);
+        else if (pool64.Owns (pData))
+            pool64.Release (pData);
+        else if (pool128.Owns (pData))
+            pool128.Release (pData);
+        else
+            return false;
+
+        return true;
+    }
+
+    bool Owns (const void* pData) const
+    {
+        return pool16.Owns (pData) || pool32.Owns (pData) || pool64.Owns (pData) || pool128.Owns (pData);
+    }
+
+    void Show (Stream& client)
+    {
+        const PoolStats* pStats[] = {&pool16.GetStats (), &pool32.GetStats (), &pool64.GetStats (), &pool128.GetStats ()};
+
+        client.println (F ("Block\tTotal\tUsed\tPeak\tAllocs\tFails\tBad"));
+        client.println (F ("----------------------------------------------"));
+
+        for (uint8_t nCount = 0; nCount < sizeof (pStats) / sizeof (pStats[0]); nCount++)
+        {
+            client.printf ("%u\t%u\t%u\t%u\t%u\t%u\t%u\r\n",
+                           pStats[nCount]->nBlockSize,
+                           pStats[nCount]->nBlocks,
+                           pStats[nCount]->nUsed,
+                           pStats[nCount]->nPeak,
+                           pStats[nCount]->nAllocs,
+                           pStats[nCount]->nFailures,
+                           pStats[nCount]->nBadReleases);
+        }
+
+        client.printf ("Oversize (heap): %u\r\n", nOversize);
+    }
+
+    uint32_t nOversize = 0;
+
+private:
+    FixedBlockPool<16, POOL_16_BLOCKS> pool16;
+    FixedBlockPool<32, POOL_32_BLOCKS> pool32;
+    FixedBlockPool<64, POOL_64_BLOCKS> pool64;
+    FixedBlockPool<128, POOL_128_BLOCKS> pool128;
+};
+
+MemoryPools memoryPools;
+
+/// Pool first allocation, requests larger than the biggest class
+/// or with every fitting class exhausted go to the heap and are
+/// counted as oversize.
+void* Pool_Allocate (size_t nSize)
+{
+    void* pData = memoryPools.Allocate (nSize);
+
+    if (pData == NULL)
+    {
+        memoryPools.nOversize++;
+        pData = TRACKED_MALLOC (nSize);
+    }
+
+    return pData;
+}
+
+void Pool_Release (void* pData)
+{
+    if (pData == NULL) return;
+
+    if (memoryPools.Release (pData) == false)
+    {
+        TRACKED_FREE (pData);
+    }
+}
+
+/// Standard allocator adapter, allows STL containers on
+/// terminal and message paths to live in the pools.
+template <typename T>
+class PoolAllocator
+{
+public:
+    typedef T value_type;
+    typedef T* pointer;
+    typedef const T* const_pointer;
+    typedef T& reference;
+    typedef const T& const_reference;
+    typedef size_t size_type;
+    typedef ptrdiff_t difference_type;
+
+    template <typename U>
+    struct rebind
+    {
+        typedef PoolAllocator<U> other;
+    };
+
+    PoolAllocator ()
+    {
+    }
+
+    template <typename U>
+    PoolAllocator (const PoolAllocator<U>&)
+    {
+    }
+
+    T* allocate (size_t nCount)
+    {
+        return (T*)Pool_Allocate (nCount * sizeof (T));
+    }
+
+    void deallocate (T* pData, size_t)
+    {
+        Pool_Release (pData);
+    }
+
+    template <typename U, typename... Args>
+    void construct (U* pData, Args&&... args)
+    {
+        new ((void*)pData) U (std::forward<Args> (args)...);
+    }
+
+    template <typename U>
+    void destroy (U* pData)
+    {
+        pData->~U ();
+    }
+
+    size_t max_size () const
+    {
+        return (size_t)-1 / sizeof (T);
+    }
+};
+
+template <typename T, typename U>
+bool operator== (const PoolAllocator<T>&, const PoolAllocator<U>&)
+{
+    return true;
+}
+
+template <typename T, typename U>
+bool operator!= (const PoolAllocator<T>&, const PoolAllocator<U>&)
+{
+    return false;
+}
+
+/// Scoped scratch buffer taken from the pools, used instead of
+/// String for transient formatting.
+class PoolBuffer
+{
+public:
+    PoolBuffer (size_t nSize) : pData ((char*)Pool_Allocate (nSize)), nSize (pData == NULL ? 0 : nSize)
+    {
+        if (pData != NULL) pData[0] = '\0';
+    }
+
+    ~PoolBuffer ()
+    {
+        Pool_Release (pData);
+    }
+
+    char* operator() ()
+    {
+        return pData;
+    }
+
+    size_t Size () const
+    {
+        return nSize;
+    }
+
+private:
+    PoolBuffer (const PoolBuffer&);
+    PoolBuffer& operator= (const PoolBuffer&);
+
+    char* pData;
+    size_t nSize;
+};
+
+#endif
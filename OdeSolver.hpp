@@ -0,0 +1,238 @@
+///
+/// @author   GUSTAVO CAMPOS
+/// @author   GUSTAVO CAMPOS
+/// @date   28/05/2019 19:44
+/// @version  <#version#>
+///
+/// @copyright  (c) GUSTAVO CAMPOS, 2019
+/// @copyright  Licence
+///
+/// @see    ReadMe.txt for references
+///
+//               GNU GENERAL PUBLIC LICENSE
+//                Version 3, 29 June 2007
+//
+// Copyright (C) 2007 Free Software Foundation, Inc. <https://fsf.org/>
+// Everyone is permitted to copy and distribute verbatim copies
+// of this license document, but changing it is not allowed.
+//
+// Preamble
+//
+// The GNU General Public License is a free, copyleft license for
+// software and other kinds of works.
+//
+// The licenses for most software and other practical works are designed
+// to take away your freedom to share and change the works.  By contrast,
+// the GNU General Public License is intended to guarantee your freedom to
+// share and change all versions of a program--to make sure it remains free
+// software for all its users.  We, the Free Software Foundation, use the
+// GNU General Public License for most of our software; it applies also to
+// any other work released this way by its authors.  You can apply it to
+// your programs, too.
+//
+// See LICENSE file for the complete information
+
+#ifndef ODE_SOLVER_HPP
+#define ODE_SOLVER_HPP
+
+#include <stdint.h>
+
+#include "FixedPoint.hpp"
+
+/// Embedded Runge-Kutta 2(3), Bogacki-Shampine
+///
+/// Three derivative evaluations per step (the last one is reused as
+/// the first of the next step), the difference between the 2nd and
+/// 3rd order solutions is the error estimate. Templated on the number
+/// type like the vessel model: Fixed on the device, double on the
+/// host.
+///
+/// Step control only halves or doubles the step: a step is rejected
+/// and halved when the error is above the tolerance and the next one
+/// doubled when it is below 1/8 of it, the error of a 3rd order step
+/// scales with h^3. No pow or root is needed, which matters without
+/// an FPU, and the cost is bounded: a rejected step is retried at half
+/// the size just tried, which is less than nStep when the last step of
+/// a span was cut short; once that reaches nMinStep or nMaxRejects
+/// retries are used up, the step is taken as it is, above the
+/// tolerance or not, and counted as forced when it is.
+///
+/// The system is any type with
+///   void Derivatives (const Number* pState, Number* pRate) const;
+
+template <typename Number, uint8_t nSize>
+class Rk23
+{
+public:
+    Rk23 () : nStep (Number (0.25)), nMinStep (Number (1.0 / 64)), nMaxStep (Number (2.0)), nSteps (0), nRejects (0), nForced (0), nEvaluations (0), nLastError (Number (0)), nMaxError (Number (0))
+    {
+        for (uint8_t nCount = 0; nCount < nSize; nCount++)
+        {
+            tolerance[nCount] = Number (0.01);
+        }
+    }
+
+    /// Absolute tolerance per component, step limits in the system's
+    /// time unit; nMaxStep / nMinStep should be a power of two
+    void Configure (const Number* pTolerance, Number nMin, Number nMax)
+    {
+        for (uint8_t nCount = 0; nCount < nSize; nCount++)
+        {
+            tolerance[nCount] = pTolerance[nCount];
+        }
+
+        nMinStep = nMin;
+        nMaxStep = nMax;
+        nStep = Clamp (nStep, nMinStep, nMaxStep);
+    }
+
+    /// Advances pState by nSpan, the system must not change inside
+    /// the span; the step size carries over to the next call
+    template <typename System>
+    void Integrate (const System& system, Number* pState, Number nSpan)
+    {
+        Number k1[nSize], k2[nSize], k3[nSize], k4[nSize], next[nSize], stage[nSize];
+
+        system.Derivatives (pState, k1);
+        nEvaluations++;
+
+        while (nSpan > Number (0))
+        {
+            uint8_t nRejected = 0;
+
+            while (true)
+            {
+                // The last step of a span is cut short, nStep is kept
+                Number h = nStep < nSpan ? nStep : nSpan;
+                Number nHalf = h * Number (0.5);
+                Number nThreeQuarters = h * Number (0.75);
+
+                for (uint8_t nCount = 0; nCount < nSize; nCount++)
+                {
+                    stage[nCount] = pState[nCount] + nHalf * k1[nCount];
+                }
+
+                system.Derivatives (stage, k2);
+
+                for (uint8_t nCount = 0; nCount < nSize; nCount++)
+                {
+                    stage[nCount] = pState[nCount] + nThreeQuarters * k2[nCount];
+                }
+
+                system.Derivatives (stage, k3);
+
+                for (uint8_t nCount = 0; nCount < nSize; nCount++)
+                {
+                    next[nCount] = pState[nCount] + h * (Number (2.0 / 9) * k1[nCount] + Number (1.0 / 3) * k2[nCount] + Number (4.0 / 9) * k3[nCount]);
+                }
+
+                system.Derivatives (next, k4);
+                nEvaluations += 3;
+
+                // Largest error as a fraction of its tolerance
+                Number nError = Number (0);
+
+                for (uint8_t nCount = 0; nCount < nSize; nCount++)
+                {
+                    Number nDelta = h * (Number (-5.0 / 72) * k1[nCount] + Number (1.0 / 12) * k2[nCount] + Number (1.0 / 9) * k3[nCount] - Number (1.0 / 8) * k4[nCount]);
+                    Number nRatio = Abs (nDelta) / tolerance[nCount];
+
+                    if (nRatio > nError) nError = nRatio;
+                }
+
+                if (nError <= Number (1) || h <= nMinStep || nRejected >= nMaxRejects)
+                {
+                    if (nError > Number (1)) nForced++;
+
+                    nLastError = nError;
+                    if (nError > nMaxError) nMaxError = nError;
+
+                    if (nError < Number (0.125) && h == nStep && nStep < nMaxStep) nStep = Clamp (nStep * Number (2), nMinStep, nMaxStep);
+
+                    nSpan -= h;
+                    break;
+                }
+
+                // Halving nStep would retry a cut short step unchanged
+                nStep = Clamp (h * Number (0.5), nMinStep, nMaxStep);
+                nRejected++;
+                nRejects++;
+            }
+
+            for (uint8_t nCount = 0; nCount < nSize; nCount++)
+            {
+                pState[nCount] = next[nCount];
+                k1[nCount] = k4[nCount];
+            }
+
+            nSteps++;
+        }
+    }
+
+    Number GetStep () const
+    {
+        return nStep;
+    }
+
+    uint32_t GetSteps () const
+    {
+        return nSteps;
+    }
+
+    uint32_t GetRejects () const
+    {
+        return nRejects;
+    }
+
+    uint32_t GetForced () const
+    {
+        return nForced;
+    }
+
+    uint32_t GetEvaluations () const
+    {
+        return nEvaluations;
+    }
+
+    /// Error of the last accepted step, 1 is the tolerance
+    Number GetLastError () const
+    {
+        return nLastError;
+    }
+
+    Number GetMaxError () const
+    {
+        return nMaxError;
+    }
+
+    static const uint8_t nMaxRejects = 4;
+
+    /// Visits the state a checkpoint keeps (Checkpoint.hpp), the same
+    /// call saves and restores
+    template <typename Archive>
+    void Checkpoint (Archive& archive)
+    {
+        archive (nStep);
+        archive (nSteps);
+        archive (nRejects);
+        archive (nForced);
+        archive (nEvaluations);
+        archive (nLastError);
+        archive (nMaxError);
+    }
+
+private:
+    Number tolerance[nSize];
+    Number nStep;
+    Number nMinStep;
+    Number nMaxStep;
+
+    uint32_t nSteps;
+    uint32_t nRejects;
+    uint32_t nForced;
+    uint32_t nEvaluations;
+    Number nLastError;
+    Number nMaxError;
+};
+
+#endif
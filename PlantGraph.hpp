@@ -0,0 +1,1039 @@
+///
+/// @author   GUSTAVO CAMPOS
+/// @author   GUSTAVO CAMPOS
+/// @date   28/05/2019 19:44
+/// @version  <#version#>
+///
+/// @copyright  (c) GUSTAVO CAMPOS, 2019
+/// @copyright  Licence
+///
+/// @see    ReadMe.txt for references
+///
+//               GNU GENERAL PUBLIC LICENSE
+//                Version 3, 29 June 2007
+//
+// Copyright (C) 2007 Free Software Foundation, Inc. <https://fsf.org/>
+// Everyone is permitted to copy and distribute verbatim copies
+// of this license document, but changing it is not allowed.
+//
+// Preamble
+//
+// The GNU General Public License is a free, copyleft license for
+// software and other kinds of works.
+//
+// The licenses for most software and other practical works are designed
+// to take away your freedom to share and change the works.  By contrast,
+// the GNU General Public License is intended to guarantee your freedom to
+// share and change all versions of a program--to make sure it remains free
+// software for all its users.  We, the Free Software Foundation, use the
+// GNU General Public License for most of our software; it applies also to
+// any other work released this way by its authors.  You can apply it to
+// your programs, too.
+//
+// See LICENSE file for the complete information
+
+#ifndef PLANT_GRAPH_HPP
+#define PLANT_GRAPH_HPP
+
+#include "Arduino.h"
+
+#include "FixedPoint.hpp"
+#include "VesselModel.hpp"
+
+/// Plant graph: pipes, pumps and valves between the vessels
+///
+/// Nodes are the simulation vessels, whose head is known (outlet
+/// elevation plus liquid level), and junctions, the tees and pump
+/// ports where pipes meet, whose head is solved for. Every link is a
+/// pipe with a conductance in L/s per metre of head, scaled by its
+/// valve opening, optionally with a pump adding head from nFrom to
+/// nTo. Flow on a link is conductance times the head difference plus
+/// the pump head; conservation at every junction gives a symmetric
+/// positive (semi) definite system, the weighted graph Laplacian of
+/// the junctions.
+///
+/// The system is solved by a sparse LDL': the analysis (minimum
+/// degree ordering on bit masks, elimination tree and column counts)
+/// only runs when junctions or links are added, it depends on the
+/// topology alone. A valve moving changes one conductance, a rank one
+/// change of the matrix, applied to the factors along the path of the
+/// elimination tree instead of factoring again; a pump changes only
+/// the right hand side. Closed links have no conductance, a junction
+/// group cut off from every vessel has a zero pivot and is held at
+/// head 0, it carries no flow.
+///
+/// Valves and pumps set from the terminal are applied by the next
+/// step, in the simulation thread.
+///
+/// Each step the moved wort carries its heat: vessels lose volume at
+/// their temperature and mix what comes in (VesselAdd), junctions
+/// hold the pipe volume and mix upwind. A vessel below PLANT_DRY
+/// litres can not feed a link, the link is blocked until the flow
+/// would turn into the vessel or it fills again.
+///
+/// Cost with everything closed is one test per step; a solve is two
+/// triangular sweeps over at most PLANT_JUNCTIONS columns.
+
+#ifndef PLANT_JUNCTIONS
+#define PLANT_JUNCTIONS 8
+#endif
+
+#ifndef PLANT_LINKS
+#define PLANT_LINKS 16
+#endif
+
+static_assert (PLANT_JUNCTIONS <= 32 && PLANT_LINKS <= 32, "Junction and link sets are 32 bit masks");
+static_assert (SIMULATION_VESSELS + PLANT_JUNCTIONS < 255, "Node ids are 8 bit");
+
+#define PLANT_NODES (SIMULATION_VESSELS + PLANT_JUNCTIONS)
+#define PLANT_FACTORS (PLANT_JUNCTIONS * (PLANT_JUNCTIONS - 1) / 2)
+#define PLANT_ENTRIES (PLANT_JUNCTIONS + PLANT_LINKS)
+#define PLANT_NONE 0xFF
+
+/// Litres below which a vessel can not feed a link
+#define PLANT_DRY 0.5
+
+/// Conductance below which a link counts as closed, L/s/m
+#define PLANT_MIN_CONDUCTANCE 0.002
+
+/// Flow below which a link is still, L/s; a stalled pump or a
+/// balanced loop leaves rounding residue that would otherwise move
+/// water through full pipes out of nothing
+#define PLANT_MIN_FLOW 0.0002
+
+/// Solve passes a step may spend blocking and unblocking dry links
+#define PLANT_PASSES 3
+
+/// Rank one updates between two full factorizations, bounds the
+/// rounding they accumulate in Q16.16
+#define PLANT_UPDATES 32
+
+template <typename Number>
+struct PlantVessel
+{
+    Number nArea;      // m2
+    Number nElevation; // m, outlet above the lowest point of the plant
+};
+
+template <typename Number>
+struct PlantJunction
+{
+    Number nHoldup;      // litres of pipe, always full
+    Number nLoss;        // kW/K to ambient
+    Number nTemperature; // C
+    Number nHead;        // m, solved
+    Number nExcess;      // litres in above the holdup, pushed out next step
+};
+
+template <typename Number>
+struct PlantLink
+{
+    uint8_t nFrom;
+    uint8_t nTo;
+    uint8_t bBlocked; // dry vessel upstream
+    uint8_t nEntry;   // off diagonal entry of the matrix, PLANT_NONE to a vessel
+    Number nConductance; // L/s/m fully open
+    Number nHead;        // m at full pump speed, 0 is a plain pipe
+    Number nValve;       // 0..1
+    Number nPump;        // 0..1
+    Number nFlow;        // L/s from nFrom to nTo, solved
+    Number nActive;      // conductance in the factors
+};
+
+/// Sparse LDL' of the junction system, symbolic part cached
+template <typename Number>
+class PlantSolver
+{
+public:
+    PlantSolver () : nSize (0), nEntries (0)
+    {
+    }
+
+    /// Ordering, matrix pattern, elimination tree and column counts.
+    /// adjacency[j] is the set of junctions linked to junction j;
+    /// Entry () then maps a junction pair to its slot in the matrix
+    void Analyze (const uint32_t* pAdjacency, uint8_t nJunctions)
+    {
+        uint32_t graph[PLANT_JUNCTIONS];
+        uint32_t nRemaining = nJunctions == 32 ? 0xFFFFFFFF : (1UL << nJunctions) - 1;
+
+        nSize = nJunctions;
+
+        // Minimum degree: eliminate the junction with the fewest
+        // neighbours left, its neighbours become a clique
+        for (uint8_t nCount = 0; nCount < nSize; nCount++) graph[nCount] = pAdjacency[nCount];
+
+        for (uint8_t nPosition = 0; nPosition < nSize; nPosition++)
+        {
+            uint8_t nBest = 0;
+            uint8_t nBestDegree = 0xFF;
+
+            for (uint8_t nCount = 0; nCount < nSize; nCount++)
+            {
+                if ((nRemaining & (1UL << nCount)) == 0) continue;
+
+                uint8_t nDegree = (uint8_t)__builtin_popcount (graph[nCount] & nRemaining);
+
+                if (nDegree < nBestDegree)
+                {
+                    nBest = nCount;
+                    nBestDegree = nDegree;
+                }
+            }
+
+            uint32_t nClique = graph[nBest] & nRemaining & ~(1UL << nBest);
+
+            for (uint8_t nCount = 0; nCount < nSize; nCount++)
+            {
+                if (nClique & (1UL << nCount)) graph[nCount] |= nClique & ~(1UL << nCount);
+            }
+
+            nRemaining &= ~(1UL << nBest);
+            order[nPosition] = nBest;
+            position[nBest] = nPosition;
+        }
+
+        // Upper triangle by columns, diagonal first
+        nEntries = 0;
+
+        for (uint8_t nColumn = 0; nColumn < nSize; nColumn++)
+        {
+            uint8_t nJunction = order[nColumn];
+
+            entryStart[nColumn] = nEntries;
+            entryRow[nEntries++] = nColumn;
+
+            for (uint8_t nCount = 0; nCount < nSize; nCount++)
+            {
+                if ((pAdjacency[nJunction] & (1UL << nCount)) && position[nCount] < nColumn) entryRow[nEntries++] = position[nCount];
+            }
+        }
+
+        entryStart[nSize] = nEntries;
+
+        // Elimination tree and column counts (Davis, LDL)
+        for (uint8_t nColumn = 0; nColumn < nSize; nColumn++)
+        {
+            parent[nColumn] = PLANT_NONE;
+            flag[nColumn] = nColumn;
+            count[nColumn] = 0;
+
+            for (uint8_t nEntry = entryStart[nColumn] + 1; nEntry < entryStart[nColumn + 1]; nEntry++)
+            {
+                for (uint8_t nRow = entryRow[nEntry]; flag[nRow] != nColumn; nRow = parent[nRow])
+                {
+                    if (parent[nRow] == PLANT_NONE) parent[nRow] = nColumn;
+
+                    count[nRow]++;
+                    flag[nRow] = nColumn;
+                }
+            }
+        }
+
+        columnStart[0] = 0;
+
+        for (uint8_t nColumn = 0; nColumn < nSize; nColumn++) columnStart[nColumn + 1] = columnStart[nColumn] + count[nColumn];
+    }
+
+    /// Diagonal slot of junction nJunction
+    uint8_t Diagonal (uint8_t nJunction) const
+    {
+        return entryStart[position[nJunction]];
+    }
+
+    /// Slot of the entry between two linked junctions
+    uint8_t Entry (uint8_t nJunctionA, uint8_t nJunctionB) const
+    {
+        uint8_t nColumn = max (position[nJunctionA], position[nJunctionB]);
+        uint8_t nRow = min (position[nJunctionA], position[nJunctionB]);
+
+        for (uint8_t nEntry = entryStart[nColumn] + 1; nEntry < entryStart[nColumn + 1]; nEntry++)
+        {
+            if (entryRow[nEntry] == nRow) return nEntry;
+        }
+
+        return PLANT_NONE;
+    }
+
+    /// Numeric factorization of the values in pValues (by slot),
+    /// up-looking, one row of L per column
+    void Factor (const Number* pValues)
+    {
+        Number work[PLANT_JUNCTIONS];
+        uint8_t pattern[PLANT_JUNCTIONS];
+
+        nSingular = 0;
+
+        for (uint8_t nColumn = 0; nColumn < nSize; nColumn++) work[nColumn] = Number (0);
+
+        for (uint8_t nColumn = 0; nColumn < nSize; nColumn++)
+        {
+            uint8_t nTop = nSize;
+
+            flag[nColumn] = nColumn;
+            count[nColumn] = 0;
+
+            for (uint8_t nEntry = entryStart[nColumn]; nEntry < entryStart[nColumn + 1]; nEntry++)
+            {
+                uint8_t nRow = entryRow[nEntry];
+                uint8_t nLength = 0;
+
+                work[nRow] += pValues[nEntry];
+
+                for (; flag[nRow] != nColumn; nRow = parent[nRow])
+                {
+                    pattern[nLength++] = nRow;
+                    flag[nRow] = nColumn;
+                }
+
+                while (nLength > 0) pattern[--nTop] = pattern[--nLength];
+            }
+
+            diagonal[nColumn] = work[nColumn];
+            work[nColumn] = Number (0);
+
+            for (; nTop < nSize; nTop++)
+            {
+                uint8_t nRow = pattern[nTop];
+                Number nValue = work[nRow];
+                uint8_t nEnd = columnStart[nRow] + count[nRow];
+
+                work[nRow] = Number (0);
+
+                for (uint8_t nFactor = columnStart[nRow]; nFactor < nEnd; nFactor++)
+                {
+                    work[factorRow[nFactor]] -= factor[nFactor] * nValue;
+                }
+
+                Number nScaled = IsSingular (nRow) ? Number (0) : nValue / diagonal[nRow];
+
+                diagonal[nColumn] -= nScaled * nValue;
+                factorRow[nEnd] = nColumn;
+                factor[nEnd] = nScaled;
+                count[nRow]++;
+            }
+
+            if (diagonal[nColumn] < Number (PLANT_MIN_CONDUCTANCE / PLANT_JUNCTIONS)) nSingular |= 1UL << nColumn;
+        }
+    }
+
+    /// L D L' + nSigma w w', w is +1 at junction nJunctionA and -1 at
+    /// nJunctionB (PLANT_NONE for a link to a vessel). Returns false
+    /// when a pivot gets too small for an update, the factors are then
+    /// partly changed and must be factored again
+    bool Update (uint8_t nJunctionA, uint8_t nJunctionB, Number nSigma)
+    {
+        Number w[PLANT_JUNCTIONS];
+
+        for (uint8_t nCount = 0; nCount < nSize; nCount++) w[nCount] = Number (0);
+
+        uint8_t nStart = PLANT_NONE;
+
+        if (nJunctionA != PLANT_NONE) w[nStart = position[nJunctionA]] = Number (1);
+
+        if (nJunctionB != PLANT_NONE)
+        {
+            w[position[nJunctionB]] = Number (-1);
+            if (nStart == PLANT_NONE || position[nJunctionB] < nStart) nStart = position[nJunctionB];
+        }
+
+        // Gill, Golub, Murray and Saunders, method C1, along the path
+        // of the elimination tree where w is not zero
+        Number nAlpha = Number (1) / nSigma;
+
+        for (uint8_t nColumn = nStart; nColumn != PLANT_NONE; nColumn = parent[nColumn])
+        {
+            if (IsSingular (nColumn)) return false;
+
+            Number nValue = w[nColumn];
+            Number nNext = nAlpha + nValue * nValue / diagonal[nColumn];
+
+            if (nNext == Number (0)) return false;
+
+            Number nBeta = nValue / diagonal[nColumn] / nNext;
+            Number nDiagonal = diagonal[nColumn] * nNext / nAlpha;
+
+            if (nDiagonal < Number (PLANT_MIN_CONDUCTANCE / PLANT_JUNCTIONS)) return false;
+
+            diagonal[nColumn] = nDiagonal;
+            nAlpha = nNext;
+
+            for (uint8_t nFactor = columnStart[nColumn]; nFactor < columnStart[nColumn] + count[nColumn]; nFactor++)
+            {
+                w[factorRow[nFactor]] -= nValue * factor[nFactor];
+                factor[nFactor] += nBeta * w[factorRow[nFactor]];
+            }
+        }
+
+        return true;
+    }
+
+    /// Solves in place, pValues by junction
+    void Solve (Number* pValues) const
+    {
+        Number x[PLANT_JUNCTIONS];
+
+        for (uint8_t nColumn = 0; nColumn < nSize; nColumn++) x[nColumn] = pValues[order[nColumn]];
+
+        for (uint8_t nColumn = 0; nColumn < nSize; nColumn++)
+        {
+            for (uint8_t nFactor = columnStart[nColumn]; nFactor < columnStart[nColumn] + count[nColumn]; nFactor++)
+            {
+                x[factorRow[nFactor]] -= factor[nFactor] * x[nColumn];
+            }
+        }
+
+        for (uint8_t nColumn = 0; nColumn < nSize; nColumn++)
+        {
+            x[nColumn] = IsSingular (nColumn) ? Number (0) : x[nColumn] / diagonal[nColumn];
+        }
+
+        for (uint8_t nColumn = nSize; nColumn-- > 0;)
+        {
+            for (uint8_t nFactor = columnStart[nColumn]; nFactor < columnStart[nColumn] + count[nColumn]; nFactor++)
+            {
+                x[nColumn] -= factor[nFactor] * x[factorRow[nFactor]];
+            }
+        }
+
+        for (uint8_t nColumn = 0; nColumn < nSize; nColumn++) pValues[order[nColumn]] = x[nColumn];
+    }
+
+    uint8_t GetEntries () const
+    {
+        return nEntries;
+    }
+
+    uint8_t GetFactors () const
+    {
+        return columnStart[nSize];
+    }
+
+    uint8_t GetSingular () const
+    {
+        return (uint8_t)__builtin_popcount (nSingular);
+    }
+
+private:
+    bool IsSingular (uint8_t nColumn) const
+    {
+        return (nSingular & (1UL << nColumn)) != 0;
+    }
+
+    uint8_t nSize;
+    uint8_t nEntries;
+    uint32_t nSingular;
+
+    uint8_t order[PLANT_JUNCTIONS];    // column to junction
+    uint8_t position[PLANT_JUNCTIONS]; // junction to column
+
+    uint8_t entryStart[PLANT_JUNCTIONS + 1];
+    uint8_t entryRow[PLANT_ENTRIES];
+
+    uint8_t parent[PLANT_JUNCTIONS];
+    uint8_t flag[PLANT_JUNCTIONS];
+    uint8_t count[PLANT_JUNCTIONS];
+    uint8_t columnStart[PLANT_JUNCTIONS + 1];
+    uint8_t factorRow[PLANT_FACTORS];
+
+    Number factor[PLANT_FACTORS];
+    Number diagonal[PLANT_JUNCTIONS];
+};
+
+template <typename Number>
+class PlantGraph : public VesselTransport<Number>
+{
+public:
+    PlantGraph () : nJunctions (0), nLinks (0), nOpen (0), nPending (0), bAnalyzed (false), bFactored (false), nUpdates (0), nAnalyses (0), nFactorizations (0), nRankUpdates (0), nSolves (0), nBlocks (0), nLastCost (0), nMaxCost (0)
+    {
+        nAmbient = Number (20);
+
+        Reset ();
+    }
+
+    /// Default brewhouse, vessels tiered for gravity: mash tun and
+    /// kettle drain to a pump, whose outlet returns to the mash
+    /// (recirculation), feeds the kettle (lautering) or the fermenter
+    /// (knockout). Links 0 mash outlet, 1 kettle outlet, 2 pump,
+    /// 3 mash return, 4 kettle inlet, 5 fermenter inlet; all closed
+    void Reset ()
+    {
+        static const double defaults[3][2] = {
+            // Area, Elevation
+            {0.1, 1.0},
+            {0.13, 0.5},
+            {0.07, 0.0}};
+
+        for (uint8_t nCount = 0; nCount < SIMULATION_VESSELS; nCount++)
+        {
+            vessels[nCount].nArea = Number (defaults[nCount % 3][0]);
+            vessels[nCount].nElevation = Number (defaults[nCount % 3][1]);
+        }
+
+        Clear ();
+
+        uint8_t nInlet = AddJunction (Number (0.5), Number (0.0005));
+        uint8_t nOutlet = AddJunction (Number (0.5), Number (0.0005));
+
+        AddLink (VESSEL_MASH, nInlet, Number (0.3), Number (0));
+        AddLink (VESSEL_BOIL, nInlet, Number (0.3), Number (0));
+        AddLink (nInlet, nOutlet, Number (0.5), Number (4));
+        AddLink (nOutlet, VESSEL_MASH, Number (0.3), Number (0));
+        AddLink (nOutlet, VESSEL_BOIL, Number (0.3), Number (0));
+        AddLink (nOutlet, VESSEL_FERMENTER, Number (0.2), Number (0));
+
+        // The pump has no valve, it runs or it blocks
+        SetValve (2, Number (1));
+    }
+
+    /// No junctions and no links
+    void Clear ()
+    {
+        nJunctions = 0;
+        nLinks = 0;
+        nOpen = 0;
+        nPending = 0;
+        bAnalyzed = false;
+        bFactored = false;
+    }
+
+    /// Returns the node id, PLANT_NONE when full
+    uint8_t AddJunction (Number nHoldup, Number nLoss)
+    {
+        if (nJunctions >= PLANT_JUNCTIONS || nHoldup <= Number (0)) return PLANT_NONE;
+
+        PlantJunction<Number>& junction = junctions[nJunctions];
+
+        junction.nHoldup = nHoldup;
+        junction.nLoss = nLoss;
+        junction.nTemperature = nAmbient;
+        junction.nHead = Number (0);
+        junction.nExcess = Number (0);
+
+        bAnalyzed = false;
+
+        return SIMULATION_VESSELS + nJunctions++;
+    }
+
+    /// Closed and stopped, returns the link id or PLANT_NONE
+    uint8_t AddLink (uint8_t nFrom, uint8_t nTo, Number nConductance, Number nHead)
+    {
+        if (nLinks >= PLANT_LINKS || nFrom == nTo || IsNode (nFrom) == false || IsNode (nTo) == false || nConductance <= Number (0)) return PLANT_NONE;
+
+        PlantLink<Number>& link = links[nLinks];
+
+        link = PlantLink<Number> ();
+
+        link.nFrom = nFrom;
+        link.nTo = nTo;
+        link.nEntry = PLANT_NONE;
+        link.nConductance = nConductance;
+        link.nHead = nHead;
+
+        bAnalyzed = false;
+
+        return nLinks++;
+    }
+
+    /// Opening 0..1, the next step applies it to the factors as a
+    /// rank one update
+    bool SetValve (uint8_t nLink, Number nOpening)
+    {
+        if (nLink >= nLinks) return false;
+
+        links[nLink].nValve = Clamp (nOpening, Number (0), Number (1));
+        nPending |= 1UL << nLink;
+
+        return true;
+    }
+
+    /// Speed 0..1, only the right hand side changes while it runs;
+    /// a stopped pump does not pass flow
+    bool SetPump (uint8_t nLink, Number nSpeed)
+    {
+        if (nLink >= nLinks || links[nLink].nHead == Number (0)) return false;
+
+        links[nLink].nPump = Clamp (nSpeed, Number (0), Number (1));
+        nPending |= 1UL << nLink;
+
+        return true;
+    }
+
+    bool SetVessel (uint8_t nVessel, Number nArea, Number nElevation)
+    {
+        if (nVessel >= SIMULATION_VESSELS || nArea <= Number (0)) return false;
+
+        vessels[nVessel].nArea = nArea;
+        vessels[nVessel].nElevation = nElevation;
+
+        return true;
+    }
+
+    /// Closes every valve but the pumps' and stops every pump, the
+    /// topology stays
+    void Stop ()
+    {
+        for (uint8_t nLink = 0; nLink < nLinks; nLink++)
+        {
+            PlantLink<Number>& link = links[nLink];
+
+            if (link.nHead == Number (0)) link.nValve = Number (0);
+
+            link.nPump = Number (0);
+            link.nFlow = Number (0);
+            link.bBlocked = false;
+
+            nPending |= 1UL << nLink;
+        }
+
+        for (uint8_t nJunction = 0; nJunction < nJunctions; nJunction++) junctions[nJunction].nExcess = Number (0);
+    }
+
+    /// Any link open, flows need fixed steps
+    bool IsActive () const override
+    {
+        return nOpen > 0 || nPending != 0;
+    }
+
+    /// Moves wort and heat between the vessels for nStep seconds
+    void Transfer (VesselState<Number>* pVessels, Number nStep) override
+    {
+        if (nOpen == 0 && nPending == 0) return;
+
+        uint32_t nStart = micros ();
+
+        for (uint8_t nLink = 0; nPending != 0; nLink++)
+        {
+            if (nPending & (1UL << nLink)) Apply (nLink);
+
+            nPending &= ~(1UL << nLink);
+        }
+
+        if (nOpen == 0)
+        {
+            for (uint8_t nLink = 0; nLink < nLinks; nLink++) links[nLink].nFlow = Number (0);
+            return;
+        }
+
+        for (uint8_t nPass = 0; nPass < PLANT_PASSES; nPass++)
+        {
+            SolveFlows (pVessels, nStep);
+
+            if (CheckDry (pVessels) == false) break;
+        }
+
+        Move (pVessels, nStep);
+
+        nLastCost = micros () - nStart;
+        if (nLastCost > nMaxCost) nMaxCost = nLastCost;
+    }
+
+    /// Head of any node, m
+    Number GetHead (const VesselState<Number>* pVessels, uint8_t nNode) const
+    {
+        if (nNode >= SIMULATION_VESSELS) return junctions[nNode - SIMULATION_VESSELS].nHead;
+
+        return vessels[nNode].nElevation + pVessels[nNode].nVolume / (vessels[nNode].nArea * Number (1000));
+    }
+
+    uint8_t GetJunctions () const
+    {
+        return nJunctions;
+    }
+
+    uint8_t GetLinks () const
+    {
+        return nLinks;
+    }
+
+    const PlantJunction<Number>& Junction (uint8_t nJunction) const
+    {
+        return junctions[nJunction % PLANT_JUNCTIONS];
+    }
+
+    const PlantLink<Number>& Link (uint8_t nLink) const
+    {
+        return links[nLink % PLANT_LINKS];
+    }
+
+    const PlantVessel<Number>& Vessel (uint8_t nVessel) const
+    {
+        return vessels[nVessel % SIMULATION_VESSELS];
+    }
+
+    const PlantSolver<Number>& Solver () const
+    {
+        return solver;
+    }
+
+    uint32_t GetAnalyses () const
+    {
+        return nAnalyses;
+    }
+
+    uint32_t GetFactorizations () const
+    {
+        return nFactorizations;
+    }
+
+    uint32_t GetRankUpdates () const
+    {
+        return nRankUpdates;
+    }
+
+    uint32_t GetSolves () const
+    {
+        return nSolves;
+    }
+
+    uint32_t GetBlocks () const
+    {
+        return nBlocks;
+    }
+
+    uint32_t GetLastCost () const
+    {
+        return nLastCost;
+    }
+
+    uint32_t GetMaxCost () const
+    {
+        return nMaxCost;
+    }
+
+    /// Visits the state a checkpoint keeps (Checkpoint.hpp), the same
+    /// call saves and restores; heads, flows, dry blocks and the
+    /// factors are derived and rebuilt by the next step
+    template <typename Archive>
+    void Checkpoint (Archive& archive)
+    {
+        archive (vessels);
+        archive (nJunctions);
+        archive (nLinks);
+        archive (nAmbient);
+
+        for (uint8_t nJunction = 0; nJunction < PLANT_JUNCTIONS; nJunction++)
+        {
+            PlantJunction<Number>& junction = junctions[nJunction];
+
+            archive (junction.nHoldup);
+            archive (junction.nLoss);
+            archive (junction.nTemperature);
+            archive (junction.nExcess);
+        }
+
+        for (uint8_t nLink = 0; nLink < PLANT_LINKS; nLink++)
+        {
+            PlantLink<Number>& link = links[nLink];
+
+            archive (link.nFrom);
+            archive (link.nTo);
+            archive (link.nConductance);
+            archive (link.nHead);
+            archive (link.nValve);
+            archive (link.nPump);
+        }
+
+        if (archive.IsReading ())
+        {
+            if (nJunctions > PLANT_JUNCTIONS || nLinks > PLANT_LINKS) Clear ();
+
+            bAnalyzed = false;
+            nOpen = 0;
+            nPending = 0;
+
+            for (uint8_t nLink = 0; nLink < nLinks; nLink++)
+            {
+                links[nLink].bBlocked = false;
+                links[nLink].nFlow = Number (0);
+                links[nLink].nActive = Number (0);
+
+                nPending |= 1UL << nLink;
+            }
+        }
+    }
+
+private:
+    bool IsNode (uint8_t nNode) const
+    {
+        return nNode < SIMULATION_VESSELS + nJunctions;
+    }
+
+    /// Junction index of a node, PLANT_NONE for a vessel
+    static uint8_t JunctionOf (uint8_t nNode)
+    {
+        return nNode >= SIMULATION_VESSELS ? nNode - SIMULATION_VESSELS : PLANT_NONE;
+    }
+
+    Number Conductance (const PlantLink<Number>& link) const
+    {
+        if (link.bBlocked || (link.nHead != Number (0) && link.nPump == Number (0))) return Number (0);
+
+        Number nConductance = link.nConductance * link.nValve;
+
+        return nConductance < Number (PLANT_MIN_CONDUCTANCE) ? Number (0) : nConductance;
+    }
+
+    /// Brings the factors in line with a link whose conductance may
+    /// have changed: rank one update when they are current
+    void Apply (uint8_t nLink)
+    {
+        PlantLink<Number>& link = links[nLink];
+        Number nConductance = Conductance (link);
+        Number nChange = nConductance - link.nActive;
+
+        if (nChange == Number (0)) return;
+
+        if (link.nActive == Number (0)) nOpen++;
+        if (nConductance == Number (0)) nOpen--;
+
+        link.nActive = nConductance;
+
+        uint8_t nA = JunctionOf (link.nFrom);
+        uint8_t nB = JunctionOf (link.nTo);
+
+        // Vessel to vessel: no junction row changes
+        if (nA == PLANT_NONE && nB == PLANT_NONE) return;
+
+        if (bAnalyzed == false || bFactored == false) return;
+
+        if (nUpdates >= PLANT_UPDATES || solver.Update (nA, nB, nChange) == false)
+        {
+            bFactored = false;
+            return;
+        }
+
+        nUpdates++;
+        nRankUpdates++;
+    }
+
+    void Analyze ()
+    {
+        uint32_t adjacency[PLANT_JUNCTIONS];
+
+        memset (adjacency, 0, sizeof (adjacency));
+
+        for (uint8_t nLink = 0; nLink < nLinks; nLink++)
+        {
+            uint8_t nA = JunctionOf (links[nLink].nFrom);
+            uint8_t nB = JunctionOf (links[nLink].nTo);
+
+            if (nA == PLANT_NONE || nB == PLANT_NONE) continue;
+
+            adjacency[nA] |= 1UL << nB;
+            adjacency[nB] |= 1UL << nA;
+        }
+
+        solver.Analyze (adjacency, nJunctions);
+
+        for (uint8_t nLink = 0; nLink < nLinks; nLink++)
+        {
+            uint8_t nA = JunctionOf (links[nLink].nFrom);
+            uint8_t nB = JunctionOf (links[nLink].nTo);
+
+            links[nLink].nEntry = nA != PLANT_NONE && nB != PLANT_NONE ? solver.Entry (nA, nB) : PLANT_NONE;
+        }
+
+        bAnalyzed = true;
+        bFactored = false;
+        nAnalyses++;
+    }
+
+    void Factor ()
+    {
+        Number values[PLANT_ENTRIES];
+
+        for (uint8_t nEntry = 0; nEntry < solver.GetEntries (); nEntry++) values[nEntry] = Number (0);
+
+        for (uint8_t nLink = 0; nLink < nLinks; nLink++)
+        {
+            const PlantLink<Number>& link = links[nLink];
+            uint8_t nA = JunctionOf (link.nFrom);
+            uint8_t nB = JunctionOf (link.nTo);
+
+            if (nA != PLANT_NONE) values[solver.Diagonal (nA)] += link.nActive;
+            if (nB != PLANT_NONE) values[solver.Diagonal (nB)] += link.nActive;
+            if (link.nEntry != PLANT_NONE) values[link.nEntry] -= link.nActive;
+        }
+
+        solver.Factor (values);
+
+        bFactored = true;
+        nUpdates = 0;
+        nFactorizations++;
+    }
+
+    /// Junction heads, then the flow of every link; what rounding left
+    /// in a junction leaves it over the step, so the pipes stay full
+    /// and the plant holds its volume exactly
+    void SolveFlows (const VesselState<Number>* pVessels, Number nStep)
+    {
+        Number heads[PLANT_JUNCTIONS];
+
+        if (bAnalyzed == false) Analyze ();
+        if (bFactored == false) Factor ();
+
+        for (uint8_t nJunction = 0; nJunction < nJunctions; nJunction++) heads[nJunction] = junctions[nJunction].nExcess / nStep;
+
+        // Known heads and pump heads move to the right hand side
+        for (uint8_t nLink = 0; nLink < nLinks; nLink++)
+        {
+            const PlantLink<Number>& link = links[nLink];
+            uint8_t nA = JunctionOf (link.nFrom);
+            uint8_t nB = JunctionOf (link.nTo);
+            Number nPush = link.nActive * link.nHead * link.nPump;
+
+            if (link.nActive == Number (0)) continue;
+
+            if (nA != PLANT_NONE) heads[nA] -= nPush;
+            if (nB != PLANT_NONE) heads[nB] += nPush;
+
+            if (nA != PLANT_NONE && nB == PLANT_NONE) heads[nA] += link.nActive * GetHead (pVessels, link.nTo);
+            if (nB != PLANT_NONE && nA == PLANT_NONE) heads[nB] += link.nActive * GetHead (pVessels, link.nFrom);
+        }
+
+        solver.Solve (heads);
+        nSolves++;
+
+        for (uint8_t nJunction = 0; nJunction < nJunctions; nJunction++) junctions[nJunction].nHead = heads[nJunction];
+
+        for (uint8_t nLink = 0; nLink < nLinks; nLink++)
+        {
+            PlantLink<Number>& link = links[nLink];
+
+            link.nFlow = link.nActive * Drive (pVessels, link);
+
+            if (Abs (link.nFlow) < Number (PLANT_MIN_FLOW)) link.nFlow = Number (0);
+        }
+    }
+
+    /// Head difference plus pump head along a link
+    Number Drive (const VesselState<Number>* pVessels, const PlantLink<Number>& link) const
+    {
+        return GetHead (pVessels, link.nFrom) - GetHead (pVessels, link.nTo) + link.nHead * link.nPump;
+    }
+
+    /// Blocks links a dry vessel would feed, unblocks those that would
+    /// flow into it again; true when any changed
+    bool CheckDry (const VesselState<Number>* pVessels)
+    {
+        bool bChanged = false;
+
+        for (uint8_t nLink = 0; nLink < nLinks; nLink++)
+        {
+            PlantLink<Number>& link = links[nLink];
+            Number nDrive = link.bBlocked ? Drive (pVessels, link) : link.nFlow;
+            uint8_t nSource = nDrive > Number (0) ? link.nFrom : link.nTo;
+            bool bDry = nDrive != Number (0) && nSource < SIMULATION_VESSELS && pVessels[nSource].nVolume < Number (PLANT_DRY);
+
+            if (link.bBlocked == bDry) continue;
+            if (bDry && link.nActive == Number (0)) continue;
+
+            link.bBlocked = bDry;
+            if (bDry) nBlocks++;
+
+            Apply (nLink);
+            bChanged = true;
+        }
+
+        return bChanged;
+    }
+
+    /// Upwind transport of volume and heat over nStep seconds
+    void Move (VesselState<Number>* pVessels, Number nStep)
+    {
+        Number inflow[PLANT_NODES];
+        Number heat[PLANT_NODES];
+        Number outflow[PLANT_NODES];
+        Number temperatures[PLANT_NODES];
+
+        for (uint8_t nNode = 0; nNode < SIMULATION_VESSELS + nJunctions; nNode++)
+        {
+            inflow[nNode] = Number (0);
+            heat[nNode] = Number (0);
+            outflow[nNode] = Number (0);
+            temperatures[nNode] = nNode < SIMULATION_VESSELS ? pVessels[nNode].nTemperature : junctions[nNode - SIMULATION_VESSELS].nTemperature;
+        }
+
+        for (uint8_t nLink = 0; nLink < nLinks; nLink++)
+        {
+            const PlantLink<Number>& link = links[nLink];
+            uint8_t nSource = link.nFlow > Number (0) ? link.nFrom : link.nTo;
+
+            outflow[nSource] += Abs (link.nFlow) * nStep;
+        }
+
+        for (uint8_t nLink = 0; nLink < nLinks; nLink++)
+        {
+            const PlantLink<Number>& link = links[nLink];
+
+            if (link.nFlow == Number (0)) continue;
+
+            uint8_t nSource = link.nFlow > Number (0) ? link.nFrom : link.nTo;
+            uint8_t nTarget = link.nFlow > Number (0) ? link.nTo : link.nFrom;
+            Number nLitres = Abs (link.nFlow) * nStep;
+
+            // A vessel can not give more than it holds
+            if (nSource < SIMULATION_VESSELS && outflow[nSource] > pVessels[nSource].nVolume)
+            {
+                nLitres = nLitres * pVessels[nSource].nVolume / outflow[nSource];
+            }
+
+            inflow[nTarget] += nLitres;
+            heat[nTarget] += nLitres * temperatures[nSource];
+        }
+
+        for (uint8_t nVessel = 0; nVessel < SIMULATION_VESSELS; nVessel++)
+        {
+            VesselState<Number>& vessel = pVessels[nVessel];
+            Number nOut = outflow[nVessel] > vessel.nVolume ? vessel.nVolume : outflow[nVessel];
+
+            vessel.nVolume -= nOut;
+            vessel.nCapacity -= nOut * Number (Physics::nWaterHeat);
+
+            if (inflow[nVessel] > Number (0)) VesselAdd (vessel, INGREDIENT_WATER, inflow[nVessel], heat[nVessel] / inflow[nVessel]);
+        }
+
+        for (uint8_t nJunction = 0; nJunction < nJunctions; nJunction++)
+        {
+            PlantJunction<Number>& junction = junctions[nJunction];
+            Number nIn = inflow[SIMULATION_VESSELS + nJunction];
+            Number nHeat = heat[SIMULATION_VESSELS + nJunction];
+
+            junction.nExcess += nIn - outflow[SIMULATION_VESSELS + nJunction];
+
+            // Pipe volume replaced within the step: fully mixed inflow
+            if (nIn >= junction.nHoldup)
+                junction.nTemperature = nHeat / nIn;
+            else
+                junction.nTemperature += (nHeat - nIn * junction.nTemperature) / junction.nHoldup;
+
+            junction.nTemperature -= junction.nLoss * (junction.nTemperature - nAmbient) * nStep / (junction.nHoldup * Number (Physics::nWaterHeat));
+        }
+    }
+
+    PlantVessel<Number> vessels[SIMULATION_VESSELS];
+    PlantJunction<Number> junctions[PLANT_JUNCTIONS];
+    PlantLink<Number> links[PLANT_LINKS];
+
+    uint8_t nJunctions;
+    uint8_t nLinks;
+    uint8_t nOpen;
+    uint32_t nPending; // links whose valve or pump changed
+    Number nAmbient;
+
+    PlantSolver<Number> solver;
+    bool bAnalyzed;
+    bool bFactored;
+    uint8_t nUpdates;
+
+    uint32_t nAnalyses;
+    uint32_t nFactorizations;
+    uint32_t nRankUpdates;
+    uint32_t nSolves;
+    uint32_t nBlocks;
+    uint32_t nLastCost;
+    uint32_t nMaxCost;
+};
+
+#endif
@@ -0,0 +1,306 @@
+///
+/// @author   GUSTAVO CAMPOS
+/// @author   GUSTAVO CAMPOS
+/// @date   28/05/2019 19:44
+/// @version  <#version#>
+///
+/// @copyright  (c) GUSTAVO CAMPOS, 2019
+/// @copyright  Licence
+///
+/// @see    ReadMe.txt for references
+///
+//               GNU GENERAL PUBLIC LICENSE
+//                Version 3, 29 June 2007
+//
+// Copyright (C) 2007 Free Software Foundation, Inc. <https://fsf.org/>
+// Everyone is permitted to copy and distribute verbatim copies
+// of this license document, but changing it is not allowed.
+//
+// Preamble
+//
+// The GNU General Public License is a free, copyleft license for
+// software and other kinds of works.
+//
+// The licenses for most software and other practical works are designed
+// to take away your freedom to share and change the works.  By contrast,
+// the GNU General Public License is intended to guarantee your freedom to
+// share and change all versions of a program--to make sure it remains free
+// software for all its users.  We, the Free Software Foundation, use the
+// GNU General Public License for most of our software; it applies also to
+// any other work released this way by its authors.  You can apply it to
+// your programs, too.
+//
+// See LICENSE file for the complete information
+
+#ifndef POST_MORTEM_HPP
+#define POST_MORTEM_HPP
+
+#include "Arduino.h"
+#include "CorePartition.h"
+
+#include <stddef.h>
+
+#include "Util.hpp"
+#include "HeapMonitor.hpp"
+#include "BinaryLog.hpp"
+
+/// Crash post-mortem
+///
+/// At crash time the thread table, the tail of the log ring and a
+/// few metrics are packed in a CRC protected snapshot and written
+/// to RTC user memory, which survives any reset but power loss.
+/// At boot Load() brings it back and "postmortem show" prints it.
+///
+/// The first 128 bytes of RTC user memory belong to OTA, the
+/// snapshot starts right after them. The crashing thread is always
+/// recorded first, the others follow in ID order.
+
+#define POSTMORTEM_MAGIC 0x504D5254
+#define POSTMORTEM_VERSION 2
+#define POSTMORTEM_RTC_BLOCK 32
+#define POSTMORTEM_RTC_SIZE 384
+
+/// At least the thread count given to CorePartition_Start
+#ifndef POSTMORTEM_THREADS
+#define POSTMORTEM_THREADS 15
+#endif
+
+#ifndef POSTMORTEM_LOGS
+#define POSTMORTEM_LOGS 4
+#endif
+
+enum PostMortemCause : uint32_t
+{
+    POSTMORTEM_STACK_OVERFLOW = 1,
+    POSTMORTEM_EXCEPTION,
+    POSTMORTEM_REQUESTED
+};
+
+/// 16 bytes, every thread has to fit in RTC user memory; the name
+/// is truncated, nice and the duty cycle saturate
+struct PostMortemThread
+{
+    char szName[6];
+    uint8_t nID;
+    uint8_t nStatus;
+    uint8_t nSecure;
+    uint8_t nNice;
+    uint16_t nStackSize;
+    uint16_t nMaxStackSize;
+    uint16_t nDutyCycle; // ms
+};
+
+struct PostMortemSnapshot
+{
+    uint32_t nMagic;
+    uint16_t nVersion;
+    uint16_t nSize;
+    uint32_t nCrc;
+
+    uint32_t nCause;
+    uint32_t nTick;
+    uint32_t nThreadID;
+    uint32_t nFreeHeap;
+    uint32_t nMaxBlock;
+    uint32_t nLowWater;
+    uint32_t nFragmentation;
+    uint32_t nReason;
+    uint32_t nExcCause;
+    uint32_t nEpc1;
+    uint32_t nExcVaddr;
+
+    uint32_t nThreads;
+    PostMortemThread threads[POSTMORTEM_THREADS];
+
+    uint32_t nLogs;
+    LogRecord logs[POSTMORTEM_LOGS];
+};
+
+static_assert (sizeof (PostMortemSnapshot) <= POSTMORTEM_RTC_SIZE, "Post-mortem snapshot does not fit in RTC user memory");
+static_assert (sizeof (PostMortemSnapshot) % 4 == 0, "RTC user memory is written in 32 bit blocks");
+
+class PostMortem
+{
+public:
+    PostMortem () : bValid (false)
+    {
+    }
+
+    /// Takes the snapshot and stores it, must not allocate nor yield
+    void Capture (PostMortemCause nCause, uint32_t nThreadID, const rst_info* pResetInfo = NULL)
+    {
+        PostMortemSnapshot& data = snapshot;
+
+        memset (&data, 0, sizeof (data));
+
+        data.nMagic = POSTMORTEM_MAGIC;
+        data.nVersion = POSTMORTEM_VERSION;
+        data.nSize = sizeof (data);
+
+        data.nCause = nCause;
+        data.nTick = millis ();
+        data.nThreadID = nThreadID;
+        data.nFreeHeap = heapMonitor.GetFree ();
+        data.nMaxBlock = heapMonitor.GetMaxBlock ();
+        data.nLowWater = heapMonitor.GetLowWater ();
+        data.nFragmentation = heapMonitor.GetFragmentation ();
+
+        if (pResetInfo != NULL)
+        {
+            data.nReason = pResetInfo->reason;
+            data.nExcCause = pResetInfo->exccause;
+            data.nEpc1 = pResetInfo->epc1;
+            data.nExcVaddr = pResetInfo->excvaddr;
+        }
+
+        // The crashing thread first, it must not fall past the limit
+        if (nThreadID < CorePartition_GetMaxNumberOfThreads ()) CaptureThread (data, nThreadID);
+
+        for (size_t nCount = 0; nCount < CorePartition_GetMaxNumberOfThreads () && data.nThreads < POSTMORTEM_THREADS; nCount++)
+        {
+            if (nCount != nThreadID && CorePartition_GetStatusByID (nCount) > 0) CaptureThread (data, nCount);
+        }
+
+        uint32_t nWritten = binaryLog.GetWritten ();
+
+        for (uint32_t nSequence = nWritten > POSTMORTEM_LOGS ? nWritten - POSTMORTEM_LOGS : 0; nSequence < nWritten; nSequence++)
+        {
+            const LogRecord* pRecord = binaryLog.Get (nSequence);
+
+            if (pRecord != NULL) data.logs[data.nLogs++] = *pRecord;
+        }
+
+        data.nCrc = Crc32 (&data.nCause, sizeof (data) - offsetof (PostMortemSnapshot, nCause));
+
+        ESP.rtcUserMemoryWrite (POSTMORTEM_RTC_BLOCK, (uint32_t*)&data, sizeof (data));
+
+        bValid = true;
+    }
+
+    /// Loads the snapshot left by the previous run, if any
+    bool Load ()
+    {
+        bValid = false;
+
+        if (ESP.rtcUserMemoryRead (POSTMORTEM_RTC_BLOCK, (uint32_t*)&snapshot, sizeof (snapshot)) == false) return false;
+
+        if (snapshot.nMagic != POSTMORTEM_MAGIC || snapshot.nVersion != POSTMORTEM_VERSION || snapshot.nSize != sizeof (snapshot)) return false;
+
+        if (snapshot.nCrc != Crc32 (&snapshot.nCause, sizeof (snapshot) - offsetof (PostMortemSnapshot, nCause))) return false;
+
+        if (snapshot.nThreads > POSTMORTEM_THREADS || snapshot.nLogs > POSTMORTEM_LOGS) return false;
+
+        bValid = true;
+
+        return true;
+    }
+
+    void Clear ()
+    {
+        uint32_t nMagic = 0;
+
+        ESP.rtcUserMemoryWrite (POSTMORTEM_RTC_BLOCK, &nMagic, sizeof (nMagic));
+
+        bValid = false;
+    }
+
+    bool IsValid () const
+    {
+        return bValid;
+    }
+
+    uint32_t GetCause () const
+    {
+        return snapshot.nCause;
+    }
+
+    uint32_t GetThreadID () const
+    {
+        return snapshot.nThreadID;
+    }
+
+    void Show (Stream& client)
+    {
+        static const char* const causes[] = {"unknown", "stack overflow", "exception", "requested"};
+
+        if (bValid == false)
+        {
+            client.println (F ("No post-mortem snapshot available."));
+            return;
+        }
+
+        client.println (F ("Post-mortem ---------------------"));
+        client.printf ("%-20s: [%s]\r\n", "Cause", causes[snapshot.nCause < 4 ? snapshot.nCause : 0]);
+        client.printf ("%-20s: [%u ms]\r\n", "Uptime", snapshot.nTick);
+        client.printf ("%-20s: [#%u]\r\n", "Thread", snapshot.nThreadID);
+        client.printf ("%-20s: [%u Bytes]\r\n", "Free heap", snapshot.nFreeHeap);
+        client.printf ("%-20s: [%u Bytes]\r\n", "Largest block", snapshot.nMaxBlock);
+        client.printf ("%-20s: [%u Bytes]\r\n", "Low water", snapshot.nLowWater);
+        client.printf ("%-20s: [%u%%]\r\n", "Fragmentation", snapshot.nFragmentation);
+
+        if (snapshot.nCause == POSTMORTEM_EXCEPTION)
+        {
+            client.printf ("%-20s: [%u]\r\n", "Reset reason", snapshot.nReason);
+            client.printf ("%-20s: [%u]\r\n", "Exception", snapshot.nExcCause);
+            client.printf ("%-20s: [0x%08X]\r\n", "EPC1", snapshot.nEpc1);
+            client.printf ("%-20s: [0x%08X]\r\n", "Address", snapshot.nExcVaddr);
+        }
+
+        client.println (F ("-[Threads]----------------------"));
+        client.println (F ("ID\tName\tStatus\tNice\tStkUsed\tStkMax\tExecTime"));
+
+        for (uint32_t nCount = 0; nCount < snapshot.nThreads; nCount++)
+        {
+            const PostMortemThread& thread = snapshot.threads[nCount];
+
+            client.printf ("%u\t%-6.6s\t%u%u\t%u\t%u\t%u\t%ums\r\n",
+                           thread.nID,
+                           thread.szName,
+                           thread.nStatus,
+                           thread.nSecure,
+                           thread.nNice,
+                           thread.nStackSize,
+                           thread.nMaxStackSize,
+                           thread.nDutyCycle);
+        }
+
+        client.println (F ("-[Log]--------------------------"));
+
+        for (uint32_t nCount = 0; nCount < snapshot.nLogs; nCount++)
+        {
+            binaryLog.Format (client, snapshot.logs[nCount]);
+        }
+    }
+
+private:
+    static void CaptureThread (PostMortemSnapshot& data, size_t nID)
+    {
+        PostMortemThread& thread = data.threads[data.nThreads++];
+        const char* pszName = CorePartition_GetThreadNameByID (nID);
+
+        if (pszName != NULL) strncpy (thread.szName, pszName, sizeof (thread.szName));
+
+        thread.nID = nID;
+        thread.nStatus = CorePartition_GetStatusByID (nID);
+        thread.nSecure = CorePartition_IsSecureByID (nID);
+        thread.nNice = min (CorePartition_GetNiceByID (nID), (uint32_t)0xFF);
+        thread.nStackSize = CorePartition_GetStackSizeByID (nID);
+        thread.nMaxStackSize = CorePartition_GetMaxStackSizeByID (nID);
+        thread.nDutyCycle = min (CorePartition_GetLastDutyCycleByID (nID), (uint32_t)0xFFFF);
+    }
+
+    PostMortemSnapshot snapshot;
+    bool bValid;
+};
+
+PostMortem postMortem;
+
+#ifdef ARDUINO_ARCH_ESP8266
+/// Called by the ESP8266 core on exceptions and watchdog resets
+extern "C" void custom_crash_callback (struct rst_info* pResetInfo, uint32_t nStack, uint32_t nStackEnd)
+{
+    postMortem.Capture (POSTMORTEM_EXCEPTION, CorePartition_GetID (), pResetInfo);
+}
+#endif
+
+#endif
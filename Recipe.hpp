@@ -0,0 +1,182 @@
+///
+/// @author   GUSTAVO CAMPOS
+/// @author   GUSTAVO CAMPOS
+/// @date   28/05/2019 19:44
+/// @version  <#version#>
+///
+/// @copyright  (c) GUSTAVO CAMPOS, 2019
+/// @copyright  Licence
+///
+/// @see    ReadMe.txt for references
+///
+//               GNU GENERAL PUBLIC LICENSE
+//                Version 3, 29 June 2007
+//
+// Copyright (C) 2007 Free Software Foundation, Inc. <https://fsf.org/>
+// Everyone is permitted to copy and distribute verbatim copies
+// of this license document, but changing it is not allowed.
+//
+// Preamble
+//
+// The GNU General Public License is a free, copyleft license for
+// software and other kinds of works.
+//
+// The licenses for most software and other practical works are designed
+// to take away your freedom to share and change the works.  By contrast,
+// the GNU General Public License is intended to guarantee your freedom to
+// share and change all versions of a program--to make sure it remains free
+// software for all its users.  We, the Free Software Foundation, use the
+// GNU General Public License for most of our software; it applies also to
+// any other work released this way by its authors.  You can apply it to
+// your programs, too.
+//
+// See LICENSE file for the complete information
+
+#ifndef RECIPE_HPP
+#define RECIPE_HPP
+
+#include "Arduino.h"
+
+#include "BrewMath.hpp"
+#include "RecipeFormat.hpp"
+#include "Simulation.hpp"
+
+// Built in recipes, generated by host/RecipeCompiler (make -C host recipes)
+#include "RecipePaleAle.h"
+
+/// Device side of the recipes: the built in blobs in PROGMEM and the
+/// selected one. Selecting is RecipeView::Open, nothing is copied to
+/// RAM, so names print through __FlashStringHelper.
+
+struct BuiltinRecipe
+{
+    const uint8_t* pData;
+    size_t nSize;
+};
+
+const BuiltinRecipe builtinRecipes[] = {
+    {recipePaleAle, sizeof (recipePaleAle)}};
+
+#define RECIPE_BUILTINS (sizeof (builtinRecipes) / sizeof (builtinRecipes[0]))
+
+RecipeView currentRecipe = RecipeView::Open (recipePaleAle, sizeof (recipePaleAle));
+
+bool Recipe_Select (uint8_t nRecipe)
+{
+    if (nRecipe >= RECIPE_BUILTINS) return false;
+
+    RecipeView view = RecipeView::Open (builtinRecipes[nRecipe].pData, builtinRecipes[nRecipe].nSize);
+
+    if (view.IsValid () == false) return false;
+
+    currentRecipe = view;
+
+    return true;
+}
+
+/// Tinseth IBU of the selected recipe brewed to nLitres of wort, the
+/// batch volume below 1 L (an empty kettle)
+Fixed Recipe_Ibu (Fixed nLitres)
+{
+    const RecipeView& view = currentRecipe;
+    Fixed nIbu;
+
+    if (view.IsValid () == false) return nIbu;
+
+    if (nLitres < Fixed (1)) nLitres = view.GetBatchVolume ();
+
+    for (uint32_t nCount = 0; nCount < view.GetHops (); nCount++)
+    {
+        const RecipeHop& hop = view.Hop (nCount);
+
+        nIbu += BrewMath_Ibu (Fixed::FromRaw (hop.nAlpha), Fixed::FromRaw (hop.nGrams), Fixed ((int)hop.nMinutes), nLitres, view.GetGravity ());
+    }
+
+    return nIbu;
+}
+
+/// Morey SRM of the selected recipe in nLitres, as Recipe_Ibu
+Fixed Recipe_Srm (Fixed nLitres)
+{
+    const RecipeView& view = currentRecipe;
+
+    if (view.IsValid () == false) return Fixed ();
+
+    if (nLitres < Fixed (1)) nLitres = view.GetBatchVolume ();
+
+    return BrewMath_Srm (view.GetGrain (), view.GetColor (), nLitres);
+}
+
+void Recipe_List (Stream& client)
+{
+    for (uint8_t nCount = 0; nCount < RECIPE_BUILTINS; nCount++)
+    {
+        RecipeView view = RecipeView::Open (builtinRecipes[nCount].pData, builtinRecipes[nCount].nSize);
+
+        client.printf ("%u\t", nCount);
+
+        if (view.IsValid ())
+            client.println ((const __FlashStringHelper*)view.GetName ());
+        else
+            client.println (F ("invalid"));
+    }
+}
+
+void Recipe_Show (Stream& client)
+{
+    const RecipeView& view = currentRecipe;
+
+    if (view.IsValid () == false)
+    {
+        client.println (F ("No recipe selected"));
+        return;
+    }
+
+    client.print (F ("Recipe: "));
+    client.println ((const __FlashStringHelper*)view.GetName ());
+
+    client.print (F ("Batch L: "));
+    PrintCenti (client, view.GetBatchVolume ());
+    client.print (F (", grain kg: "));
+    PrintCenti (client, view.GetGrain ());
+    client.printf (", boil: %u min\r\n", view.GetBoilMinutes ());
+
+    client.print (F ("OG points: "));
+    PrintCenti (client, view.GetGravity ());
+    client.print (F (", Plato: "));
+    PrintCenti (client, BrewMath_Plato (view.GetGravity ()));
+    client.print (F (", IBU: "));
+    PrintCenti (client, Recipe_Ibu (view.GetBatchVolume ()));
+    client.print (F (", SRM: "));
+    PrintCenti (client, Recipe_Srm (view.GetBatchVolume ()));
+    client.println ();
+
+    for (uint32_t nCount = 0; nCount < view.GetMashSteps (); nCount++)
+    {
+        client.printf ("Mash %u\t", nCount);
+        PrintCenti (client, Fixed::FromRaw (view.MashStep (nCount).nTemperature));
+        client.printf (" C\t%u min\r\n", view.MashStep (nCount).nMinutes);
+    }
+
+    for (uint32_t nCount = 0; nCount < view.GetHops (); nCount++)
+    {
+        const RecipeHop& hop = view.Hop (nCount);
+
+        client.printf ("Hop %u\t", nCount);
+        client.print ((const __FlashStringHelper*)view.Text (hop.nName));
+        client.print (F ("\t"));
+        PrintCenti (client, Fixed::FromRaw (hop.nGrams));
+        client.printf (" g\tat %u min\t", hop.nMinutes);
+        PrintCenti (client, Fixed::FromRaw (hop.nAlpha));
+        client.println (F (" %"));
+    }
+
+    for (uint32_t nCount = 0; nCount < view.GetFermentSteps (); nCount++)
+    {
+        client.printf ("Ferment %u\t", nCount);
+        PrintCenti (client, Fixed::FromRaw (view.FermentStep (nCount).nTemperature));
+        client.printf (" C\t%u h\r\n", view.FermentStep (nCount).nHours);
+    }
+}
+
+#endif
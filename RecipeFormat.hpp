@@ -0,0 +1,272 @@
+///
+/// @author   GUSTAVO CAMPOS
+/// @author   GUSTAVO CAMPOS
+/// @date   28/05/2019 19:44
+/// @version  <#version#>
+///
+/// @copyright  (c) GUSTAVO CAMPOS, 2019
+/// @copyright  Licence
+///
+/// @see    ReadMe.txt for references
+///
+//               GNU GENERAL PUBLIC LICENSE
+//                Version 3, 29 June 2007
+//
+// Copyright (C) 2007 Free Software Foundation, Inc. <https://fsf.org/>
+// Everyone is permitted to copy and distribute verbatim copies
+// of this license document, but changing it is not allowed.
+//
+// Preamble
+//
+// The GNU General Public License is a free, copyleft license for
+// software and other kinds of works.
+//
+// The licenses for most software and other practical works are designed
+// to take away your freedom to share and change the works.  By contrast,
+// the GNU General Public License is intended to guarantee your freedom to
+// share and change all versions of a program--to make sure it remains free
+// software for all its users.  We, the Free Software Foundation, use the
+// GNU General Public License for most of our software; it applies also to
+// any other work released this way by its authors.  You can apply it to
+// your programs, too.
+//
+// See LICENSE file for the complete information
+
+#ifndef RECIPE_FORMAT_HPP
+#define RECIPE_FORMAT_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "FixedPoint.hpp"
+#include "Encoding.hpp"
+
+/// Binary recipe format
+///
+/// A recipe is one flat blob: header, then tables of fixed size
+/// records, then a string pool. Tables and strings are referenced by
+/// byte offsets from the start of the blob, so the blob is used where
+/// it lies (PROGMEM, a flash mapped partition or a RAM buffer) with no
+/// parse or copy. Every field is 32 bit and every table 4 byte aligned,
+/// the ESP8266 can only read flash mapped memory 32 bits at a time.
+/// Strings are the exception: read them with the _P functions or
+/// print them through __FlashStringHelper. The blob is little endian,
+/// like the ESP8266 and x86 hosts.
+///
+/// Values that are not counts are Q16.16 raw (Fixed::FromRaw).
+///
+/// Version 2 adds the hop alpha acids, the original gravity and the
+/// grist colour, what BrewMath.hpp needs for bitterness and colour.
+///
+/// Versioning: nVersion is bumped on incompatible changes and rejected
+/// by older readers; fields appended to the header grow nHeaderSize and
+/// older readers ignore them.
+///
+/// Blobs are built and validated by host/RecipeCompiler.cpp.
+
+#define RECIPE_MAGIC 0x50435242 // "BRCP"
+#define RECIPE_VERSION 2
+
+#define RECIPE_MAX_MASH_STEPS 8
+#define RECIPE_MAX_HOPS 16
+#define RECIPE_MAX_FERMENT_STEPS 8
+
+struct RecipeTable
+{
+    uint32_t nOffset;
+    uint32_t nCount;
+};
+
+struct RecipeMashStep
+{
+    int32_t nTemperature; // C
+    uint32_t nMinutes;
+};
+
+struct RecipeHop
+{
+    uint32_t nName;  // string offset
+    int32_t nGrams;
+    uint32_t nMinutes; // before the end of the boil
+    int32_t nAlpha;    // alpha acids, %
+};
+
+struct RecipeFermentStep
+{
+    int32_t nTemperature; // C
+    uint32_t nHours;
+};
+
+struct RecipeHeader
+{
+    uint32_t nMagic;
+    uint32_t nVersion;
+    uint32_t nHeaderSize;
+    uint32_t nSize; // whole blob
+    uint32_t nCrc;  // whole blob with nCrc = 0
+
+    uint32_t nName; // string offset
+    int32_t nBatchVolume; // litres
+    int32_t nGrain;       // kg
+    uint32_t nBoilMinutes;
+    int32_t nGravity; // original gravity points, 50 for 1.050
+    int32_t nColor;   // grist average, Lovibond
+
+    RecipeTable mashSteps;
+    RecipeTable hops;
+    RecipeTable fermentSteps;
+};
+
+/// Typed view over a validated blob, only pointer arithmetic
+class RecipeView
+{
+public:
+    RecipeView () : pHeader (NULL)
+    {
+    }
+
+    /// The load: bounds checks and a pointer, NULL view if invalid
+    static RecipeView Open (const void* pData, size_t nSize)
+    {
+        RecipeView view;
+        const RecipeHeader* pHeader = (const RecipeHeader*)pData;
+
+        if (pData == NULL || ((uintptr_t)pData & 3) != 0 || nSize < sizeof (RecipeHeader)) return view;
+
+        if (pHeader->nMagic != RECIPE_MAGIC || pHeader->nVersion != RECIPE_VERSION) return view;
+
+        if (pHeader->nHeaderSize < sizeof (RecipeHeader) || pHeader->nSize > nSize || pHeader->nSize < pHeader->nHeaderSize || (pHeader->nSize & 3) != 0) return view;
+
+        // The string pool ends the blob and its last byte is a NUL, so
+        // no string can run past the end; read as a word, flash safe
+        if ((((const uint32_t*)pData)[pHeader->nSize / 4 - 1] >> 24) != 0) return view;
+
+        if (CheckTable (pHeader, pHeader->mashSteps, sizeof (RecipeMashStep), RECIPE_MAX_MASH_STEPS) == false ||
+            CheckTable (pHeader, pHeader->hops, sizeof (RecipeHop), RECIPE_MAX_HOPS) == false ||
+            CheckTable (pHeader, pHeader->fermentSteps, sizeof (RecipeFermentStep), RECIPE_MAX_FERMENT_STEPS) == false ||
+            CheckText (pHeader, pHeader->nName) == false)
+        {
+            return view;
+        }
+
+        view.pHeader = pHeader;
+
+        for (uint32_t nCount = 0; nCount < pHeader->hops.nCount; nCount++)
+        {
+            if (CheckText (pHeader, view.Hop (nCount).nName) == false) return RecipeView ();
+        }
+
+        return view;
+    }
+
+    /// Full integrity check, reads the whole blob; Open does not
+    bool Verify () const
+    {
+        if (pHeader == NULL) return false;
+
+        return Checksum (pHeader, pHeader->nSize) == pHeader->nCrc;
+    }
+
+    /// CRC-32 of a blob with its nCrc field as zero, word reads only
+    static uint32_t Checksum (const void* pData, uint32_t nSize)
+    {
+        return Crc32_Words (pData, nSize, offsetof (RecipeHeader, nCrc) / 4);
+    }
+
+    bool IsValid () const
+    {
+        return pHeader != NULL;
+    }
+
+    const RecipeHeader& Header () const
+    {
+        return *pHeader;
+    }
+
+    /// Points into the blob, flash on the device
+    const char* Text (uint32_t nOffset) const
+    {
+        return (const char*)pHeader + nOffset;
+    }
+
+    const char* GetName () const
+    {
+        return Text (pHeader->nName);
+    }
+
+    Fixed GetBatchVolume () const
+    {
+        return Fixed::FromRaw (pHeader->nBatchVolume);
+    }
+
+    Fixed GetGrain () const
+    {
+        return Fixed::FromRaw (pHeader->nGrain);
+    }
+
+    uint32_t GetBoilMinutes () const
+    {
+        return pHeader->nBoilMinutes;
+    }
+
+    Fixed GetGravity () const
+    {
+        return Fixed::FromRaw (pHeader->nGravity);
+    }
+
+    Fixed GetColor () const
+    {
+        return Fixed::FromRaw (pHeader->nColor);
+    }
+
+    uint32_t GetMashSteps () const
+    {
+        return pHeader->mashSteps.nCount;
+    }
+
+    const RecipeMashStep& MashStep (uint32_t nIndex) const
+    {
+        return Table<RecipeMashStep> (pHeader->mashSteps)[nIndex];
+    }
+
+    uint32_t GetHops () const
+    {
+        return pHeader->hops.nCount;
+    }
+
+    const RecipeHop& Hop (uint32_t nIndex) const
+    {
+        return Table<RecipeHop> (pHeader->hops)[nIndex];
+    }
+
+    uint32_t GetFermentSteps () const
+    {
+        return pHeader->fermentSteps.nCount;
+    }
+
+    const RecipeFermentStep& FermentStep (uint32_t nIndex) const
+    {
+        return Table<RecipeFermentStep> (pHeader->fermentSteps)[nIndex];
+    }
+
+private:
+    static bool CheckTable (const RecipeHeader* pHeader, const RecipeTable& table, size_t nRecordSize, uint32_t nMaxCount)
+    {
+        return Blob_CheckTable (pHeader->nHeaderSize, pHeader->nSize, table.nOffset, table.nCount, (uint32_t)nRecordSize, nMaxCount);
+    }
+
+    static bool CheckText (const RecipeHeader* pHeader, uint32_t nOffset)
+    {
+        return Blob_CheckText (pHeader->nHeaderSize, pHeader->nSize, nOffset);
+    }
+
+    template <typename Type>
+    const Type* Table (const RecipeTable& table) const
+    {
+        return (const Type*)((const uint8_t*)pHeader + table.nOffset);
+    }
+
+    const RecipeHeader* pHeader;
+};
+
+#endif
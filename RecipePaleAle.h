@@ -0,0 +1,25 @@
+///
+/// Generated by host/RecipeCompiler from ../recipes/pale-ale.recipe, do not edit
+///
+
+#pragma once
+
+static const uint8_t recipePaleAle[] PROGMEM __attribute__ ((aligned (4))) = {
+    0x42, 0x52, 0x43, 0x50, 0x02, 0x00, 0x00, 0x00, 0x44, 0x00, 0x00, 0x00,
+    0xC4, 0x00, 0x00, 0x00, 0xB4, 0xFF, 0x66, 0xA2, 0xA4, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x17, 0x00, 0x33, 0x33, 0x05, 0x00, 0x3C, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x32, 0x00, 0x00, 0x80, 0x03, 0x00, 0x44, 0x00, 0x00, 0x00,
+    0x03, 0x00, 0x00, 0x00, 0x74, 0x00, 0x00, 0x00, 0x03, 0x00, 0x00, 0x00,
+    0x5C, 0x00, 0x00, 0x00, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x42, 0x00,
+    0x3C, 0x00, 0x00, 0x00, 0x00, 0x00, 0x48, 0x00, 0x0F, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x4E, 0x00, 0x0A, 0x00, 0x00, 0x00, 0x00, 0x00, 0x12, 0x00,
+    0x78, 0x00, 0x00, 0x00, 0x00, 0x00, 0x15, 0x00, 0x30, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x02, 0x00, 0x30, 0x00, 0x00, 0x00, 0xAD, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x14, 0x00, 0x3C, 0x00, 0x00, 0x00, 0x00, 0x80, 0x0C, 0x00,
+    0xB4, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1E, 0x00, 0x0F, 0x00, 0x00, 0x00,
+    0x00, 0x80, 0x06, 0x00, 0xBC, 0x00, 0x00, 0x00, 0x00, 0x00, 0x28, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x80, 0x06, 0x00, 0x50, 0x61, 0x6C, 0x65,
+    0x20, 0x41, 0x6C, 0x65, 0x00, 0x4D, 0x61, 0x67, 0x6E, 0x75, 0x6D, 0x00,
+    0x43, 0x61, 0x73, 0x63, 0x61, 0x64, 0x65, 0x00, 0x43, 0x61, 0x73, 0x63,
+    0x61, 0x64, 0x65, 0x00,
+};
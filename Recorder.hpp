@@ -0,0 +1,634 @@
+///
+/// @author   GUSTAVO CAMPOS
+/// @author   GUSTAVO CAMPOS
+/// @date   28/05/2019 19:44
+/// @version  <#version#>
+///
+/// @copyright  (c) GUSTAVO CAMPOS, 2019
+/// @copyright  Licence
+///
+/// @see    ReadMe.txt for references
+///
+//               GNU GENERAL PUBLIC LICENSE
+//                Version 3, 29 June 2007
+//
+// Copyright (C) 2007 Free Software Foundation, Inc. <https://fsf.org/>
+// Everyone is permitted to copy and distribute verbatim copies
+// of this license document, but changing it is not allowed.
+//
+// Preamble
+//
+// The GNU General Public License is a free, copyleft license for
+// software and other kinds of works.
+//
+// The licenses for most software and other practical works are designed
+// to take away your freedom to share and change the works.  By contrast,
+// the GNU General Public License is intended to guarantee your freedom to
+// share and change all versions of a program--to make sure it remains free
+// software for all its users.  We, the Free Software Foundation, use the
+// GNU General Public License for most of our software; it applies also to
+// any other work released this way by its authors.  You can apply it to
+// your programs, too.
+//
+// See LICENSE file for the complete information
+
+#ifndef RECORDER_HPP
+#define RECORDER_HPP
+
+#include "Arduino.h"
+#include "CorePartition.h"
+
+#include <LittleFS.h>
+
+#include "Encoding.hpp"
+#include "BinaryLog.hpp"
+#include "Simulation.hpp"
+#include "Controller.hpp"
+#include "SensorPipeline.hpp"
+#include "Checkpoint.hpp"
+#include "Sync.hpp"
+
+/// Input recording for deterministic replays
+///
+/// A recording starts with the process state in the checkpoint
+/// section format (Checkpoint.hpp, flash log page excluded) and then
+/// holds, in order, every input the control stack saw:
+///
+///   tick     a control thread run on new plant time: simulated and
+///            real time since the previous record, every sensor
+///            sample and the output every loop wrote
+///   command  a sim, control or plant terminal line, or the port
+///            write of a script (Script.hpp), applied at the
+///            simulated time of the record
+///
+/// Values are raw Q16.16 as zigzag varint deltas against the previous
+/// tick, times are zigzag deltas too (a sim reset goes back), a
+/// steady tick costs about a dozen bytes. Records are encoded into a
+/// RAM buffer that Thread_Recorder appends to RECORD_FILE, so the
+/// control thread never waits for flash. There is no index or
+/// trailer, a recording cut by a reset replays up to its last whole
+/// record.
+///
+/// The host replays a recording with brewersim --replay, see
+/// host/Replay.h.
+
+#define RECORD_MAGIC 0x43455242 // "BREC"
+#define RECORD_VERSION 4
+
+#define RECORD_FILE "/rec.bin"
+
+#ifndef RECORD_BUFFER
+#define RECORD_BUFFER 1024
+#endif
+
+/// Pending bytes that trigger a write, or RECORD_SYNC_MS of age
+#ifndef RECORD_FLUSH
+#define RECORD_FLUSH 256
+#endif
+
+#ifndef RECORD_SYNC_MS
+#define RECORD_SYNC_MS 1000
+#endif
+
+/// Recording stops when the file reaches this size
+#ifndef RECORD_MAX_SIZE
+#define RECORD_MAX_SIZE (512 * 1024)
+#endif
+
+/// Longer command lines are cut
+#define RECORD_COMMAND_MAX 96
+
+#define RECORD_CHANNELS SENSOR_CHANNELS
+#define RECORD_LOOPS CONTROL_LOOPS
+
+enum RecordType : uint8_t
+{
+    RECORD_TICK = 1,
+    RECORD_COMMAND,
+    RECORD_END
+};
+
+/// Terminal command a command record is replayed through
+enum RecordSource : uint8_t
+{
+    RECORD_SOURCE_SIM = 0,
+    RECORD_SOURCE_CONTROL,
+    RECORD_SOURCE_PLANT,
+    RECORD_SOURCE_SCRIPT
+};
+
+/// Why a recording was stopped by the recorder itself
+enum RecordError : uint8_t
+{
+    RECORD_ERROR_OVERRUN = 1, // flash writes could not keep up
+    RECORD_ERROR_FULL,        // RECORD_MAX_SIZE reached
+    RECORD_ERROR_WRITE        // file write failed
+};
+
+struct RecordHeader
+{
+    uint32_t nMagic;
+    uint16_t nVersion;
+    uint8_t nChannels;
+    uint8_t nLoops;
+    uint32_t nTime;     // simulated seconds at start
+    uint32_t nSnapshot; // bytes of checkpoint sections after the header
+};
+
+/// Longest tick: type, two times, a value per channel and per loop
+#define RECORD_TICK_MAX (1 + 5 * (2 + RECORD_CHANNELS + RECORD_LOOPS))
+
+/// One decoded record, values are absolute
+struct RecordEntry
+{
+    uint8_t nType;
+    uint32_t nTime;   // simulated seconds
+    uint32_t nMillis; // real time since the start
+    int32_t nSamples[RECORD_CHANNELS];
+    int32_t nOutputs[RECORD_LOOPS];
+    uint8_t nSource;
+    char szCommand[RECORD_COMMAND_MAX + 1];
+};
+
+/// Archive that writes the visited fields straight to a file, the
+/// snapshot needs no RAM buffer
+class RecordWriter
+{
+public:
+    RecordWriter (File& file) : file (file), bFailed (false)
+    {
+    }
+
+    template <typename Type>
+    void operator() (const Type& value)
+    {
+        if (file.write ((const uint8_t*)&value, sizeof (Type)) != sizeof (Type)) bFailed = true;
+    }
+
+    static bool IsReading ()
+    {
+        return false;
+    }
+
+    bool IsFailed () const
+    {
+        return bFailed;
+    }
+
+private:
+    File& file;
+    bool bFailed;
+};
+
+/// Decodes a recording held in memory
+class RecordReader
+{
+public:
+    RecordReader (const uint8_t* pData, size_t nSize) : pData (pData), nSize (nSize), nOffset (0)
+    {
+        memset (&entry, 0, sizeof (entry));
+    }
+
+    /// Checks the header against this build, positions after the
+    /// snapshot
+    bool Open ()
+    {
+        const RecordHeader& header = Header ();
+
+        memset (&entry, 0, sizeof (entry));
+
+        if (nSize < sizeof (RecordHeader) || header.nMagic != RECORD_MAGIC || header.nVersion != RECORD_VERSION) return false;
+
+        if (header.nChannels != RECORD_CHANNELS || header.nLoops != RECORD_LOOPS || sizeof (RecordHeader) + header.nSnapshot > nSize) return false;
+
+        nOffset = sizeof (RecordHeader) + header.nSnapshot;
+        entry.nTime = header.nTime;
+
+        return true;
+    }
+
+    const RecordHeader& Header () const
+    {
+        return *(const RecordHeader*)pData;
+    }
+
+    /// Checkpoint sections, for Checkpoint_Apply
+    const uint8_t* Snapshot () const
+    {
+        return pData + sizeof (RecordHeader);
+    }
+
+    /// Next record, false at the end or at a cut record
+    bool Next (const RecordEntry*& pEntry)
+    {
+        uint32_t nValue = 0;
+
+        if (nOffset >= nSize) return false;
+
+        entry.nType = pData[nOffset];
+
+        size_t nPosition = nOffset + 1;
+
+        if (entry.nType == RECORD_TICK)
+        {
+            if (Read (nPosition, nValue) == false) return false;
+            entry.nTime += (uint32_t)ZigZag_Decode (nValue);
+
+            if (Read (nPosition, nValue) == false) return false;
+            entry.nMillis += nValue;
+
+            for (uint8_t nCount = 0; nCount < RECORD_CHANNELS; nCount++)
+            {
+                if (Read (nPosition, nValue) == false) return false;
+                entry.nSamples[nCount] += ZigZag_Decode (nValue);
+            }
+
+            for (uint8_t nCount = 0; nCount < RECORD_LOOPS; nCount++)
+            {
+                if (Read (nPosition, nValue) == false) return false;
+                entry.nOutputs[nCount] += ZigZag_Decode (nValue);
+            }
+        }
+        else if (entry.nType == RECORD_COMMAND)
+        {
+            if (Read (nPosition, nValue) == false) return false;
+            entry.nTime += (uint32_t)ZigZag_Decode (nValue);
+
+            if (nPosition >= nSize) return false;
+            entry.nSource = pData[nPosition++];
+
+            if (Read (nPosition, nValue) == false || nValue > RECORD_COMMAND_MAX || nPosition + nValue > nSize) return false;
+
+            memcpy (entry.szCommand, pData + nPosition, nValue);
+            entry.szCommand[nValue] = '\0';
+            nPosition += nValue;
+        }
+        else
+        {
+            return false;
+        }
+
+        nOffset = nPosition;
+        pEntry = &entry;
+
+        return true;
+    }
+
+    /// Bytes decoded so far
+    size_t GetOffset () const
+    {
+        return nOffset;
+    }
+
+private:
+    bool Read (size_t& nPosition, uint32_t& nValue) const
+    {
+        uint8_t nRead = Varint_Read (pData + nPosition, nSize - nPosition, nValue);
+
+        nPosition += nRead;
+
+        return nRead > 0;
+    }
+
+    const uint8_t* pData;
+    size_t nSize;
+    size_t nOffset;
+    RecordEntry entry;
+};
+
+class Recorder
+{
+public:
+    Recorder () : bRecording (false), nUsed (0), nSize (0), nStartTime (0), nStartMillis (0), nLastTime (0), nTickTime (0), nLastMillis (0), nFlushMillis (0), nSimSeconds (0), nTicks (0), nCommands (0), nError (0), pending ("recorder", 0, 1)
+    {
+        memset (nSamples, 0, sizeof (nSamples));
+        memset (nOutputs, 0, sizeof (nOutputs));
+    }
+
+    /// Opens RECORD_FILE and writes the header and the snapshot, in
+    /// one slice so the snapshot is consistent
+    bool Start ()
+    {
+        RecordHeader header;
+
+        if (bRecording) Stop ();
+
+        if (LittleFS.begin () == false) return false;
+
+        memset (&header, 0, sizeof (header));
+
+        header.nMagic = RECORD_MAGIC;
+        header.nVersion = RECORD_VERSION;
+        header.nChannels = RECORD_CHANNELS;
+        header.nLoops = RECORD_LOOPS;
+        header.nTime = simulation.GetTime ();
+
+        for (uint16_t nSection = CHECKPOINT_SIMULATION; nSection < CHECKPOINT_HISTORY; nSection++)
+        {
+            CheckpointSizer sizer;
+
+            Checkpoint_Visit ((CheckpointSection)nSection, sizer);
+            header.nSnapshot += (sizeof (CheckpointSectionHeader) + sizer.GetSize () + 3) & ~3;
+        }
+
+        file = LittleFS.open (RECORD_FILE, "w");
+
+        if (!file) return false;
+
+        bool bWritten = file.write ((const uint8_t*)&header, sizeof (header)) == sizeof (header);
+
+        for (uint16_t nSection = CHECKPOINT_SIMULATION; bWritten && nSection < CHECKPOINT_HISTORY; nSection++)
+        {
+            static const uint8_t padding[4] = {0, 0, 0, 0};
+            CheckpointSectionHeader section;
+            CheckpointSizer sizer;
+            RecordWriter writer (file);
+
+            Checkpoint_Visit ((CheckpointSection)nSection, sizer);
+
+            section.nSection = nSection;
+            section.nSize = (uint16_t)sizer.GetSize ();
+
+            bWritten = file.write ((const uint8_t*)&section, sizeof (section)) == sizeof (section);
+
+            Checkpoint_Visit ((CheckpointSection)nSection, writer);
+
+            uint32_t nPadding = ((sizeof (section) + section.nSize + 3) & ~3) - sizeof (section) - section.nSize;
+
+            bWritten = bWritten && writer.IsFailed () == false && file.write (padding, nPadding) == nPadding;
+        }
+
+        if (bWritten == false)
+        {
+            file.close ();
+            return false;
+        }
+
+        nSize = sizeof (header) + header.nSnapshot;
+        nUsed = 0;
+        nStartTime = header.nTime;
+        nLastTime = header.nTime;
+        nTickTime = header.nTime;
+        nStartMillis = millis ();
+        nLastMillis = nStartMillis;
+        nFlushMillis = nStartMillis;
+        nSimSeconds = 0;
+        nTicks = 0;
+        nCommands = 0;
+        nError = 0;
+
+        memset (nSamples, 0, sizeof (nSamples));
+        memset (nOutputs, 0, sizeof (nOutputs));
+
+        bRecording = true;
+
+        // Thread_Recorder waits without a timeout while idle
+        pending.Give ();
+
+        LOG_INFO (LOG_RECORD_START, nStartTime, nSize);
+
+        return true;
+    }
+
+    /// Ends the stream and closes the file
+    void Stop ()
+    {
+        if (bRecording == false) return;
+
+        if (nUsed < sizeof (buffer)) buffer[nUsed++] = RECORD_END;
+
+        Flush ();
+
+        if (bRecording == false) return;
+
+        file.close ();
+        bRecording = false;
+
+        LOG_INFO (LOG_RECORD_STOP, nTicks, nSize);
+    }
+
+    /// Called by the control thread after its loops ran, records only
+    /// when plant time moved since the last tick
+    void Tick ()
+    {
+        uint8_t record[RECORD_TICK_MAX];
+        uint8_t nRecord = 0;
+
+        if (bRecording == false) return;
+
+        uint32_t nTime = simulation.GetTime ();
+
+        if (nTime == nTickTime) return;
+
+        uint32_t nNow = millis ();
+
+        record[nRecord++] = RECORD_TICK;
+        nRecord += Varint_Write (&record[nRecord], ZigZag_Encode ((int32_t)(nTime - nLastTime)));
+        nRecord += Varint_Write (&record[nRecord], nNow - nLastMillis);
+
+        for (uint8_t nCount = 0; nCount < RECORD_CHANNELS; nCount++)
+        {
+            int32_t nValue = Sensor_Read (nCount).Raw ();
+
+            nRecord += Varint_Write (&record[nRecord], ZigZag_Encode (nValue - nSamples[nCount]));
+            nSamples[nCount] = nValue;
+        }
+
+        for (uint8_t nCount = 0; nCount < RECORD_LOOPS; nCount++)
+        {
+            int32_t nValue = controlLoops[nCount].GetOutput ().Raw ();
+
+            nRecord += Varint_Write (&record[nRecord], ZigZag_Encode (nValue - nOutputs[nCount]));
+            nOutputs[nCount] = nValue;
+        }
+
+        if (nTime > nLastTime) nSimSeconds += nTime - nLastTime;
+
+        nLastTime = nTime;
+        nTickTime = nTime;
+        nLastMillis = nNow;
+        nTicks++;
+
+        Append (record, nRecord);
+    }
+
+    /// Called by a terminal command before it runs
+    void Command (RecordSource nSource, const String& strCommandLine)
+    {
+        Command (nSource, strCommandLine.c_str ());
+    }
+
+    void Command (RecordSource nSource, const char* pszCommandLine)
+    {
+        uint8_t record[1 + 5 + 1 + 1 + RECORD_COMMAND_MAX];
+        uint8_t nRecord = 0;
+
+        if (bRecording == false) return;
+
+        uint32_t nTime = simulation.GetTime ();
+        size_t nCommandLine = strlen (pszCommandLine);
+        uint8_t nLength = nCommandLine > RECORD_COMMAND_MAX ? RECORD_COMMAND_MAX : (uint8_t)nCommandLine;
+
+        record[nRecord++] = RECORD_COMMAND;
+        nRecord += Varint_Write (&record[nRecord], ZigZag_Encode ((int32_t)(nTime - nLastTime)));
+        record[nRecord++] = nSource;
+        nRecord += Varint_Write (&record[nRecord], nLength);
+
+        memcpy (&record[nRecord], pszCommandLine, nLength);
+        nRecord += nLength;
+
+        if (nTime > nLastTime) nSimSeconds += nTime - nLastTime;
+
+        nLastTime = nTime;
+        nCommands++;
+
+        Append (record, nRecord);
+    }
+
+    /// Writes the pending bytes once there are enough or they are old
+    void Sync ()
+    {
+        if (bRecording && nError != 0)
+            Stop ();
+        else if (bRecording && (nUsed >= RECORD_FLUSH || (nUsed > 0 && millis () - nFlushMillis >= RECORD_SYNC_MS))) Flush ();
+    }
+
+    bool IsRecording () const
+    {
+        return bRecording;
+    }
+
+    /// Parks Thread_Recorder until RECORD_FLUSH bytes are pending, an
+    /// error, or the pending bytes turn RECORD_SYNC_MS old
+    void WaitPending ()
+    {
+        uint32_t nTimeout = SYNC_FOREVER;
+
+        if (bRecording && nUsed == 0)
+        {
+            nTimeout = RECORD_SYNC_MS;
+        }
+        else if (bRecording)
+        {
+            uint32_t nAge = millis () - nFlushMillis;
+
+            nTimeout = nAge >= RECORD_SYNC_MS ? 1 : RECORD_SYNC_MS - nAge;
+        }
+
+        pending.Take (nTimeout);
+    }
+
+    void Show (Stream& client)
+    {
+        client.printf ("%-20s: [%s]\r\n", "Recording", bRecording ? "yes" : "no");
+        client.printf ("%-20s: [%s]\r\n", "File", RECORD_FILE);
+        client.printf ("%-20s: [%us]\r\n", "Started at", nStartTime);
+        client.printf ("%-20s: [%us simulated, %us real]\r\n", "Span", nSimSeconds, (nLastMillis - nStartMillis) / 1000);
+        client.printf ("%-20s: [%u]\r\n", "Ticks", nTicks);
+        client.printf ("%-20s: [%u]\r\n", "Commands", nCommands);
+        client.printf ("%-20s: [%u written, %u pending, max %u]\r\n", "Bytes", nSize, nUsed, RECORD_MAX_SIZE);
+
+        if (nSimSeconds > 0) client.printf ("%-20s: [%u]\r\n", "Bytes per sim hour", (uint32_t)((uint64_t)(nSize + nUsed) * 3600 / nSimSeconds));
+
+        if (nError != 0) client.printf ("%-20s: [%u]\r\n", "Stopped by error", nError);
+    }
+
+private:
+    void Append (const uint8_t* pRecord, uint8_t nRecord)
+    {
+        if (nError != 0) return;
+
+        if (nSize + nUsed + nRecord + 1 > RECORD_MAX_SIZE)
+        {
+            Abort (RECORD_ERROR_FULL);
+        }
+        else if (nUsed + nRecord + 1 > sizeof (buffer))
+        {
+            // A dropped record would break the deltas, end it here
+            Abort (RECORD_ERROR_OVERRUN);
+        }
+        else
+        {
+            memcpy (&buffer[nUsed], pRecord, nRecord);
+            nUsed += nRecord;
+
+            if (nUsed >= RECORD_FLUSH) pending.Give ();
+        }
+    }
+
+    void Flush ()
+    {
+        nFlushMillis = millis ();
+
+        if (nUsed == 0) return;
+
+        if (file.write (buffer, nUsed) != nUsed)
+        {
+            Abort (RECORD_ERROR_WRITE);
+
+            file.close ();
+            bRecording = false;
+            nUsed = 0;
+            return;
+        }
+
+        nSize += nUsed;
+        nUsed = 0;
+    }
+
+    /// Later records are dropped, Thread_Recorder closes the file
+    void Abort (RecordError nCause)
+    {
+        if (nError == 0) LOG_ERROR (LOG_RECORD_ERROR, nCause);
+
+        nError = nCause;
+
+        pending.Give ();
+    }
+
+    File file;
+    bool bRecording;
+
+    // One byte is always left for RECORD_END
+    uint8_t buffer[RECORD_BUFFER];
+    uint32_t nUsed;
+    uint32_t nSize;
+
+    uint32_t nStartTime;
+    uint32_t nStartMillis;
+    uint32_t nLastTime;
+    uint32_t nTickTime;
+    uint32_t nLastMillis;
+    uint32_t nFlushMillis;
+    uint32_t nSimSeconds;
+
+    int32_t nSamples[RECORD_CHANNELS];
+    int32_t nOutputs[RECORD_LOOPS];
+
+    uint32_t nTicks;
+    uint32_t nCommands;
+    uint8_t nError;
+
+    SyncSemaphore pending;
+};
+
+Recorder recorder;
+
+/// Control thread hook, declared in Controller.hpp
+void Recorder_Tick ()
+{
+    recorder.Tick ();
+}
+
+/// Appends the encoded records to flash, off the control thread, and
+/// ends a recording the recorder aborted
+void Thread_Recorder (void* pValue)
+{
+    while (true)
+    {
+        recorder.Sync ();
+        recorder.WaitPending ();
+    }
+}
+
+#endif
@@ -0,0 +1,100 @@
+///
+/// @author   GUSTAVO CAMPOS
+/// @author   GUSTAVO CAMPOS
+/// @date   28/05/2019 19:44
+/// @version  <#version#>
+///
+/// @copyright  (c) GUSTAVO CAMPOS, 2019
+/// @copyright  Licence
+///
+/// @see    ReadMe.txt for references
+///
+//               GNU GENERAL PUBLIC LICENSE
+//                Version 3, 29 June 2007
+//
+// Copyright (C) 2007 Free Software Foundation, Inc. <https://fsf.org/>
+// Everyone is permitted to copy and distribute verbatim copies
+// of this license document, but changing it is not allowed.
+//
+// Preamble
+//
+// The GNU General Public License is a free, copyleft license for
+// software and other kinds of works.
+//
+// The licenses for most software and other practical works are designed
+// to take away your freedom to share and change the works.  By contrast,
+// the GNU General Public License is intended to guarantee your freedom to
+// share and change all versions of a program--to make sure it remains free
+// software for all its users.  We, the Free Software Foundation, use the
+// GNU General Public License for most of our software; it applies also to
+// any other work released this way by its authors.  You can apply it to
+// your programs, too.
+//
+// See LICENSE file for the complete information
+
+#ifndef RING_HPP
+#define RING_HPP
+
+#include <stdint.h>
+
+/// Lock-free single producer / single consumer ring
+///
+/// Only the head and tail indexes are shared, each written by one
+/// side, so a producer in an ISR and a consumer thread need no lock.
+/// Between cooperative threads any number of producers is fine as
+/// long as Push is not interrupted by a yield.
+template <typename Type, uint16_t nSize>
+class LockFreeRing
+{
+public:
+    LockFreeRing () : nHead (0), nTail (0), nDropped (0)
+    {
+        static_assert ((nSize & (nSize - 1)) == 0, "Ring size must be a power of two");
+    }
+
+    /// Producer side, false when full
+    bool Push (const Type& item)
+    {
+        uint16_t nNext = (nHead + 1) & (nSize - 1);
+
+        if (nNext == nTail)
+        {
+            nDropped++;
+            return false;
+        }
+
+        items[nHead] = item;
+        nHead = nNext;
+
+        return true;
+    }
+
+    /// Consumer side, false when empty
+    bool Pop (Type& item)
+    {
+        if (nTail == nHead) return false;
+
+        item = items[nTail];
+        nTail = (nTail + 1) & (nSize - 1);
+
+        return true;
+    }
+
+    uint16_t GetCount () const
+    {
+        return (nHead - nTail) & (nSize - 1);
+    }
+
+    uint32_t GetDropped () const
+    {
+        return nDropped;
+    }
+
+private:
+    Type items[nSize];
+    volatile uint16_t nHead;
+    volatile uint16_t nTail;
+    uint32_t nDropped;
+};
+
+#endif
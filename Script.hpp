@@ -0,0 +1,369 @@
+///
+/// @author   GUSTAVO CAMPOS
+/// @author   GUSTAVO CAMPOS
+/// @date   28/05/2019 19:44
+/// @version  <#version#>
+///
+/// @copyright  (c) GUSTAVO CAMPOS, 2019
+/// @copyright  Licence
+///
+/// @see    ReadMe.txt for references
+///
+//               GNU GENERAL PUBLIC LICENSE
+//                Version 3, 29 June 2007
+//
+// Copyright (C) 2007 Free Software Foundation, Inc. <https://fsf.org/>
+// Everyone is permitted to copy and distribute verbatim copies
+// of this license document, but changing it is not allowed.
+//
+// Preamble
+//
+// The GNU General Public License is a free, copyleft license for
+// software and other kinds of works.
+//
+// The licenses for most software and other practical works are designed
+// to take away your freedom to share and change the works.  By contrast,
+// the GNU General Public License is intended to guarantee your freedom to
+// share and change all versions of a program--to make sure it remains free
+// software for all its users.  We, the Free Software Foundation, use the
+// GNU General Public License for most of our software; it applies also to
+// any other work released this way by its authors.  You can apply it to
+// your programs, too.
+//
+// See LICENSE file for the complete information
+
+#ifndef SCRIPT_HPP
+#define SCRIPT_HPP
+
+#include "Arduino.h"
+#include "CorePartition.h"
+
+#include <LittleFS.h>
+#include <stdlib.h>
+
+#include "BinaryLog.hpp"
+#include "Simulation.hpp"
+#include "Controller.hpp"
+#include "SensorPipeline.hpp"
+#include "Recorder.hpp"
+#include "ScriptVM.hpp"
+
+// Built in scripts, generated by host/ScriptCompiler (make -C host scripts)
+#include "ScriptStepMash.h"
+
+/// Device side of the automation scripts: the built in blobs in
+/// PROGMEM, one RAM slot loaded from LittleFS, and SCRIPT_TASKS tasks
+/// that Thread_Script runs SCRIPT_BUDGET instructions at a time,
+/// yielding to the other threads after every task that ran.
+///
+/// Scripts read the sensors, vessels, loops and links and write
+/// setpoints, modes, heaters, valves, pumps and hop additions. Every
+/// write goes to the recorder as its raw value, so a replay applies
+/// the same writes at the same simulated time without running the
+/// scripts. Tasks are not checkpointed, a reboot or sim reset stops
+/// them.
+
+#ifndef SCRIPT_TASKS
+#define SCRIPT_TASKS 8
+#endif
+
+/// Instructions per task and slice
+#ifndef SCRIPT_BUDGET
+#define SCRIPT_BUDGET 64
+#endif
+
+/// Largest script "script load" takes
+#ifndef SCRIPT_LOAD_SIZE
+#define SCRIPT_LOAD_SIZE 1024
+#endif
+
+struct BuiltinScript
+{
+    const uint8_t* pData;
+    size_t nSize;
+};
+
+const BuiltinScript builtinScripts[] = {
+    {scriptStepMash, sizeof (scriptStepMash)}};
+
+#define SCRIPT_BUILTINS (sizeof (builtinScripts) / sizeof (builtinScripts[0]))
+
+/// Program SCRIPT_BUILTINS, empty until loaded
+uint32_t scriptLoaded[SCRIPT_LOAD_SIZE / 4];
+size_t nScriptLoaded = 0;
+
+ScriptTask scriptTasks[SCRIPT_TASKS];
+
+const char* const scriptStateNames[] = {"idle", "ready", "sleeping", "done", "fault"};
+
+/// Output of a script on the plant, false when nIndex does not exist
+bool Script_Apply (uint8_t nPort, uint8_t nIndex, Fixed nValue)
+{
+    switch (nPort)
+    {
+        case SCRIPT_OUT_SETPOINT:
+            if (nIndex >= CONTROL_LOOPS) return false;
+
+            controlLoops[nIndex].SetSetpoint (nValue);
+            return true;
+
+        case SCRIPT_OUT_MODE:
+            if (nIndex >= CONTROL_LOOPS || nValue < Fixed (0) || nValue > Fixed (CONTROL_AUTOTUNE)) return false;
+
+            controlLoops[nIndex].SetMode ((ControlMode)nValue.ToInt ());
+            return true;
+
+        case SCRIPT_OUT_HEATER:
+            if (nIndex >= SIMULATION_VESSELS) return false;
+
+            simulation.SetDuty (nIndex, nValue / Fixed (100));
+            return true;
+
+        case SCRIPT_OUT_VALVE:
+            return plant.SetValve (nIndex, nValue / Fixed (100));
+
+        case SCRIPT_OUT_PUMP:
+            return plant.SetPump (nIndex, nValue / Fixed (100));
+
+        case SCRIPT_OUT_HOPS:
+            if (nIndex >= SIMULATION_VESSELS || nValue <= Fixed (0)) return false;
+
+            simulation.Add (nIndex, INGREDIENT_HOPS, nValue / Fixed (1000), Fixed (20));
+            return true;
+    }
+
+    return false;
+}
+
+/// Applies a recorded write, "<port> <index> <raw value>"
+void Script_Replay (const char* pszCommandLine)
+{
+    char* pszEnd;
+    long nPort = strtol (pszCommandLine, &pszEnd, 10);
+    long nIndex = strtol (pszEnd, &pszEnd, 10);
+    long nRaw = strtol (pszEnd, &pszEnd, 10);
+
+    Script_Apply ((uint8_t)nPort, (uint8_t)nIndex, Fixed::FromRaw ((int32_t)nRaw));
+}
+
+/// The scripts' view of the simulated brewery
+class SimulatedScriptHost : public ScriptHost
+{
+public:
+    SimulatedScriptHost () : nTask (0)
+    {
+    }
+
+    /// Task running now, for the log
+    void SetTask (uint8_t nTaskID)
+    {
+        nTask = nTaskID;
+    }
+
+    uint32_t GetTime () override
+    {
+        return simulation.GetTime ();
+    }
+
+    bool Read (uint8_t nPort, uint8_t nIndex, Fixed& nValue) override
+    {
+        switch (nPort)
+        {
+            case SCRIPT_IN_TEMPERATURE:
+                if (nIndex >= SENSOR_CHANNELS) return false;
+
+                nValue = Sensor_Read (nIndex);
+                return true;
+
+            case SCRIPT_IN_VOLUME:
+                if (nIndex >= SIMULATION_VESSELS) return false;
+
+                nValue = simulation.Vessel (nIndex).nVolume;
+                return true;
+
+            case SCRIPT_IN_SETPOINT:
+                if (nIndex >= CONTROL_LOOPS) return false;
+
+                nValue = controlLoops[nIndex].GetSetpoint ();
+                return true;
+
+            case SCRIPT_IN_OUTPUT:
+                if (nIndex >= CONTROL_LOOPS) return false;
+
+                nValue = controlLoops[nIndex].GetOutput () * Fixed (100);
+                return true;
+
+            case SCRIPT_IN_FLOW:
+                if (nIndex >= plant.GetLinks ()) return false;
+
+                nValue = plant.Link (nIndex).nFlow * Fixed (60);
+                return true;
+
+            case SCRIPT_IN_GRAVITY:
+                if (nIndex != 0) return false;
+
+                nValue = fermentation.GetGravity ();
+                return true;
+        }
+
+        return false;
+    }
+
+    bool Write (uint8_t nPort, uint8_t nIndex, Fixed nValue) override
+    {
+        if (nPort == SCRIPT_OUT_LOG)
+        {
+            LOG_INFO (LOG_SCRIPT_LOG, nTask, nIndex, (uint32_t)ToCenti (nValue));
+            return true;
+        }
+
+        if (Script_Apply (nPort, nIndex, nValue) == false) return false;
+
+        char szCommand[32];
+
+        snprintf (szCommand, sizeof (szCommand), "%u %u %d", nPort, nIndex, nValue.Raw ());
+        recorder.Command (RECORD_SOURCE_SCRIPT, szCommand);
+
+        return true;
+    }
+
+private:
+    uint8_t nTask;
+};
+
+SimulatedScriptHost scriptHost;
+
+/// Built in or loaded program, invalid when there is none
+ScriptView Script_Open (uint8_t nProgram)
+{
+    if (nProgram < SCRIPT_BUILTINS) return ScriptView::Open (builtinScripts[nProgram].pData, builtinScripts[nProgram].nSize);
+
+    if (nProgram == SCRIPT_BUILTINS && nScriptLoaded > 0) return ScriptView::Open (scriptLoaded, nScriptLoaded);
+
+    return ScriptView ();
+}
+
+/// Starts nProgram on a free task, returns the task or -1
+int Script_Start (uint8_t nProgram)
+{
+    ScriptView view = Script_Open (nProgram);
+
+    if (view.IsValid () == false) return -1;
+
+    for (uint8_t nCount = 0; nCount < SCRIPT_TASKS; nCount++)
+    {
+        if (scriptTasks[nCount].IsActive ()) continue;
+
+        scriptTasks[nCount].Start (view, nProgram, simulation.GetTime ());
+
+        LOG_INFO (LOG_SCRIPT_START, nCount, nProgram);
+
+        return nCount;
+    }
+
+    return -1;
+}
+
+void Script_StopAll ()
+{
+    for (uint8_t nCount = 0; nCount < SCRIPT_TASKS; nCount++) scriptTasks[nCount].Stop ();
+}
+
+/// Reads a compiled script into the RAM slot, tasks running the
+/// previous one are stopped first
+bool Script_Load (const char* pszPath)
+{
+    for (uint8_t nCount = 0; nCount < SCRIPT_TASKS; nCount++)
+    {
+        if (scriptTasks[nCount].GetProgram () == SCRIPT_BUILTINS) scriptTasks[nCount].Stop ();
+    }
+
+    nScriptLoaded = 0;
+
+    File file = LittleFS.open (pszPath, "r");
+
+    if (!file) return false;
+
+    size_t nSize = file.size ();
+    bool bRead = nSize <= sizeof (scriptLoaded) && file.read ((uint8_t*)scriptLoaded, nSize) == nSize;
+
+    file.close ();
+
+    if (bRead == false || ScriptView::Open (scriptLoaded, nSize).IsValid () == false) return false;
+
+    nScriptLoaded = nSize;
+
+    return true;
+}
+
+void Script_List (Stream& client)
+{
+    for (uint8_t nCount = 0; nCount <= SCRIPT_BUILTINS; nCount++)
+    {
+        ScriptView view = Script_Open (nCount);
+
+        client.printf ("%u\t", nCount);
+
+        if (view.IsValid () == false)
+            client.println (nCount < SCRIPT_BUILTINS ? F ("invalid") : F ("(load slot empty)"));
+        else
+        {
+            client.print ((const __FlashStringHelper*)view.GetName ());
+            client.printf ("\t%u instructions%s\r\n", view.GetCodeSize (), nCount < SCRIPT_BUILTINS ? "" : ", loaded");
+        }
+    }
+}
+
+void Script_Show (Stream& client)
+{
+    uint32_t nTime = simulation.GetTime ();
+
+    client.println (F ("Task\tState\t\tProgram\tPc\tSleep s\tInstr\tSlices"));
+
+    for (uint8_t nCount = 0; nCount < SCRIPT_TASKS; nCount++)
+    {
+        const ScriptTask& task = scriptTasks[nCount];
+
+        if (task.GetState () == SCRIPT_IDLE) continue;
+
+        client.printf ("%u\t%-8s\t%u\t%u\t%u\t%u\t%u", nCount, scriptStateNames[task.GetState ()], task.GetProgram (), task.GetPc (), task.GetSleep (nTime), task.GetInstructions (), task.GetSlices ());
+
+        if (task.GetState () == SCRIPT_FAULT) client.printf ("\tfault %u", task.GetFault ());
+
+        client.println ();
+    }
+
+    client.printf ("Tasks: %u of %u bytes each, budget %u instructions\r\n", SCRIPT_TASKS, (unsigned)sizeof (ScriptTask), SCRIPT_BUDGET);
+}
+
+/// Runs every active task once per control period, the plant then
+/// moved about a step; a task that ran yields before the next one
+void Thread_Script (void* pValue)
+{
+    while (true)
+    {
+        for (uint8_t nCount = 0; nCount < SCRIPT_TASKS; nCount++)
+        {
+            ScriptTask& task = scriptTasks[nCount];
+
+            if (task.IsActive () == false) continue;
+
+            uint32_t nInstructions = task.GetInstructions ();
+
+            scriptHost.SetTask (nCount);
+
+            ScriptState nState = task.Run (scriptHost, SCRIPT_BUDGET);
+
+            if (nState == SCRIPT_DONE) LOG_INFO (LOG_SCRIPT_DONE, nCount, task.GetInstructions ());
+            if (nState == SCRIPT_FAULT) LOG_WARNING (LOG_SCRIPT_FAULT, nCount, task.GetFault (), task.GetPc ());
+
+            if (task.GetInstructions () != nInstructions) CorePartition_Yield ();
+        }
+
+        uint32_t nPeriod = Control_GetPeriod () / 1000;
+
+        CorePartition_Sleep (nPeriod < 5 ? 5 : nPeriod);
+    }
+}
+
+#endif
@@ -0,0 +1,346 @@
+///
+/// @author   GUSTAVO CAMPOS
+/// @author   GUSTAVO CAMPOS
+/// @date   28/05/2019 19:44
+/// @version  <#version#>
+///
+/// @copyright  (c) GUSTAVO CAMPOS, 2019
+/// @copyright  Licence
+///
+/// @see    ReadMe.txt for references
+///
+//               GNU GENERAL PUBLIC LICENSE
+//                Version 3, 29 June 2007
+//
+// Copyright (C) 2007 Free Software Foundation, Inc. <https://fsf.org/>
+// Everyone is permitted to copy and distribute verbatim copies
+// of this license document, but changing it is not allowed.
+//
+// Preamble
+//
+// The GNU General Public License is a free, copyleft license for
+// software and other kinds of works.
+//
+// The licenses for most software and other practical works are designed
+// to take away your freedom to share and change the works.  By contrast,
+// the GNU General Public License is intended to guarantee your freedom to
+// share and change all versions of a program--to make sure it remains free
+// software for all its users.  We, the Free Software Foundation, use the
+// GNU General Public License for most of our software; it applies also to
+// any other work released this way by its authors.  You can apply it to
+// your programs, too.
+//
+// See LICENSE file for the complete information
+
+#ifndef SCRIPT_FORMAT_HPP
+#define SCRIPT_FORMAT_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "FixedPoint.hpp"
+#include "Encoding.hpp"
+
+/// Binary automation script format
+///
+/// A script is a flat blob like a recipe (RecipeFormat.hpp): header,
+/// the code, a constant pool and a string pool, referenced by byte
+/// offsets and used where it lies, in PROGMEM or a RAM buffer.
+///
+/// Code is a table of 32 bit instructions for a register machine,
+/// the opcode in the low byte:
+///
+///   op | A << 8 | B << 16 | C << 24    three operands
+///   op | A << 8 | Bx << 16             a 16 bit operand, sBx signed
+///
+/// Registers are Q16.16 (Fixed), SCRIPT_REGISTERS at most; the header
+/// says how many the code uses. Jumps are absolute instruction
+/// indexes. READ and WRITE reach the plant through numbered ports and
+/// an index (vessel, loop or link), the host checks the index.
+///
+/// Open validates every instruction once, operands, jump targets,
+/// constants and ports, so the interpreter (ScriptVM.hpp) runs
+/// without checks.
+///
+/// Blobs are built by host/ScriptCompiler.cpp from a text language.
+
+#define SCRIPT_MAGIC 0x52435342 // "BSCR"
+#define SCRIPT_VERSION 1
+
+#define SCRIPT_REGISTERS 16
+#define SCRIPT_MAX_CODE 4096
+#define SCRIPT_MAX_CONSTANTS 256
+
+/// Opcodes and their operand layout, the order is the encoding
+#define SCRIPT_OPCODES(OP)                                    \
+    OP (HALT, SCRIPT_OPERANDS_NONE)    /* ends the script */  \
+    OP (YIELD, SCRIPT_OPERANDS_NONE)   /* ends the slice */   \
+    OP (SLEEP, SCRIPT_OPERANDS_A)      /* A minutes */        \
+    OP (LOADI, SCRIPT_OPERANDS_ASBX)   /* A = sBx */          \
+    OP (LOADK, SCRIPT_OPERANDS_ACONST) /* A = constant Bx */  \
+    OP (MOVE, SCRIPT_OPERANDS_AB)      /* A = B */            \
+    OP (ADD, SCRIPT_OPERANDS_ABC)      /* A = B + C */        \
+    OP (SUB, SCRIPT_OPERANDS_ABC)                             \
+    OP (MUL, SCRIPT_OPERANDS_ABC)                             \
+    OP (DIV, SCRIPT_OPERANDS_ABC)      /* saturates on 0 */   \
+    OP (NEG, SCRIPT_OPERANDS_AB)                              \
+    OP (NOT, SCRIPT_OPERANDS_AB)       /* A = B == 0 */       \
+    OP (LT, SCRIPT_OPERANDS_ABC)       /* A = B < C, 1 or 0 */ \
+    OP (LE, SCRIPT_OPERANDS_ABC)                              \
+    OP (EQ, SCRIPT_OPERANDS_ABC)                              \
+    OP (NE, SCRIPT_OPERANDS_ABC)                              \
+    OP (JUMP, SCRIPT_OPERANDS_JUMP)    /* to Bx */            \
+    OP (JUMPIF, SCRIPT_OPERANDS_AJUMP) /* to Bx if A */       \
+    OP (JUMPIFNOT, SCRIPT_OPERANDS_AJUMP)                     \
+    OP (NOW, SCRIPT_OPERANDS_A)        /* minutes running */  \
+    OP (READ, SCRIPT_OPERANDS_AREAD)   /* A = input B [C] */  \
+    OP (WRITE, SCRIPT_OPERANDS_AWRITE) /* output B [C] = A */
+
+enum ScriptOperands : uint8_t
+{
+    SCRIPT_OPERANDS_NONE = 0,
+    SCRIPT_OPERANDS_A,
+    SCRIPT_OPERANDS_AB,
+    SCRIPT_OPERANDS_ABC,
+    SCRIPT_OPERANDS_ASBX,
+    SCRIPT_OPERANDS_ACONST,
+    SCRIPT_OPERANDS_JUMP,
+    SCRIPT_OPERANDS_AJUMP,
+    SCRIPT_OPERANDS_AREAD,
+    SCRIPT_OPERANDS_AWRITE
+};
+
+#define SCRIPT_OPCODE_ENUM(NAME, OPERANDS) SCRIPT_##NAME,
+#define SCRIPT_OPCODE_OPERANDS(NAME, OPERANDS) OPERANDS,
+#define SCRIPT_OPCODE_NAME(NAME, OPERANDS) #NAME,
+
+enum ScriptOpcode : uint8_t
+{
+    SCRIPT_OPCODES (SCRIPT_OPCODE_ENUM) SCRIPT_OPCODE_COUNT
+};
+
+/// Inputs, READ A = port B of index C
+enum ScriptInput : uint8_t
+{
+    SCRIPT_IN_TEMPERATURE = 0, // vessel, C
+    SCRIPT_IN_VOLUME,          // vessel, L
+    SCRIPT_IN_SETPOINT,        // control loop, C
+    SCRIPT_IN_OUTPUT,          // control loop, %
+    SCRIPT_IN_FLOW,            // plant link, L/min
+    SCRIPT_IN_GRAVITY,         // fermenter 0, points
+    SCRIPT_INPUTS
+};
+
+/// Outputs, WRITE port B of index C = A
+enum ScriptOutput : uint8_t
+{
+    SCRIPT_OUT_SETPOINT = 0, // control loop, C
+    SCRIPT_OUT_MODE,         // control loop, ControlMode
+    SCRIPT_OUT_HEATER,       // vessel, %
+    SCRIPT_OUT_VALVE,        // plant link, %
+    SCRIPT_OUT_PUMP,         // plant link, %
+    SCRIPT_OUT_HOPS,         // vessel, grams added
+    SCRIPT_OUT_LOG,          // message id, value
+    SCRIPT_OUTPUTS
+};
+
+inline uint32_t Script_Encode (ScriptOpcode nOpcode, uint8_t nA, uint8_t nB, uint8_t nC)
+{
+    return (uint32_t)nOpcode | (uint32_t)nA << 8 | (uint32_t)nB << 16 | (uint32_t)nC << 24;
+}
+
+inline uint32_t Script_EncodeBx (ScriptOpcode nOpcode, uint8_t nA, uint16_t nBx)
+{
+    return (uint32_t)nOpcode | (uint32_t)nA << 8 | (uint32_t)nBx << 16;
+}
+
+struct ScriptTable
+{
+    uint32_t nOffset;
+    uint32_t nCount;
+};
+
+struct ScriptHeader
+{
+    uint32_t nMagic;
+    uint32_t nVersion;
+    uint32_t nHeaderSize;
+    uint32_t nSize; // whole blob
+    uint32_t nCrc;  // whole blob with nCrc = 0
+
+    uint32_t nName;      // string offset
+    uint32_t nRegisters; // used by the code
+
+    ScriptTable code;      // uint32_t instructions
+    ScriptTable constants; // int32_t, Q16.16 raw
+};
+
+/// Typed view over a validated blob, only pointer arithmetic
+class ScriptView
+{
+public:
+    ScriptView () : pHeader (NULL)
+    {
+    }
+
+    /// The load: bounds checks and one pass over the code, NULL view
+    /// if anything would let the interpreter leave the blob
+    static ScriptView Open (const void* pData, size_t nSize)
+    {
+        ScriptView view;
+        const ScriptHeader* pHeader = (const ScriptHeader*)pData;
+
+        if (pData == NULL || ((uintptr_t)pData & 3) != 0 || nSize < sizeof (ScriptHeader)) return view;
+
+        if (pHeader->nMagic != SCRIPT_MAGIC || pHeader->nVersion != SCRIPT_VERSION) return view;
+
+        if (pHeader->nHeaderSize < sizeof (ScriptHeader) || pHeader->nSize > nSize || pHeader->nSize < pHeader->nHeaderSize || (pHeader->nSize & 3) != 0) return view;
+
+        // The string pool ends the blob with a NUL, as in recipes
+        if ((((const uint32_t*)pData)[pHeader->nSize / 4 - 1] >> 24) != 0) return view;
+
+        if (CheckTable (pHeader, pHeader->code, SCRIPT_MAX_CODE) == false || CheckTable (pHeader, pHeader->constants, SCRIPT_MAX_CONSTANTS) == false ||
+            pHeader->code.nCount == 0 || pHeader->nRegisters > SCRIPT_REGISTERS || Blob_CheckText (pHeader->nHeaderSize, pHeader->nSize, pHeader->nName) == false)
+        {
+            return view;
+        }
+
+        const uint32_t* pCode = (const uint32_t*)((const uint8_t*)pData + pHeader->code.nOffset);
+
+        for (uint32_t nCount = 0; nCount < pHeader->code.nCount; nCount++)
+        {
+            if (CheckInstruction (pHeader, pCode[nCount]) == false) return view;
+        }
+
+        // Nothing runs past the end
+        uint8_t nLast = pCode[pHeader->code.nCount - 1] & 0xFF;
+
+        if (nLast != SCRIPT_HALT && nLast != SCRIPT_JUMP) return view;
+
+        view.pHeader = pHeader;
+
+        return view;
+    }
+
+    /// Full integrity check, reads the whole blob; Open does not
+    bool Verify () const
+    {
+        if (pHeader == NULL) return false;
+
+        return Checksum (pHeader, pHeader->nSize) == pHeader->nCrc;
+    }
+
+    /// CRC-32 of a blob with its nCrc field as zero, word reads only
+    static uint32_t Checksum (const void* pData, uint32_t nSize)
+    {
+        return Crc32_Words (pData, nSize, offsetof (ScriptHeader, nCrc) / 4);
+    }
+
+    static ScriptOperands Operands (uint8_t nOpcode)
+    {
+        static const ScriptOperands operands[] = {SCRIPT_OPCODES (SCRIPT_OPCODE_OPERANDS)};
+
+        return nOpcode < SCRIPT_OPCODE_COUNT ? operands[nOpcode] : SCRIPT_OPERANDS_NONE;
+    }
+
+    bool IsValid () const
+    {
+        return pHeader != NULL;
+    }
+
+    const ScriptHeader& Header () const
+    {
+        return *pHeader;
+    }
+
+    /// Points into the blob, flash on the device
+    const char* Text (uint32_t nOffset) const
+    {
+        return (const char*)pHeader + nOffset;
+    }
+
+    const char* GetName () const
+    {
+        return Text (pHeader->nName);
+    }
+
+    uint32_t GetRegisters () const
+    {
+        return pHeader->nRegisters;
+    }
+
+    uint32_t GetCodeSize () const
+    {
+        return pHeader->code.nCount;
+    }
+
+    const uint32_t* Code () const
+    {
+        return (const uint32_t*)((const uint8_t*)pHeader + pHeader->code.nOffset);
+    }
+
+    uint32_t GetConstants () const
+    {
+        return pHeader->constants.nCount;
+    }
+
+    const int32_t* Constants () const
+    {
+        return (const int32_t*)((const uint8_t*)pHeader + pHeader->constants.nOffset);
+    }
+
+private:
+    static bool CheckTable (const ScriptHeader* pHeader, const ScriptTable& table, uint32_t nMaxCount)
+    {
+        return Blob_CheckTable (pHeader->nHeaderSize, pHeader->nSize, table.nOffset, table.nCount, 4, nMaxCount);
+    }
+
+    static bool CheckInstruction (const ScriptHeader* pHeader, uint32_t nWord)
+    {
+        uint8_t nOpcode = nWord & 0xFF;
+        uint8_t nA = (nWord >> 8) & 0xFF;
+        uint8_t nB = (nWord >> 16) & 0xFF;
+        uint8_t nC = (nWord >> 24) & 0xFF;
+        uint16_t nBx = (uint16_t)(nWord >> 16);
+        uint32_t nRegisters = pHeader->nRegisters;
+
+        if (nOpcode >= SCRIPT_OPCODE_COUNT) return false;
+
+        switch (Operands (nOpcode))
+        {
+            case SCRIPT_OPERANDS_NONE:
+                return true;
+
+            case SCRIPT_OPERANDS_A:
+            case SCRIPT_OPERANDS_ASBX:
+                return nA < nRegisters;
+
+            case SCRIPT_OPERANDS_AB:
+                return nA < nRegisters && nB < nRegisters;
+
+            case SCRIPT_OPERANDS_ABC:
+                return nA < nRegisters && nB < nRegisters && nC < nRegisters;
+
+            case SCRIPT_OPERANDS_ACONST:
+                return nA < nRegisters && nBx < pHeader->constants.nCount;
+
+            case SCRIPT_OPERANDS_JUMP:
+                return nBx < pHeader->code.nCount;
+
+            case SCRIPT_OPERANDS_AJUMP:
+                return nA < nRegisters && nBx < pHeader->code.nCount;
+
+            case SCRIPT_OPERANDS_AREAD:
+                return nA < nRegisters && nB < SCRIPT_INPUTS;
+
+            case SCRIPT_OPERANDS_AWRITE:
+                return nA < nRegisters && nB < SCRIPT_OUTPUTS;
+        }
+
+        return false;
+    }
+
+    const ScriptHeader* pHeader;
+};
+
+#endif
@@ -0,0 +1,46 @@
+///
+/// Generated by host/ScriptCompiler from ../scripts/step-mash.script, do not edit
+///
+
+#pragma once
+
+static const uint8_t scriptStepMash[] PROGMEM __attribute__ ((aligned (4))) = {
+    0x42, 0x53, 0x43, 0x52, 0x01, 0x00, 0x00, 0x00, 0x2C, 0x00, 0x00, 0x00,
+    0xC4, 0x01, 0x00, 0x00, 0x7D, 0x00, 0xFA, 0x3E, 0xB8, 0x01, 0x00, 0x00,
+    0x06, 0x00, 0x00, 0x00, 0x2C, 0x00, 0x00, 0x00, 0x61, 0x00, 0x00, 0x00,
+    0xB0, 0x01, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x03, 0x00, 0x64, 0x00,
+    0x15, 0x00, 0x03, 0x00, 0x03, 0x00, 0x64, 0x00, 0x15, 0x00, 0x03, 0x03,
+    0x03, 0x00, 0x3C, 0x00, 0x15, 0x00, 0x04, 0x02, 0x03, 0x00, 0x02, 0x00,
+    0x15, 0x00, 0x01, 0x00, 0x03, 0x00, 0x00, 0x00, 0x03, 0x02, 0x03, 0x00,
+    0x0C, 0x01, 0x00, 0x02, 0x12, 0x01, 0x2A, 0x00, 0x03, 0x01, 0x42, 0x00,
+    0x03, 0x02, 0x3C, 0x00, 0x03, 0x04, 0x01, 0x00, 0x0E, 0x03, 0x00, 0x04,
+    0x12, 0x03, 0x15, 0x00, 0x03, 0x03, 0x48, 0x00, 0x05, 0x01, 0x03, 0x00,
+    0x03, 0x03, 0x0F, 0x00, 0x05, 0x02, 0x03, 0x00, 0x03, 0x04, 0x02, 0x00,
+    0x0E, 0x03, 0x00, 0x04, 0x12, 0x03, 0x1C, 0x00, 0x03, 0x03, 0x4E, 0x00,
+    0x05, 0x01, 0x03, 0x00, 0x03, 0x03, 0x0A, 0x00, 0x05, 0x02, 0x03, 0x00,
+    0x15, 0x01, 0x00, 0x00, 0x14, 0x03, 0x00, 0x00, 0x04, 0x05, 0x00, 0x00,
+    0x07, 0x04, 0x01, 0x05, 0x0D, 0x03, 0x04, 0x03, 0x11, 0x03, 0x24, 0x00,
+    0x01, 0x00, 0x00, 0x00, 0x10, 0x00, 0x1D, 0x00, 0x15, 0x01, 0x06, 0x01,
+    0x02, 0x02, 0x00, 0x00, 0x03, 0x04, 0x01, 0x00, 0x06, 0x03, 0x00, 0x04,
+    0x05, 0x00, 0x03, 0x00, 0x10, 0x00, 0x09, 0x00, 0x03, 0x03, 0x00, 0x00,
+    0x15, 0x03, 0x03, 0x03, 0x03, 0x03, 0x64, 0x00, 0x15, 0x03, 0x03, 0x04,
+    0x03, 0x03, 0x64, 0x00, 0x15, 0x03, 0x04, 0x02, 0x03, 0x03, 0x00, 0x00,
+    0x15, 0x03, 0x01, 0x00, 0x03, 0x03, 0x00, 0x00, 0x15, 0x03, 0x02, 0x00,
+    0x14, 0x03, 0x01, 0x00, 0x04, 0x04, 0x00, 0x00, 0x0C, 0x03, 0x03, 0x04,
+    0x11, 0x03, 0x3B, 0x00, 0x14, 0x03, 0x04, 0x02, 0x04, 0x04, 0x01, 0x00,
+    0x0C, 0x03, 0x03, 0x04, 0x11, 0x03, 0x3E, 0x00, 0x01, 0x00, 0x00, 0x00,
+    0x10, 0x00, 0x34, 0x00, 0x03, 0x03, 0x00, 0x00, 0x15, 0x03, 0x04, 0x02,
+    0x03, 0x03, 0x00, 0x00, 0x15, 0x03, 0x03, 0x00, 0x03, 0x03, 0x00, 0x00,
+    0x15, 0x03, 0x03, 0x04, 0x03, 0x03, 0x02, 0x00, 0x15, 0x03, 0x01, 0x01,
+    0x03, 0x03, 0x64, 0x00, 0x15, 0x03, 0x00, 0x01, 0x14, 0x03, 0x00, 0x01,
+    0x03, 0x04, 0x63, 0x00, 0x0D, 0x03, 0x04, 0x03, 0x11, 0x03, 0x4E, 0x00,
+    0x01, 0x00, 0x00, 0x00, 0x10, 0x00, 0x48, 0x00, 0x14, 0x03, 0x01, 0x01,
+    0x15, 0x03, 0x06, 0x02, 0x03, 0x03, 0x14, 0x00, 0x15, 0x03, 0x05, 0x01,
+    0x03, 0x03, 0x2D, 0x00, 0x02, 0x03, 0x00, 0x00, 0x03, 0x03, 0x1E, 0x00,
+    0x15, 0x03, 0x05, 0x01, 0x03, 0x03, 0x0F, 0x00, 0x02, 0x03, 0x00, 0x00,
+    0x03, 0x03, 0x28, 0x00, 0x15, 0x03, 0x05, 0x01, 0x03, 0x03, 0x00, 0x00,
+    0x15, 0x03, 0x01, 0x01, 0x03, 0x03, 0x00, 0x00, 0x15, 0x03, 0x02, 0x01,
+    0x13, 0x03, 0x00, 0x00, 0x15, 0x03, 0x06, 0x03, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x80, 0x00, 0x00, 0x9A, 0x19, 0x00, 0x00, 0x53, 0x74, 0x65, 0x70,
+    0x20, 0x6D, 0x61, 0x73, 0x68, 0x00, 0x00, 0x00,
+};
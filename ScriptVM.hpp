@@ -0,0 +1,378 @@
+///
+/// @author   GUSTAVO CAMPOS
+/// @author   GUSTAVO CAMPOS
+/// @date   28/05/2019 19:44
+/// @version  <#version#>
+///
+/// @copyright  (c) GUSTAVO CAMPOS, 2019
+/// @copyright  Licence
+///
+/// @see    ReadMe.txt for references
+///
+//               GNU GENERAL PUBLIC LICENSE
+//                Version 3, 29 June 2007
+//
+// Copyright (C) 2007 Free Software Foundation, Inc. <https://fsf.org/>
+// Everyone is permitted to copy and distribute verbatim copies
+// of this license document, but changing it is not allowed.
+//
+// Preamble
+//
+// The GNU General Public License is a free, copyleft license for
+// software and other kinds of works.
+//
+// The licenses for most software and other practical works are designed
+// to take away your freedom to share and change the works.  By contrast,
+// the GNU General Public License is intended to guarantee your freedom to
+// share and change all versions of a program--to make sure it remains free
+// software for all its users.  We, the Free Software Foundation, use the
+// GNU General Public License for most of our software; it applies also to
+// any other work released this way by its authors.  You can apply it to
+// your programs, too.
+//
+// See LICENSE file for the complete information
+
+#ifndef SCRIPT_VM_HPP
+#define SCRIPT_VM_HPP
+
+#include <stdint.h>
+
+#include "FixedPoint.hpp"
+#include "ScriptFormat.hpp"
+
+/// Script interpreter
+///
+/// A ScriptTask is one running script: its registers, program counter
+/// and wake time, about a hundred bytes with no heap, so many of them
+/// sit in a static array. Run executes at most nBudget instructions
+/// and returns, keeping its place; the caller yields to the other
+/// threads between tasks. YIELD ends the slice early, SLEEP parks the
+/// task until the plant clock reaches its wake time, a sleeping task
+/// costs one compare per slice.
+///
+/// Dispatch is threaded, a computed goto per instruction, when the
+/// compiler has labels as values (GCC, also for the ESP8266), and a
+/// switch otherwise; both run the same handlers. The code is read
+/// 32 bits at a time, so it can stay in flash.
+///
+/// The plant is reached through ScriptHost, the device implements it
+/// on the simulation and the control loops (Script.hpp), the host
+/// tools on a model.
+
+#ifndef SCRIPT_THREADED
+#ifdef __GNUC__
+#define SCRIPT_THREADED 1
+#else
+#define SCRIPT_THREADED 0
+#endif
+#endif
+
+class ScriptHost
+{
+public:
+    /// Plant clock, seconds
+    virtual uint32_t GetTime () = 0;
+
+    /// False when nIndex does not exist, the task faults
+    virtual bool Read (uint8_t nPort, uint8_t nIndex, Fixed& nValue) = 0;
+    virtual bool Write (uint8_t nPort, uint8_t nIndex, Fixed nValue) = 0;
+};
+
+enum ScriptState : uint8_t
+{
+    SCRIPT_IDLE = 0,
+    SCRIPT_READY,
+    SCRIPT_SLEEPING,
+    SCRIPT_DONE,
+    SCRIPT_FAULT
+};
+
+enum ScriptFault : uint8_t
+{
+    SCRIPT_FAULT_NONE = 0,
+    SCRIPT_FAULT_READ,
+    SCRIPT_FAULT_WRITE
+};
+
+class ScriptTask
+{
+public:
+    ScriptTask () : pCode (NULL), pConstants (NULL), nPc (0), nState (SCRIPT_IDLE), nFault (SCRIPT_FAULT_NONE), nProgram (0), nStart (0), nWake (0), nInstructions (0), nSlices (0)
+    {
+    }
+
+    /// Runs view from its first instruction, registers at 0
+    void Start (const ScriptView& view, uint8_t nProgramID, uint32_t nTime)
+    {
+        pCode = view.Code ();
+        pConstants = view.Constants ();
+        nProgram = nProgramID;
+        nPc = 0;
+        nState = SCRIPT_READY;
+        nFault = SCRIPT_FAULT_NONE;
+        nStart = nTime;
+        nWake = nTime;
+        nInstructions = 0;
+        nSlices = 0;
+
+        for (uint8_t nCount = 0; nCount < SCRIPT_REGISTERS; nCount++) registers[nCount] = Fixed ();
+    }
+
+    void Stop ()
+    {
+        nState = SCRIPT_IDLE;
+    }
+
+    bool IsActive () const
+    {
+        return nState == SCRIPT_READY || nState == SCRIPT_SLEEPING;
+    }
+
+    /// Up to nBudget instructions, returns the state it stopped in
+    ScriptState Run (ScriptHost& host, uint32_t nBudget)
+    {
+        return Execute<SCRIPT_THREADED != 0> (host, nBudget);
+    }
+
+    /// Run with the dispatch chosen by the caller, the host benchmark
+    /// compares both
+    template <bool bThreaded>
+    ScriptState Execute (ScriptHost& host, uint32_t nBudget)
+    {
+        if (nState == SCRIPT_SLEEPING)
+        {
+            if ((int32_t)(host.GetTime () - nWake) < 0) return SCRIPT_SLEEPING;
+
+            nState = SCRIPT_READY;
+        }
+
+        if (nState != SCRIPT_READY || nBudget == 0) return (ScriptState)nState;
+
+        const uint32_t* const pProgram = pCode;
+        Fixed* const r = registers;
+        uint32_t nPosition = nPc;
+        uint32_t nLeft = nBudget;
+        uint32_t nWord;
+
+        nSlices++;
+
+#define SCRIPT_A ((nWord >> 8) & 0xFF)
+#define SCRIPT_B ((nWord >> 16) & 0xFF)
+#define SCRIPT_C (nWord >> 24)
+#define SCRIPT_BX (nWord >> 16)
+#define SCRIPT_LABEL(NAME, OPERANDS) &&Op_##NAME,
+
+#if SCRIPT_THREADED
+        static const void* const labels[] = {SCRIPT_OPCODES (SCRIPT_LABEL)};
+
+#define SCRIPT_CASE(NAME) \
+    case SCRIPT_##NAME:   \
+    Op_##NAME:
+
+#define SCRIPT_NEXT()                            \
+    if (bThreaded)                               \
+    {                                            \
+        if (nLeft == 0) goto Suspend;            \
+        nLeft--;                                 \
+        nWord = pProgram[nPosition++];           \
+        goto* labels[nWord & 0xFF];              \
+    }                                            \
+    continue
+#else
+#define SCRIPT_CASE(NAME) case SCRIPT_##NAME:
+#define SCRIPT_NEXT() continue
+#endif
+
+        while (true)
+        {
+            if (nLeft == 0) goto Suspend;
+
+            nLeft--;
+            nWord = pProgram[nPosition++];
+
+            switch (nWord & 0xFF)
+            {
+                SCRIPT_CASE (HALT)
+                    nState = SCRIPT_DONE;
+                    goto Suspend;
+
+                SCRIPT_CASE (YIELD)
+                    goto Suspend;
+
+                SCRIPT_CASE (SLEEP)
+                {
+                    int64_t nSeconds = ((int64_t)r[SCRIPT_A].Raw () * 60 + Fixed::nOne / 2) / Fixed::nOne;
+
+                    if (nSeconds > 0)
+                    {
+                        nWake = host.GetTime () + (uint32_t)nSeconds;
+                        nState = SCRIPT_SLEEPING;
+                    }
+
+                    goto Suspend;
+                }
+
+                SCRIPT_CASE (LOADI)
+                    r[SCRIPT_A] = Fixed ((int)(int16_t)SCRIPT_BX);
+                    SCRIPT_NEXT ();
+
+                SCRIPT_CASE (LOADK)
+                    r[SCRIPT_A] = Fixed::FromRaw (pConstants[SCRIPT_BX]);
+                    SCRIPT_NEXT ();
+
+                SCRIPT_CASE (MOVE)
+                    r[SCRIPT_A] = r[SCRIPT_B];
+                    SCRIPT_NEXT ();
+
+                SCRIPT_CASE (ADD)
+                    r[SCRIPT_A] = r[SCRIPT_B] + r[SCRIPT_C];
+                    SCRIPT_NEXT ();
+
+                SCRIPT_CASE (SUB)
+                    r[SCRIPT_A] = r[SCRIPT_B] - r[SCRIPT_C];
+                    SCRIPT_NEXT ();
+
+                SCRIPT_CASE (MUL)
+                    r[SCRIPT_A] = r[SCRIPT_B] * r[SCRIPT_C];
+                    SCRIPT_NEXT ();
+
+                SCRIPT_CASE (DIV)
+                    r[SCRIPT_A] = r[SCRIPT_B] / r[SCRIPT_C];
+                    SCRIPT_NEXT ();
+
+                SCRIPT_CASE (NEG)
+                    r[SCRIPT_A] = -r[SCRIPT_B];
+                    SCRIPT_NEXT ();
+
+                SCRIPT_CASE (NOT)
+                    r[SCRIPT_A] = Fixed (r[SCRIPT_B] == Fixed () ? 1 : 0);
+                    SCRIPT_NEXT ();
+
+                SCRIPT_CASE (LT)
+                    r[SCRIPT_A] = Fixed (r[SCRIPT_B] < r[SCRIPT_C] ? 1 : 0);
+                    SCRIPT_NEXT ();
+
+                SCRIPT_CASE (LE)
+                    r[SCRIPT_A] = Fixed (r[SCRIPT_B] <= r[SCRIPT_C] ? 1 : 0);
+                    SCRIPT_NEXT ();
+
+                SCRIPT_CASE (EQ)
+                    r[SCRIPT_A] = Fixed (r[SCRIPT_B] == r[SCRIPT_C] ? 1 : 0);
+                    SCRIPT_NEXT ();
+
+                SCRIPT_CASE (NE)
+                    r[SCRIPT_A] = Fixed (r[SCRIPT_B] != r[SCRIPT_C] ? 1 : 0);
+                    SCRIPT_NEXT ();
+
+                SCRIPT_CASE (JUMP)
+                    nPosition = SCRIPT_BX;
+                    SCRIPT_NEXT ();
+
+                SCRIPT_CASE (JUMPIF)
+                    if (r[SCRIPT_A] != Fixed ()) nPosition = SCRIPT_BX;
+                    SCRIPT_NEXT ();
+
+                SCRIPT_CASE (JUMPIFNOT)
+                    if (r[SCRIPT_A] == Fixed ()) nPosition = SCRIPT_BX;
+                    SCRIPT_NEXT ();
+
+                SCRIPT_CASE (NOW)
+                {
+                    int64_t nRaw = (int64_t)(host.GetTime () - nStart) * Fixed::nOne / 60;
+
+                    r[SCRIPT_A] = Fixed::FromRaw (nRaw > INT32_MAX ? INT32_MAX : (int32_t)nRaw);
+                    SCRIPT_NEXT ();
+                }
+
+                SCRIPT_CASE (READ)
+                    if (host.Read (SCRIPT_B, SCRIPT_C, r[SCRIPT_A]) == false)
+                    {
+                        nFault = SCRIPT_FAULT_READ;
+                        nState = SCRIPT_FAULT;
+                        goto Suspend;
+                    }
+                    SCRIPT_NEXT ();
+
+                SCRIPT_CASE (WRITE)
+                    if (host.Write (SCRIPT_B, SCRIPT_C, r[SCRIPT_A]) == false)
+                    {
+                        nFault = SCRIPT_FAULT_WRITE;
+                        nState = SCRIPT_FAULT;
+                        goto Suspend;
+                    }
+                    SCRIPT_NEXT ();
+            }
+        }
+
+#undef SCRIPT_NEXT
+#undef SCRIPT_CASE
+#undef SCRIPT_LABEL
+#undef SCRIPT_BX
+#undef SCRIPT_C
+#undef SCRIPT_B
+#undef SCRIPT_A
+
+    Suspend:
+        // A fault points at the instruction that failed
+        nPc = nState == SCRIPT_FAULT ? nPosition - 1 : nPosition;
+        nInstructions += nBudget - nLeft;
+
+        return (ScriptState)nState;
+    }
+
+    ScriptState GetState () const
+    {
+        return (ScriptState)nState;
+    }
+
+    ScriptFault GetFault () const
+    {
+        return (ScriptFault)nFault;
+    }
+
+    uint8_t GetProgram () const
+    {
+        return nProgram;
+    }
+
+    uint16_t GetPc () const
+    {
+        return nPc;
+    }
+
+    /// Plant seconds left asleep, 0 when awake
+    uint32_t GetSleep (uint32_t nTime) const
+    {
+        return nState == SCRIPT_SLEEPING && (int32_t)(nWake - nTime) > 0 ? nWake - nTime : 0;
+    }
+
+    uint32_t GetInstructions () const
+    {
+        return nInstructions;
+    }
+
+    uint32_t GetSlices () const
+    {
+        return nSlices;
+    }
+
+    const Fixed& Register (uint8_t nRegister) const
+    {
+        return registers[nRegister];
+    }
+
+private:
+    const uint32_t* pCode;
+    const int32_t* pConstants;
+    Fixed registers[SCRIPT_REGISTERS];
+    uint16_t nPc;
+    uint8_t nState;
+    uint8_t nFault;
+    uint8_t nProgram;
+    uint32_t nStart;
+    uint32_t nWake;
+    uint32_t nInstructions;
+    uint32_t nSlices;
+};
+
+#endif
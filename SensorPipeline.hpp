@@ -0,0 +1,464 @@
+///
+/// @author   GUSTAVO CAMPOS
+/// @author   GUSTAVO CAMPOS
+/// @date   28/05/2019 19:44
+/// @version  <#version#>
+///
+/// @copyright  (c) GUSTAVO CAMPOS, 2019
+/// @copyright  Licence
+///
+/// @see    ReadMe.txt for references
+///
+//               GNU GENERAL PUBLIC LICENSE
+//                Version 3, 29 June 2007
+//
+// Copyright (C) 2007 Free Software Foundation, Inc. <https://fsf.org/>
+// Everyone is permitted to copy and distribute verbatim copies
+// of this license document, but changing it is not allowed.
+//
+// Preamble
+//
+// The GNU General Public License is a free, copyleft license for
+// software and other kinds of works.
+//
+// The licenses for most software and other practical works are designed
+// to take away your freedom to share and change the works.  By contrast,
+// the GNU General Public License is intended to guarantee your freedom to
+// share and change all versions of a program--to make sure it remains free
+// software for all its users.  We, the Free Software Foundation, use the
+// GNU General Public License for most of our software; it applies also to
+// any other work released this way by its authors.  You can apply it to
+// your programs, too.
+//
+// See LICENSE file for the complete information
+
+#ifndef SENSOR_PIPELINE_HPP
+#define SENSOR_PIPELINE_HPP
+
+#include "Arduino.h"
+#include "CorePartition.h"
+
+#include "FixedPoint.hpp"
+#include "Ring.hpp"
+#include "Simulation.hpp"
+
+/// Sensor acquisition pipeline
+///
+/// Producers (a sensor thread, an ISR or the simulation) push raw
+/// samples into a single producer / single consumer ring per channel,
+/// no locks, only the head and tail indexes are shared. The consumer
+/// drains the rings into three aggregate tiers, 1s, 1min and 10min,
+/// each a ring of min/max/avg buckets. A closing bucket feeds the next
+/// tier, so every sample costs O(1) no matter how long the history.
+///
+/// Readers pick the tier that fits the span and number of points they
+/// want to draw and copy at most that many buckets.
+
+#ifndef SENSOR_RAW_SAMPLES
+#define SENSOR_RAW_SAMPLES 32 // power of two
+#endif
+
+#ifndef SENSOR_TIER_SECONDS
+#define SENSOR_TIER_SECONDS 60 // 1s buckets, one minute
+#endif
+
+#ifndef SENSOR_TIER_MINUTES
+#define SENSOR_TIER_MINUTES 60 // 1min buckets, one hour
+#endif
+
+#ifndef SENSOR_TIER_TEN_MINUTES
+#define SENSOR_TIER_TEN_MINUTES 36 // 10min buckets, six hours
+#endif
+
+#define SENSOR_TIERS 3
+
+#define SENSOR_CHANNELS SIMULATION_VESSELS
+
+struct Sample
+{
+    uint32_t nTime; // seconds
+    Fixed nValue;
+};
+
+/// Closed bucket, empty when nMin > nMax
+struct Aggregate
+{
+    Fixed nMin;
+    Fixed nMax;
+    Fixed nAvg;
+
+    bool IsEmpty () const
+    {
+        return nMin > nMax;
+    }
+};
+
+/// Open bucket, or a closed one travelling to the next tier
+struct Partial
+{
+    Fixed nMin;
+    Fixed nMax;
+    int64_t nSum; // raw Fixed
+    uint32_t nCount;
+
+    void Clear ()
+    {
+        nMin = Fixed::FromRaw (INT32_MAX);
+        nMax = Fixed::FromRaw (INT32_MIN);
+        nSum = 0;
+        nCount = 0;
+    }
+
+    void Merge (const Partial& other)
+    {
+        if (other.nMin < nMin) nMin = other.nMin;
+        if (other.nMax > nMax) nMax = other.nMax;
+
+        nSum += other.nSum;
+        nCount += other.nCount;
+    }
+};
+
+class AggregateTier
+{
+public:
+    AggregateTier (uint32_t nResolution, Aggregate* pBuckets, uint16_t nSize) : nResolution (nResolution), pBuckets (pBuckets), nSize (nSize)
+    {
+        Reset ();
+    }
+
+    void Reset ()
+    {
+        nHead = 0;
+        nStored = 0;
+        nOpenTime = 0;
+        bOpen = false;
+        open.Clear ();
+    }
+
+    /// Accumulates into the bucket covering nTime, returns true when
+    /// that closed the previous bucket, copied to closed/nClosedTime
+    bool Add (uint32_t nTime, const Partial& partial, Partial& closed, uint32_t& nClosedTime)
+    {
+        uint32_t nStart = nTime - nTime % nResolution;
+        bool bClosed = false;
+
+        if (bOpen && nStart < nOpenTime)
+        {
+            Reset ();
+        }
+
+        if (bOpen == false)
+        {
+            nOpenTime = nStart;
+            bOpen = true;
+        }
+        else if (nStart > nOpenTime)
+        {
+            closed = open;
+            nClosedTime = nOpenTime;
+            bClosed = true;
+
+            Store (open);
+
+            // Gaps become empty buckets, at most a full ring of them
+            uint32_t nGap = (nStart - nOpenTime) / nResolution - 1;
+
+            if (nGap > nSize) nGap = nSize;
+
+            open.Clear ();
+
+            while (nGap-- > 0)
+            {
+                Store (open);
+            }
+
+            nOpenTime = nStart;
+        }
+
+        open.Merge (partial);
+
+        return bClosed;
+    }
+
+    /// Copies the newest nPoints closed buckets, oldest first
+    uint16_t Read (Aggregate* pOut, uint16_t nPoints) const
+    {
+        if (nPoints > nStored) nPoints = nStored;
+
+        uint16_t nIndex = (nHead + nSize - nPoints) % nSize;
+
+        for (uint16_t nCount = 0; nCount < nPoints; nCount++)
+        {
+            pOut[nCount] = pBuckets[nIndex];
+            nIndex = nIndex + 1 == nSize ? 0 : nIndex + 1;
+        }
+
+        return nPoints;
+    }
+
+    uint32_t GetResolution () const
+    {
+        return nResolution;
+    }
+
+    uint16_t GetSize () const
+    {
+        return nSize;
+    }
+
+    uint16_t GetStored () const
+    {
+        return nStored;
+    }
+
+    const Partial& GetOpen () const
+    {
+        return open;
+    }
+
+private:
+    void Store (const Partial& partial)
+    {
+        Aggregate& bucket = pBuckets[nHead];
+
+        bucket.nMin = partial.nMin;
+        bucket.nMax = partial.nMax;
+        bucket.nAvg = partial.nCount > 0 ? Fixed::FromRaw ((int32_t)(partial.nSum / (int64_t)partial.nCount)) : Fixed (0);
+
+        nHead = nHead + 1 == nSize ? 0 : nHead + 1;
+        if (nStored < nSize) nStored++;
+    }
+
+    uint32_t nResolution;
+    Aggregate* pBuckets;
+    uint16_t nSize;
+
+    uint16_t nHead;
+    uint16_t nStored;
+    uint32_t nOpenTime;
+    bool bOpen;
+    Partial open;
+};
+
+class SensorChannel
+{
+public:
+    SensorChannel () : tiers{AggregateTier (1, seconds, SENSOR_TIER_SECONDS), AggregateTier (60, minutes, SENSOR_TIER_MINUTES), AggregateTier (600, tenMinutes, SENSOR_TIER_TEN_MINUTES)}, nSamples (0)
+    {
+        last.nTime = 0;
+        last.nValue = Fixed (0);
+    }
+
+    /// Producer side
+    bool Push (uint32_t nTime, Fixed nValue)
+    {
+        Sample sample = {nTime, nValue};
+
+        return raw.Push (sample);
+    }
+
+    /// Consumer side, drains the raw ring into the tiers
+    void Process ()
+    {
+        Sample sample;
+
+        while (raw.Pop (sample))
+        {
+            Partial partial;
+            Partial closed;
+            uint32_t nTime = sample.nTime;
+            uint32_t nClosedTime;
+
+            partial.nMin = partial.nMax = sample.nValue;
+            partial.nSum = sample.nValue.Raw ();
+            partial.nCount = 1;
+
+            for (uint8_t nTier = 0; nTier < SENSOR_TIERS; nTier++)
+            {
+                if (tiers[nTier].Add (nTime, partial, closed, nClosedTime) == false || closed.nCount == 0) break;
+
+                partial = closed;
+                nTime = nClosedTime;
+            }
+
+            last = sample;
+            nSamples++;
+        }
+    }
+
+    void Reset ()
+    {
+        for (uint8_t nTier = 0; nTier < SENSOR_TIERS; nTier++)
+        {
+            tiers[nTier].Reset ();
+        }
+    }
+
+    /// Picks the finest tier where nSpan seconds fit in nPoints buckets
+    /// and the history reaches back far enough
+    const AggregateTier& SelectTier (uint32_t nSpan, uint16_t nPoints) const
+    {
+        for (uint8_t nTier = 0; nTier < SENSOR_TIERS - 1; nTier++)
+        {
+            const AggregateTier& tier = tiers[nTier];
+
+            if (nSpan / tier.GetResolution () <= nPoints && nSpan / tier.GetResolution () <= tier.GetSize ()) return tier;
+        }
+
+        return tiers[SENSOR_TIERS - 1];
+    }
+
+    /// Newest buckets covering nSpan seconds, at most nPoints, oldest
+    /// first; nResolution receives the bucket width
+    uint16_t Read (uint32_t nSpan, Aggregate* pOut, uint16_t nPoints, uint32_t& nResolution) const
+    {
+        const AggregateTier& tier = SelectTier (nSpan, nPoints);
+        uint32_t nBuckets = nSpan / tier.GetResolution ();
+
+        if (nBuckets == 0) nBuckets = 1;
+        if (nBuckets < nPoints) nPoints = (uint16_t)nBuckets;
+
+        nResolution = tier.GetResolution ();
+
+        return tier.Read (pOut, nPoints);
+    }
+
+    const AggregateTier& GetTier (uint8_t nTier) const
+    {
+        return tiers[nTier % SENSOR_TIERS];
+    }
+
+    const Sample& GetLast () const
+    {
+        return last;
+    }
+
+    uint32_t GetSamples () const
+    {
+        return nSamples;
+    }
+
+    uint32_t GetDropped () const
+    {
+        return raw.GetDropped ();
+    }
+
+private:
+    LockFreeRing<Sample, SENSOR_RAW_SAMPLES> raw;
+
+    Aggregate seconds[SENSOR_TIER_SECONDS];
+    Aggregate minutes[SENSOR_TIER_MINUTES];
+    Aggregate tenMinutes[SENSOR_TIER_TEN_MINUTES];
+
+    AggregateTier tiers[SENSOR_TIERS];
+
+    Sample last;
+    uint32_t nSamples;
+};
+
+SensorChannel sensorChannels[SENSOR_CHANNELS];
+
+/// Acquisition source, the simulated vessel temperatures; a real probe
+/// driver replaces this function
+Fixed Sensor_Read (uint8_t nChannel)
+{
+    return simulation.Vessel (nChannel).nTemperature;
+}
+
+uint32_t Sensor_GetTime ()
+{
+    return simulation.GetTime ();
+}
+
+void Sensor_Show (Stream& client)
+{
+    client.println (F ("Ch\tLast C\tTime s\tSamples\tDropped\t1s\t1min\t10min"));
+
+    for (uint8_t nCount = 0; nCount < SENSOR_CHANNELS; nCount++)
+    {
+        SensorChannel& channel = sensorChannels[nCount];
+
+        client.printf ("%u\t", nCount);
+        PrintCenti (client, channel.GetLast ().nValue);
+        client.printf ("\t%u\t%u\t%u\t%u\t%u\t%u\r\n",
+                       channel.GetLast ().nTime,
+                       channel.GetSamples (),
+                       channel.GetDropped (),
+                       channel.GetTier (0).GetStored (),
+                       channel.GetTier (1).GetStored (),
+                       channel.GetTier (2).GetStored ());
+    }
+}
+
+void Sensor_ShowHistory (Stream& client, uint8_t nChannel, uint32_t nSpan, uint16_t nPoints)
+{
+    // Static, thread stacks are small
+    static Aggregate buckets[SENSOR_TIER_SECONDS];
+    uint32_t nResolution;
+
+    if (nPoints > SENSOR_TIER_SECONDS) nPoints = SENSOR_TIER_SECONDS;
+
+    uint16_t nRead = sensorChannels[nChannel % SENSOR_CHANNELS].Read (nSpan, buckets, nPoints, nResolution);
+
+    client.printf ("Channel %u, %u buckets of %us\r\n", nChannel, nRead, nResolution);
+    client.println (F ("#\tMin\tMax\tAvg"));
+
+    for (uint16_t nCount = 0; nCount < nRead; nCount++)
+    {
+        client.printf ("%u\t", nCount);
+
+        if (buckets[nCount].IsEmpty ())
+        {
+            client.println (F ("-"));
+            continue;
+        }
+
+        PrintCenti (client, buckets[nCount].nMin);
+        client.print (F ("\t"));
+        PrintCenti (client, buckets[nCount].nMax);
+        client.print (F ("\t"));
+        PrintCenti (client, buckets[nCount].nAvg);
+        client.println ();
+    }
+}
+
+/// Samples every channel once per second of plant time and drains the
+/// rings; at high simulation speeds the skipped seconds show as empty
+/// buckets
+void Thread_Sensors (void* pValue)
+{
+    uint32_t nLast = Sensor_GetTime ();
+
+    while (true)
+    {
+        uint32_t nNow = Sensor_GetTime ();
+
+        if (nNow < nLast)
+        {
+            for (uint8_t nCount = 0; nCount < SENSOR_CHANNELS; nCount++)
+            {
+                sensorChannels[nCount].Reset ();
+            }
+        }
+
+        if (nNow != nLast)
+        {
+            for (uint8_t nCount = 0; nCount < SENSOR_CHANNELS; nCount++)
+            {
+                sensorChannels[nCount].Push (nNow, Sensor_Read (nCount));
+            }
+
+            nLast = nNow;
+        }
+
+        for (uint8_t nCount = 0; nCount < SENSOR_CHANNELS; nCount++)
+        {
+            sensorChannels[nCount].Process ();
+        }
+
+        CorePartition_Yield ();
+    }
+}
+
+#endif
@@ -0,0 +1,334 @@
+///
+/// @author   GUSTAVO CAMPOS
+/// @author   GUSTAVO CAMPOS
+/// @date   28/05/2019 19:44
+/// @version  <#version#>
+///
+/// @copyright  (c) GUSTAVO CAMPOS, 2019
+/// @copyright  Licence
+///
+/// @see    ReadMe.txt for references
+///
+//               GNU GENERAL PUBLIC LICENSE
+//                Version 3, 29 June 2007
+//
+// Copyright (C) 2007 Free Software Foundation, Inc. <https://fsf.org/>
+// Everyone is permitted to copy and distribute verbatim copies
+// of this license document, but changing it is not allowed.
+//
+// Preamble
+//
+// The GNU General Public License is a free, copyleft license for
+// software and other kinds of works.
+//
+// The licenses for most software and other practical works are designed
+// to take away your freedom to share and change the works.  By contrast,
+// the GNU General Public License is intended to guarantee your freedom to
+// share and change all versions of a program--to make sure it remains free
+// software for all its users.  We, the Free Software Foundation, use the
+// GNU General Public License for most of our software; it applies also to
+// any other work released this way by its authors.  You can apply it to
+// your programs, too.
+//
+// See LICENSE file for the complete information
+
+#ifndef SIMULATION_HPP
+#define SIMULATION_HPP
+
+#include "Arduino.h"
+#include "CorePartition.h"
+
+#include "FixedPoint.hpp"
+#include "VesselModel.hpp"
+#include "PlantGraph.hpp"
+#include "EventSimulation.hpp"
+#include "Fermentation.hpp"
+#include "BinaryLog.hpp"
+
+/// Device side of the simulation: the Fixed instance, its thread
+/// and terminal output. The model itself lives in VesselModel.hpp
+/// so host tools can instantiate it without the device runtime.
+
+/// Max steps per thread slice, keeps the terminal responsive
+#ifndef SIMULATION_BUDGET
+#define SIMULATION_BUDGET 64
+#endif
+
+/// Event mode: simulated seconds per slice at max speed, and the
+/// sleep between slices, spans are exact so slices can be long
+#ifndef SIMULATION_HORIZON
+#define SIMULATION_HORIZON 3600
+#endif
+
+#ifndef SIMULATION_EVENT_MS
+#define SIMULATION_EVENT_MS 100
+#endif
+
+/// Pipes, pumps and valves between the vessels, stepped with them
+PlantGraph<Fixed> plant;
+
+Simulation<Fixed> simulation (&plant);
+
+EventSimulation<Fixed> simulationEvents (simulation);
+
+/// Event driven instead of fixed steps, see EventSimulation.hpp
+bool bSimulationEvents = false;
+
+/// Simulated seconds between kinetics updates, event mode slices are
+/// longer and couple once per slice
+#ifndef FERMENTATION_COUPLING
+#define FERMENTATION_COUPLING 60
+#endif
+
+/// Yeast kinetics of the fermenter, owns its extra power once pitched
+Fermentation<Fixed> fermentation;
+
+uint32_t nFermentationTime = 0;
+
+/// Pacing, 1 is real time, N runs N times faster and 0 runs as fast
+/// as the slice budget allows, decoupled from millis()
+uint32_t nSimulationSpeed = 1;
+
+/// Slices that could not keep up with the requested speed
+uint32_t nSimulationLagging = 0;
+
+/// Prints a value with two decimals without floating point
+template <typename Number>
+void PrintCenti (Stream& client, Number nValue)
+{
+    int32_t nCenti = ToCenti (nValue);
+
+    client.printf ("%s%d.%02d", nCenti < 0 ? "-" : "", (int)(Abs (nCenti) / 100), (int)(Abs (nCenti) % 100));
+}
+
+void Simulation_Show (Stream& client)
+{
+    static const char* const vesselNames[] = {"Mash", "Boil", "Ferment"};
+
+    client.printf ("Simulated time: %us, speed: ", simulation.GetTime ());
+
+    if (nSimulationSpeed == 0)
+        client.print (F ("max"));
+    else
+        client.printf ("%ux", nSimulationSpeed);
+
+    client.printf (", lagging: %u, steps: %u, step cost: %uus, max slice: %uus\r\n",
+                   nSimulationLagging,
+                   simulation.GetSteps (),
+                   simulation.GetLastStepCost (),
+                   simulation.GetMaxSliceCost ());
+
+    client.printf ("Mode: %s, events: %u pending, %u run, %u dropped, crossings: %u, spans: %u\r\n",
+                   bSimulationEvents ? "event" : "step",
+                   simulationEvents.GetCount (),
+                   simulationEvents.GetProcessed (),
+                   simulationEvents.GetDropped (),
+                   simulationEvents.GetCrossings (),
+                   simulationEvents.GetSpans ());
+
+    client.println (F ("Vessel\t\tTemp C\tVol L\tDuty\tkW\tBoiled\tMJ"));
+
+    for (uint8_t nCount = 0; nCount < SIMULATION_VESSELS; nCount++)
+    {
+        VesselState<Fixed>& vessel = simulation.Vessel (nCount);
+
+        client.printf ("%u %-8s\t", nCount, vesselNames[nCount % 3]);
+        PrintCenti (client, vessel.nTemperature);
+        client.print (F ("\t"));
+        PrintCenti (client, vessel.nVolume);
+        client.print (F ("\t"));
+        PrintCenti (client, vessel.nDuty);
+        client.print (F ("\t"));
+        PrintCenti (client, simulation.Params (nCount).nHeaterPower);
+        client.print (F ("\t"));
+        PrintCenti (client, vessel.nEvaporated);
+        client.print (F ("\t"));
+        PrintCenti (client, vessel.nEnergy);
+        client.println ();
+    }
+
+    if (fermentation.IsActive () == false) return;
+
+    const Rk23<Fixed, Fermentation<Fixed>::FERMENTATION_SIZE>& solver = fermentation.Solver ();
+
+    client.print (F ("Fermentation: gravity "));
+    PrintCenti (client, fermentation.GetGravity ());
+    client.print (F (" pts, abv "));
+    PrintCenti (client, fermentation.GetAbv ());
+    client.print (F ("%, yeast "));
+    PrintCenti (client, fermentation.GetYeast ());
+    client.print (F (" g/L, CO2 "));
+    PrintCenti (client, fermentation.GetCo2 ());
+    client.print (F (" g/L, heat "));
+    PrintCenti (client, fermentation.GetHeat () * Fixed (1000));
+    client.println (F (" W"));
+
+    client.printf ("Kinetics: %u steps, %u rejected, %u forced, %u evaluations, error last/max ", solver.GetSteps (), solver.GetRejects (), solver.GetForced (), solver.GetEvaluations ());
+    PrintCenti (client, solver.GetLastError ());
+    client.print (F (" / "));
+    PrintCenti (client, solver.GetMaxError ());
+    client.print (F (", step "));
+    PrintCenti (client, solver.GetStep ());
+    client.println (F (" h"));
+}
+
+void Plant_Show (Stream& client)
+{
+    static const char* const vesselNames[] = {"mash", "boil", "ferment"};
+    const PlantSolver<Fixed>& solver = plant.Solver ();
+
+    client.printf ("Plant: %u junctions, %u links, %s\r\n", plant.GetJunctions (), plant.GetLinks (), plant.IsActive () ? "flowing" : "closed");
+    client.printf ("Solver: %u analyses, %u factorizations, %u rank one updates, %u solves, %u entries, %u factors, %u cut off\r\n",
+                   plant.GetAnalyses (),
+                   plant.GetFactorizations (),
+                   plant.GetRankUpdates (),
+                   plant.GetSolves (),
+                   solver.GetEntries (),
+                   solver.GetFactors (),
+                   solver.GetSingular ());
+    client.printf ("Step cost last/max: %u / %uus, dry blocks: %u\r\n", plant.GetLastCost (), plant.GetMaxCost (), plant.GetBlocks ());
+
+    client.println (F ("Node		Head m	Temp C"));
+
+    for (uint8_t nNode = 0; nNode < SIMULATION_VESSELS + plant.GetJunctions (); nNode++)
+    {
+        if (nNode < SIMULATION_VESSELS)
+            client.printf ("%u %-8s\t", nNode, vesselNames[nNode % 3]);
+        else
+            client.printf ("%u junction\t", nNode);
+
+        PrintCenti (client, plant.GetHead (&simulation.Vessel (0), nNode));
+        client.print (F ("\t"));
+        PrintCenti (client, nNode < SIMULATION_VESSELS ? simulation.Vessel (nNode).nTemperature : plant.Junction (nNode - SIMULATION_VESSELS).nTemperature);
+        client.println ();
+    }
+
+    client.println (F ("Link	From	To	Valve	Pump	L/min"));
+
+    for (uint8_t nLink = 0; nLink < plant.GetLinks (); nLink++)
+    {
+        const PlantLink<Fixed>& link = plant.Link (nLink);
+
+        client.printf ("%u\t%u\t%u\t", nLink, link.nFrom, link.nTo);
+        PrintCenti (client, link.nValve * Fixed (100));
+        client.print (F ("\t"));
+
+        if (link.nHead == Fixed (0))
+            client.print (F ("-"));
+        else
+            PrintCenti (client, link.nPump * Fixed (100));
+
+        client.print (F ("\t"));
+        PrintCenti (client, link.nFlow * Fixed (60));
+        client.println (link.bBlocked ? F ("\tdry") : F (""));
+    }
+}
+
+/// Advances the kinetics to the simulated time at the fermenter
+/// temperature, the heat released drives the fermenter until the
+/// next update
+void Simulation_Ferment ()
+{
+    uint32_t nTime = simulation.GetTime ();
+
+    // The simulation was reset
+    if (nTime < nFermentationTime) nFermentationTime = nTime;
+
+    if (nTime - nFermentationTime < FERMENTATION_COUPLING) return;
+
+    VesselState<Fixed>& fermenter = simulation.Vessel (VESSEL_FERMENTER);
+
+    if (fermentation.IsActive ()) fermenter.nExtraPower = fermentation.Advance (nTime - nFermentationTime, fermenter.nTemperature, fermenter.nVolume);
+
+    nFermentationTime = nTime;
+}
+
+/// Simulation thread, steps paced by the real time clock times the
+/// speed, a backlog beyond a few slices is dropped and counted. In
+/// event mode it integrates to the paced time once per
+/// SIMULATION_EVENT_MS and sleeps, at max speed it jumps
+/// SIMULATION_HORIZON seconds per slice. While the plant flows the
+/// event mode steps too, SIMULATION_BUDGET per slice like the fixed
+/// step mode, and yields until it has caught up.
+void Thread_Simulation (void* pValue)
+{
+    const uint32_t nStepMs = Simulation<Fixed>::nStepSeconds * 1000;
+    uint32_t nLast = millis ();
+    uint32_t nPendingMs = 0;
+
+    LOG_INFO (LOG_SIMULATION_START, SIMULATION_VESSELS);
+
+    while (true)
+    {
+        uint32_t nNow = millis ();
+
+        Simulation_Ferment ();
+
+        if (bSimulationEvents)
+        {
+            bool bReached;
+
+            if (nSimulationSpeed == 0)
+            {
+                bReached = simulationEvents.Run (simulation.GetTime () + SIMULATION_HORIZON, SIMULATION_BUDGET);
+                nPendingMs = 0;
+            }
+            else
+            {
+                uint32_t nStart = simulation.GetTime ();
+
+                nPendingMs += (nNow - nLast) * nSimulationSpeed;
+                bReached = simulationEvents.Run (nStart + nPendingMs / 1000, SIMULATION_BUDGET);
+                nPendingMs -= (simulation.GetTime () - nStart) * 1000;
+
+                // Only the stepped spans fall behind, exact ones always reach
+                if (bReached == false && nPendingMs / 1000 > SIMULATION_BUDGET * 4)
+                {
+                    nSimulationLagging++;
+                    nPendingMs = SIMULATION_BUDGET * 4 * 1000;
+                }
+            }
+
+            nLast = nNow;
+
+            if (bReached)
+                CorePartition_Sleep (SIMULATION_EVENT_MS);
+            else
+                CorePartition_Yield ();
+
+            continue;
+        }
+
+        if (nSimulationSpeed == 0)
+        {
+            simulation.Run (SIMULATION_BUDGET);
+            nPendingMs = 0;
+        }
+        else
+        {
+            nPendingMs += (nNow - nLast) * nSimulationSpeed;
+
+            uint32_t nDue = nPendingMs / nStepMs;
+
+            if (nDue > SIMULATION_BUDGET * 4)
+            {
+                nSimulationLagging++;
+                nDue = SIMULATION_BUDGET * 4;
+                nPendingMs = nDue * nStepMs;
+            }
+
+            if (nDue > 0)
+            {
+                uint32_t nRun = simulation.Run (nDue > SIMULATION_BUDGET ? SIMULATION_BUDGET : nDue);
+
+                nPendingMs -= nRun * nStepMs;
+            }
+        }
+
+        nLast = nNow;
+
+        CorePartition_Yield ();
+    }
+}
+
+#endif
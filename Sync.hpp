@@ -0,0 +1,622 @@
+///
+/// @author   GUSTAVO CAMPOS
+/// @author   GUSTAVO CAMPOS
+/// @date   28/05/2019 19:44
+/// @version  <#version#>
+///
+/// @copyright  (c) GUSTAVO CAMPOS, 2019
+/// @copyright  Licence
+///
+/// @see    ReadMe.txt for references
+///
+//               GNU GENERAL PUBLIC LICENSE
+//                Version 3, 29 June 2007
+//
+// Copyright (C) 2007 Free Software Foundation, Inc. <https://fsf.org/>
+// Everyone is permitted to copy and distribute verbatim copies
+// of this license document, but changing it is not allowed.
+//
+// Preamble
+//
+// The GNU General Public License is a free, copyleft license for
+// software and other kinds of works.
+//
+// The licenses for most software and other practical works are designed
+// to take away your freedom to share and change the works.  By contrast,
+// the GNU General Public License is intended to guarantee your freedom to
+// share and change all versions of a program--to make sure it remains free
+// software for all its users.  We, the Free Software Foundation, use the
+// GNU General Public License for most of our software; it applies also to
+// any other work released this way by its authors.  You can apply it to
+// your programs, too.
+//
+// See LICENSE file for the complete information
+
+#ifndef SYNC_HPP
+#define SYNC_HPP
+
+#include "Arduino.h"
+#include "CorePartition.h"
+
+/// Cooperative synchronization for CorePartition threads
+///
+/// Mutex, counting semaphore, event flags and condition variable. A
+/// thread that has to wait is parked with CorePartition_Wait, the
+/// scheduler skips it entirely, and the thread that releases it wakes
+/// it with CorePartition_NotifyOne; nothing polls.
+///
+/// CorePartition copies a parked thread's stack out, so the waiter
+/// records can not live there: they are a static table indexed by
+/// thread ID, and each primitive queues its waiters in FIFO order as a
+/// list of IDs through it. A released mutex or semaphore unit is
+/// handed straight to the first waiter, a thread that did not wait
+/// can not overtake one that did.
+///
+/// A timed wait parks the same way with a deadline. Sync_Expire wakes
+/// the waiters past it with a timeout; every primitive calls it and
+/// so does the idle hook, which also shortens its sleep to the
+/// nearest deadline (Sync_Idle).
+///
+/// Scheduling is cooperative, so no atomics are needed; none of it may
+/// be used from an interrupt. Outside a thread (setup, the idle hook)
+/// only the calls that never wait are allowed, or a timeout of 0.
+
+#ifndef SYNC_THREADS
+#define SYNC_THREADS 16
+#endif
+
+#define SYNC_FOREVER 0xFFFFFFFF
+#define SYNC_NONE 0xFF
+
+enum SyncResult : uint8_t
+{
+    SYNC_WAITING = 0,
+    SYNC_SIGNALED,
+    SYNC_TIMEOUT
+};
+
+enum SyncType : uint8_t
+{
+    SYNC_MUTEX = 0,
+    SYNC_SEMAPHORE,
+    SYNC_EVENT,
+    SYNC_CONDITION
+};
+
+static const char syncTypeNames[][10] = {"mutex", "semaphore", "event", "condition"};
+
+/// Event wait options
+#define SYNC_EVENT_ALL 0x01
+#define SYNC_EVENT_CLEAR 0x02
+
+/// Waiter flags
+#define SYNC_WAITER_TIMED 0x80
+
+class SyncQueue;
+
+/// One per thread, valid while pQueue is set
+struct SyncWaiter
+{
+    SyncQueue* pQueue;
+    uint32_t nDeadline;
+    uint32_t nBits;
+    uint8_t nNext;
+    uint8_t nResult;
+    uint8_t nFlags;
+};
+
+SyncWaiter syncWaiters[SYNC_THREADS];
+
+/// Timed waiters parked now, Sync_Expire does nothing without them
+uint8_t nSyncTimed = 0;
+
+/// Every primitive, for the "sync" command
+SyncQueue* pSyncFirst = NULL;
+
+struct SyncStats
+{
+    uint32_t nAcquired;  // locks, takes and waits that succeeded
+    uint32_t nContended; // of all attempts, the ones that had to wait
+    uint32_t nTimeouts;
+    uint32_t nWaitMs;    // total time parked
+    uint32_t nMaxWaitMs;
+    uint8_t nWaiting;
+    uint8_t nMaxWaiting;
+};
+
+/// Wait queue shared by all the primitives
+class SyncQueue
+{
+public:
+    SyncQueue (const char* pszQueueName, SyncType nQueueType) : pszName (pszQueueName), pNext (pSyncFirst), nHead (SYNC_NONE), nTail (SYNC_NONE), nType (nQueueType)
+    {
+        memset (&stats, 0, sizeof (stats));
+        pSyncFirst = this;
+    }
+
+    const char* GetName () const
+    {
+        return pszName;
+    }
+
+    SyncType GetType () const
+    {
+        return (SyncType)nType;
+    }
+
+    const SyncStats& GetStats () const
+    {
+        return stats;
+    }
+
+    SyncQueue* GetNext () const
+    {
+        return pNext;
+    }
+
+    bool HasWaiters () const
+    {
+        return nHead != SYNC_NONE;
+    }
+
+    /// Takes nID out of the queue with nResult and wakes it
+    void Wake (uint8_t nID, uint8_t nResult)
+    {
+        SyncWaiter& waiter = syncWaiters[nID];
+
+        Remove (nID);
+
+        waiter.nResult = nResult;
+        CorePartition_NotifyOne (&waiter);
+    }
+
+protected:
+    /// Parks the calling thread at the tail until woken or nTimeout ms
+    /// @return SYNC_SIGNALED or SYNC_TIMEOUT
+    uint8_t Park (uint32_t nTimeout, uint32_t nBits = 0, uint8_t nFlags = 0)
+    {
+        size_t nID = CorePartition_GetID ();
+
+        if (nTimeout == 0 || nID >= SYNC_THREADS)
+        {
+            stats.nTimeouts++;
+            return SYNC_TIMEOUT;
+        }
+
+        SyncWaiter& waiter = syncWaiters[nID];
+        uint32_t nStart = millis ();
+
+        waiter.pQueue = this;
+        waiter.nDeadline = nStart + nTimeout;
+        waiter.nBits = nBits;
+        waiter.nNext = SYNC_NONE;
+        waiter.nResult = SYNC_WAITING;
+        waiter.nFlags = nFlags;
+
+        if (nTimeout != SYNC_FOREVER)
+        {
+            waiter.nFlags |= SYNC_WAITER_TIMED;
+            nSyncTimed++;
+        }
+
+        if (nTail == SYNC_NONE)
+            nHead = (uint8_t)nID;
+        else
+            syncWaiters[nTail].nNext = (uint8_t)nID;
+
+        nTail = (uint8_t)nID;
+
+        if (++stats.nWaiting > stats.nMaxWaiting) stats.nMaxWaiting = stats.nWaiting;
+
+        while (waiter.nResult == SYNC_WAITING)
+        {
+            // Also covers a wake that was not ours
+            if ((waiter.nFlags & SYNC_WAITER_TIMED) && (int32_t)(millis () - waiter.nDeadline) >= 0)
+            {
+                Remove ((uint8_t)nID);
+                waiter.nResult = SYNC_TIMEOUT;
+                break;
+            }
+
+            CorePartition_Wait (&waiter);
+        }
+
+        uint32_t nWaited = millis () - nStart;
+
+        stats.nWaitMs += nWaited;
+        if (nWaited > stats.nMaxWaitMs) stats.nMaxWaitMs = nWaited;
+        if (waiter.nResult == SYNC_TIMEOUT) stats.nTimeouts++;
+
+        return waiter.nResult;
+    }
+
+    uint8_t First () const
+    {
+        return nHead;
+    }
+
+    void Remove (uint8_t nID)
+    {
+        SyncWaiter& waiter = syncWaiters[nID];
+        uint8_t nPrevious = SYNC_NONE;
+
+        if (waiter.pQueue != this) return;
+
+        for (uint8_t nCurrent = nHead; nCurrent != nID; nCurrent = syncWaiters[nCurrent].nNext)
+        {
+            if (nCurrent == SYNC_NONE) return;
+            nPrevious = nCurrent;
+        }
+
+        if (nPrevious == SYNC_NONE)
+            nHead = waiter.nNext;
+        else
+            syncWaiters[nPrevious].nNext = waiter.nNext;
+
+        if (nTail == nID) nTail = nPrevious;
+
+        if (waiter.nFlags & SYNC_WAITER_TIMED) nSyncTimed--;
+
+        waiter.pQueue = NULL;
+        waiter.nNext = SYNC_NONE;
+        stats.nWaiting--;
+    }
+
+    SyncStats stats;
+
+private:
+    const char* pszName;
+    SyncQueue* pNext;
+    uint8_t nHead;
+    uint8_t nTail;
+    uint8_t nType;
+};
+
+/// Wakes every timed waiter past its deadline
+/// @return how many it woke
+uint8_t Sync_Expire ()
+{
+    uint8_t nWoken = 0;
+
+    if (nSyncTimed == 0) return 0;
+
+    uint32_t nNow = millis ();
+
+    for (uint8_t nID = 0; nID < SYNC_THREADS; nID++)
+    {
+        SyncWaiter& waiter = syncWaiters[nID];
+
+        if (waiter.pQueue != NULL && (waiter.nFlags & SYNC_WAITER_TIMED) && (int32_t)(nNow - waiter.nDeadline) >= 0)
+        {
+            waiter.pQueue->Wake (nID, SYNC_TIMEOUT);
+            nWoken++;
+        }
+    }
+
+    return nWoken;
+}
+
+/// For the idle hook: expires what is due and returns how long it may
+/// sleep, nSleepTime or less when a timed wait ends earlier, 0 when
+/// it just woke a thread
+uint32_t Sync_Idle (uint32_t nSleepTime)
+{
+    if (Sync_Expire () > 0) return 0;
+
+    if (nSyncTimed == 0) return nSleepTime;
+
+    uint32_t nNow = millis ();
+
+    for (uint8_t nID = 0; nID < SYNC_THREADS; nID++)
+    {
+        const SyncWaiter& waiter = syncWaiters[nID];
+
+        if (waiter.pQueue != NULL && (waiter.nFlags & SYNC_WAITER_TIMED) && waiter.nDeadline - nNow < nSleepTime)
+        {
+            nSleepTime = waiter.nDeadline - nNow;
+        }
+    }
+
+    return nSleepTime;
+}
+
+/// Owned by one thread at a time, recursive for its owner
+class SyncMutex : public SyncQueue
+{
+public:
+    SyncMutex (const char* pszName) : SyncQueue (pszName, SYNC_MUTEX), nOwner (SYNC_NONE), nDepth (0)
+    {
+    }
+
+    /// @return false after nTimeout ms without the lock
+    bool Lock (uint32_t nTimeout = SYNC_FOREVER)
+    {
+        size_t nID = CorePartition_GetID ();
+
+        Sync_Expire ();
+
+        // Nothing outside a thread can own it
+        if (nID >= SYNC_THREADS) return false;
+
+        if (nOwner == SYNC_NONE || nOwner == nID)
+        {
+            nOwner = (uint8_t)nID;
+            nDepth++;
+            stats.nAcquired++;
+            return true;
+        }
+
+        stats.nContended++;
+
+        // Unlock made us the owner before waking us
+        if (Park (nTimeout) != SYNC_SIGNALED) return false;
+
+        stats.nAcquired++;
+        return true;
+    }
+
+    bool TryLock ()
+    {
+        return Lock (0);
+    }
+
+    void Unlock ()
+    {
+        if (nOwner != (uint8_t)CorePartition_GetID () || --nDepth > 0) return;
+
+        HandOver ();
+    }
+
+    uint8_t GetOwner () const
+    {
+        return nOwner;
+    }
+
+    /// Gives the lock up whatever the depth, for SyncCondition
+    uint8_t Release ()
+    {
+        uint8_t nHeld = nDepth;
+
+        nDepth = 0;
+        HandOver ();
+
+        return nHeld;
+    }
+
+    /// Takes the lock back at the depth Release returned
+    void Acquire (uint8_t nHeld)
+    {
+        Lock ();
+        nDepth = nHeld;
+    }
+
+private:
+    void HandOver ()
+    {
+        nOwner = First ();
+
+        if (nOwner != SYNC_NONE)
+        {
+            nDepth = 1;
+            Wake (nOwner, SYNC_SIGNALED);
+        }
+    }
+
+    uint8_t nOwner;
+    uint8_t nDepth;
+};
+
+/// Counting semaphore, at most nMax units
+class SyncSemaphore : public SyncQueue
+{
+public:
+    SyncSemaphore (const char* pszName, uint16_t nInitial, uint16_t nMaximum) : SyncQueue (pszName, SYNC_SEMAPHORE), nCount (nInitial), nMax (nMaximum)
+    {
+    }
+
+    /// @return false after nTimeout ms without a unit
+    bool Take (uint32_t nTimeout = SYNC_FOREVER)
+    {
+        Sync_Expire ();
+
+        if (nCount > 0)
+        {
+            nCount--;
+            stats.nAcquired++;
+            return true;
+        }
+
+        stats.nContended++;
+
+        // Give handed its unit to us
+        if (Park (nTimeout) != SYNC_SIGNALED) return false;
+
+        stats.nAcquired++;
+        return true;
+    }
+
+    bool TryTake ()
+    {
+        return Take (0);
+    }
+
+    /// Safe outside a thread, never waits
+    /// @return false when already at the maximum
+    bool Give ()
+    {
+        if (HasWaiters ())
+        {
+            Wake (First (), SYNC_SIGNALED);
+            return true;
+        }
+
+        if (nCount >= nMax) return false;
+
+        nCount++;
+        return true;
+    }
+
+    uint16_t GetCount () const
+    {
+        return nCount;
+    }
+
+private:
+    uint16_t nCount;
+    uint16_t nMax;
+};
+
+/// 32 event flags, waiters choose any or all of a mask
+class SyncEvent : public SyncQueue
+{
+public:
+    SyncEvent (const char* pszName) : SyncQueue (pszName, SYNC_EVENT), nFlags (0)
+    {
+    }
+
+    /// @param nOptions SYNC_EVENT_ALL waits for every bit of nMask,
+    ///                 SYNC_EVENT_CLEAR consumes the bits it returns
+    /// @return the bits of nMask that were set, 0 on timeout
+    uint32_t Wait (uint32_t nMask, uint8_t nOptions = 0, uint32_t nTimeout = SYNC_FOREVER)
+    {
+        Sync_Expire ();
+
+        uint32_t nMatch = Match (nFlags, nMask, nOptions);
+
+        if (nMatch != 0)
+        {
+            if (nOptions & SYNC_EVENT_CLEAR) nFlags &= ~nMatch;
+            stats.nAcquired++;
+            return nMatch;
+        }
+
+        stats.nContended++;
+
+        if (Park (nTimeout, nMask, nOptions) != SYNC_SIGNALED) return 0;
+
+        stats.nAcquired++;
+
+        // Set left the matched bits in the waiter record
+        return syncWaiters[CorePartition_GetID ()].nBits;
+    }
+
+    /// Safe outside a thread, never waits
+    void Set (uint32_t nBits)
+    {
+        nFlags |= nBits;
+
+        for (uint8_t nID = First (); nID != SYNC_NONE && nFlags != 0;)
+        {
+            SyncWaiter& waiter = syncWaiters[nID];
+            uint8_t nNextID = waiter.nNext;
+            uint32_t nMatch = Match (nFlags, waiter.nBits, waiter.nFlags);
+
+            if (nMatch != 0)
+            {
+                if (waiter.nFlags & SYNC_EVENT_CLEAR) nFlags &= ~nMatch;
+
+                waiter.nBits = nMatch;
+                Wake (nID, SYNC_SIGNALED);
+            }
+
+            nID = nNextID;
+        }
+    }
+
+    void Clear (uint32_t nBits)
+    {
+        nFlags &= ~nBits;
+    }
+
+    uint32_t Get () const
+    {
+        return nFlags;
+    }
+
+private:
+    static uint32_t Match (uint32_t nSet, uint32_t nMask, uint8_t nOptions)
+    {
+        uint32_t nMatch = nSet & nMask;
+
+        return (nOptions & SYNC_EVENT_ALL) && nMatch != nMask ? 0 : nMatch;
+    }
+
+    uint32_t nFlags;
+};
+
+/// Condition variable over a SyncMutex
+class SyncCondition : public SyncQueue
+{
+public:
+    SyncCondition (const char* pszName) : SyncQueue (pszName, SYNC_CONDITION)
+    {
+    }
+
+    /// Releases mutex while waiting and holds it again on return,
+    /// also after a timeout; the condition must be checked again
+    /// @return false on timeout
+    bool Wait (SyncMutex& mutex, uint32_t nTimeout = SYNC_FOREVER)
+    {
+        Sync_Expire ();
+
+        stats.nContended++;
+
+        uint8_t nHeld = mutex.Release ();
+        bool bSignaled = Park (nTimeout) == SYNC_SIGNALED;
+
+        mutex.Acquire (nHeld);
+
+        if (bSignaled) stats.nAcquired++;
+
+        return bSignaled;
+    }
+
+    /// Safe outside a thread, never waits
+    void Signal ()
+    {
+        if (HasWaiters ()) Wake (First (), SYNC_SIGNALED);
+    }
+
+    void Broadcast ()
+    {
+        while (HasWaiters ()) Wake (First (), SYNC_SIGNALED);
+    }
+};
+
+/// One line per primitive, state then contention
+void Sync_Show (Stream& client)
+{
+    client.println (F ("Name         Type       State       Acquired  Contended  Timeouts  Wait ms  Max ms  Queue/max"));
+
+    for (SyncQueue* pQueue = pSyncFirst; pQueue != NULL; pQueue = pQueue->GetNext ())
+    {
+        const SyncStats& stats = pQueue->GetStats ();
+        char szState[12] = "-";
+
+        switch (pQueue->GetType ())
+        {
+            case SYNC_MUTEX:
+                if (((SyncMutex*)pQueue)->GetOwner () != SYNC_NONE) snprintf (szState, sizeof (szState), "owner #%u", ((SyncMutex*)pQueue)->GetOwner ());
+                break;
+
+            case SYNC_SEMAPHORE:
+                snprintf (szState, sizeof (szState), "count %u", ((SyncSemaphore*)pQueue)->GetCount ());
+                break;
+
+            case SYNC_EVENT:
+                snprintf (szState, sizeof (szState), "0x%08x", ((SyncEvent*)pQueue)->Get ());
+                break;
+
+            default:
+                break;
+        }
+
+        client.printf ("%-12s %-10s %-11s %8u  %9u  %8u  %7u  %6u  %u/%u\r\n", pQueue->GetName (), syncTypeNames[pQueue->GetType ()], szState, stats.nAcquired, stats.nContended, stats.nTimeouts, stats.nWaitMs, stats.nMaxWaitMs, stats.nWaiting, stats.nMaxWaiting);
+
+        CorePartition_Yield ();
+    }
+
+    client.printf ("Timed waiters: %u\r\n", nSyncTimed);
+}
+
+#endif
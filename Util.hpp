@@ -38,6 +38,7 @@
 #include "CorePartition.h"
 
 #include "Arduino.h"
+#include "Encoding.hpp"
 
 #include <LedControl.h>
 #include <Wire.h>
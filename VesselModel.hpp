@@ -0,0 +1,450 @@
+///
+/// @author   GUSTAVO CAMPOS
+/// @author   GUSTAVO CAMPOS
+/// @date   28/05/2019 19:44
+/// @version  <#version#>
+///
+/// @copyright  (c) GUSTAVO CAMPOS, 2019
+/// @copyright  Licence
+///
+/// @see    ReadMe.txt for references
+///
+//               GNU GENERAL PUBLIC LICENSE
+//                Version 3, 29 June 2007
+//
+// Copyright (C) 2007 Free Software Foundation, Inc. <https://fsf.org/>
+// Everyone is permitted to copy and distribute verbatim copies
+// of this license document, but changing it is not allowed.
+//
+// Preamble
+//
+// The GNU General Public License is a free, copyleft license for
+// software and other kinds of works.
+//
+// The licenses for most software and other practical works are designed
+// to take away your freedom to share and change the works.  By contrast,
+// the GNU General Public License is intended to guarantee your freedom to
+// share and change all versions of a program--to make sure it remains free
+// software for all its users.  We, the Free Software Foundation, use the
+// GNU General Public License for most of our software; it applies also to
+// any other work released this way by its authors.  You can apply it to
+// your programs, too.
+//
+// See LICENSE file for the complete information
+
+#ifndef VESSEL_MODEL_HPP
+#define VESSEL_MODEL_HPP
+
+#include "Arduino.h"
+
+#include "FixedPoint.hpp"
+
+/// Brewing thermal simulation
+///
+/// Each vessel is a lumped thermal mass: heater and external power
+/// in, Newton loss to ambient out, explicit Euler over a fixed step.
+/// Above the boiling point the surplus energy evaporates water
+/// instead of raising the temperature. Additions mix by heat
+/// capacity. Units are chosen to keep Q16.16 in range: kW, kJ/K,
+/// kg, litres, seconds and Celsius.
+///
+/// The step is two multiplies and a handful of adds, one simulated
+/// hour (3600 steps per vessel) costs a few milliseconds on the
+/// ESP8266. For long spans with constant inputs VesselAdvance jumps
+/// with the exact solution instead, see EventSimulation.hpp.
+
+#ifndef SIMULATION_VESSELS
+#define SIMULATION_VESSELS 3
+#endif
+
+enum VesselType : uint8_t
+{
+    VESSEL_MASH = 0,
+    VESSEL_BOIL,
+    VESSEL_FERMENTER
+};
+
+enum IngredientType : uint8_t
+{
+    INGREDIENT_WATER = 0,
+    INGREDIENT_GRAIN,
+    INGREDIENT_HOPS,
+    INGREDIENT_OTHER
+};
+
+namespace Physics
+{
+    const double nWaterHeat = 4.186;   // kJ/(kg.K)
+    const double nGrainHeat = 1.8;     // kJ/(kg.K)
+    const double nHopsHeat = 1.5;      // kJ/(kg.K)
+    const double nLatentHeat = 2257.0; // kJ/kg
+    const double nBoilingPoint = 100.0;
+};
+
+template <typename Number>
+struct VesselParams
+{
+    Number nHeaterPower;   // kW at full duty
+    Number nLoss;          // kW/K to ambient
+    Number nShellCapacity; // kJ/K of the empty vessel
+    Number nAmbient;       // C
+};
+
+template <typename Number>
+struct VesselState
+{
+    Number nTemperature; // C
+    Number nVolume;      // litres (kg) of water
+    Number nCapacity;    // kJ/K, water + shell + solids
+    Number nDuty;        // heater 0..1
+    Number nExtraPower;  // kW, jackets, fermentation heat, etc
+    Number nEvaporated;  // kg since reset
+    Number nEnergy;      // MJ delivered by the heater since reset
+    Number nResidue;     // raw remainder of the last temperature step
+};
+
+/// Adds nHeat / nCapacity to the temperature. In Q16.16 the quotient
+/// of a vessel near equilibrium is below one LSB and would truncate to
+/// nothing every step, the remainder of the division is carried to the
+/// next one instead so the small steps still add up
+inline void VesselHeat (Fixed& nTemperature, Fixed& nResidue, Fixed nHeat, Fixed nCapacity)
+{
+    if (nCapacity.Raw () <= 0) return;
+
+    int64_t nScaled = (int64_t)nHeat.Raw () * Fixed::nOne + nResidue.Raw ();
+    int64_t nDelta = nScaled / nCapacity.Raw ();
+
+    nResidue = Fixed::FromRaw ((int32_t)(nScaled - nDelta * nCapacity.Raw ()));
+    nTemperature += Fixed::FromRaw ((int32_t)nDelta);
+}
+
+inline void VesselHeat (double& nTemperature, double& nResidue, double nHeat, double nCapacity)
+{
+    nTemperature += nHeat / nCapacity;
+}
+
+/// Advances one vessel by nStep seconds
+template <typename Number>
+inline void VesselStep (VesselState<Number>& state, const VesselParams<Number>& params, Number nStep)
+{
+    Number nHeater = params.nHeaterPower * state.nDuty;
+    Number nPower = nHeater + state.nExtraPower - params.nLoss * (state.nTemperature - params.nAmbient);
+    Number nHeat = nPower * nStep;
+
+    state.nEnergy += nHeater * nStep / Number (1000);
+
+    if (state.nTemperature >= Number (Physics::nBoilingPoint) && nHeat > Number (0))
+    {
+        Number nBoiled = nHeat / Number (Physics::nLatentHeat);
+
+        if (nBoiled > state.nVolume) nBoiled = state.nVolume;
+
+        state.nVolume -= nBoiled;
+        state.nEvaporated += nBoiled;
+        state.nCapacity -= nBoiled * Number (Physics::nWaterHeat);
+        state.nTemperature = Number (Physics::nBoilingPoint);
+        return;
+    }
+
+    VesselHeat (state.nTemperature, state.nResidue, nHeat, state.nCapacity);
+}
+
+/// Seconds until the vessel reaches nTarget under its current inputs,
+/// negative if it never does, the boiling point caps the curve
+template <typename Number>
+inline double VesselTimeTo (const VesselState<Number>& state, const VesselParams<Number>& params, double nTarget)
+{
+    double nPower = ToDouble (params.nHeaterPower) * ToDouble (state.nDuty) + ToDouble (state.nExtraPower);
+    double nLoss = ToDouble (params.nLoss);
+    double nCapacity = ToDouble (state.nCapacity);
+    double nTemperature = ToDouble (state.nTemperature);
+
+    if (nTarget > Physics::nBoilingPoint || nCapacity <= 0) return -1;
+    if (nTarget == nTemperature) return 0;
+
+    if (nLoss <= 0)
+    {
+        double nTime = (nTarget - nTemperature) * nCapacity / nPower;
+
+        return nPower != 0 && nTime > 0 ? nTime : -1;
+    }
+
+    // Fraction of the distance to equilibrium left at the target
+    double nFinal = ToDouble (params.nAmbient) + nPower / nLoss;
+    double nRatio = (nTarget - nFinal) / (nTemperature - nFinal);
+
+    if (nRatio <= 0 || nRatio >= 1) return -1;
+
+    return -log (nRatio) * nCapacity / nLoss;
+}
+
+/// Advances one vessel by nSeconds with the exact solution for
+/// constant inputs, the event driven mode integrates a whole span
+/// between events with it. Below the boiling point the temperature
+/// relaxes exponentially towards Ta + P / L with time constant C / L;
+/// once boiling the surplus power evaporates water at a constant
+/// rate. Computed in double, one exp and one log per call whatever
+/// the span.
+template <typename Number>
+inline void VesselAdvance (VesselState<Number>& state, const VesselParams<Number>& params, double nSeconds)
+{
+    double nHeater = ToDouble (params.nHeaterPower) * ToDouble (state.nDuty);
+    double nPower = nHeater + ToDouble (state.nExtraPower);
+    double nLoss = ToDouble (params.nLoss);
+    double nAmbient = ToDouble (params.nAmbient);
+    double nCapacity = ToDouble (state.nCapacity);
+    double nTemperature = ToDouble (state.nTemperature);
+
+    if (nSeconds <= 0 || nCapacity <= 0) return;
+
+    state.nEnergy += Number (nHeater * nSeconds / 1000);
+
+    // Heating part, up to the boiling point if the curve gets there
+    if (nTemperature < Physics::nBoilingPoint || nPower <= nLoss * (Physics::nBoilingPoint - nAmbient))
+    {
+        double nSpan = nSeconds;
+
+        if (nTemperature < Physics::nBoilingPoint)
+        {
+            double nBoiling = VesselTimeTo (state, params, Physics::nBoilingPoint);
+
+            if (nBoiling >= 0 && nBoiling < nSpan) nSpan = nBoiling;
+        }
+
+        if (nLoss > 0)
+        {
+            double nFinal = nAmbient + nPower / nLoss;
+
+            nTemperature = nFinal + (nTemperature - nFinal) * exp (-nSpan * nLoss / nCapacity);
+        }
+        else
+        {
+            nTemperature += nPower * nSpan / nCapacity;
+        }
+
+        nSeconds -= nSpan;
+    }
+
+    if (nSeconds > 0)
+    {
+        // Boiling, the rest of the span evaporates at a constant rate
+        double nBoiled = (nPower - nLoss * (Physics::nBoilingPoint - nAmbient)) * nSeconds / Physics::nLatentHeat;
+
+        if (nBoiled > ToDouble (state.nVolume)) nBoiled = ToDouble (state.nVolume);
+
+        state.nVolume -= Number (nBoiled);
+        state.nEvaporated += Number (nBoiled);
+        state.nCapacity -= Number (nBoiled * Physics::nWaterHeat);
+        nTemperature = Physics::nBoilingPoint;
+    }
+
+    state.nTemperature = Number (nTemperature);
+}
+
+/// Mixes an ingredient into the vessel
+template <typename Number>
+inline void VesselAdd (VesselState<Number>& state, IngredientType nType, Number nMass, Number nTemperature)
+{
+    static const double specificHeat[] = {Physics::nWaterHeat, Physics::nGrainHeat, Physics::nHopsHeat, Physics::nWaterHeat};
+
+    Number nAddedCapacity = nMass * Number (specificHeat[nType]);
+    Number nCapacity = state.nCapacity + nAddedCapacity;
+
+    if (nCapacity <= Number (0)) return;
+
+    // Written as a correction to keep the products inside Q16.16
+    state.nTemperature += nAddedCapacity * (nTemperature - state.nTemperature) / nCapacity;
+    state.nCapacity = nCapacity;
+
+    if (nType == INGREDIENT_WATER) state.nVolume += nMass;
+}
+
+template <typename Number>
+inline void VesselReset (VesselState<Number>& state, const VesselParams<Number>& params, Number nVolume, Number nTemperature)
+{
+    state.nTemperature = nTemperature;
+    state.nVolume = nVolume;
+    state.nCapacity = params.nShellCapacity + nVolume * Number (Physics::nWaterHeat);
+    state.nDuty = Number (0);
+    state.nExtraPower = Number (0);
+    state.nEvaporated = Number (0);
+    state.nEnergy = Number (0);
+    state.nResidue = Number (0);
+}
+
+/// Moves mass and heat between the vessels every step, pipes and
+/// pumps (PlantGraph.hpp)
+template <typename Number>
+class VesselTransport
+{
+public:
+    /// Something may flow, exact spans do not hold
+    virtual bool IsActive () const = 0;
+
+    virtual void Transfer (VesselState<Number>* pVessels, Number nStep) = 0;
+};
+
+template <typename Number>
+class Simulation
+{
+public:
+    Simulation (VesselTransport<Number>* pNewTransport = NULL) : pTransport (pNewTransport), nTime (0), nSteps (0), nLastStepCost (0), nMaxSliceCost (0)
+    {
+        Reset ();
+    }
+
+    /// Default brewhouse: 40L mash tun, 60L kettle, 30L fermenter
+    void Reset ()
+    {
+        static const double defaults[SIMULATION_VESSELS][6] = {
+            // Power, Loss, Shell, Ambient, Volume, Temp
+            {3.0, 0.004, 8.0, 20.0, 0.0, 20.0},
+            {5.5, 0.010, 12.0, 20.0, 0.0, 20.0},
+            {0.05, 0.003, 6.0, 20.0, 0.0, 20.0}}; // Fermenter heat belt
+
+        for (uint8_t nCount = 0; nCount < SIMULATION_VESSELS; nCount++)
+        {
+            const double* pDefault = defaults[nCount % 3];
+
+            params[nCount].nHeaterPower = Number (pDefault[0]);
+            params[nCount].nLoss = Number (pDefault[1]);
+            params[nCount].nShellCapacity = Number (pDefault[2]);
+            params[nCount].nAmbient = Number (pDefault[3]);
+
+            VesselReset (vessels[nCount], params[nCount], Number (pDefault[4]), Number (pDefault[5]));
+        }
+
+        nTime = 0;
+        nSteps = 0;
+    }
+
+    /// One fixed step for every vessel
+    void Step ()
+    {
+        for (uint8_t nCount = 0; nCount < SIMULATION_VESSELS; nCount++)
+        {
+            VesselStep (vessels[nCount], params[nCount], Number (nStepSeconds));
+        }
+
+        if (pTransport != NULL) pTransport->Transfer (vessels, Number (nStepSeconds));
+
+        nTime += nStepSeconds;
+        nSteps++;
+    }
+
+    /// Advances every vessel by nSeconds in one exact span, for the
+    /// event driven mode, the inputs must not change over it; while
+    /// something flows between the vessels it takes fixed steps, at
+    /// most nMaxSteps, and may stop short. Returns the steps taken
+    uint32_t Skip (uint32_t nSeconds, uint32_t nMaxSteps = UINT32_MAX)
+    {
+        if (pTransport != NULL && pTransport->IsActive ())
+        {
+            uint32_t nCount = 0;
+
+            for (uint32_t nDone = 0; nDone < nSeconds && nCount < nMaxSteps; nDone += nStepSeconds, nCount++) Step ();
+
+            return nCount;
+        }
+
+        for (uint8_t nCount = 0; nCount < SIMULATION_VESSELS; nCount++)
+        {
+            VesselAdvance (vessels[nCount], params[nCount], (double)nSeconds);
+        }
+
+        nTime += nSeconds;
+
+        return 0;
+    }
+
+    /// Runs up to nMaxSteps, returns how many were run
+    uint32_t Run (uint32_t nMaxSteps)
+    {
+        uint32_t nStart = micros ();
+        uint32_t nCount;
+
+        for (nCount = 0; nCount < nMaxSteps; nCount++)
+        {
+            Step ();
+        }
+
+        uint32_t nCost = micros () - nStart;
+
+        if (nCount > 0) nLastStepCost = nCost / nCount;
+        if (nCost > nMaxSliceCost) nMaxSliceCost = nCost;
+
+        return nCount;
+    }
+
+    VesselState<Number>& Vessel (uint8_t nVessel)
+    {
+        return vessels[nVessel % SIMULATION_VESSELS];
+    }
+
+    VesselParams<Number>& Params (uint8_t nVessel)
+    {
+        return params[nVessel % SIMULATION_VESSELS];
+    }
+
+    /// Called every step after the vessels, NULL detaches
+    void SetTransport (VesselTransport<Number>* pNewTransport)
+    {
+        pTransport = pNewTransport;
+    }
+
+    void SetDuty (uint8_t nVessel, Number nDuty)
+    {
+        Vessel (nVessel).nDuty = Clamp (nDuty, Number (0), Number (1));
+    }
+
+    void Add (uint8_t nVessel, IngredientType nType, Number nMass, Number nTemperature)
+    {
+        VesselAdd (Vessel (nVessel), nType, nMass, nTemperature);
+    }
+
+    /// Simulated seconds since reset
+    uint32_t GetTime () const
+    {
+        return nTime;
+    }
+
+    uint32_t GetSteps () const
+    {
+        return nSteps;
+    }
+
+    uint32_t GetLastStepCost () const
+    {
+        return nLastStepCost;
+    }
+
+    uint32_t GetMaxSliceCost () const
+    {
+        return nMaxSliceCost;
+    }
+
+    static const uint32_t nStepSeconds = 1;
+
+    /// Visits the state a checkpoint keeps (Checkpoint.hpp), the same
+    /// call saves and restores
+    template <typename Archive>
+    void Checkpoint (Archive& archive)
+    {
+        archive (params);
+        archive (vessels);
+        archive (nTime);
+        archive (nSteps);
+    }
+
+private:
+    VesselParams<Number> params[SIMULATION_VESSELS];
+    VesselState<Number> vessels[SIMULATION_VESSELS];
+    VesselTransport<Number>* pTransport;
+
+    uint32_t nTime;
+    uint32_t nSteps;
+    uint32_t nLastStepCost;
+    uint32_t nMaxSliceCost;
+};
+
+#endif
@@ -0,0 +1,320 @@
+///
+/// Linux host shim for the Arduino core, only what BrewerSim2,
+/// Terminal and the e-paper driver use.
+///
+
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <math.h>
+
+#include <algorithm>
+#include <string>
+
+#include "avr/pgmspace.h"
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HIGH 0x1
+#define LOW 0x0
+
+#define INPUT 0x00
+#define OUTPUT 0x01
+#define INPUT_PULLUP 0x02
+
+#define LSBFIRST 0
+#define MSBFIRST 1
+
+#define D0 16
+#define D1 5
+#define D2 4
+#define D3 0
+#define D4 2
+#define D5 14
+#define D6 12
+#define D7 13
+#define D8 15
+#define SS 15
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+// As the ESP8266 core, both arguments of the same type
+using std::max;
+using std::min;
+
+#define DEC 10
+#define HEX 16
+
+uint32_t millis (void);
+uint32_t micros (void);
+void delay (uint32_t nDelay);
+void delayMicroseconds (uint32_t nDelay);
+void yield (void);
+
+void pinMode (uint8_t nPin, uint8_t nMode);
+void digitalWrite (uint8_t nPin, uint8_t nValue);
+int digitalRead (uint8_t nPin);
+void shiftOut (uint8_t nDataPin, uint8_t nClockPin, uint8_t nBitOrder, uint8_t nValue);
+
+class __FlashStringHelper;
+#define F(string_literal) (reinterpret_cast<const __FlashStringHelper*> (string_literal))
+
+class String
+{
+public:
+    String () {}
+    String (const char* pszValue) : str (pszValue == NULL ? "" : pszValue) {}
+    String (const std::string& strValue) : str (strValue) {}
+    String (const __FlashStringHelper* pszValue) : str ((const char*)pszValue) {}
+    String (char chValue) : str (1, chValue) {}
+    String (int nValue, unsigned char nBase = 10) { FromLong (nValue, nBase); }
+    String (unsigned int nValue, unsigned char nBase = 10) { FromLong ((long)nValue, nBase); }
+    String (long nValue, unsigned char nBase = 10) { FromLong (nValue, nBase); }
+    String (unsigned long nValue, unsigned char nBase = 10) { FromLong ((long)nValue, nBase); }
+    String (double nValue, unsigned char nDecimals = 2)
+    {
+        char szTemp[48];
+        snprintf (szTemp, sizeof (szTemp), "%.*f", nDecimals, nValue);
+        str = szTemp;
+    }
+
+    const char* c_str () const { return str.c_str (); }
+    unsigned int length () const { return (unsigned int)str.length (); }
+    bool reserve (unsigned int nSize) { str.reserve (nSize); return true; }
+
+    char charAt (unsigned int nIndex) const { return nIndex < str.length () ? str [nIndex] : 0; }
+    char operator[] (unsigned int nIndex) const { return charAt (nIndex); }
+    char& operator[] (unsigned int nIndex) { return str [nIndex]; }
+    void setCharAt (unsigned int nIndex, char chValue) { if (nIndex < str.length ()) str [nIndex] = chValue; }
+
+    String& operator= (const char* pszValue) { str = pszValue == NULL ? "" : pszValue; return *this; }
+    String& operator+= (const String& strValue) { str += strValue.str; return *this; }
+    String& operator+= (const char* pszValue) { str += pszValue; return *this; }
+    String& operator+= (char chValue) { str += chValue; return *this; }
+    String& operator+= (int nValue) { str += String (nValue).str; return *this; }
+    bool concat (const String& strValue) { str += strValue.str; return true; }
+    bool concat (char chValue) { str += chValue; return true; }
+
+    friend String operator+ (const String& strA, const String& strB) { return String (strA.str + strB.str); }
+    friend String operator+ (const String& strA, const char* pszB) { return String (strA.str + pszB); }
+    friend String operator+ (const char* pszA, const String& strB) { return String (pszA + strB.str); }
+
+    bool operator== (const String& strValue) const { return str == strValue.str; }
+    bool operator== (const char* pszValue) const { return str == pszValue; }
+    bool operator!= (const String& strValue) const { return str != strValue.str; }
+    bool operator!= (const char* pszValue) const { return str != pszValue; }
+    bool operator< (const String& strValue) const { return str < strValue.str; }
+    bool equals (const String& strValue) const { return str == strValue.str; }
+    bool equalsIgnoreCase (const String& strValue) const { return strcasecmp (str.c_str (), strValue.c_str ()) == 0; }
+    int compareTo (const String& strValue) const { return str.compare (strValue.str); }
+    bool startsWith (const String& strValue) const { return str.compare (0, strValue.str.length (), strValue.str) == 0; }
+    bool endsWith (const String& strValue) const { return str.length () >= strValue.str.length () && str.compare (str.length () - strValue.str.length (), strValue.str.length (), strValue.str) == 0; }
+
+    int indexOf (char chValue, unsigned int nFrom = 0) const { size_t nPos = str.find (chValue, nFrom); return nPos == std::string::npos ? -1 : (int)nPos; }
+    int indexOf (const String& strValue, unsigned int nFrom = 0) const { size_t nPos = str.find (strValue.str, nFrom); return nPos == std::string::npos ? -1 : (int)nPos; }
+    int lastIndexOf (char chValue) const { size_t nPos = str.rfind (chValue); return nPos == std::string::npos ? -1 : (int)nPos; }
+
+    String substring (unsigned int nBegin) const { return nBegin >= str.length () ? String () : String (str.substr (nBegin)); }
+    String substring (unsigned int nBegin, unsigned int nEnd) const { if (nBegin > nEnd) { unsigned int nTemp = nBegin; nBegin = nEnd; nEnd = nTemp; } return nBegin >= str.length () ? String () : String (str.substr (nBegin, nEnd - nBegin)); }
+
+    void trim ()
+    {
+        size_t nBegin = str.find_first_not_of (" \t\r\n");
+        size_t nEnd = str.find_last_not_of (" \t\r\n");
+        str = nBegin == std::string::npos ? std::string () : str.substr (nBegin, nEnd - nBegin + 1);
+    }
+    void toLowerCase () { for (size_t nCount = 0; nCount < str.length (); nCount++) str [nCount] = (char)tolower (str [nCount]); }
+    void toUpperCase () { for (size_t nCount = 0; nCount < str.length (); nCount++) str [nCount] = (char)toupper (str [nCount]); }
+    void remove (unsigned int nIndex, unsigned int nCount = (unsigned int)-1) { if (nIndex < str.length ()) str.erase (nIndex, nCount); }
+    void replace (const String& strFind, const String& strReplace)
+    {
+        size_t nPos = 0;
+        while (strFind.str.length () > 0 && (nPos = str.find (strFind.str, nPos)) != std::string::npos)
+        {
+            str.replace (nPos, strFind.str.length (), strReplace.str);
+            nPos += strReplace.str.length ();
+        }
+    }
+
+    long toInt () const { return atol (str.c_str ()); }
+    float toFloat () const { return (float)atof (str.c_str ()); }
+    double toDouble () const { return atof (str.c_str ()); }
+
+private:
+    void FromLong (long nValue, unsigned char nBase)
+    {
+        char szTemp[40];
+        snprintf (szTemp, sizeof (szTemp), nBase == 16 ? "%lx" : "%ld", nValue);
+        str = szTemp;
+    }
+
+    std::string str;
+};
+
+class Print
+{
+public:
+    virtual ~Print () {}
+
+    virtual size_t write (uint8_t nValue) = 0;
+    virtual size_t write (const uint8_t* pBuffer, size_t nSize)
+    {
+        size_t nCount = 0;
+        while (nSize--) nCount += write (*pBuffer++);
+        return nCount;
+    }
+    size_t write (const char* pszValue) { return pszValue == NULL ? 0 : write ((const uint8_t*)pszValue, strlen (pszValue)); }
+    size_t write (const char* pBuffer, size_t nSize) { return write ((const uint8_t*)pBuffer, nSize); }
+    virtual void flush () {}
+
+    size_t print (const __FlashStringHelper* pszValue) { return write ((const char*)pszValue); }
+    size_t print (const String& strValue) { return write ((const uint8_t*)strValue.c_str (), strValue.length ()); }
+    size_t print (const char* pszValue) { return write (pszValue); }
+    size_t print (char chValue) { return write ((uint8_t)chValue); }
+    size_t print (unsigned char nValue, int nBase = DEC) { return print ((unsigned long)nValue, nBase); }
+    size_t print (int nValue, int nBase = DEC) { return print ((long)nValue, nBase); }
+    size_t print (unsigned int nValue, int nBase = DEC) { return print ((unsigned long)nValue, nBase); }
+    size_t print (long nValue, int nBase = DEC) { return nBase == DEC ? printf ("%ld", nValue) : printf ("%lx", nValue); }
+    size_t print (unsigned long nValue, int nBase = DEC) { return nBase == DEC ? printf ("%lu", nValue) : printf ("%lx", nValue); }
+    size_t print (long long nValue, int nBase = DEC) { return nBase == DEC ? printf ("%lld", nValue) : printf ("%llx", nValue); }
+    size_t print (unsigned long long nValue, int nBase = DEC) { return nBase == DEC ? printf ("%llu", nValue) : printf ("%llx", nValue); }
+    size_t print (double nValue, int nDecimals = 2) { return printf ("%.*f", nDecimals, nValue); }
+
+    size_t println () { return write ("\r\n"); }
+    template <typename T>
+    size_t println (const T& value) { size_t nCount = print (value); return nCount + println (); }
+    template <typename T>
+    size_t println (const T& value, int nFormat) { size_t nCount = print (value, nFormat); return nCount + println (); }
+
+    size_t printf (const char* pszFormat, ...) __attribute__ ((format (printf, 2, 3)))
+    {
+        char szTemp[256];
+        va_list args;
+
+        va_start (args, pszFormat);
+        int nLen = vsnprintf (szTemp, sizeof (szTemp), pszFormat, args);
+        va_end (args);
+
+        if (nLen < 0) return 0;
+
+        return write ((const uint8_t*)szTemp, (size_t)nLen < sizeof (szTemp) ? (size_t)nLen : sizeof (szTemp) - 1);
+    }
+};
+
+class Stream : public Print
+{
+public:
+    virtual int available () = 0;
+    virtual int read () = 0;
+    virtual int peek () = 0;
+
+    void setTimeout (unsigned long nTimeout) { this->nTimeout = nTimeout; }
+
+    size_t readBytes (char* pBuffer, size_t nLength)
+    {
+        size_t nCount = 0;
+        uint32_t nStart = millis ();
+
+        while (nCount < nLength && (millis () - nStart) < nTimeout)
+        {
+            int nValue = read ();
+            if (nValue < 0)
+            {
+                yield ();
+                continue;
+            }
+            pBuffer [nCount++] = (char)nValue;
+        }
+
+        return nCount;
+    }
+
+    String readStringUntil (char chTerminator)
+    {
+        String strReturn;
+        uint32_t nStart = millis ();
+
+        while ((millis () - nStart) < nTimeout)
+        {
+            int nValue = read ();
+            if (nValue < 0)
+            {
+                yield ();
+                continue;
+            }
+            if (nValue == chTerminator) break;
+            strReturn += (char)nValue;
+        }
+
+        return strReturn;
+    }
+
+protected:
+    unsigned long nTimeout = 1000;
+};
+
+/// Serial backed by stdin/stdout, stdin is switched to non-blocking
+/// raw mode on begin() when it is a terminal.
+class HardwareSerial : public Stream
+{
+public:
+    void begin (unsigned long nBaud);
+    void end () {}
+    operator bool () { return true; }
+
+    int available () override;
+    int read () override;
+    int peek () override;
+    size_t write (uint8_t nValue) override;
+    size_t write (const uint8_t* pBuffer, size_t nSize) override;
+    using Print::write;
+    void flush () override;
+
+private:
+    int nPeek = -1;
+    bool bStarted = false;
+};
+
+extern HardwareSerial Serial;
+
+struct rst_info
+{
+    uint32_t reason;
+    uint32_t exccause;
+    uint32_t epc1;
+    uint32_t epc2;
+    uint32_t epc3;
+    uint32_t excvaddr;
+    uint32_t depc;
+};
+
+/// ESP8266 system calls used by the application
+class EspClass
+{
+public:
+    uint32_t getFreeHeap ();
+    uint16_t getMaxFreeBlockSize ();
+    uint8_t getHeapFragmentation ();
+    void getHeapStats (uint32_t* pnFree, uint16_t* pnMax, uint8_t* pnFragmentation);
+    uint32_t getChipId ();
+    const char* getSdkVersion ();
+    uint8_t getCpuFreqMHz ();
+    uint32_t getCycleCount ();
+    String getResetReason ();
+    rst_info* getResetInfoPtr ();
+    bool rtcUserMemoryRead (uint32_t nOffset, uint32_t* pData, size_t nSize);
+    bool rtcUserMemoryWrite (uint32_t nOffset, uint32_t* pData, size_t nSize);
+    void restart ();
+    void wdtFeed () {}
+};
+
+extern EspClass ESP;
+
+#endif
@@ -0,0 +1,537 @@
+///
+/// Batch runner for the brewing simulation
+///
+/// Runs complete brews (strike heating, dough-in, mash rest, mash
+/// out, boil) with the same vessel model the device uses, as fast as
+/// the host allows and spread over every core. Parameters are swept
+/// over a grid and every grid point is repeated with randomised
+/// ambient and grain temperatures; outcome statistics are printed as
+/// CSV, one line per grid point.
+///
+/// Use:
+///   brewbatch [--grain a:b:step] [--mash a:b:step] [--power a:b:step]
+///             [--samples n] [--threads n] [--seed n] [--fixed]
+///
+/// Ranges are inclusive, a single value is a one point range. Every
+/// brew is seeded from its index, results do not depend on the
+/// thread count.
+///
+///   brewbatch --ferment days [--fixed]
+///
+/// Runs one ale fermentation in the event driven mode with the yeast
+/// kinetics instead and prints the batch once per simulated day.
+///
+///   brewbatch --ferment-steps days
+///
+/// Lets the same ale ferment free at 12 C ambient with fixed one
+/// second steps, as the device does in step mode, once in double and
+/// once in Q16.16, and prints both temperatures every six hours with
+/// the largest difference.
+///
+
+#include "Arduino.h"
+
+#include "../FixedPoint.hpp"
+#include "../VesselModel.hpp"
+#include "../EventSimulation.hpp"
+#include "../Fermentation.hpp"
+
+#include <math.h>
+#include <time.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+struct Range
+{
+    double nStart;
+    double nEnd;
+    double nStep;
+
+    size_t Count () const
+    {
+        return nStep <= 0 || nEnd < nStart ? 1 : (size_t)((nEnd - nStart) / nStep + 1e-9) + 1;
+    }
+
+    double At (size_t nIndex) const
+    {
+        return nStart + nStep * nIndex;
+    }
+};
+
+struct BrewConfig
+{
+    double nGrain;     // kg
+    double nMashTemp;  // C
+    double nPower;     // kW, mash tun and kettle heaters
+    double nAmbient;   // C
+    double nGrainTemp; // C
+};
+
+enum BrewMetric
+{
+    METRIC_STRIKE = 0,   // minutes to reach strike temperature
+    METRIC_MASH_ERROR,   // mean absolute error during the rest, K
+    METRIC_MASH_PEAK,    // max absolute error during the rest, K
+    METRIC_TO_BOIL,      // minutes from kettle fill to boil
+    METRIC_TOTAL,        // minutes for the whole brew
+    METRIC_ENERGY,       // MJ delivered by both heaters
+    METRIC_POST_BOIL,    // litres after the boil
+    METRIC_GRAVITY,      // original gravity points (SG - 1) * 1000
+    METRIC_COUNT
+};
+
+static const char* const metricNames[METRIC_COUNT] = {"strike_min", "mash_err", "mash_peak", "to_boil_min", "total_min", "energy_mj", "post_boil_l", "og_points"};
+
+struct BrewOutcome
+{
+    double metrics[METRIC_COUNT];
+};
+
+/// xorshift32, one stream per brew
+static uint32_t NextRandom (uint32_t& nState)
+{
+    nState ^= nState << 13;
+    nState ^= nState >> 17;
+    nState ^= nState << 5;
+    return nState;
+}
+
+static double Uniform (uint32_t& nState, double nMin, double nMax)
+{
+    return nMin + (nMax - nMin) * (NextRandom (nState) / 4294967296.0);
+}
+
+/// Bang-bang with hysteresis, the controller the device had before PID
+template <typename Number>
+static void Hold (VesselState<Number>& vessel, Number nSetpoint, Number nHysteresis)
+{
+    if (vessel.nTemperature < nSetpoint - nHysteresis)
+        vessel.nDuty = Number (1);
+    else if (vessel.nTemperature > nSetpoint + nHysteresis)
+        vessel.nDuty = Number (0);
+}
+
+template <typename Number>
+static BrewOutcome RunBrew (const BrewConfig& config)
+{
+    const double nMashWater = config.nGrain * 3.0;   // L/kg mash thickness
+    const double nAbsorption = config.nGrain * 1.0;  // L/kg lost in the grain
+    const double nSparge = config.nGrain * 2.5;      // L/kg sparge water
+    const double nExtract = 308.0 * 0.72;            // points.L/kg at 72% efficiency
+    const uint32_t nLimit = 4 * 3600;                // give up a phase after 4h
+
+    Simulation<Number> sim;
+    BrewOutcome outcome = {};
+    uint32_t nSeconds = 0;
+
+    for (uint8_t nVessel = 0; nVessel < SIMULATION_VESSELS; nVessel++)
+    {
+        sim.Params (nVessel).nAmbient = Number (config.nAmbient);
+        sim.Params (nVessel).nHeaterPower = Number (config.nPower);
+    }
+
+    VesselState<Number>& mash = sim.Vessel (VESSEL_MASH);
+    VesselState<Number>& kettle = sim.Vessel (VESSEL_BOIL);
+
+    VesselReset (mash, sim.Params (VESSEL_MASH), Number (nMashWater), Number (config.nAmbient));
+
+    // Strike temperature so the dough-in lands on the rest temperature
+    double nTunCapacity = ToDouble (mash.nCapacity);
+    double nGrainCapacity = config.nGrain * Physics::nGrainHeat;
+    double nStrike = (config.nMashTemp * (nTunCapacity + nGrainCapacity) - nGrainCapacity * config.nGrainTemp) / nTunCapacity;
+
+    for (nSeconds = 0; mash.nTemperature < Number (nStrike) && nSeconds < nLimit; nSeconds++)
+    {
+        mash.nDuty = Number (1);
+        sim.Step ();
+    }
+
+    outcome.metrics[METRIC_STRIKE] = nSeconds / 60.0;
+
+    uint32_t nTotal = nSeconds;
+
+    sim.Add (VESSEL_MASH, INGREDIENT_GRAIN, Number (config.nGrain), Number (config.nGrainTemp));
+
+    // 60 minute rest
+    double nErrorSum = 0;
+    double nErrorPeak = 0;
+
+    for (nSeconds = 0; nSeconds < 3600; nSeconds++)
+    {
+        Hold (mash, Number (config.nMashTemp), Number (0.25));
+        sim.Step ();
+
+        double nError = fabs (ToDouble (mash.nTemperature) - config.nMashTemp);
+
+        nErrorSum += nError;
+        if (nError > nErrorPeak) nErrorPeak = nError;
+    }
+
+    outcome.metrics[METRIC_MASH_ERROR] = nErrorSum / 3600.0;
+    outcome.metrics[METRIC_MASH_PEAK] = nErrorPeak;
+    nTotal += nSeconds;
+
+    // Mash out, ramp to 76C and hold 10 minutes
+    for (nSeconds = 0; mash.nTemperature < Number (76.0) && nSeconds < nLimit; nSeconds++)
+    {
+        mash.nDuty = Number (1);
+        sim.Step ();
+    }
+
+    nTotal += nSeconds;
+
+    for (nSeconds = 0; nSeconds < 600; nSeconds++)
+    {
+        Hold (mash, Number (76.0), Number (0.25));
+        sim.Step ();
+    }
+
+    nTotal += nSeconds;
+    mash.nDuty = Number (0);
+
+    // Lauter into the kettle, sparge water at 76C
+    double nPreBoil = nMashWater - nAbsorption + nSparge;
+
+    VesselReset (kettle, sim.Params (VESSEL_BOIL), Number (nMashWater - nAbsorption), mash.nTemperature);
+    sim.Add (VESSEL_BOIL, INGREDIENT_WATER, Number (nPreBoil - (nMashWater - nAbsorption)), Number (76.0));
+
+    for (nSeconds = 0; kettle.nTemperature < Number (Physics::nBoilingPoint) && nSeconds < nLimit; nSeconds++)
+    {
+        kettle.nDuty = Number (1);
+        sim.Step ();
+    }
+
+    outcome.metrics[METRIC_TO_BOIL] = nSeconds / 60.0;
+    nTotal += nSeconds;
+
+    // 60 minute boil
+    for (nSeconds = 0; nSeconds < 3600; nSeconds++)
+    {
+        kettle.nDuty = Number (1);
+        sim.Step ();
+    }
+
+    nTotal += nSeconds;
+
+    double nPostBoil = ToDouble (kettle.nVolume);
+
+    outcome.metrics[METRIC_TOTAL] = nTotal / 60.0;
+    outcome.metrics[METRIC_ENERGY] = ToDouble (mash.nEnergy) + ToDouble (kettle.nEnergy);
+    outcome.metrics[METRIC_POST_BOIL] = nPostBoil;
+    outcome.metrics[METRIC_GRAVITY] = nPostBoil > 0 ? config.nGrain * nExtract / nPostBoil : 0;
+
+    return outcome;
+}
+
+/// Ale at 12 C ambient: 1.050 wort pitched at 20 C, held at 18 C
+/// with the heat belt, diacetyl rest at 21 C from day 10, then free
+/// to drift. Setpoints are events, thermostat crossings are found
+/// analytically and the yeast kinetics are integrated adaptively,
+/// coupled to the fermenter once per simulated hour: the released
+/// heat becomes its extra power for the next hour.
+template <typename Number>
+static uint32_t RunFerment (uint32_t nDays)
+{
+    const uint32_t nDay = 86400;
+    const uint32_t nCoupling = 3600;
+
+    Simulation<Number> sim;
+    EventSimulation<Number> events (sim);
+    Fermentation<Number> fermentation;
+    VesselState<Number>& fermenter = sim.Vessel (VESSEL_FERMENTER);
+
+    sim.Params (VESSEL_FERMENTER).nAmbient = Number (12.0);
+    VesselReset (fermenter, sim.Params (VESSEL_FERMENTER), Number (23.0), Number (20.0));
+    fermentation.Pitch (Number (50), Number (0.75), Number (0.15));
+
+    events.Schedule (0, SIMULATION_EVENT_SETPOINT, VESSEL_FERMENTER, Number (18.0), Number (0.3));
+    events.Schedule (10 * nDay, SIMULATION_EVENT_SETPOINT, VESSEL_FERMENTER, Number (21.0), Number (0.3));
+    events.Schedule (12 * nDay, SIMULATION_EVENT_SETPOINT, VESSEL_FERMENTER, Number (0), Number (0));
+
+    printf ("day,temperature_c,duty,heater_kwh,gravity,abv,yeast_gl,co2_gl,heat_w\n");
+
+    for (uint32_t nTime = nCoupling; nTime <= nDays * nDay; nTime += nCoupling)
+    {
+        // Kinetics over the hour at its starting temperature, then the
+        // vessel over the same hour with the resulting heat
+        fermenter.nExtraPower = fermentation.Advance (nCoupling, fermenter.nTemperature, fermenter.nVolume);
+        events.Run (nTime);
+
+        if (nTime % nDay != 0) continue;
+
+        printf ("%u,%.3f,%.0f,%.3f,%.4f,%.2f,%.3f,%.2f,%.2f\n",
+                nTime / nDay,
+                ToDouble (fermenter.nTemperature),
+                ToDouble (fermenter.nDuty),
+                ToDouble (fermenter.nEnergy) / 3.6,
+                1 + ToDouble (fermentation.GetGravity ()) / 1000,
+                ToDouble (fermentation.GetAbv ()),
+                ToDouble (fermentation.GetYeast ()),
+                ToDouble (fermentation.GetCo2 ()),
+                ToDouble (fermentation.GetHeat ()) * 1000);
+    }
+
+    const Rk23<Number, Fermentation<Number>::FERMENTATION_SIZE>& solver = fermentation.Solver ();
+
+    fprintf (stderr, "%u events, %u crossings, %u spans; kinetics %u steps, %u rejected, %u forced, %u evaluations, max error %.3f of tolerance\n",
+             events.GetProcessed (),
+             events.GetCrossings (),
+             events.GetSpans (),
+             solver.GetSteps (),
+             solver.GetRejects (),
+             solver.GetForced (),
+             solver.GetEvaluations (),
+             ToDouble (solver.GetMaxError ()));
+
+    return nDays * nDay;
+}
+
+/// Free running fermenter in fixed steps, temperature every hour
+template <typename Number>
+static std::vector<double> StepFerment (uint32_t nDays)
+{
+    Simulation<Number> sim;
+    Fermentation<Number> fermentation;
+    VesselState<Number>& fermenter = sim.Vessel (VESSEL_FERMENTER);
+    std::vector<double> temperatures;
+
+    sim.Params (VESSEL_FERMENTER).nAmbient = Number (12.0);
+    VesselReset (fermenter, sim.Params (VESSEL_FERMENTER), Number (23.0), Number (20.0));
+    fermentation.Pitch (Number (50), Number (0.75), Number (0.15));
+
+    for (uint32_t nHour = 0; nHour < nDays * 24; nHour++)
+    {
+        fermenter.nExtraPower = fermentation.Advance (3600, fermenter.nTemperature, fermenter.nVolume);
+
+        for (uint32_t nSecond = 0; nSecond < 3600; nSecond++) sim.Step ();
+
+        temperatures.push_back (ToDouble (fermenter.nTemperature));
+    }
+
+    return temperatures;
+}
+
+static void CompareFerment (uint32_t nDays)
+{
+    std::vector<double> reference = StepFerment<double> (nDays);
+    std::vector<double> fixed = StepFerment<Fixed> (nDays);
+    double nMaxError = 0;
+    size_t nMaxHour = 0;
+
+    printf ("hour,double_c,fixed_c,error_k\n");
+
+    for (size_t nHour = 0; nHour < reference.size (); nHour++)
+    {
+        double nError = fixed[nHour] - reference[nHour];
+
+        if (fabs (nError) > fabs (nMaxError))
+        {
+            nMaxError = nError;
+            nMaxHour = nHour + 1;
+        }
+
+        if ((nHour + 1) % 6 == 0) printf ("%zu,%.3f,%.3f,%.4f\n", nHour + 1, reference[nHour], fixed[nHour], nError);
+    }
+
+    fprintf (stderr, "%u days in fixed steps, largest Q16.16 error %.4f K at hour %zu\n", nDays, nMaxError, nMaxHour);
+}
+
+static bool ParseRange (const char* pszValue, Range& range)
+{
+    int nFields = sscanf (pszValue, "%lf:%lf:%lf", &range.nStart, &range.nEnd, &range.nStep);
+
+    if (nFields == 1)
+    {
+        range.nEnd = range.nStart;
+        range.nStep = 0;
+    }
+    else if (nFields != 3)
+    {
+        return false;
+    }
+
+    return true;
+}
+
+static void Usage (const char* pszName)
+{
+    fprintf (stderr, "Use: %s [--grain a:b:step] [--mash a:b:step] [--power a:b:step] [--samples n] [--threads n] [--seed n] [--fixed]\n", pszName);
+    fprintf (stderr, "     %s --ferment days [--fixed]\n", pszName);
+    fprintf (stderr, "     %s --ferment-steps days\n", pszName);
+}
+
+int main (int argc, char** argv)
+{
+    Range grain = {5.0, 5.0, 0};
+    Range mash = {66.0, 66.0, 0};
+    Range power = {3.0, 3.0, 0};
+    size_t nSamples = 100;
+    size_t nThreads = std::thread::hardware_concurrency ();
+    uint32_t nSeed = 1;
+    bool bFixed = false;
+    uint32_t nFerment = 0;
+    uint32_t nCompare = 0;
+
+    for (int nCount = 1; nCount < argc; nCount++)
+    {
+        bool bValid = true;
+        const char* pszValue = nCount + 1 < argc ? argv[nCount + 1] : "";
+
+        if (strcmp (argv[nCount], "--grain") == 0)
+            bValid = ParseRange (pszValue, grain), nCount++;
+        else if (strcmp (argv[nCount], "--mash") == 0)
+            bValid = ParseRange (pszValue, mash), nCount++;
+        else if (strcmp (argv[nCount], "--power") == 0)
+            bValid = ParseRange (pszValue, power), nCount++;
+        else if (strcmp (argv[nCount], "--samples") == 0)
+            nSamples = strtoul (pszValue, NULL, 10), nCount++;
+        else if (strcmp (argv[nCount], "--threads") == 0)
+            nThreads = strtoul (pszValue, NULL, 10), nCount++;
+        else if (strcmp (argv[nCount], "--seed") == 0)
+            nSeed = strtoul (pszValue, NULL, 10), nCount++;
+        else if (strcmp (argv[nCount], "--fixed") == 0)
+            bFixed = true;
+        else if (strcmp (argv[nCount], "--ferment") == 0)
+            bValid = (nFerment = strtoul (pszValue, NULL, 10)) > 0, nCount++;
+        else if (strcmp (argv[nCount], "--ferment-steps") == 0)
+            bValid = (nCompare = strtoul (pszValue, NULL, 10)) > 0, nCount++;
+        else
+            bValid = false;
+
+        if (bValid == false)
+        {
+            Usage (argv[0]);
+            return 1;
+        }
+    }
+
+    if (nCompare > 0)
+    {
+        CompareFerment (nCompare);
+        return 0;
+    }
+
+    if (nFerment > 0)
+    {
+        struct timespec tsStart, tsEnd;
+
+        clock_gettime (CLOCK_MONOTONIC, &tsStart);
+
+        uint32_t nSimulated = bFixed ? RunFerment<Fixed> (nFerment) : RunFerment<double> (nFerment);
+
+        clock_gettime (CLOCK_MONOTONIC, &tsEnd);
+
+        double nElapsed = (tsEnd.tv_sec - tsStart.tv_sec) + (tsEnd.tv_nsec - tsStart.tv_nsec) / 1e9;
+
+        fprintf (stderr, "%u simulated days in %.3fms, %s arithmetic\n", nSimulated / 86400, nElapsed * 1000, bFixed ? "Q16.16" : "double");
+
+        return 0;
+    }
+
+    if (nSamples == 0) nSamples = 1;
+    if (nThreads == 0) nThreads = 1;
+
+    size_t nPoints = grain.Count () * mash.Count () * power.Count ();
+    size_t nBrews = nPoints * nSamples;
+
+    std::vector<BrewConfig> configs (nBrews);
+    std::vector<BrewOutcome> outcomes (nBrews);
+
+    for (size_t nBrew = 0; nBrew < nBrews; nBrew++)
+    {
+        size_t nPoint = nBrew / nSamples;
+        uint32_t nState = (uint32_t)(nSeed * 2654435761UL) ^ (uint32_t)(nBrew * 40503UL + 1);
+
+        NextRandom (nState);
+
+        BrewConfig& config = configs[nBrew];
+
+        config.nGrain = grain.At (nPoint % grain.Count ());
+        config.nMashTemp = mash.At ((nPoint / grain.Count ()) % mash.Count ());
+        config.nPower = power.At (nPoint / (grain.Count () * mash.Count ()));
+        config.nAmbient = Uniform (nState, 10.0, 25.0);
+        config.nGrainTemp = config.nAmbient + Uniform (nState, -2.0, 2.0);
+    }
+
+    std::atomic<size_t> nNext (0);
+    std::vector<std::thread> workers;
+    struct timespec tsStart, tsEnd;
+
+    clock_gettime (CLOCK_MONOTONIC, &tsStart);
+
+    for (size_t nCount = 0; nCount < nThreads; nCount++)
+    {
+        workers.push_back (std::thread ([&] () {
+            size_t nBrew;
+
+            while ((nBrew = nNext.fetch_add (1)) < nBrews)
+            {
+                outcomes[nBrew] = bFixed ? RunBrew<Fixed> (configs[nBrew]) : RunBrew<double> (configs[nBrew]);
+            }
+        }));
+    }
+
+    for (size_t nCount = 0; nCount < workers.size (); nCount++)
+    {
+        workers[nCount].join ();
+    }
+
+    clock_gettime (CLOCK_MONOTONIC, &tsEnd);
+
+    printf ("grain_kg,mash_c,power_kw,samples");
+
+    for (int nMetric = 0; nMetric < METRIC_COUNT; nMetric++)
+    {
+        printf (",%s_mean,%s_sd,%s_min,%s_max", metricNames[nMetric], metricNames[nMetric], metricNames[nMetric], metricNames[nMetric]);
+    }
+
+    printf ("\n");
+
+    double nSimulatedMinutes = 0;
+
+    for (size_t nPoint = 0; nPoint < nPoints; nPoint++)
+    {
+        const BrewConfig& config = configs[nPoint * nSamples];
+
+        printf ("%.2f,%.2f,%.2f,%zu", config.nGrain, config.nMashTemp, config.nPower, nSamples);
+
+        for (int nMetric = 0; nMetric < METRIC_COUNT; nMetric++)
+        {
+            double nSum = 0, nSquares = 0, nMin = INFINITY, nMax = -INFINITY;
+
+            for (size_t nSample = 0; nSample < nSamples; nSample++)
+            {
+                double nValue = outcomes[nPoint * nSamples + nSample].metrics[nMetric];
+
+                nSum += nValue;
+                nSquares += nValue * nValue;
+                if (nValue < nMin) nMin = nValue;
+                if (nValue > nMax) nMax = nValue;
+            }
+
+            double nMean = nSum / nSamples;
+            double nVariance = nSquares / nSamples - nMean * nMean;
+
+            printf (",%.3f,%.3f,%.3f,%.3f", nMean, nVariance > 0 ? sqrt (nVariance) : 0.0, nMin, nMax);
+
+            if (nMetric == METRIC_TOTAL) nSimulatedMinutes += nSum;
+        }
+
+        printf ("\n");
+    }
+
+    double nElapsed = (tsEnd.tv_sec - tsStart.tv_sec) + (tsEnd.tv_nsec - tsStart.tv_nsec) / 1e9;
+
+    fprintf (stderr, "%zu brews (%zu points x %zu samples) on %zu threads in %.3fs, %.0f simulated hours per second, %s arithmetic\n",
+             nBrews,
+             nPoints,
+             nSamples,
+             nThreads,
+             nElapsed,
+             nElapsed > 0 ? nSimulatedMinutes / 60.0 / nElapsed : 0.0,
+             bFixed ? "Q16.16" : "double");
+
+    return 0;
+}
@@ -0,0 +1,189 @@
+///
+/// Brewing math tables against the C library
+///
+/// Sweeps every curve of BrewMath.hpp over its grid at 1/4096 of a
+/// step and compares the table lookup with the double reference,
+/// then does the same for the composite calculations (IBU of an
+/// addition, colour of a grain bill, cold volume, hydrometer
+/// correction) on random brews. Prints the largest error of each
+/// against the bound documented in the header, the table sizes and
+/// the cost per call on this host, and fails when a bound is broken.
+///
+/// Use:
+///   brewmath [--samples n] [--seed n]
+///
+
+#include "Arduino.h"
+
+#include "../BrewMath.hpp"
+
+#include <time.h>
+
+static bool bFailed = false;
+
+/// xorshift32
+static uint32_t NextRandom (uint32_t& nState)
+{
+    nState ^= nState << 13;
+    nState ^= nState >> 17;
+    nState ^= nState << 5;
+    return nState;
+}
+
+static double Uniform (uint32_t& nState, double nMin, double nMax)
+{
+    return nMin + (nMax - nMin) * (NextRandom (nState) / 4294967296.0);
+}
+
+static double Nanoseconds ()
+{
+    struct timespec ts;
+
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void Report (const char* pszName, double nError, double nAt, double nBound, const char* pszUnit)
+{
+    bool bPass = nError <= nBound;
+
+    printf ("%-24s %12.3g %12.3g %10.3f %-6s %s\n", pszName, nError, nBound, nAt, pszUnit, bPass ? "ok" : "FAIL");
+
+    if (bPass == false) bFailed = true;
+}
+
+/// Largest error over the grid, from nFrom to the end of it
+template <typename Curve>
+static double Sweep (const char* pszName, double (*pReference) (double), double nFrom, double nBound, const char* pszUnit)
+{
+    const int32_t nStep = 1 << Curve::nShift;
+    const int32_t nFirst = Fixed (Curve::nMin).Raw () + Fixed (nFrom).Raw ();
+    const int32_t nLast = Fixed (Curve::nMin).Raw () + nStep * (int32_t)Curve::nIntervals;
+    double nMax = 0;
+    double nAt = 0;
+
+    for (int32_t nRaw = nFirst; nRaw <= nLast; nRaw += nStep / 4096 > 0 ? nStep / 4096 : 1)
+    {
+        Fixed nValue = Fixed::FromRaw (nRaw);
+        double nError = fabs (BrewTable<Curve>::Lookup (nValue).ToDouble () - pReference (nValue.ToDouble ()));
+
+        if (nError > nMax)
+        {
+            nMax = nError;
+            nAt = nValue.ToDouble ();
+        }
+    }
+
+    Report (pszName, nMax, nAt, nBound, pszUnit);
+
+    return nMax;
+}
+
+/// ns per call of pFunction over nCount inputs, the sum defeats the
+/// optimizer
+template <typename Function>
+static double Cost (Function function, size_t nCount, double& nSink)
+{
+    double nStart = Nanoseconds ();
+
+    for (size_t nIndex = 0; nIndex < nCount; nIndex++)
+    {
+        nSink += function (nIndex);
+    }
+
+    return (Nanoseconds () - nStart) / nCount;
+}
+
+int main (int argc, char** argv)
+{
+    size_t nSamples = 1000000;
+    uint32_t nSeed = 1;
+
+    for (int nCount = 1; nCount < argc; nCount++)
+    {
+        const char* pszValue = nCount + 1 < argc ? argv[nCount + 1] : "";
+
+        if (strcmp (argv[nCount], "--samples") == 0)
+            nSamples = strtoul (pszValue, NULL, 10), nCount++;
+        else if (strcmp (argv[nCount], "--seed") == 0)
+            nSeed = strtoul (pszValue, NULL, 10), nCount++;
+        else
+        {
+            fprintf (stderr, "Use: %s [--samples n] [--seed n]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if (nSamples == 0) nSamples = 1;
+    if (nSeed == 0) nSeed = 1;
+
+    printf ("%-24s %12s %12s %10s %-6s\n", "Curve", "Max error", "Bound", "At", "Unit");
+
+    Sweep<TimeFactorCurve> ("Tinseth time factor", BrewReference::TimeFactor, 0, 2.5e-5, "");
+    Sweep<GravityFactorCurve> ("Tinseth gravity factor", BrewReference::GravityFactor, 0, 2.5e-5, "");
+    Sweep<SrmCurve> ("Morey SRM below 4 MCU", BrewReference::Srm, 0, 0.25, "SRM");
+    Sweep<SrmCurve> ("Morey SRM", BrewReference::Srm, 4, 0.008, "SRM");
+    Sweep<WaterDensityCurve> ("Water density", BrewReference::WaterDensity, 0, 2e-5, "kg/L");
+    Sweep<PlatoCurve> ("Plato", BrewReference::Plato, 0, 3e-4, "P");
+
+    // Composites on random brews
+    uint32_t nState = nSeed;
+    double nIbu = 0, nIbuAt = 0, nSrm = 0, nSrmAt = 0, nVolume = 0, nVolumeAt = 0, nGravity = 0, nGravityAt = 0;
+
+    for (size_t nCount = 0; nCount < nSamples; nCount++)
+    {
+        double nAlpha = Uniform (nState, 2, 20);
+        double nGrams = Uniform (nState, 5, 300);
+        double nMinutes = Uniform (nState, 0, 120);
+        double nLitres = Uniform (nState, 10, 60);
+        double nPoints = Uniform (nState, 30, 100);
+        double nKg = Uniform (nState, 2, 12);
+        double nLovibond = Uniform (nState, 2, 40);
+        double nCelsius = Uniform (nState, 10, 100);
+
+        double nReference = BrewReference::TimeFactor (nMinutes) * BrewReference::GravityFactor (nPoints) * nAlpha * 10 * nGrams / nLitres;
+        double nValue = BrewMath_Ibu (Fixed (nAlpha), Fixed (nGrams), Fixed (nMinutes), Fixed (nLitres), Fixed (nPoints)).ToDouble ();
+
+        double nError = fabs (nValue - nReference);
+        if (nError > nIbu) nIbu = nError, nIbuAt = nReference;
+
+        nReference = BrewReference::Srm (nKg * nLovibond / nLitres * 8.3454);
+        nValue = BrewMath_Srm (Fixed (nKg), Fixed (nLovibond), Fixed (nLitres)).ToDouble ();
+        nError = fabs (nValue - nReference);
+        if (nError > nSrm) nSrm = nError, nSrmAt = nReference;
+
+        nReference = nLitres * BrewReference::WaterDensity (nCelsius) / BrewReference::WaterDensity (20);
+        nValue = BrewMath_ColdVolume (Fixed (nLitres), Fixed (nCelsius)).ToDouble ();
+        nError = fabs (nValue - nReference) / nReference;
+        if (nError > nVolume) nVolume = nError, nVolumeAt = nReference;
+
+        nReference = (1000 + nPoints) * BrewReference::WaterDensity (20) / BrewReference::WaterDensity (nCelsius) - 1000;
+        nValue = BrewMath_CorrectGravity (Fixed (nPoints), Fixed (nCelsius), Fixed (20)).ToDouble ();
+        nError = fabs (nValue - nReference);
+        if (nError > nGravity) nGravity = nError, nGravityAt = nReference;
+    }
+
+    printf ("\n%-24s %12s %12s %10s %-6s\n", "Calculation", "Max error", "Bound", "At", "Unit");
+
+    Report ("IBU of an addition", nIbu, nIbuAt, 0.15, "IBU");
+    Report ("SRM of a grain bill", nSrm, nSrmAt, 0.2, "SRM");
+    Report ("Cold volume", nVolume, nVolumeAt, 3e-5, "rel");
+    Report ("Corrected gravity", nGravity, nGravityAt, 0.03, "pts");
+
+    printf ("\nTables: %u bytes of flash\n", BrewTable<TimeFactorCurve>::GetSize () + BrewTable<GravityFactorCurve>::GetSize () + BrewTable<SrmCurve>::GetSize () +
+                                             BrewTable<WaterDensityCurve>::GetSize () + BrewTable<PlatoCurve>::GetSize ());
+
+    // Cost on this host, the ESP8266 ratio is far larger: no FPU
+    const size_t nCalls = 10000000;
+    double nSink = 0;
+
+    double nTable = Cost ([] (size_t nIndex) { return BrewMath_Utilisation (Fixed::FromRaw ((int32_t)(nIndex & 0x7FFFFF)), Fixed::FromRaw ((int32_t)((nIndex * 7) & 0x7FFFFF))).ToDouble (); }, nCalls, nSink);
+    double nLibrary = Cost ([] (size_t nIndex) { return BrewReference::TimeFactor ((nIndex & 0x7FFFFF) / 65536.0) * BrewReference::GravityFactor (((nIndex * 7) & 0x7FFFFF) / 65536.0); }, nCalls, nSink);
+
+    printf ("Utilisation: %.1f ns per call from the tables, %.1f ns with exp and pow (%g)\n", nTable, nLibrary, nSink > 0 ? 1.0 : 0.0);
+
+    printf ("\n%s\n", bFailed ? "Some errors are above their bounds" : "All errors within their bounds");
+
+    return bFailed ? 1 : 0;
+}
@@ -0,0 +1,10 @@
+///
+/// Linux host shim, there is no radio on the host
+///
+
+#ifndef HOST_ESP8266WIFI_H
+#define HOST_ESP8266WIFI_H
+
+#include "Arduino.h"
+
+#endif
@@ -0,0 +1,142 @@
+///
+/// Flash log decoder
+///
+/// Reads the output of "flashlog export" captured from the terminal,
+/// other lines (prompt, "End, n pages") are skipped. Every page is
+/// checked and decoded through FlashLogFormat.hpp, the same code the
+/// device uses, and its records are printed one per line: log seconds
+/// then every channel in hundredths, tab separated or as CSV. A page
+/// that fails its CRC or does not decode is reported and skipped.
+///
+/// Use:
+///   flashlog [export.txt] [--csv] [--from seconds]
+///
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../FlashLogFormat.hpp"
+
+static int HexDigit (char chValue)
+{
+    if (chValue >= '0' && chValue <= '9') return chValue - '0';
+    if (chValue >= 'A' && chValue <= 'F') return chValue - 'A' + 10;
+    if (chValue >= 'a' && chValue <= 'f') return chValue - 'a' + 10;
+
+    return -1;
+}
+
+/// ':' then the whole page in hex, false for any other line
+static bool ParsePage (const char* pszLine, FlashLogPage& page)
+{
+    const char* pszHex = strchr (pszLine, ':');
+
+    if (pszHex == NULL) return false;
+
+    pszHex++;
+
+    uint8_t* pBuffer = (uint8_t*)&page;
+
+    for (size_t nByte = 0; nByte < sizeof (page); nByte++)
+    {
+        int nHigh = HexDigit (pszHex[nByte * 2]);
+        int nLow = nHigh < 0 ? -1 : HexDigit (pszHex[nByte * 2 + 1]);
+
+        if (nLow < 0) return false;
+
+        pBuffer[nByte] = (uint8_t)(nHigh << 4 | nLow);
+    }
+
+    return true;
+}
+
+int main (int argc, char** argv)
+{
+    const char* pszFile = NULL;
+    bool bCsv = false;
+    uint32_t nFrom = 0;
+
+    for (int nCount = 1; nCount < argc; nCount++)
+    {
+        if (strcmp (argv[nCount], "--csv") == 0)
+            bCsv = true;
+        else if (strcmp (argv[nCount], "--from") == 0 && nCount + 1 < argc)
+            nFrom = strtoul (argv[++nCount], NULL, 10);
+        else if (argv[nCount][0] != '-' && pszFile == NULL)
+            pszFile = argv[nCount];
+        else
+        {
+            fprintf (stderr, "Use: %s [export.txt] [--csv] [--from seconds]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    FILE* pFile = pszFile != NULL ? fopen (pszFile, "r") : stdin;
+
+    if (pFile == NULL)
+    {
+        fprintf (stderr, "%s: can not open\n", pszFile);
+        return 1;
+    }
+
+    char* pszLine = NULL;
+    size_t nCapacity = 0;
+    uint32_t nLine = 0;
+    uint32_t nPages = 0;
+    uint32_t nBad = 0;
+    uint32_t nRecords = 0;
+    uint8_t nChannels = 0;
+    FlashLogPage page;
+
+    while (getline (&pszLine, &nCapacity, pFile) >= 0)
+    {
+        nLine++;
+
+        if (ParsePage (pszLine, page) == false) continue;
+
+        nPages++;
+
+        bool bDecoded = FlashLog_Decode (page, [&] (uint32_t nTime, const int32_t* pnValues) {
+            if (nTime < nFrom) return;
+
+            // Column names again whenever the channel count changes
+            if (page.nChannels != nChannels)
+            {
+                nChannels = page.nChannels;
+
+                printf (bCsv ? "time" : "      time");
+
+                for (uint8_t nChannel = 0; nChannel < nChannels; nChannel++) printf (bCsv ? ",channel%u" : "\tchannel%u", nChannel);
+
+                printf ("\n");
+            }
+
+            printf (bCsv ? "%u" : "%10u", nTime);
+
+            for (uint8_t nChannel = 0; nChannel < page.nChannels; nChannel++)
+            {
+                int32_t nValue = pnValues[nChannel];
+
+                printf ("%c%s%d.%02d", bCsv ? ',' : '\t', nValue < 0 ? "-" : "", abs (nValue) / 100, abs (nValue) % 100);
+            }
+
+            printf ("\n");
+            nRecords++;
+        });
+
+        if (bDecoded == false)
+        {
+            fprintf (stderr, "line %u: bad page, skipped\n", nLine);
+            nBad++;
+        }
+    }
+
+    free (pszLine);
+
+    if (pFile != stdin) fclose (pFile);
+
+    fprintf (stderr, "%u pages, %u bad, %u records\n", nPages, nBad, nRecords);
+
+    return nBad > 0 ? 2 : 0;
+}
@@ -0,0 +1,665 @@
+///
+/// Linux host runtime for BrewerSim2
+///
+/// Implements the Arduino and ESP8266 calls declared by the shims
+/// in this directory: time from CLOCK_MONOTONIC, Serial over
+/// stdin/stdout, digital pins in memory and the e-paper panel
+/// simulated behind SPI. The application itself (BrewerSim2.ino)
+/// is compiled unchanged through Sketch.cpp, host tools link this
+/// file with their own main().
+///
+/// Options:
+///   --panel <file>   e-paper frame dump on every refresh (PBM)
+///   --rtc <file>     backing file for RTC user memory
+///   --flash <dir>    directory backing the LittleFS partition
+///   --matrix <file>  LED matrix text dump on every change
+///   --exit-on-eof    leave when stdin ends (fuzzing and replays)
+///
+
+#include "Arduino.h"
+#include "LittleFS.h"
+#include "SPI.h"
+#include "user_interface.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <malloc.h>
+#include <sys/stat.h>
+#include <sched.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+HardwareSerial Serial;
+SPIClass SPI;
+EspClass ESP;
+FS LittleFS;
+
+static struct timespec tsStart;
+static const char* pszPanelFile = "epaper.pbm";
+static const char* pszRtcFile = "rtcmem.bin";
+static const char* pszFlashDir = "flash";
+static const char* pszMatrixFile = NULL;
+static bool bExitOnEOF = false;
+
+/// Time ------------------------------------------------------------
+
+static uint64_t HostNanoseconds ()
+{
+    struct timespec tsNow;
+
+    clock_gettime (CLOCK_MONOTONIC, &tsNow);
+
+    return (uint64_t)(tsNow.tv_sec - tsStart.tv_sec) * 1000000000ULL + (uint64_t)tsNow.tv_nsec - (uint64_t)tsStart.tv_nsec;
+}
+
+uint32_t millis (void)
+{
+    return (uint32_t)(HostNanoseconds () / 1000000ULL);
+}
+
+uint32_t micros (void)
+{
+    return (uint32_t)(HostNanoseconds () / 1000ULL);
+}
+
+void delay (uint32_t nDelay)
+{
+    struct timespec tsDelay = {(time_t)(nDelay / 1000), (long)(nDelay % 1000) * 1000000L};
+
+    while (nanosleep (&tsDelay, &tsDelay) != 0 && errno == EINTR)
+        ;
+}
+
+void delayMicroseconds (uint32_t nDelay)
+{
+    struct timespec tsDelay = {(time_t)(nDelay / 1000000), (long)(nDelay % 1000000) * 1000L};
+
+    while (nanosleep (&tsDelay, &tsDelay) != 0 && errno == EINTR)
+        ;
+}
+
+void yield (void)
+{
+    sched_yield ();
+}
+
+/// Simulated e-paper panel (4.2" 400x300, 1 bit) ---------------------
+
+#define PANEL_WIDTH 400
+#define PANEL_HEIGHT 300
+#define PANEL_DC_PIN D2
+#define PANEL_BUSY_PIN D1
+
+static uint8_t pins[32];
+static uint8_t panelFrame[PANEL_WIDTH / 8 * PANEL_HEIGHT];
+
+static struct
+{
+    uint8_t nCommand;
+    uint8_t nParam;
+    uint8_t window[9];
+    bool bPartial;
+    uint16_t nX0, nX1, nY0, nY1;
+    uint32_t nCursor;
+    uint32_t nRefreshes;
+} panel;
+
+static void HostPanel_Dump ()
+{
+    FILE* pFile = fopen (pszPanelFile, "wb");
+
+    if (pFile == NULL) return;
+
+    // PBM uses 1 for black, the panel uses 0 for black
+    fprintf (pFile, "P4\n%u %u\n", PANEL_WIDTH, PANEL_HEIGHT);
+
+    for (size_t nCount = 0; nCount < sizeof (panelFrame); nCount++)
+    {
+        fputc (~panelFrame[nCount] & 0xFF, pFile);
+    }
+
+    fclose (pFile);
+}
+
+static void HostPanel_Data (uint8_t nData)
+{
+    switch (panel.nCommand)
+    {
+        case 0x90: // PARTIAL_WINDOW
+            if (panel.nParam < sizeof (panel.window)) panel.window[panel.nParam++] = nData;
+
+            if (panel.nParam == 8)
+            {
+                panel.nX0 = ((panel.window[0] << 8) | panel.window[1]) & 0x1F8;
+                panel.nX1 = ((panel.window[2] << 8) | panel.window[3]);
+                panel.nY0 = (panel.window[4] << 8) | panel.window[5];
+                panel.nY1 = (panel.window[6] << 8) | panel.window[7];
+            }
+            break;
+
+        case 0x13: // DATA_START_TRANSMISSION_2
+        {
+            uint32_t nOffset;
+
+            if (panel.bPartial)
+            {
+                uint32_t nRowBytes = (panel.nX1 - panel.nX0 + 1) / 8;
+
+                if (nRowBytes == 0) break;
+
+                uint32_t nRow = panel.nY0 + panel.nCursor / nRowBytes;
+                uint32_t nColumn = panel.nX0 / 8 + panel.nCursor % nRowBytes;
+
+                nOffset = nRow * (PANEL_WIDTH / 8) + nColumn;
+            }
+            else
+            {
+                nOffset = panel.nCursor;
+            }
+
+            if (nOffset < sizeof (panelFrame)) panelFrame[nOffset] = nData;
+
+            panel.nCursor++;
+        }
+        break;
+
+        default:
+            break;
+    }
+}
+
+static void HostPanel_Command (uint8_t nCommand)
+{
+    panel.nCommand = nCommand;
+    panel.nParam = 0;
+    panel.nCursor = 0;
+
+    switch (nCommand)
+    {
+        case 0x91: // PARTIAL_IN
+            panel.bPartial = true;
+            break;
+
+        case 0x92: // PARTIAL_OUT
+            panel.bPartial = false;
+            break;
+
+        case 0x12: // DISPLAY_REFRESH
+            panel.nRefreshes++;
+            HostPanel_Dump ();
+            break;
+
+        default:
+            break;
+    }
+}
+
+/// Number of full panel refreshes since start
+uint32_t HostPanel_GetRefreshes ()
+{
+    return panel.nRefreshes;
+}
+
+/// Simulated MAX7219 chain -------------------------------------------
+
+#define MATRIX_HOST_CS_PIN D3
+#define MATRIX_HOST_DEVICES 16
+
+static struct
+{
+    uint8_t words[MATRIX_HOST_DEVICES * 2];
+    uint32_t nShifted;
+    uint8_t rows[MATRIX_HOST_DEVICES][8];
+    uint8_t nDevices;
+    uint32_t nLatches;
+    bool bSelected; // pins[] start low, only an explicit low selects
+} matrix;
+
+static void HostMatrix_Dump ()
+{
+    if (pszMatrixFile == NULL) return;
+
+    FILE* pFile = fopen (pszMatrixFile, "w");
+
+    if (pFile == NULL) return;
+
+    for (uint8_t nRow = 0; nRow < 8; nRow++)
+    {
+        for (uint8_t nDevice = 0; nDevice < matrix.nDevices; nDevice++)
+        {
+            for (uint8_t nBit = 0; nBit < 8; nBit++)
+            {
+                fputc (matrix.rows[nDevice][nRow] & (0x80 >> nBit) ? '#' : '.', pFile);
+            }
+        }
+
+        fputc ('\n', pFile);
+    }
+
+    fclose (pFile);
+}
+
+static void HostMatrix_Data (uint8_t nData)
+{
+    if (matrix.nShifted < sizeof (matrix.words)) matrix.words[matrix.nShifted] = nData;
+
+    matrix.nShifted++;
+}
+
+/// Rising chip select, the last word shifted in sits in device 0
+static void HostMatrix_Latch ()
+{
+    uint32_t nWords = (matrix.nShifted < sizeof (matrix.words) ? matrix.nShifted : sizeof (matrix.words)) / 2;
+    bool bChanged = false;
+
+    for (uint32_t nDevice = 0; nDevice < nWords; nDevice++)
+    {
+        uint8_t nRegister = matrix.words[(nWords - 1 - nDevice) * 2];
+        uint8_t nValue = matrix.words[(nWords - 1 - nDevice) * 2 + 1];
+
+        if (nDevice >= matrix.nDevices) matrix.nDevices = nDevice + 1;
+
+        if (nRegister >= 1 && nRegister <= 8 && matrix.rows[nDevice][nRegister - 1] != nValue)
+        {
+            matrix.rows[nDevice][nRegister - 1] = nValue;
+            bChanged = true;
+        }
+    }
+
+    matrix.nShifted = 0;
+    matrix.nLatches++;
+
+    if (bChanged) HostMatrix_Dump ();
+}
+
+/// Digital I/O -------------------------------------------------------
+
+void pinMode (uint8_t nPin, uint8_t nMode)
+{
+}
+
+void digitalWrite (uint8_t nPin, uint8_t nValue)
+{
+    if (nPin == MATRIX_HOST_CS_PIN)
+    {
+        if (matrix.bSelected && nValue) HostMatrix_Latch ();
+
+        matrix.bSelected = nValue == LOW;
+    }
+
+    if (nPin < sizeof (pins)) pins[nPin] = nValue ? HIGH : LOW;
+}
+
+int digitalRead (uint8_t nPin)
+{
+    // The simulated panel is never busy
+    if (nPin == PANEL_BUSY_PIN) return HIGH;
+
+    return nPin < sizeof (pins) ? pins[nPin] : LOW;
+}
+
+void shiftOut (uint8_t nDataPin, uint8_t nClockPin, uint8_t nBitOrder, uint8_t nValue)
+{
+    for (uint8_t nBit = 0; nBit < 8; nBit++)
+    {
+        digitalWrite (nDataPin, nBitOrder == LSBFIRST ? (nValue >> nBit) & 1 : (nValue >> (7 - nBit)) & 1);
+        digitalWrite (nClockPin, HIGH);
+        digitalWrite (nClockPin, LOW);
+    }
+}
+
+void SPIClass::begin ()
+{
+}
+
+uint8_t SPIClass::transfer (uint8_t nData)
+{
+    if (matrix.bSelected)
+        HostMatrix_Data (nData);
+    else if (pins[PANEL_DC_PIN] == LOW)
+        HostPanel_Command (nData);
+    else
+        HostPanel_Data (nData);
+
+    return 0;
+}
+
+void SPIClass::writeBytes (const uint8_t* pData, uint32_t nSize)
+{
+    while (nSize-- > 0) transfer (*pData++);
+}
+
+/// Serial over stdin/stdout -------------------------------------------
+
+static struct termios termOriginal;
+static bool bTermChanged = false;
+
+static void HostSerial_Restore ()
+{
+    if (bTermChanged) tcsetattr (STDIN_FILENO, TCSANOW, &termOriginal);
+}
+
+void HardwareSerial::begin (unsigned long nBaud)
+{
+    if (bStarted) return;
+
+    bStarted = true;
+
+    if (isatty (STDIN_FILENO) && tcgetattr (STDIN_FILENO, &termOriginal) == 0)
+    {
+        struct termios termRaw = termOriginal;
+
+        // Character at a time, the terminal does its own echo, ^C still works
+        termRaw.c_lflag &= ~(ICANON | ECHO);
+        termRaw.c_iflag &= ~(ICRNL);
+        termRaw.c_cc[VMIN] = 0;
+        termRaw.c_cc[VTIME] = 0;
+
+        if (tcsetattr (STDIN_FILENO, TCSANOW, &termRaw) == 0)
+        {
+            bTermChanged = true;
+            atexit (HostSerial_Restore);
+        }
+    }
+
+    fcntl (STDIN_FILENO, F_SETFL, fcntl (STDIN_FILENO, F_GETFL) | O_NONBLOCK);
+}
+
+int HardwareSerial::peek ()
+{
+    if (nPeek < 0)
+    {
+        uint8_t nValue;
+        ssize_t nRead = ::read (STDIN_FILENO, &nValue, 1);
+
+        if (nRead == 1)
+        {
+            nPeek = nValue;
+        }
+        else if (nRead == 0 && bExitOnEOF)
+        {
+            fflush (stdout);
+            exit (0);
+        }
+    }
+
+    return nPeek;
+}
+
+int HardwareSerial::available ()
+{
+    return peek () < 0 ? 0 : 1;
+}
+
+int HardwareSerial::read ()
+{
+    int nValue = peek ();
+
+    nPeek = -1;
+
+    return nValue;
+}
+
+size_t HardwareSerial::write (uint8_t nValue)
+{
+    return fwrite (&nValue, 1, 1, stdout);
+}
+
+size_t HardwareSerial::write (const uint8_t* pBuffer, size_t nSize)
+{
+    return fwrite (pBuffer, 1, nSize, stdout);
+}
+
+void HardwareSerial::flush ()
+{
+    fflush (stdout);
+}
+
+/// ESP8266 system ----------------------------------------------------
+
+static uint32_t rtcMemory[128];
+
+uint32_t EspClass::getFreeHeap ()
+{
+    struct mallinfo2 info = mallinfo2 ();
+
+    return (uint32_t)info.fordblks;
+}
+
+uint16_t EspClass::getMaxFreeBlockSize ()
+{
+    uint32_t nFree = getFreeHeap ();
+
+    return nFree > 0xFFFF ? 0xFFFF : (uint16_t)nFree;
+}
+
+uint8_t EspClass::getHeapFragmentation ()
+{
+    return 0;
+}
+
+void EspClass::getHeapStats (uint32_t* pnFree, uint16_t* pnMax, uint8_t* pnFragmentation)
+{
+    if (pnFree != NULL) *pnFree = getFreeHeap ();
+    if (pnMax != NULL) *pnMax = getMaxFreeBlockSize ();
+    if (pnFragmentation != NULL) *pnFragmentation = getHeapFragmentation ();
+}
+
+uint32_t EspClass::getChipId ()
+{
+    return 0x00B5E11;
+}
+
+const char* EspClass::getSdkVersion ()
+{
+    return "linux-host";
+}
+
+uint8_t EspClass::getCpuFreqMHz ()
+{
+    return 80;
+}
+
+uint32_t EspClass::getCycleCount ()
+{
+    return (uint32_t)(HostNanoseconds () * 80 / 1000);
+}
+
+String EspClass::getResetReason ()
+{
+    return String ("Host start");
+}
+
+rst_info* EspClass::getResetInfoPtr ()
+{
+    static rst_info info;
+
+    return &info;
+}
+
+bool EspClass::rtcUserMemoryRead (uint32_t nOffset, uint32_t* pData, size_t nSize)
+{
+    if (nOffset * 4 + nSize > sizeof (rtcMemory)) return false;
+
+    FILE* pFile = fopen (pszRtcFile, "rb");
+
+    if (pFile != NULL)
+    {
+        size_t nRead = fread (rtcMemory, 1, sizeof (rtcMemory), pFile);
+        (void)nRead;
+        fclose (pFile);
+    }
+
+    memcpy (pData, &rtcMemory[nOffset], nSize);
+
+    return true;
+}
+
+bool EspClass::rtcUserMemoryWrite (uint32_t nOffset, uint32_t* pData, size_t nSize)
+{
+    if (nOffset * 4 + nSize > sizeof (rtcMemory)) return false;
+
+    memcpy (&rtcMemory[nOffset], pData, nSize);
+
+    FILE* pFile = fopen (pszRtcFile, "wb");
+
+    if (pFile != NULL)
+    {
+        fwrite (rtcMemory, 1, sizeof (rtcMemory), pFile);
+        fclose (pFile);
+    }
+
+    return true;
+}
+
+void EspClass::restart ()
+{
+    fflush (stdout);
+    exit (0);
+}
+
+uint32_t system_get_free_heap_size (void)
+{
+    return ESP.getFreeHeap ();
+}
+
+uint32_t system_get_chip_id (void)
+{
+    return ESP.getChipId ();
+}
+
+const char* system_get_sdk_version (void)
+{
+    return ESP.getSdkVersion ();
+}
+
+uint8_t system_get_cpu_freq (void)
+{
+    return ESP.getCpuFreqMHz ();
+}
+
+/// Flash file system --------------------------------------------------
+
+/// Maps a LittleFS path onto the backing directory
+static std::string HostFlash_Path (const char* pszPath)
+{
+    std::string strPath (pszFlashDir);
+
+    if (pszPath[0] != '/') strPath += '/';
+
+    return strPath + pszPath;
+}
+
+bool Dir::next ()
+{
+    struct dirent* pEntry;
+
+    while (pDir != NULL && (pEntry = readdir (pDir)) != NULL)
+    {
+        struct stat fileStat;
+        std::string strFull = HostFlash_Path (strPath.c_str ()) + "/" + pEntry->d_name;
+
+        if (stat (strFull.c_str (), &fileStat) != 0 || S_ISREG (fileStat.st_mode) == false) continue;
+
+        strName = String (pEntry->d_name);
+        nSize = (size_t)fileStat.st_size;
+
+        return true;
+    }
+
+    if (pDir != NULL) closedir (pDir);
+    pDir = NULL;
+
+    return false;
+}
+
+bool FS::begin ()
+{
+    ::mkdir (pszFlashDir, 0755);
+
+    return true;
+}
+
+bool FS::format ()
+{
+    return true;
+}
+
+bool FS::exists (const char* pszPath)
+{
+    struct stat fileStat;
+
+    return stat (HostFlash_Path (pszPath).c_str (), &fileStat) == 0;
+}
+
+bool FS::remove (const char* pszPath)
+{
+    return unlink (HostFlash_Path (pszPath).c_str ()) == 0;
+}
+
+bool FS::mkdir (const char* pszPath)
+{
+    return ::mkdir (HostFlash_Path (pszPath).c_str (), 0755) == 0 || errno == EEXIST;
+}
+
+File FS::open (const char* pszPath, const char* pszMode)
+{
+    std::string strMode (pszMode);
+
+    // Arduino modes are text, the host stores bytes
+    if (strMode.find ('b') == std::string::npos) strMode += 'b';
+
+    return File (fopen (HostFlash_Path (pszPath).c_str (), strMode.c_str ()));
+}
+
+Dir FS::openDir (const char* pszPath)
+{
+    return Dir (opendir (HostFlash_Path (pszPath).c_str ()), String (pszPath));
+}
+
+/// Entry point helpers -----------------------------------------------
+
+/// Starts the clock, every host program calls it first
+void Host_Init ()
+{
+    clock_gettime (CLOCK_MONOTONIC, &tsStart);
+
+    // Output is line buffered so the terminal feels interactive
+    setvbuf (stdout, NULL, _IOLBF, 0);
+}
+
+/// Parses the runtime options listed at the top of this file
+bool Host_ParseOptions (int argc, char** argv)
+{
+    for (int nCount = 1; nCount < argc; nCount++)
+    {
+        if (strcmp (argv[nCount], "--panel") == 0 && nCount + 1 < argc)
+        {
+            pszPanelFile = argv[++nCount];
+        }
+        else if (strcmp (argv[nCount], "--rtc") == 0 && nCount + 1 < argc)
+        {
+            pszRtcFile = argv[++nCount];
+        }
+        else if (strcmp (argv[nCount], "--flash") == 0 && nCount + 1 < argc)
+        {
+            pszFlashDir = argv[++nCount];
+        }
+        else if (strcmp (argv[nCount], "--matrix") == 0 && nCount + 1 < argc)
+        {
+            pszMatrixFile = argv[++nCount];
+        }
+        else if (strcmp (argv[nCount], "--exit-on-eof") == 0)
+        {
+            bExitOnEOF = true;
+        }
+        else
+        {
+            fprintf (stderr, "Use: %s [--panel file.pbm] [--rtc file] [--flash dir] [--matrix file] [--exit-on-eof]\n", argv[0]);
+            return false;
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,807 @@
+///
+/// Layout compiler
+///
+/// Turns text screen definitions into the flat binary blob described
+/// in LayoutFormat.hpp. The grid and box layout is resolved here, down
+/// to pixel rectangles aligned for the panel partial window, and every
+/// widget is checked against the panel, its neighbours and its fonts,
+/// so the device only binds, renders and diffs.
+///
+/// Use:
+///   layoutcompiler <input.layout> [-o output.bin]
+///   layoutcompiler <input.layout> --header <symbol> [-o output.h]
+///   layoutcompiler --dump <input.bin>
+///
+/// Text format, one statement per line, '#' starts a comment:
+///   panel 400 300                     pixels, once, before any screen
+///   screen "Brewhouse"                starts a screen
+///   grid 2 4 [margin 4] [gap 4]       columns and rows of the screen
+///   box 0 2 2 2 grid 3 1 [gap 4]      nested grid over cells (col row
+///   ...                               cols rows) of the enclosing one,
+///   end                               closed by end
+///   text  <col> <row> [<cols> <rows>] options
+///   value <col> <row> [<cols> <rows>] options
+///   bar   <col> <row> [<cols> <rows>] options
+///
+/// Widget options:
+///   label "Mash"        static text, or caption of a value or bar
+///   source <name>       data source (see LAYOUT_SOURCES)
+///   font 8|12|16|20|24  glyph height of the text or value
+///   decimals 0..2       value digits after the point
+///   unit "C"            shown after the value
+///   min <n> max <n>     bar range, in source units
+///   border, invert      frame, white on black
+///   duration            value shown as h:mm:ss, h:mm from resolution 60
+///
+/// Binding options, they decide when a value or bar is redrawn:
+///   resolution <n>      source units the value is rounded to, defaults
+///                       to the last decimal shown (or a bar pixel)
+///   hysteresis <n>      how far past a rounding step the value has to
+///                       move before it is shown, source units
+///   interval <ms>       minimum time between two redraws
+///
+
+#include "../LayoutFormat.hpp"
+#include "SourceLine.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#define LAYOUT_SOURCE_NAME(ID, NAME) NAME,
+
+static const char* const sourceNames[] = {LAYOUT_SOURCES (LAYOUT_SOURCE_NAME)};
+
+/// Glyph widths of the panel fonts (epd4in2/font*.cpp) by height
+static const struct
+{
+    uint32_t nHeight;
+    uint32_t nWidth;
+} fonts[] = {{8, 5}, {12, 7}, {16, 11}, {20, 14}, {24, 17}};
+
+/// Captions of values and bars use the 12 pixel font
+#define CAPTION_FONT 12
+#define PADDING 4
+
+struct Region
+{
+    double nX;
+    double nY;
+    double nWidth;
+    double nHeight;
+    uint32_t nColumns;
+    uint32_t nRows;
+    double nGap;
+};
+
+struct WidgetSource
+{
+    LayoutWidget widget;
+    std::string strLabel;
+    std::string strUnit;
+    uint32_t nLine;
+};
+
+struct ScreenSource
+{
+    std::string strName;
+    std::vector<WidgetSource> widgets;
+};
+
+struct LayoutSourceFile
+{
+    uint32_t nWidth;
+    uint32_t nHeight;
+    std::vector<ScreenSource> screens;
+};
+
+static const char* pszInput = "";
+static uint32_t nLine = 0;
+static uint32_t nErrors = 0;
+
+static void Error (const char* pszMessage, const char* pszDetail = "")
+{
+    if (nLine > 0)
+        fprintf (stderr, "%s:%u: error: %s%s\n", pszInput, nLine, pszMessage, pszDetail);
+    else
+        fprintf (stderr, "%s: error: %s%s\n", pszInput, pszMessage, pszDetail);
+    nErrors++;
+}
+
+/// Splits a line into words, double quotes group words together
+static std::vector<std::string> Tokenize (const char* pszLine)
+{
+    std::vector<std::string> tokens;
+    const char* pszCursor = pszLine;
+
+    while (*pszCursor != '\0')
+    {
+        while (*pszCursor == ' ' || *pszCursor == '\t' || *pszCursor == '\r' || *pszCursor == '\n') pszCursor++;
+
+        if (*pszCursor == '\0' || *pszCursor == '#') break;
+
+        std::string strToken;
+
+        if (*pszCursor == '"')
+        {
+            pszCursor++;
+
+            while (*pszCursor != '\0' && *pszCursor != '"') strToken += *pszCursor++;
+
+            if (*pszCursor != '"')
+            {
+                Error ("unterminated string");
+                break;
+            }
+
+            pszCursor++;
+        }
+        else
+        {
+            while (*pszCursor != '\0' && strchr (" \t\r\n#", *pszCursor) == NULL) strToken += *pszCursor++;
+        }
+
+        tokens.push_back (strToken);
+    }
+
+    return tokens;
+}
+
+static bool Number (const std::string& strToken, double nMin, double nMax, double& nValue, const char* pszWhat)
+{
+    char* pszEnd;
+
+    nValue = strtod (strToken.c_str (), &pszEnd);
+
+    if (strToken.empty () || *pszEnd != '\0')
+    {
+        Error ("not a number: ", strToken.c_str ());
+        return false;
+    }
+
+    if (nValue < nMin || nValue > nMax)
+    {
+        char szMessage[96];
+
+        snprintf (szMessage, sizeof (szMessage), "%s out of range [%g, %g]: ", pszWhat, nMin, nMax);
+        Error (szMessage, strToken.c_str ());
+        return false;
+    }
+
+    return true;
+}
+
+static uint32_t FontWidth (uint32_t nHeight)
+{
+    for (size_t nCount = 0; nCount < sizeof (fonts) / sizeof (fonts[0]); nCount++)
+    {
+        if (fonts[nCount].nHeight == nHeight) return fonts[nCount].nWidth;
+    }
+
+    return 0;
+}
+
+/// Reads "<col> <row> [<cols> <rows>]" at tokens[nIndex], returns the
+/// index of the first token after it, 0 on error
+static size_t Cell (const std::vector<std::string>& tokens, size_t nIndex, const Region& region, uint32_t cell[4])
+{
+    uint8_t nCount;
+    double nValue;
+    char* pszEnd;
+
+    cell[2] = cell[3] = 1;
+
+    for (nCount = 0; nCount < 4 && nIndex < tokens.size (); nCount++, nIndex++)
+    {
+        // The spans are optional, the cell ends at the first word
+        strtod (tokens[nIndex].c_str (), &pszEnd);
+
+        if (tokens[nIndex].empty () || *pszEnd != '\0') break;
+
+        if (Number (tokens[nIndex], nCount < 2 ? 0 : 1, 64, nValue, "cell") == false) return 0;
+
+        cell[nCount] = (uint32_t)nValue;
+    }
+
+    if (nCount != 2 && nCount != 4)
+    {
+        Error ("cell is <col> <row> [<cols> <rows>]");
+        return 0;
+    }
+
+    if (cell[0] + cell[2] > region.nColumns || cell[1] + cell[3] > region.nRows)
+    {
+        Error ("cell outside of its grid");
+        return 0;
+    }
+
+    return nIndex;
+}
+
+/// Pixel rectangle of a cell
+static bool Resolve (const Region& region, const uint32_t cell[4], Region& rect)
+{
+    double nCellWidth = (region.nWidth - region.nGap * (region.nColumns - 1)) / region.nColumns;
+    double nCellHeight = (region.nHeight - region.nGap * (region.nRows - 1)) / region.nRows;
+
+    rect.nX = region.nX + cell[0] * (nCellWidth + region.nGap);
+    rect.nY = region.nY + cell[1] * (nCellHeight + region.nGap);
+    rect.nWidth = cell[2] * nCellWidth + (cell[2] - 1) * region.nGap;
+    rect.nHeight = cell[3] * nCellHeight + (cell[3] - 1) * region.nGap;
+    rect.nColumns = rect.nRows = 1;
+    rect.nGap = 0;
+
+    return nCellWidth > 0 && nCellHeight > 0;
+}
+
+static void ParseWidget (const std::vector<std::string>& tokens, const Region& region, LayoutSourceFile& layout)
+{
+    WidgetSource source;
+    LayoutWidget& widget = source.widget;
+    uint32_t cell[4];
+    double nValue;
+    double nResolution = 0;
+    bool bRange = false;
+
+    memset (&widget, 0, sizeof (widget));
+
+    widget.nType = tokens[0] == "text" ? LAYOUT_WIDGET_TEXT : tokens[0] == "value" ? LAYOUT_WIDGET_VALUE : LAYOUT_WIDGET_BAR;
+    widget.nFont = 16;
+    widget.nMax = 100 * 100;
+    source.nLine = nLine;
+
+    size_t nIndex = Cell (tokens, 1, region, cell);
+
+    if (nIndex == 0) return;
+
+    for (; nIndex < tokens.size (); nIndex++)
+    {
+        const std::string& strOption = tokens[nIndex];
+        bool bArgument = nIndex + 1 < tokens.size ();
+
+        if (strOption == "border")
+        {
+            widget.nFlags |= LAYOUT_BORDER;
+        }
+        else if (strOption == "invert")
+        {
+            widget.nFlags |= LAYOUT_INVERT;
+        }
+        else if (strOption == "duration")
+        {
+            widget.nFlags |= LAYOUT_DURATION;
+        }
+        else if (strOption == "label" && bArgument)
+        {
+            source.strLabel = tokens[++nIndex];
+
+            if (source.strLabel.size () > 31) Error ("label longer than 31 characters");
+        }
+        else if (strOption == "unit" && bArgument)
+        {
+            source.strUnit = tokens[++nIndex];
+
+            if (source.strUnit.size () > 7) Error ("unit longer than 7 characters");
+        }
+        else if (strOption == "source" && bArgument)
+        {
+            const std::string& strName = tokens[++nIndex];
+
+            for (widget.nSource = 0; widget.nSource < LAYOUT_SOURCE_COUNT; widget.nSource++)
+            {
+                if (strName == sourceNames[widget.nSource]) break;
+            }
+
+            if (widget.nSource == LAYOUT_SOURCE_COUNT) Error ("unknown source: ", strName.c_str ());
+        }
+        else if (strOption == "font" && bArgument)
+        {
+            if (Number (tokens[++nIndex], 8, 24, nValue, "font") && FontWidth ((uint32_t)nValue) == 0) Error ("no such font: ", tokens[nIndex].c_str ());
+
+            widget.nFont = (uint32_t)nValue;
+        }
+        else if (strOption == "decimals" && bArgument)
+        {
+            if (Number (tokens[++nIndex], 0, 2, nValue, "decimals")) widget.nDecimals = (uint32_t)nValue;
+        }
+        else if (strOption == "resolution" && bArgument)
+        {
+            if (Number (tokens[++nIndex], 0.01, 1e6, nValue, "resolution")) nResolution = nValue;
+        }
+        else if (strOption == "hysteresis" && bArgument)
+        {
+            if (Number (tokens[++nIndex], 0, 1e6, nValue, "hysteresis")) widget.nHysteresis = (int32_t)lround (nValue * 100);
+        }
+        else if (strOption == "interval" && bArgument)
+        {
+            if (Number (tokens[++nIndex], 0, 3600000, nValue, "interval")) widget.nInterval = (uint32_t)nValue;
+        }
+        else if ((strOption == "min" || strOption == "max") && bArgument)
+        {
+            if (Number (tokens[++nIndex], -1e6, 1e6, nValue, strOption.c_str ()))
+            {
+                (strOption == "min" ? widget.nMin : widget.nMax) = (int32_t)lround (nValue * 100);
+            }
+
+            bRange = true;
+        }
+        else
+        {
+            Error ("unknown widget option or missing argument: ", strOption.c_str ());
+        }
+    }
+
+    Region rect;
+
+    if (Resolve (region, cell, rect) == false)
+    {
+        Error ("grid too small for its gaps");
+        return;
+    }
+
+    // Snapped inwards, a widget never leaves its cell
+    uint32_t nX0 = (uint32_t)ceil (rect.nX / 8) * 8;
+    uint32_t nX1 = (uint32_t)floor ((rect.nX + rect.nWidth) / 8) * 8;
+
+    widget.nX = nX0;
+    widget.nY = (uint32_t)lround (rect.nY);
+    widget.nWidth = nX1 > nX0 ? nX1 - nX0 : 0;
+    widget.nHeight = (uint32_t)lround (rect.nY + rect.nHeight) - widget.nY;
+
+    // Finer than the display only makes redraws that show nothing new
+    if (nResolution == 0)
+    {
+        nResolution = widget.nFlags & LAYOUT_DURATION ? 1 : pow (10, -(double)widget.nDecimals);
+
+        if (widget.nType == LAYOUT_WIDGET_BAR && widget.nWidth > 2 * PADDING) nResolution = fmax (nResolution, (widget.nMax - widget.nMin) / 100.0 / (widget.nWidth - 2 * PADDING));
+    }
+
+    widget.nResolution = (int32_t)lround (nResolution * 100);
+
+    if (widget.nType == LAYOUT_WIDGET_TEXT && (widget.nHysteresis != 0 || widget.nInterval != 0)) Error ("text has no binding");
+
+    // What has to fit: caption line, then the text, value or bar
+    uint32_t nCaption = widget.nType != LAYOUT_WIDGET_TEXT && source.strLabel.empty () == false ? CAPTION_FONT + 2 : 0;
+    uint32_t nContent = widget.nType == LAYOUT_WIDGET_BAR ? 6 : widget.nFont;
+    uint32_t nTextWidth = (uint32_t)source.strLabel.size () * FontWidth (widget.nType == LAYOUT_WIDGET_TEXT ? widget.nFont : CAPTION_FONT);
+
+    if (widget.nType == LAYOUT_WIDGET_TEXT && source.strLabel.empty ()) Error ("text needs a label");
+    if (widget.nType != LAYOUT_WIDGET_TEXT && widget.nSource == LAYOUT_SOURCE_NONE) Error ("value and bar need a source");
+    if (widget.nType == LAYOUT_WIDGET_TEXT && widget.nSource != LAYOUT_SOURCE_NONE) Error ("text can not have a source");
+    if (widget.nType != LAYOUT_WIDGET_BAR && bRange) Error ("min and max are only for bars");
+    if (widget.nMin >= widget.nMax) Error ("bar min must be below max");
+
+    if (widget.nWidth < 8 || widget.nHeight < nCaption + nContent + 2 * PADDING)
+    {
+        char szMessage[96];
+
+        snprintf (szMessage, sizeof (szMessage), "cell of %ux%u pixels too small for the widget", widget.nWidth, widget.nHeight);
+        Error (szMessage);
+    }
+    else if (nTextWidth + 2 * PADDING > widget.nWidth)
+    {
+        Error ("label does not fit: ", source.strLabel.c_str ());
+    }
+
+    if (layout.screens.back ().widgets.size () == LAYOUT_MAX_WIDGETS) Error ("too many widgets on the screen");
+
+    layout.screens.back ().widgets.push_back (source);
+}
+
+static bool Parse (FILE* pFile, LayoutSourceFile& layout)
+{
+    char szLine[256];
+    bool bTooLong;
+    std::vector<Region> regions;
+
+    layout.nWidth = 400;
+    layout.nHeight = 300;
+
+    while (Source_ReadLine (pFile, szLine, sizeof (szLine), bTooLong))
+    {
+        nLine++;
+
+        if (bTooLong)
+        {
+            Error ("line too long");
+            continue;
+        }
+
+        std::vector<std::string> tokens = Tokenize (szLine);
+
+        if (tokens.empty ()) continue;
+
+        const std::string& strKeyword = tokens[0];
+        size_t nArgs = tokens.size () - 1;
+        double nA, nB;
+
+        if (strKeyword == "panel" && nArgs == 2)
+        {
+            if (layout.screens.empty () == false) Error ("panel must come before the screens");
+
+            if (Number (tokens[1], 8, 2048, nA, "panel width") && Number (tokens[2], 8, 2048, nB, "panel height"))
+            {
+                if ((uint32_t)nA % 8 != 0) Error ("panel width must be a multiple of 8");
+
+                layout.nWidth = (uint32_t)nA;
+                layout.nHeight = (uint32_t)nB;
+            }
+        }
+        else if (strKeyword == "screen" && nArgs == 1)
+        {
+            if (regions.size () > 1) Error ("box not closed before the next screen");
+            if (tokens[1].empty () || tokens[1].size () > 31) Error ("screen name must be 1 to 31 characters");
+            if (layout.screens.size () == LAYOUT_MAX_SCREENS) Error ("too many screens");
+
+            layout.screens.push_back ({tokens[1], {}});
+            regions.clear ();
+        }
+        else if (layout.screens.empty ())
+        {
+            Error ("statement before the first screen: ", strKeyword.c_str ());
+        }
+        else if (strKeyword == "grid" && nArgs >= 2)
+        {
+            Region region = {0, 0, (double)layout.nWidth, (double)layout.nHeight, 1, 1, 0};
+            double nMargin = 0;
+
+            if (regions.empty () == false) Error ("grid must come once, right after screen");
+
+            if (Number (tokens[1], 1, 64, nA, "grid columns") && Number (tokens[2], 1, 64, nB, "grid rows"))
+            {
+                region.nColumns = (uint32_t)nA;
+                region.nRows = (uint32_t)nB;
+            }
+
+            for (size_t nIndex = 3; nIndex < tokens.size (); nIndex++)
+            {
+                if (tokens[nIndex] == "margin" && nIndex + 1 < tokens.size ())
+                    Number (tokens[++nIndex], 0, 64, nMargin, "margin");
+                else if (tokens[nIndex] == "gap" && nIndex + 1 < tokens.size ())
+                    Number (tokens[++nIndex], 0, 64, region.nGap, "gap");
+                else
+                    Error ("unknown grid option: ", tokens[nIndex].c_str ());
+            }
+
+            region.nX = region.nY = nMargin;
+            region.nWidth -= 2 * nMargin;
+            region.nHeight -= 2 * nMargin;
+
+            regions.push_back (region);
+        }
+        else if (regions.empty ())
+        {
+            Error ("screen needs a grid before: ", strKeyword.c_str ());
+        }
+        else if (strKeyword == "box")
+        {
+            uint32_t cell[4];
+            size_t nIndex = Cell (tokens, 1, regions.back (), cell);
+            Region region;
+
+            if (nIndex == 0) continue;
+
+            if (Resolve (regions.back (), cell, region) == false) Error ("grid too small for its gaps");
+
+            for (; nIndex < tokens.size (); nIndex++)
+            {
+                if (tokens[nIndex] == "grid" && nIndex + 2 < tokens.size ())
+                {
+                    if (Number (tokens[nIndex + 1], 1, 64, nA, "grid columns") && Number (tokens[nIndex + 2], 1, 64, nB, "grid rows"))
+                    {
+                        region.nColumns = (uint32_t)nA;
+                        region.nRows = (uint32_t)nB;
+                    }
+
+                    nIndex += 2;
+                }
+                else if (tokens[nIndex] == "gap" && nIndex + 1 < tokens.size ())
+                {
+                    Number (tokens[++nIndex], 0, 64, region.nGap, "gap");
+                }
+                else
+                {
+                    Error ("unknown box option: ", tokens[nIndex].c_str ());
+                }
+            }
+
+            regions.push_back (region);
+        }
+        else if (strKeyword == "end" && nArgs == 0)
+        {
+            if (regions.size () < 2)
+                Error ("end without box");
+            else
+                regions.pop_back ();
+        }
+        else if (strKeyword == "text" || strKeyword == "value" || strKeyword == "bar")
+        {
+            ParseWidget (tokens, regions.back (), layout);
+        }
+        else
+        {
+            Error ("unknown statement or wrong argument count: ", strKeyword.c_str ());
+        }
+    }
+
+    nLine = 0;
+
+    if (regions.size () > 1) Error ("box not closed at the end of the file");
+
+    if (layout.screens.empty ()) Error ("at least one screen is needed");
+
+    // Widgets are redrawn on their own, they must not overlap
+    for (size_t nScreen = 0; nScreen < layout.screens.size (); nScreen++)
+    {
+        const std::vector<WidgetSource>& widgets = layout.screens[nScreen].widgets;
+
+        nLine = 0;
+
+        if (widgets.empty ()) Error ("screen without widgets: ", layout.screens[nScreen].strName.c_str ());
+
+        for (size_t nFirst = 0; nFirst < widgets.size (); nFirst++)
+        {
+            const LayoutWidget& first = widgets[nFirst].widget;
+
+            for (size_t nSecond = nFirst + 1; nSecond < widgets.size (); nSecond++)
+            {
+                const LayoutWidget& second = widgets[nSecond].widget;
+
+                if (first.nX < second.nX + second.nWidth && second.nX < first.nX + first.nWidth &&
+                    first.nY < second.nY + second.nHeight && second.nY < first.nY + first.nHeight)
+                {
+                    char szMessage[96];
+
+                    nLine = widgets[nSecond].nLine;
+                    snprintf (szMessage, sizeof (szMessage), "widget overlaps the one on line %u", widgets[nFirst].nLine);
+                    Error (szMessage);
+                }
+            }
+        }
+    }
+
+    nLine = 0;
+
+    return nErrors == 0;
+}
+
+template <typename Type>
+static LayoutTable Append (std::vector<uint8_t>& blob, const Type* pItems, size_t nCount)
+{
+    LayoutTable table = {(uint32_t)blob.size (), (uint32_t)nCount};
+
+    blob.insert (blob.end (), (const uint8_t*)pItems, (const uint8_t*)(pItems + nCount));
+
+    return table;
+}
+
+static std::vector<uint8_t> Build (const LayoutSourceFile& layout)
+{
+    std::vector<uint8_t> blob (sizeof (LayoutHeader), 0);
+    std::vector<uint8_t> strings;
+    std::vector<LayoutScreen> screens;
+    std::vector<LayoutWidget> widgets;
+    LayoutHeader header;
+
+    memset (&header, 0, sizeof (header));
+
+    // String pool goes last, offsets are fixed up once its base is known
+    auto AddString = [&strings] (const std::string& strValue) {
+        uint32_t nOffset = (uint32_t)strings.size ();
+
+        strings.insert (strings.end (), strValue.begin (), strValue.end ());
+        strings.push_back (0);
+
+        return nOffset;
+    };
+
+    for (size_t nScreen = 0; nScreen < layout.screens.size (); nScreen++)
+    {
+        const ScreenSource& screen = layout.screens[nScreen];
+
+        screens.push_back ({AddString (screen.strName), (uint32_t)widgets.size (), (uint32_t)screen.widgets.size ()});
+
+        for (size_t nCount = 0; nCount < screen.widgets.size (); nCount++)
+        {
+            LayoutWidget widget = screen.widgets[nCount].widget;
+
+            widget.nText = AddString (screen.widgets[nCount].strLabel);
+            widget.nUnit = AddString (screen.widgets[nCount].strUnit);
+
+            widgets.push_back (widget);
+        }
+    }
+
+    uint32_t nStrings = (uint32_t)(blob.size () + screens.size () * sizeof (LayoutScreen) + widgets.size () * sizeof (LayoutWidget));
+
+    for (size_t nCount = 0; nCount < screens.size (); nCount++)
+    {
+        screens[nCount].nName += nStrings;
+    }
+
+    for (size_t nCount = 0; nCount < widgets.size (); nCount++)
+    {
+        widgets[nCount].nText += nStrings;
+        widgets[nCount].nUnit += nStrings;
+    }
+
+    header.screens = Append (blob, screens.data (), screens.size ());
+    header.widgets = Append (blob, widgets.data (), widgets.size ());
+
+    blob.insert (blob.end (), strings.begin (), strings.end ());
+
+    // Word sized blob, the padding keeps the final NUL
+    while (blob.size () % 4 != 0) blob.push_back (0);
+
+    header.nMagic = LAYOUT_MAGIC;
+    header.nVersion = LAYOUT_VERSION;
+    header.nHeaderSize = sizeof (LayoutHeader);
+    header.nSize = (uint32_t)blob.size ();
+    header.nWidth = layout.nWidth;
+    header.nHeight = layout.nHeight;
+
+    memcpy (blob.data (), &header, sizeof (header));
+
+    header.nCrc = LayoutView::Checksum (blob.data (), header.nSize);
+
+    memcpy (blob.data (), &header, sizeof (header));
+
+    return blob;
+}
+
+static void WriteHeader (FILE* pFile, const std::vector<uint8_t>& blob, const char* pszSymbol)
+{
+    fprintf (pFile, "///\n/// Generated by host/LayoutCompiler from %s, do not edit\n///\n\n", pszInput);
+    fprintf (pFile, "#pragma once\n\n");
+    fprintf (pFile, "static const uint8_t %s[] PROGMEM __attribute__ ((aligned (4))) = {", pszSymbol);
+
+    for (size_t nCount = 0; nCount < blob.size (); nCount++)
+    {
+        fprintf (pFile, "%s0x%02X,", nCount % 12 == 0 ? "\n    " : " ", blob[nCount]);
+    }
+
+    fprintf (pFile, "\n};\n");
+}
+
+static int Dump (const char* pszFile)
+{
+    static const char* const typeNames[] = {"text", "value", "bar"};
+
+    FILE* pFile = fopen (pszFile, "rb");
+
+    if (pFile == NULL)
+    {
+        perror (pszFile);
+        return 1;
+    }
+
+    std::vector<uint32_t> words;
+    uint32_t nWord;
+
+    while (fread (&nWord, 1, sizeof (nWord), pFile) == sizeof (nWord)) words.push_back (nWord);
+
+    fclose (pFile);
+
+    LayoutView view = LayoutView::Open (words.data (), words.size () * 4);
+
+    if (view.IsValid () == false || view.Verify () == false)
+    {
+        fprintf (stderr, "%s: not a valid version %u layout\n", pszFile, LAYOUT_VERSION);
+        return 1;
+    }
+
+    printf ("panel    %u x %u\n", view.Header ().nWidth, view.Header ().nHeight);
+
+    for (uint32_t nScreen = 0; nScreen < view.GetScreens (); nScreen++)
+    {
+        const LayoutScreen& screen = view.Screen (nScreen);
+
+        printf ("screen   %s\n", view.Text (screen.nName));
+
+        for (uint32_t nCount = 0; nCount < screen.nCount; nCount++)
+        {
+            const LayoutWidget& widget = view.Widget (screen, nCount);
+
+            printf ("  %-6s %3u,%3u %3ux%-3u font %2u flags %x %-22s \"%s\" %s\n", widget.nType < 3 ? typeNames[widget.nType] : "?",
+                    widget.nX, widget.nY, widget.nWidth, widget.nHeight, widget.nFont, widget.nFlags, sourceNames[widget.nSource],
+                    view.Text (widget.nText), view.Text (widget.nUnit));
+
+            if (widget.nType != LAYOUT_WIDGET_TEXT)
+            {
+                printf ("         resolution %.2f hysteresis %.2f interval %u ms\n", widget.nResolution / 100.0, widget.nHysteresis / 100.0, widget.nInterval);
+            }
+        }
+    }
+
+    printf ("size     %u bytes\n", view.Header ().nSize);
+
+    return 0;
+}
+
+int main (int argc, char** argv)
+{
+    const char* pszOutput = NULL;
+    const char* pszSymbol = NULL;
+
+    for (int nCount = 1; nCount < argc; nCount++)
+    {
+        if (strcmp (argv[nCount], "--dump") == 0 && nCount + 1 < argc)
+        {
+            return Dump (argv[nCount + 1]);
+        }
+        else if (strcmp (argv[nCount], "-o") == 0 && nCount + 1 < argc)
+        {
+            pszOutput = argv[++nCount];
+        }
+        else if (strcmp (argv[nCount], "--header") == 0 && nCount + 1 < argc)
+        {
+            pszSymbol = argv[++nCount];
+        }
+        else if (argv[nCount][0] != '-' && pszInput[0] == '\0')
+        {
+            pszInput = argv[nCount];
+        }
+        else
+        {
+            pszInput = "";
+            break;
+        }
+    }
+
+    if (pszInput[0] == '\0')
+    {
+        fprintf (stderr, "Use: %s <input.layout> [--header symbol] [-o output] | --dump <input.bin>\n", argv[0]);
+        return 1;
+    }
+
+    FILE* pFile = fopen (pszInput, "r");
+
+    if (pFile == NULL)
+    {
+        perror (pszInput);
+        return 1;
+    }
+
+    LayoutSourceFile layout;
+    bool bParsed = Parse (pFile, layout);
+
+    fclose (pFile);
+
+    if (bParsed == false)
+    {
+        fprintf (stderr, "%s: %u error(s)\n", pszInput, nErrors);
+        return 1;
+    }
+
+    std::vector<uint8_t> blob = Build (layout);
+
+    // The blob must pass the device reader before it is written
+    LayoutView view = LayoutView::Open (blob.data (), blob.size ());
+
+    if (view.IsValid () == false || view.Verify () == false)
+    {
+        fprintf (stderr, "%s: internal error, built blob does not validate\n", pszInput);
+        return 1;
+    }
+
+    FILE* pOutput = pszOutput == NULL ? stdout : fopen (pszOutput, pszSymbol != NULL ? "w" : "wb");
+
+    if (pOutput == NULL)
+    {
+        perror (pszOutput);
+        return 1;
+    }
+
+    if (pszSymbol != NULL)
+        WriteHeader (pOutput, blob, pszSymbol);
+    else
+        fwrite (blob.data (), 1, blob.size (), pOutput);
+
+    if (pOutput != stdout) fclose (pOutput);
+
+    return 0;
+}
@@ -0,0 +1,11 @@
+///
+/// Linux host shim, the matrix is driven through the simulated
+/// digital pins
+///
+
+#ifndef HOST_LEDCONTROL_H
+#define HOST_LEDCONTROL_H
+
+#include "Arduino.h"
+
+#endif
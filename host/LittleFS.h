@@ -0,0 +1,128 @@
+///
+/// Linux host shim for the ESP8266 LittleFS API, files live in a
+/// directory on the host (--flash <dir>, "flash" by default)
+///
+
+#ifndef HOST_LITTLEFS_H
+#define HOST_LITTLEFS_H
+
+#include "Arduino.h"
+
+#include <dirent.h>
+
+enum SeekMode
+{
+    SeekSet = 0,
+    SeekCur = 1,
+    SeekEnd = 2
+};
+
+class File
+{
+public:
+    File () : pFile (NULL)
+    {
+    }
+
+    explicit File (FILE* pFile) : pFile (pFile)
+    {
+    }
+
+    operator bool () const
+    {
+        return pFile != NULL;
+    }
+
+    size_t write (const uint8_t* pBuffer, size_t nSize)
+    {
+        return pFile != NULL ? fwrite (pBuffer, 1, nSize, pFile) : 0;
+    }
+
+    size_t read (uint8_t* pBuffer, size_t nSize)
+    {
+        return pFile != NULL ? fread (pBuffer, 1, nSize, pFile) : 0;
+    }
+
+    bool seek (uint32_t nPosition, SeekMode nMode = SeekSet)
+    {
+        return pFile != NULL && fseek (pFile, nPosition, nMode == SeekSet ? SEEK_SET : nMode == SeekCur ? SEEK_CUR : SEEK_END) == 0;
+    }
+
+    size_t position () const
+    {
+        return pFile != NULL ? (size_t)ftell (pFile) : 0;
+    }
+
+    size_t size () const
+    {
+        if (pFile == NULL) return 0;
+
+        long nCurrent = ftell (pFile);
+        fseek (pFile, 0, SEEK_END);
+        long nSize = ftell (pFile);
+        fseek (pFile, nCurrent, SEEK_SET);
+
+        return (size_t)nSize;
+    }
+
+    void flush ()
+    {
+        if (pFile != NULL) fflush (pFile);
+    }
+
+    void close ()
+    {
+        if (pFile != NULL) fclose (pFile);
+        pFile = NULL;
+    }
+
+private:
+    FILE* pFile;
+};
+
+class Dir
+{
+public:
+    Dir () : pDir (NULL), nSize (0)
+    {
+    }
+
+    Dir (DIR* pDir, const String& strPath) : pDir (pDir), strPath (strPath), nSize (0)
+    {
+    }
+
+    /// Closes the directory once the listing ends
+    bool next ();
+
+    String fileName () const
+    {
+        return strName;
+    }
+
+    size_t fileSize () const
+    {
+        return nSize;
+    }
+
+private:
+    DIR* pDir;
+    String strPath;
+    String strName;
+    size_t nSize;
+};
+
+class FS
+{
+public:
+    bool begin ();
+    bool format ();
+    bool exists (const char* pszPath);
+    bool remove (const char* pszPath);
+    bool mkdir (const char* pszPath);
+    File open (const char* pszPath, const char* pszMode);
+    Dir openDir (const char* pszPath);
+};
+
+extern FS LittleFS;
+
+#endif
@@ -0,0 +1,476 @@
+///
+/// Recipe compiler
+///
+/// Turns a text recipe into the flat binary blob described in
+/// RecipeFormat.hpp, validating every value on the way, and writes it
+/// as a raw file or as a PROGMEM array for the firmware. Existing
+/// blobs can be checked and dumped through the same reader the
+/// device uses; the dump adds the bitterness and colour estimates of
+/// BrewMath.hpp.
+///
+/// Use:
+///   recipecompiler <input.recipe> [-o output.bin]
+///   recipecompiler <input.recipe> --header <symbol> [-o output.h]
+///   recipecompiler --dump <input.bin>
+///
+/// Text format, one statement per line, '#' starts a comment:
+///   name "Pale Ale"
+///   batch 23             litres
+///   grain 5.2            kg
+///   gravity 50           original gravity points (1.050)
+///   color 4.5            grist average, Lovibond
+///   boil 60              minutes
+///   mash 66 60           C, minutes (repeat per step)
+///   hop "Cascade" 20 60 6.5
+///                        grams, minutes before the end of the boil,
+///                        alpha acids %
+///   ferment 19 168       C, hours (repeat per step)
+///
+
+#include "../RecipeFormat.hpp"
+#include "../BrewMath.hpp"
+#include "SourceLine.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+struct HopSource
+{
+    std::string strName;
+    double nGrams;
+    uint32_t nMinutes;
+    double nAlpha;
+};
+
+struct RecipeSource
+{
+    std::string strName;
+    double nBatchVolume;
+    double nGrain;
+    double nGravity;
+    double nColor;
+    uint32_t nBoilMinutes;
+    std::vector<RecipeMashStep> mashSteps;
+    std::vector<HopSource> hops;
+    std::vector<RecipeFermentStep> fermentSteps;
+};
+
+static const char* pszInput = "";
+static uint32_t nLine = 0;
+static uint32_t nErrors = 0;
+
+static void Error (const char* pszMessage, const char* pszDetail = "")
+{
+    if (nLine > 0)
+        fprintf (stderr, "%s:%u: error: %s%s\n", pszInput, nLine, pszMessage, pszDetail);
+    else
+        fprintf (stderr, "%s: error: %s%s\n", pszInput, pszMessage, pszDetail);
+    nErrors++;
+}
+
+/// Splits a line into words, double quotes group words together
+static std::vector<std::string> Tokenize (const char* pszLine)
+{
+    std::vector<std::string> tokens;
+    const char* pszCursor = pszLine;
+
+    while (*pszCursor != '\0')
+    {
+        while (*pszCursor == ' ' || *pszCursor == '\t' || *pszCursor == '\r' || *pszCursor == '\n') pszCursor++;
+
+        if (*pszCursor == '\0' || *pszCursor == '#') break;
+
+        std::string strToken;
+
+        if (*pszCursor == '"')
+        {
+            pszCursor++;
+
+            while (*pszCursor != '\0' && *pszCursor != '"') strToken += *pszCursor++;
+
+            if (*pszCursor != '"')
+            {
+                Error ("unterminated string");
+                break;
+            }
+
+            pszCursor++;
+        }
+        else
+        {
+            while (*pszCursor != '\0' && strchr (" \t\r\n#", *pszCursor) == NULL) strToken += *pszCursor++;
+        }
+
+        tokens.push_back (strToken);
+    }
+
+    return tokens;
+}
+
+static bool Number (const std::string& strToken, double nMin, double nMax, double& nValue, const char* pszWhat)
+{
+    char* pszEnd;
+
+    nValue = strtod (strToken.c_str (), &pszEnd);
+
+    if (strToken.empty () || *pszEnd != '\0')
+    {
+        Error ("not a number: ", strToken.c_str ());
+        return false;
+    }
+
+    if (nValue < nMin || nValue > nMax)
+    {
+        char szMessage[96];
+
+        snprintf (szMessage, sizeof (szMessage), "%s out of range [%g, %g]: ", pszWhat, nMin, nMax);
+        Error (szMessage, strToken.c_str ());
+        return false;
+    }
+
+    return true;
+}
+
+static bool Parse (FILE* pFile, RecipeSource& recipe)
+{
+    char szLine[256];
+    bool bTooLong;
+
+    recipe.nBatchVolume = 0;
+    recipe.nGrain = 0;
+    recipe.nGravity = 0;
+    recipe.nColor = 0;
+    recipe.nBoilMinutes = 60;
+
+    while (Source_ReadLine (pFile, szLine, sizeof (szLine), bTooLong))
+    {
+        nLine++;
+
+        if (bTooLong)
+        {
+            Error ("line too long");
+            continue;
+        }
+
+        std::vector<std::string> tokens = Tokenize (szLine);
+
+        if (tokens.empty ()) continue;
+
+        const std::string& strKeyword = tokens[0];
+        size_t nArgs = tokens.size () - 1;
+        double nA, nB, nC;
+
+        if (strKeyword == "name" && nArgs == 1)
+        {
+            if (tokens[1].empty () || tokens[1].size () > 31) Error ("name must be 1 to 31 characters");
+
+            recipe.strName = tokens[1];
+        }
+        else if (strKeyword == "batch" && nArgs == 1)
+        {
+            if (Number (tokens[1], 1, 200, nA, "batch litres")) recipe.nBatchVolume = nA;
+        }
+        else if (strKeyword == "grain" && nArgs == 1)
+        {
+            if (Number (tokens[1], 0, 100, nA, "grain kg")) recipe.nGrain = nA;
+        }
+        else if (strKeyword == "gravity" && nArgs == 1)
+        {
+            if (Number (tokens[1], 10, 150, nA, "gravity points")) recipe.nGravity = nA;
+        }
+        else if (strKeyword == "color" && nArgs == 1)
+        {
+            if (Number (tokens[1], 1, 600, nA, "color Lovibond")) recipe.nColor = nA;
+        }
+        else if (strKeyword == "boil" && nArgs == 1)
+        {
+            if (Number (tokens[1], 0, 240, nA, "boil minutes")) recipe.nBoilMinutes = (uint32_t)nA;
+        }
+        else if (strKeyword == "mash" && nArgs == 2)
+        {
+            if (Number (tokens[1], 35, 80, nA, "mash C") && Number (tokens[2], 1, 240, nB, "mash minutes"))
+            {
+                if (recipe.mashSteps.empty () == false && Fixed (nA).Raw () < recipe.mashSteps.back ().nTemperature) Error ("mash steps must not cool down");
+
+                recipe.mashSteps.push_back ({Fixed (nA).Raw (), (uint32_t)nB});
+            }
+        }
+        else if (strKeyword == "hop" && nArgs == 4)
+        {
+            if (tokens[1].empty () || tokens[1].size () > 31) Error ("hop name must be 1 to 31 characters");
+
+            if (Number (tokens[2], 0.1, 1000, nA, "hop grams") && Number (tokens[3], 0, 240, nB, "hop minutes") && Number (tokens[4], 0.5, 30, nC, "hop alpha %"))
+            {
+                if (recipe.hops.empty () == false && (uint32_t)nB > recipe.hops.back ().nMinutes) Error ("hops must be listed in boil order");
+
+                recipe.hops.push_back ({tokens[1], nA, (uint32_t)nB, nC});
+            }
+        }
+        else if (strKeyword == "ferment" && nArgs == 2)
+        {
+            if (Number (tokens[1], 0, 40, nA, "ferment C") && Number (tokens[2], 1, 2000, nB, "ferment hours"))
+            {
+                recipe.fermentSteps.push_back ({Fixed (nA).Raw (), (uint32_t)nB});
+            }
+        }
+        else
+        {
+            Error ("unknown statement or wrong argument count: ", strKeyword.c_str ());
+        }
+    }
+
+    nLine = 0;
+
+    if (recipe.strName.empty ()) Error ("missing name");
+    if (recipe.nBatchVolume == 0) Error ("missing batch");
+    if (recipe.nGravity == 0) Error ("missing gravity");
+    if (recipe.nColor == 0) Error ("missing color");
+    if (recipe.mashSteps.empty ()) Error ("at least one mash step is needed");
+    if (recipe.mashSteps.size () > RECIPE_MAX_MASH_STEPS) Error ("too many mash steps");
+    if (recipe.hops.size () > RECIPE_MAX_HOPS) Error ("too many hop additions");
+    if (recipe.fermentSteps.size () > RECIPE_MAX_FERMENT_STEPS) Error ("too many fermentation steps");
+
+    for (size_t nCount = 0; nCount < recipe.hops.size (); nCount++)
+    {
+        if (recipe.hops[nCount].nMinutes > recipe.nBoilMinutes) Error ("hop added before the boil starts: ", recipe.hops[nCount].strName.c_str ());
+    }
+
+    return nErrors == 0;
+}
+
+template <typename Type>
+static RecipeTable Append (std::vector<uint8_t>& blob, const Type* pItems, size_t nCount)
+{
+    RecipeTable table = {(uint32_t)blob.size (), (uint32_t)nCount};
+
+    blob.insert (blob.end (), (const uint8_t*)pItems, (const uint8_t*)(pItems + nCount));
+
+    return table;
+}
+
+static std::vector<uint8_t> Build (const RecipeSource& recipe)
+{
+    std::vector<uint8_t> blob (sizeof (RecipeHeader), 0);
+    std::vector<uint8_t> strings;
+    std::vector<RecipeHop> hops;
+    RecipeHeader header;
+
+    memset (&header, 0, sizeof (header));
+
+    // String pool goes last, offsets are fixed up once its base is known
+    auto AddString = [&strings] (const std::string& strValue) {
+        uint32_t nOffset = (uint32_t)strings.size ();
+
+        strings.insert (strings.end (), strValue.begin (), strValue.end ());
+        strings.push_back (0);
+
+        return nOffset;
+    };
+
+    header.nName = AddString (recipe.strName);
+
+    for (size_t nCount = 0; nCount < recipe.hops.size (); nCount++)
+    {
+        hops.push_back ({AddString (recipe.hops[nCount].strName), Fixed (recipe.hops[nCount].nGrams).Raw (), recipe.hops[nCount].nMinutes, Fixed (recipe.hops[nCount].nAlpha).Raw ()});
+    }
+
+    header.mashSteps = Append (blob, recipe.mashSteps.data (), recipe.mashSteps.size ());
+    header.fermentSteps = Append (blob, recipe.fermentSteps.data (), recipe.fermentSteps.size ());
+
+    uint32_t nHopsOffset = (uint32_t)blob.size ();
+    uint32_t nStrings = nHopsOffset + (uint32_t)(hops.size () * sizeof (RecipeHop));
+
+    for (size_t nCount = 0; nCount < hops.size (); nCount++)
+    {
+        hops[nCount].nName += nStrings;
+    }
+
+    header.hops = Append (blob, hops.data (), hops.size ());
+    header.nName += nStrings;
+
+    blob.insert (blob.end (), strings.begin (), strings.end ());
+
+    // Word sized blob, the padding keeps the final NUL
+    while (blob.size () % 4 != 0) blob.push_back (0);
+
+    header.nMagic = RECIPE_MAGIC;
+    header.nVersion = RECIPE_VERSION;
+    header.nHeaderSize = sizeof (RecipeHeader);
+    header.nSize = (uint32_t)blob.size ();
+    header.nBatchVolume = Fixed (recipe.nBatchVolume).Raw ();
+    header.nGrain = Fixed (recipe.nGrain).Raw ();
+    header.nBoilMinutes = recipe.nBoilMinutes;
+    header.nGravity = Fixed (recipe.nGravity).Raw ();
+    header.nColor = Fixed (recipe.nColor).Raw ();
+
+    memcpy (blob.data (), &header, sizeof (header));
+
+    header.nCrc = RecipeView::Checksum (blob.data (), header.nSize);
+
+    memcpy (blob.data (), &header, sizeof (header));
+
+    return blob;
+}
+
+static void WriteHeader (FILE* pFile, const std::vector<uint8_t>& blob, const char* pszSymbol)
+{
+    fprintf (pFile, "///\n/// Generated by host/RecipeCompiler from %s, do not edit\n///\n\n", pszInput);
+    fprintf (pFile, "#pragma once\n\n");
+    fprintf (pFile, "static const uint8_t %s[] PROGMEM __attribute__ ((aligned (4))) = {", pszSymbol);
+
+    for (size_t nCount = 0; nCount < blob.size (); nCount++)
+    {
+        fprintf (pFile, "%s0x%02X,", nCount % 12 == 0 ? "\n    " : " ", blob[nCount]);
+    }
+
+    fprintf (pFile, "\n};\n");
+}
+
+static int Dump (const char* pszFile)
+{
+    FILE* pFile = fopen (pszFile, "rb");
+
+    if (pFile == NULL)
+    {
+        perror (pszFile);
+        return 1;
+    }
+
+    std::vector<uint32_t> words;
+    uint32_t nWord;
+
+    while (fread (&nWord, 1, sizeof (nWord), pFile) == sizeof (nWord)) words.push_back (nWord);
+
+    fclose (pFile);
+
+    RecipeView view = RecipeView::Open (words.data (), words.size () * 4);
+
+    if (view.IsValid () == false || view.Verify () == false)
+    {
+        fprintf (stderr, "%s: not a valid version %u recipe\n", pszFile, RECIPE_VERSION);
+        return 1;
+    }
+
+    printf ("name     %s\n", view.GetName ());
+    printf ("batch    %.2f L\n", view.GetBatchVolume ().ToDouble ());
+    printf ("grain    %.2f kg\n", view.GetGrain ().ToDouble ());
+    printf ("gravity  %.1f points, %.2f P\n", view.GetGravity ().ToDouble (), BrewMath_Plato (view.GetGravity ()).ToDouble ());
+    printf ("color    %.1f L, %.1f SRM\n", view.GetColor ().ToDouble (), BrewMath_Srm (view.GetGrain (), view.GetColor (), view.GetBatchVolume ()).ToDouble ());
+    printf ("boil     %u min\n", view.GetBoilMinutes ());
+
+    for (uint32_t nCount = 0; nCount < view.GetMashSteps (); nCount++)
+    {
+        printf ("mash     %.2f C %u min\n", Fixed::FromRaw (view.MashStep (nCount).nTemperature).ToDouble (), view.MashStep (nCount).nMinutes);
+    }
+
+    Fixed nIbu;
+
+    for (uint32_t nCount = 0; nCount < view.GetHops (); nCount++)
+    {
+        const RecipeHop& hop = view.Hop (nCount);
+        Fixed nHopIbu = BrewMath_Ibu (Fixed::FromRaw (hop.nAlpha), Fixed::FromRaw (hop.nGrams), Fixed ((int32_t)hop.nMinutes), view.GetBatchVolume (), view.GetGravity ());
+
+        printf ("hop      %s %.2f g at %u min, %.1f%% alpha, %.1f IBU\n", view.Text (hop.nName), Fixed::FromRaw (hop.nGrams).ToDouble (), hop.nMinutes, Fixed::FromRaw (hop.nAlpha).ToDouble (), nHopIbu.ToDouble ());
+
+        nIbu += nHopIbu;
+    }
+
+    printf ("bitter   %.1f IBU\n", nIbu.ToDouble ());
+
+    for (uint32_t nCount = 0; nCount < view.GetFermentSteps (); nCount++)
+    {
+        printf ("ferment  %.2f C %u h\n", Fixed::FromRaw (view.FermentStep (nCount).nTemperature).ToDouble (), view.FermentStep (nCount).nHours);
+    }
+
+    printf ("size     %u bytes\n", view.Header ().nSize);
+
+    return 0;
+}
+
+int main (int argc, char** argv)
+{
+    const char* pszOutput = NULL;
+    const char* pszSymbol = NULL;
+
+    for (int nCount = 1; nCount < argc; nCount++)
+    {
+        if (strcmp (argv[nCount], "--dump") == 0 && nCount + 1 < argc)
+        {
+            return Dump (argv[nCount + 1]);
+        }
+        else if (strcmp (argv[nCount], "-o") == 0 && nCount + 1 < argc)
+        {
+            pszOutput = argv[++nCount];
+        }
+        else if (strcmp (argv[nCount], "--header") == 0 && nCount + 1 < argc)
+        {
+            pszSymbol = argv[++nCount];
+        }
+        else if (argv[nCount][0] != '-' && pszInput[0] == '\0')
+        {
+            pszInput = argv[nCount];
+        }
+        else
+        {
+            pszInput = "";
+            break;
+        }
+    }
+
+    if (pszInput[0] == '\0')
+    {
+        fprintf (stderr, "Use: %s <input.recipe> [--header symbol] [-o output] | --dump <input.bin>\n", argv[0]);
+        return 1;
+    }
+
+    FILE* pFile = fopen (pszInput, "r");
+
+    if (pFile == NULL)
+    {
+        perror (pszInput);
+        return 1;
+    }
+
+    RecipeSource recipe;
+    bool bParsed = Parse (pFile, recipe);
+
+    fclose (pFile);
+
+    if (bParsed == false)
+    {
+        fprintf (stderr, "%s: %u error(s)\n", pszInput, nErrors);
+        return 1;
+    }
+
+    std::vector<uint8_t> blob = Build (recipe);
+
+    // The blob must pass the device reader before it is written
+    RecipeView view = RecipeView::Open (blob.data (), blob.size ());
+
+    if (view.IsValid () == false || view.Verify () == false)
+    {
+        fprintf (stderr, "%s: internal error, built blob does not validate\n", pszInput);
+        return 1;
+    }
+
+    FILE* pOutput = pszOutput == NULL ? stdout : fopen (pszOutput, pszSymbol != NULL ? "w" : "wb");
+
+    if (pOutput == NULL)
+    {
+        perror (pszOutput);
+        return 1;
+    }
+
+    if (pszSymbol != NULL)
+        WriteHeader (pOutput, blob, pszSymbol);
+    else
+        fwrite (blob.data (), 1, blob.size (), pOutput);
+
+    if (pOutput != stdout) fclose (pOutput);
+
+    return 0;
+}
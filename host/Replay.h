@@ -0,0 +1,352 @@
+///
+/// Deterministic replay of an input recording (Recorder.hpp)
+///
+/// Restores the snapshot a recording starts with and walks its
+/// records without threads or pacing: the plant is advanced to the
+/// time of every record the way Thread_Simulation does at max speed,
+/// command lines go through the same terminal commands, script writes
+/// are applied as recorded without running the scripts, and every
+/// tick steps the control loops as Thread_Control did. By default the
+/// loops read the recorded sensor samples, so their outputs depend
+/// on the controller code only; --closed-loop has them read the
+/// simulated plant, so plant model changes show up as well.
+///
+/// Reports CPU time per simulated hour and, for every sensor channel
+/// and loop output, the largest difference to the recording; exits
+/// with 2 when one is above the tolerance, so a recorded run serves
+/// as a regression test and as a benchmark.
+///
+/// Use:
+///   brewersim --replay <file> [--closed-loop] [--tolerance <C or %>] [--repeat <n>]
+///
+
+#include <time.h>
+
+#include <vector>
+
+/// Terminal output of replayed commands goes nowhere
+class ReplayNullStream : public Stream
+{
+public:
+    size_t write (uint8_t nValue) override
+    {
+        return 1;
+    }
+
+    size_t write (const uint8_t* pBuffer, size_t nSize) override
+    {
+        return nSize;
+    }
+
+    int available () override
+    {
+        return 0;
+    }
+
+    int read () override
+    {
+        return -1;
+    }
+
+    int peek () override
+    {
+        return -1;
+    }
+};
+
+/// Plant of a replayed loop: the recorded sample or the simulated
+/// vessel as measurement, the output drives the simulation
+class ReplayPlant : public ControlPlant
+{
+public:
+    ReplayPlant () : nVessel (0), bClosedLoop (false)
+    {
+    }
+
+    void Configure (uint8_t nVesselID, bool bClosed)
+    {
+        nVessel = nVesselID;
+        bClosedLoop = bClosed;
+    }
+
+    void SetSample (Fixed nValue)
+    {
+        nSample = nValue;
+    }
+
+    uint32_t GetTime () override
+    {
+        return simulation.GetTime ();
+    }
+
+    Fixed Read () override
+    {
+        return bClosedLoop ? Sensor_Read (nVessel) : nSample;
+    }
+
+    void Write (Fixed nOutput) override
+    {
+        simulation.SetDuty (nVessel, nOutput);
+    }
+
+private:
+    uint8_t nVessel;
+    bool bClosedLoop;
+    Fixed nSample;
+};
+
+/// Largest difference of one channel against the recording
+struct ReplayDiff
+{
+    int32_t nMax;
+    uint32_t nDiffering; // ticks with any difference
+    uint32_t nFirst;     // simulated time of the first one
+};
+
+struct ReplayResult
+{
+    uint32_t nTicks;
+    uint32_t nCommands;
+    uint32_t nSimSeconds;
+    uint32_t nMillis; // real time the recording spans
+    bool bComplete;   // ends with RECORD_END, not cut by a reset
+    ReplayDiff samples[RECORD_CHANNELS];
+    ReplayDiff outputs[RECORD_LOOPS];
+};
+
+static uint64_t Replay_CpuNanoseconds ()
+{
+    struct timespec ts;
+
+    clock_gettime (CLOCK_PROCESS_CPUTIME_ID, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/// Plant time up to nTime, slices as Thread_Simulation runs them at
+/// max speed, the kinetics couple before every slice
+static void Replay_Advance (uint32_t nTime)
+{
+    while ((int32_t)(nTime - simulation.GetTime ()) > 0)
+    {
+        uint32_t nNow = simulation.GetTime ();
+
+        Simulation_Ferment ();
+
+        if (bSimulationEvents)
+        {
+            simulationEvents.Run (nTime - nNow > SIMULATION_HORIZON ? nNow + SIMULATION_HORIZON : nTime, SIMULATION_BUDGET);
+        }
+        else
+        {
+            uint32_t nSteps = (nTime - nNow) / Simulation<Fixed>::nStepSeconds;
+
+            simulation.Run (nSteps > SIMULATION_BUDGET ? SIMULATION_BUDGET : nSteps);
+        }
+
+        if (simulation.GetTime () == nNow) break;
+    }
+}
+
+static void Replay_Compare (ReplayDiff& diff, int32_t nReplayed, int32_t nRecorded, uint32_t nTime)
+{
+    int32_t nDiff = Abs (nReplayed - nRecorded);
+
+    if (nDiff == 0) return;
+
+    if (diff.nDiffering++ == 0) diff.nFirst = nTime;
+    if (nDiff > diff.nMax) diff.nMax = nDiff;
+}
+
+/// One pass over the recording from its snapshot
+static bool Replay_Run (const std::vector<uint8_t>& data, bool bClosedLoop, ReplayResult& result)
+{
+    static ReplayNullStream nullStream;
+    static TStream replayStream (nullStream);
+    static Terminal terminal (replayStream);
+    static ReplayPlant plants[CONTROL_LOOPS];
+
+    RecordReader reader (data.data (), data.size ());
+    const RecordEntry* pEntry = NULL;
+
+    memset (&result, 0, sizeof (result));
+
+    if (reader.Open () == false) return false;
+
+    // Attached first, the snapshot then restores the loop clocks
+    for (uint8_t nCount = 0; nCount < CONTROL_LOOPS; nCount++)
+    {
+        plants[nCount].Configure (controlPlants[nCount].GetVessel (), bClosedLoop);
+        controlLoops[nCount].Attach (nCount, plants[nCount]);
+    }
+
+    if (Checkpoint_Apply (reader.Snapshot (), reader.Header ().nSnapshot) != CHECKPOINT_HISTORY - CHECKPOINT_SIMULATION) return false;
+
+    uint32_t nLastTime = reader.Header ().nTime;
+
+    while (reader.Next (pEntry))
+    {
+        if ((int32_t)(pEntry->nTime - nLastTime) > 0) result.nSimSeconds += pEntry->nTime - nLastTime;
+
+        nLastTime = pEntry->nTime;
+
+        Replay_Advance (pEntry->nTime);
+
+        if (pEntry->nType == RECORD_COMMAND)
+        {
+            String strCommandLine (pEntry->szCommand);
+
+            if (pEntry->nSource == RECORD_SOURCE_SIM)
+                simulationCommand.Execute (terminal, replayStream, strCommandLine);
+            else if (pEntry->nSource == RECORD_SOURCE_CONTROL)
+                controlCommand.Execute (terminal, replayStream, strCommandLine);
+            else if (pEntry->nSource == RECORD_SOURCE_PLANT)
+                plantCommand.Execute (terminal, replayStream, strCommandLine);
+            else if (pEntry->nSource == RECORD_SOURCE_SCRIPT)
+                Script_Replay (pEntry->szCommand);
+
+            result.nCommands++;
+            continue;
+        }
+
+        for (uint8_t nCount = 0; nCount < CONTROL_LOOPS; nCount++)
+        {
+            plants[nCount].SetSample (Fixed::FromRaw (pEntry->nSamples[controlPlants[nCount].GetVessel ()]));
+            controlLoops[nCount].Step ();
+        }
+
+        for (uint8_t nCount = 0; nCount < RECORD_CHANNELS; nCount++)
+        {
+            Replay_Compare (result.samples[nCount], Sensor_Read (nCount).Raw (), pEntry->nSamples[nCount], pEntry->nTime);
+        }
+
+        for (uint8_t nCount = 0; nCount < RECORD_LOOPS; nCount++)
+        {
+            Replay_Compare (result.outputs[nCount], controlLoops[nCount].GetOutput ().Raw (), pEntry->nOutputs[nCount], pEntry->nTime);
+        }
+
+        result.nMillis = pEntry->nMillis;
+        result.nTicks++;
+    }
+
+    result.bComplete = reader.GetOffset () < data.size () && data[reader.GetOffset ()] == RECORD_END;
+
+    return true;
+}
+
+/// Prints one diff row, returns true when within the tolerance
+static bool Replay_ShowDiff (const char* pszName, const ReplayDiff& diff, double nScale, const char* pszUnit, double nTolerance)
+{
+    double nMax = diff.nMax * nScale / 65536.0;
+
+    if (diff.nDiffering == 0)
+        printf ("%-24s %12s %10u %10s\n", pszName, "0", 0, "-");
+    else
+        printf ("%-24s %10.4f %s %10u %9us\n", pszName, nMax, pszUnit, diff.nDiffering, diff.nFirst);
+
+    return nMax <= nTolerance;
+}
+
+int Replay_Main (int argc, char** argv)
+{
+    static const char* const channelNames[] = {"mash", "boil", "fermenter"};
+
+    const char* pszFile = NULL;
+    bool bClosedLoop = false;
+    double nTolerance = 0;
+    uint32_t nRepeat = 1;
+
+    for (int nCount = 1; nCount < argc; nCount++)
+    {
+        if (strcmp (argv[nCount], "--replay") == 0 && nCount + 1 < argc)
+        {
+            pszFile = argv[++nCount];
+        }
+        else if (strcmp (argv[nCount], "--closed-loop") == 0)
+        {
+            bClosedLoop = true;
+        }
+        else if (strcmp (argv[nCount], "--tolerance") == 0 && nCount + 1 < argc)
+        {
+            nTolerance = atof (argv[++nCount]);
+        }
+        else if (strcmp (argv[nCount], "--repeat") == 0 && nCount + 1 < argc)
+        {
+            nRepeat = (uint32_t)atoi (argv[++nCount]);
+            if (nRepeat == 0) nRepeat = 1;
+        }
+        else
+        {
+            fprintf (stderr, "Use: %s --replay <file> [--closed-loop] [--tolerance <C or %%>] [--repeat <n>]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    FILE* pFile = pszFile != NULL ? fopen (pszFile, "rb") : NULL;
+
+    if (pFile == NULL)
+    {
+        fprintf (stderr, "Error, cannot open the recording: %s\n", pszFile != NULL ? pszFile : "(none)");
+        return 1;
+    }
+
+    std::vector<uint8_t> data;
+    uint8_t chunk[4096];
+    size_t nRead;
+
+    while ((nRead = fread (chunk, 1, sizeof (chunk), pFile)) > 0)
+    {
+        data.insert (data.end (), chunk, chunk + nRead);
+    }
+
+    fclose (pFile);
+
+    ReplayResult result;
+    uint64_t nBest = 0;
+    uint64_t nTotal = 0;
+
+    for (uint32_t nCount = 0; nCount < nRepeat; nCount++)
+    {
+        uint64_t nStart = Replay_CpuNanoseconds ();
+
+        if (Replay_Run (data, bClosedLoop, result) == false)
+        {
+            fprintf (stderr, "Error, %s is not a recording of this build (version %u, %u channels, %u loops)\n", pszFile, RECORD_VERSION, RECORD_CHANNELS, RECORD_LOOPS);
+            return 1;
+        }
+
+        uint64_t nCost = Replay_CpuNanoseconds () - nStart;
+
+        nTotal += nCost;
+        if (nCount == 0 || nCost < nBest) nBest = nCost;
+    }
+
+    double nHours = result.nSimSeconds / 3600.0;
+
+    printf ("Recording: %s, %zu bytes%s, %u ticks, %u commands\n", pszFile, data.size (), result.bComplete ? "" : " (cut)", result.nTicks, result.nCommands);
+    printf ("Span: %us simulated (%.2f h), %.1fs real\n", result.nSimSeconds, nHours, result.nMillis / 1000.0);
+    printf ("Replay: %s loop, %u runs, CPU best %.3f ms, mean %.3f ms\n", bClosedLoop ? "closed" : "open", nRepeat, nBest / 1e6, nTotal / 1e6 / nRepeat);
+
+    if (nHours > 0) printf ("Cost: %.3f ms CPU per simulated hour, %.0fx faster than simulated time\n", nBest / 1e6 / nHours, result.nSimSeconds * 1e9 / (nBest > 0 ? nBest : 1));
+
+    printf ("\n%-24s %12s %10s %10s\n", "Channel", "Max diff", "Ticks", "First");
+
+    bool bMatch = true;
+    char szName[32];
+
+    for (uint8_t nCount = 0; nCount < RECORD_CHANNELS; nCount++)
+    {
+        snprintf (szName, sizeof (szName), "sensor %u %s", nCount, channelNames[nCount % 3]);
+        bMatch &= Replay_ShowDiff (szName, result.samples[nCount], 1.0, "C", nTolerance);
+    }
+
+    for (uint8_t nCount = 0; nCount < RECORD_LOOPS; nCount++)
+    {
+        snprintf (szName, sizeof (szName), "loop %u output", nCount);
+        bMatch &= Replay_ShowDiff (szName, result.outputs[nCount], 100.0, "%", nTolerance);
+    }
+
+    printf ("\n%s\n", bMatch ? "Replay matches the recording" : "Replay differs from the recording");
+
+    return bMatch ? 0 : 2;
+}
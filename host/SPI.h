@@ -0,0 +1,32 @@
+///
+/// Linux host shim, SPI traffic goes to the simulated panel or LED
+/// matrix, whichever chip select is low
+///
+
+#ifndef HOST_SPI_H
+#define HOST_SPI_H
+
+#include "Arduino.h"
+
+#define SPI_MODE0 0x00
+
+class SPISettings
+{
+public:
+    SPISettings (uint32_t nClock, uint8_t nBitOrder, uint8_t nDataMode) {}
+};
+
+class SPIClass
+{
+public:
+    void begin ();
+    void end () {}
+    void beginTransaction (SPISettings settings) {}
+    void endTransaction () {}
+    uint8_t transfer (uint8_t nData);
+    void writeBytes (const uint8_t* pData, uint32_t nSize);
+};
+
+extern SPIClass SPI;
+
+#endif
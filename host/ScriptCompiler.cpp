@@ -0,0 +1,1178 @@
+///
+/// Script compiler
+///
+/// Turns an automation script into the bytecode blob described in
+/// ScriptFormat.hpp and writes it as a raw file, to be copied to
+/// LittleFS and run with "script load", or as a PROGMEM array built
+/// into the firmware. Every blob is checked by the same reader the
+/// device uses before it is written; --dump disassembles one and
+/// --bench measures the interpreter on this host.
+///
+/// Use:
+///   scriptcompiler <input.script> [-o output.bin]
+///   scriptcompiler <input.script> --header <symbol> [-o output.h]
+///   scriptcompiler --dump <input.bin>
+///   scriptcompiler --bench [million instructions]
+///
+/// Language, one statement per line, '#' starts a comment:
+///   name "Step mash"
+///   let <variable> = <expression>
+///   setpoint mash|boil <expression>          C
+///   mode mash|boil off|bangbang|pid|autotune
+///   heater <vessel> <expression>             % duty
+///   valve <link> <expression>                % open
+///   pump <link> <expression>                 % speed
+///   hops <vessel> <expression>               grams added
+///   log <id> <expression>                    to the binary log
+///   wait <expression> [s|min|h]              minutes by default
+///   wait until <condition>
+///   if <condition> ... [else ...] end
+///   while <condition> ... end
+///   yield                                    ends the slice
+///   stop
+///
+/// Expressions: numbers, variables, + - * / ( ), comparisons
+/// < <= > >= == != (1 or 0), and, or, not, and the values
+///   now                      minutes since the script started
+///   <vessel>.temp            C, vessels are mash, boil, fermenter
+///   <vessel>.volume          L
+///   mash.setpoint            C, also boil
+///   mash.output              % heater duty of the loop, also boil
+///   fermenter.gravity        points
+///   link<n>.flow             L/min through plant link n
+///
+
+#include "../ScriptVM.hpp"
+#include "SourceLine.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+static const char* pszInput = "";
+static uint32_t nLine = 0;
+static uint32_t nErrors = 0;
+
+static void Error (const char* pszMessage, const char* pszDetail = "")
+{
+    if (nLine > 0)
+        fprintf (stderr, "%s:%u: error: %s%s\n", pszInput, nLine, pszMessage, pszDetail);
+    else
+        fprintf (stderr, "%s: error: %s%s\n", pszInput, pszMessage, pszDetail);
+    nErrors++;
+}
+
+enum TokenType
+{
+    TOKEN_END = 0,
+    TOKEN_NUMBER,
+    TOKEN_NAME,
+    TOKEN_STRING,
+    TOKEN_SYMBOL
+};
+
+struct Token
+{
+    TokenType nType;
+    std::string strText;
+    double nValue;
+};
+
+/// Splits a line into numbers, names (dots included), strings and
+/// operators; always ends with TOKEN_END
+static std::vector<Token> Tokenize (const char* pszLine)
+{
+    std::vector<Token> tokens;
+    const char* pszCursor = pszLine;
+
+    while (true)
+    {
+        while (*pszCursor == ' ' || *pszCursor == '\t' || *pszCursor == '\r' || *pszCursor == '\n') pszCursor++;
+
+        if (*pszCursor == '\0' || *pszCursor == '#') break;
+
+        Token token = {TOKEN_SYMBOL, "", 0};
+
+        if (*pszCursor == '"')
+        {
+            pszCursor++;
+
+            while (*pszCursor != '\0' && *pszCursor != '"') token.strText += *pszCursor++;
+
+            if (*pszCursor != '"')
+            {
+                Error ("unterminated string");
+                break;
+            }
+
+            pszCursor++;
+            token.nType = TOKEN_STRING;
+        }
+        else if ((*pszCursor >= '0' && *pszCursor <= '9') || (*pszCursor == '.' && pszCursor[1] >= '0' && pszCursor[1] <= '9'))
+        {
+            char* pszEnd;
+
+            token.nValue = strtod (pszCursor, &pszEnd);
+            token.strText.assign (pszCursor, pszEnd - pszCursor);
+            token.nType = TOKEN_NUMBER;
+            pszCursor = pszEnd;
+        }
+        else if ((*pszCursor >= 'a' && *pszCursor <= 'z') || (*pszCursor >= 'A' && *pszCursor <= 'Z') || *pszCursor == '_')
+        {
+            while ((*pszCursor >= 'a' && *pszCursor <= 'z') || (*pszCursor >= 'A' && *pszCursor <= 'Z') || (*pszCursor >= '0' && *pszCursor <= '9') || *pszCursor == '_' || *pszCursor == '.')
+            {
+                token.strText += *pszCursor++;
+            }
+
+            token.nType = TOKEN_NAME;
+        }
+        else
+        {
+            static const char* const symbols[] = {"<=", ">=", "==", "!=", "<", ">", "+", "-", "*", "/", "(", ")", "="};
+
+            for (size_t nCount = 0; nCount < sizeof (symbols) / sizeof (symbols[0]); nCount++)
+            {
+                if (strncmp (pszCursor, symbols[nCount], strlen (symbols[nCount])) == 0)
+                {
+                    token.strText = symbols[nCount];
+                    break;
+                }
+            }
+
+            if (token.strText.empty ())
+            {
+                char szSymbol[2] = {*pszCursor, '\0'};
+
+                Error ("unexpected character: ", szSymbol);
+                break;
+            }
+
+            pszCursor += token.strText.size ();
+        }
+
+        tokens.push_back (token);
+    }
+
+    tokens.push_back ({TOKEN_END, "", 0});
+
+    return tokens;
+}
+
+/// Vessels by name, control loops have the same index (mash, boil)
+static int VesselIndex (const std::string& strName)
+{
+    static const char* const vesselNames[] = {"mash", "boil", "fermenter"};
+
+    for (int nCount = 0; nCount < 3; nCount++)
+    {
+        if (strName == vesselNames[nCount]) return nCount;
+    }
+
+    return -1;
+}
+
+static const int nControlLoops = 2;
+
+enum BlockType
+{
+    BLOCK_IF,
+    BLOCK_ELSE,
+    BLOCK_WHILE
+};
+
+struct Block
+{
+    BlockType nType;
+    uint32_t nLine;
+    size_t nStart; // loop head
+    size_t nJump;  // forward jump to patch at else or end
+};
+
+class Compiler
+{
+public:
+    Compiler () : nMaxRegister (0), pToken (NULL)
+    {
+    }
+
+    bool Compile (FILE* pFile)
+    {
+        char szLine[256];
+        bool bTooLong;
+
+        while (Source_ReadLine (pFile, szLine, sizeof (szLine), bTooLong))
+        {
+            nLine++;
+
+            if (bTooLong)
+            {
+                Error ("line too long");
+                continue;
+            }
+
+            std::vector<Token> tokens = Tokenize (szLine);
+
+            if (tokens.size () > 1)
+            {
+                pToken = tokens.data ();
+                Statement ();
+            }
+        }
+
+        for (size_t nCount = 0; nCount < blocks.size (); nCount++)
+        {
+            nLine = blocks[nCount].nLine;
+            Error ("block is not closed with end");
+        }
+
+        nLine = 0;
+
+        Emit (Script_Encode (SCRIPT_HALT, 0, 0, 0));
+
+        if (strName.empty ()) Error ("missing name");
+        if (code.size () > SCRIPT_MAX_CODE) Error ("script too long");
+        if (constants.size () > SCRIPT_MAX_CONSTANTS) Error ("too many constants");
+
+        return nErrors == 0;
+    }
+
+    std::vector<uint8_t> Build () const
+    {
+        std::vector<uint8_t> blob (sizeof (ScriptHeader), 0);
+        ScriptHeader header;
+
+        memset (&header, 0, sizeof (header));
+
+        header.code = {(uint32_t)blob.size (), (uint32_t)code.size ()};
+        blob.insert (blob.end (), (const uint8_t*)code.data (), (const uint8_t*)(code.data () + code.size ()));
+
+        header.constants = {(uint32_t)blob.size (), (uint32_t)constants.size ()};
+        blob.insert (blob.end (), (const uint8_t*)constants.data (), (const uint8_t*)(constants.data () + constants.size ()));
+
+        // String pool last, its final NUL ends the blob
+        header.nName = (uint32_t)blob.size ();
+        blob.insert (blob.end (), strName.begin (), strName.end ());
+        blob.push_back (0);
+
+        while (blob.size () % 4 != 0) blob.push_back (0);
+
+        header.nMagic = SCRIPT_MAGIC;
+        header.nVersion = SCRIPT_VERSION;
+        header.nHeaderSize = sizeof (ScriptHeader);
+        header.nSize = (uint32_t)blob.size ();
+        header.nRegisters = nMaxRegister;
+
+        memcpy (blob.data (), &header, sizeof (header));
+
+        header.nCrc = ScriptView::Checksum (blob.data (), header.nSize);
+
+        memcpy (blob.data (), &header, sizeof (header));
+
+        return blob;
+    }
+
+private:
+    void Statement ()
+    {
+        std::string strKeyword = pToken->strText;
+
+        if (pToken->nType != TOKEN_NAME)
+        {
+            Error ("statement expected: ", strKeyword.c_str ());
+            return;
+        }
+
+        pToken++;
+
+        if (strKeyword == "name")
+        {
+            if (pToken->nType != TOKEN_STRING || pToken->strText.empty () || pToken->strText.size () > 31)
+            {
+                Error ("name must be a string of 1 to 31 characters");
+                return;
+            }
+
+            strName = pToken->strText;
+            pToken++;
+        }
+        else if (strKeyword == "let")
+        {
+            Let ();
+        }
+        else if (strKeyword == "setpoint" || strKeyword == "mode")
+        {
+            int nLoop = VesselIndex (pToken->strText);
+
+            if (nLoop < 0 || nLoop >= nControlLoops)
+            {
+                Error ("control loop expected, mash or boil: ", pToken->strText.c_str ());
+                return;
+            }
+
+            pToken++;
+
+            if (strKeyword == "setpoint")
+            {
+                Write (SCRIPT_OUT_SETPOINT, (uint8_t)nLoop, Expression (nVariables ()));
+            }
+            else
+            {
+                static const char* const modeNames[] = {"off", "bangbang", "pid", "autotune"};
+                int nMode = -1;
+
+                for (int nCount = 0; nCount < 4; nCount++)
+                {
+                    if (pToken->strText == modeNames[nCount]) nMode = nCount;
+                }
+
+                if (nMode < 0)
+                {
+                    Error ("mode expected, off, bangbang, pid or autotune: ", pToken->strText.c_str ());
+                    return;
+                }
+
+                pToken++;
+
+                uint8_t nRegister = Temporary (nVariables ());
+
+                Emit (Script_EncodeBx (SCRIPT_LOADI, nRegister, (uint16_t)nMode));
+                Write (SCRIPT_OUT_MODE, (uint8_t)nLoop, nRegister);
+            }
+        }
+        else if (strKeyword == "heater" || strKeyword == "hops")
+        {
+            int nVessel = VesselIndex (pToken->strText);
+
+            if (nVessel < 0)
+            {
+                Error ("vessel expected, mash, boil or fermenter: ", pToken->strText.c_str ());
+                return;
+            }
+
+            pToken++;
+
+            Write (strKeyword == "heater" ? SCRIPT_OUT_HEATER : SCRIPT_OUT_HOPS, (uint8_t)nVessel, Expression (nVariables ()));
+        }
+        else if (strKeyword == "valve" || strKeyword == "pump" || strKeyword == "log")
+        {
+            int nIndex = Index ();
+
+            if (nIndex < 0) return;
+
+            ScriptOutput nPort = strKeyword == "valve" ? SCRIPT_OUT_VALVE : strKeyword == "pump" ? SCRIPT_OUT_PUMP : SCRIPT_OUT_LOG;
+
+            Write (nPort, (uint8_t)nIndex, Expression (nVariables ()));
+        }
+        else if (strKeyword == "wait")
+        {
+            Wait ();
+        }
+        else if (strKeyword == "if")
+        {
+            uint8_t nCondition = Expression (nVariables ());
+
+            blocks.push_back ({BLOCK_IF, nLine, 0, Emit (Script_EncodeBx (SCRIPT_JUMPIFNOT, nCondition, 0))});
+        }
+        else if (strKeyword == "else")
+        {
+            if (blocks.empty () || blocks.back ().nType != BLOCK_IF)
+            {
+                Error ("else without if");
+                return;
+            }
+
+            Block& block = blocks.back ();
+            size_t nSkip = Emit (Script_EncodeBx (SCRIPT_JUMP, 0, 0));
+
+            Patch (block.nJump);
+            block.nType = BLOCK_ELSE;
+            block.nJump = nSkip;
+        }
+        else if (strKeyword == "while")
+        {
+            size_t nStart = code.size ();
+            uint8_t nCondition = Expression (nVariables ());
+
+            blocks.push_back ({BLOCK_WHILE, nLine, nStart, Emit (Script_EncodeBx (SCRIPT_JUMPIFNOT, nCondition, 0))});
+        }
+        else if (strKeyword == "end")
+        {
+            if (blocks.empty ())
+            {
+                Error ("end without a block");
+                return;
+            }
+
+            Block block = blocks.back ();
+
+            blocks.pop_back ();
+
+            if (block.nType == BLOCK_WHILE) Emit (Script_EncodeBx (SCRIPT_JUMP, 0, (uint16_t)block.nStart));
+
+            Patch (block.nJump);
+        }
+        else if (strKeyword == "yield")
+        {
+            Emit (Script_Encode (SCRIPT_YIELD, 0, 0, 0));
+        }
+        else if (strKeyword == "stop")
+        {
+            Emit (Script_Encode (SCRIPT_HALT, 0, 0, 0));
+        }
+        else
+        {
+            Error ("unknown statement: ", strKeyword.c_str ());
+            return;
+        }
+
+        if (pToken->nType != TOKEN_END) Error ("unexpected text after the statement: ", pToken->strText.c_str ());
+    }
+
+    void Let ()
+    {
+        if (pToken->nType != TOKEN_NAME || pToken[1].strText != "=" || Reserved (pToken->strText))
+        {
+            Error ("let <variable> = <expression> expected");
+            return;
+        }
+
+        std::string strVariable = pToken->strText;
+
+        pToken += 2;
+
+        // The value is computed above the variables, a new one then
+        // takes the first free register, usually where it already is
+        uint8_t nValue = Expression (nVariables ());
+
+        if (variables.count (strVariable) == 0)
+        {
+            if (nVariables () >= SCRIPT_REGISTERS - 2)
+            {
+                Error ("too many variables: ", strVariable.c_str ());
+                return;
+            }
+
+            uint8_t nRegister = nVariables ();
+
+            variables[strVariable] = nRegister;
+            Temporary (nRegister);
+        }
+
+        Move (variables[strVariable], nValue);
+    }
+
+    void Wait ()
+    {
+        uint8_t nRegister = nVariables ();
+
+        if (pToken->strText == "until")
+        {
+            pToken++;
+
+            // Checked first, a yield between checks
+            size_t nStart = code.size ();
+            uint8_t nCondition = Expression (nRegister);
+            size_t nDone = Emit (Script_EncodeBx (SCRIPT_JUMPIF, nCondition, 0));
+
+            Emit (Script_Encode (SCRIPT_YIELD, 0, 0, 0));
+            Emit (Script_EncodeBx (SCRIPT_JUMP, 0, (uint16_t)nStart));
+            Patch (nDone);
+            return;
+        }
+
+        // A plain number folds into minutes here
+        if (pToken->nType == TOKEN_NUMBER && pToken[1].nType != TOKEN_SYMBOL)
+        {
+            double nValue = pToken->nValue;
+
+            pToken++;
+
+            double nMinutes = Unit (nValue);
+
+            Emit (Script_EncodeBx (SCRIPT_SLEEP, LoadConstant (Temporary (nRegister), nMinutes), 0));
+            return;
+        }
+
+        uint8_t nValue = Expression (nRegister);
+
+        if (pToken->strText == "s" || pToken->strText == "h")
+        {
+            uint8_t nScale = Temporary (nRegister + 1);
+
+            Emit (Script_EncodeBx (SCRIPT_LOADI, nScale, 60));
+            Emit (Script_Encode (pToken->strText == "s" ? SCRIPT_DIV : SCRIPT_MUL, nRegister, nValue, nScale));
+            nValue = nRegister;
+        }
+
+        if (pToken->strText == "s" || pToken->strText == "h" || pToken->strText == "min") pToken++;
+
+        Emit (Script_EncodeBx (SCRIPT_SLEEP, nValue, 0));
+    }
+
+    /// Minutes of nValue in the unit that follows, consumed
+    double Unit (double nValue)
+    {
+        if (pToken->strText == "s")
+        {
+            pToken++;
+            return nValue / 60;
+        }
+
+        if (pToken->strText == "h")
+        {
+            pToken++;
+            return nValue * 60;
+        }
+
+        if (pToken->strText == "min") pToken++;
+
+        return nValue;
+    }
+
+    /// A small integer operand: link number or log id
+    int Index ()
+    {
+        if (pToken->nType != TOKEN_NUMBER || pToken->nValue < 0 || pToken->nValue > 255 || pToken->nValue != (int)pToken->nValue)
+        {
+            Error ("index 0 to 255 expected: ", pToken->strText.c_str ());
+            return -1;
+        }
+
+        return (int)(pToken++)->nValue;
+    }
+
+    /// Expressions, each level returns the register holding its value:
+    /// nTarget and above are free, variables are read where they live
+    uint8_t Expression (uint8_t nTarget)
+    {
+        return Or (nTarget);
+    }
+
+    uint8_t Or (uint8_t nTarget)
+    {
+        return Logical (nTarget, "or", SCRIPT_JUMPIF);
+    }
+
+    /// Short circuit: the first operand that decides is the value
+    uint8_t Logical (uint8_t nTarget, const char* pszOperator, ScriptOpcode nJump)
+    {
+        uint8_t nValue = nJump == SCRIPT_JUMPIF ? Logical (nTarget, "and", SCRIPT_JUMPIFNOT) : Not (nTarget);
+
+        if (pToken->strText != pszOperator) return nValue;
+
+        std::vector<size_t> jumps;
+
+        Move (Temporary (nTarget), nValue);
+
+        while (pToken->strText == pszOperator)
+        {
+            pToken++;
+
+            jumps.push_back (Emit (Script_EncodeBx (nJump, nTarget, 0)));
+
+            nValue = nJump == SCRIPT_JUMPIF ? Logical (nTarget, "and", SCRIPT_JUMPIFNOT) : Not (nTarget);
+            Move (nTarget, nValue);
+        }
+
+        for (size_t nCount = 0; nCount < jumps.size (); nCount++) Patch (jumps[nCount]);
+
+        return nTarget;
+    }
+
+    uint8_t Not (uint8_t nTarget)
+    {
+        if (pToken->strText != "not") return Compare (nTarget);
+
+        pToken++;
+
+        uint8_t nValue = Not (nTarget);
+
+        Emit (Script_Encode (SCRIPT_NOT, Temporary (nTarget), nValue, 0));
+
+        return nTarget;
+    }
+
+    uint8_t Compare (uint8_t nTarget)
+    {
+        uint8_t nLeft = Sum (nTarget);
+        std::string strOperator = pToken->strText;
+
+        if (pToken->nType != TOKEN_SYMBOL || (strOperator != "<" && strOperator != "<=" && strOperator != ">" && strOperator != ">=" && strOperator != "==" && strOperator != "!="))
+        {
+            return nLeft;
+        }
+
+        pToken++;
+
+        uint8_t nRight = Sum (Temporary (nTarget + 1));
+
+        Temporary (nTarget);
+
+        // Greater than swaps the operands
+        if (strOperator == "<") Emit (Script_Encode (SCRIPT_LT, nTarget, nLeft, nRight));
+        if (strOperator == "<=") Emit (Script_Encode (SCRIPT_LE, nTarget, nLeft, nRight));
+        if (strOperator == ">") Emit (Script_Encode (SCRIPT_LT, nTarget, nRight, nLeft));
+        if (strOperator == ">=") Emit (Script_Encode (SCRIPT_LE, nTarget, nRight, nLeft));
+        if (strOperator == "==") Emit (Script_Encode (SCRIPT_EQ, nTarget, nLeft, nRight));
+        if (strOperator == "!=") Emit (Script_Encode (SCRIPT_NE, nTarget, nLeft, nRight));
+
+        return nTarget;
+    }
+
+    uint8_t Sum (uint8_t nTarget)
+    {
+        uint8_t nLeft = Term (nTarget);
+
+        while (pToken->strText == "+" || pToken->strText == "-")
+        {
+            ScriptOpcode nOpcode = pToken->strText == "+" ? SCRIPT_ADD : SCRIPT_SUB;
+
+            pToken++;
+
+            uint8_t nRight = Term (Temporary (nTarget + 1));
+
+            Emit (Script_Encode (nOpcode, Temporary (nTarget), nLeft, nRight));
+            nLeft = nTarget;
+        }
+
+        return nLeft;
+    }
+
+    uint8_t Term (uint8_t nTarget)
+    {
+        uint8_t nLeft = Unary (nTarget);
+
+        while (pToken->strText == "*" || pToken->strText == "/")
+        {
+            ScriptOpcode nOpcode = pToken->strText == "*" ? SCRIPT_MUL : SCRIPT_DIV;
+
+            pToken++;
+
+            uint8_t nRight = Unary (Temporary (nTarget + 1));
+
+            Emit (Script_Encode (nOpcode, Temporary (nTarget), nLeft, nRight));
+            nLeft = nTarget;
+        }
+
+        return nLeft;
+    }
+
+    uint8_t Unary (uint8_t nTarget)
+    {
+        if (pToken->strText != "-") return Primary (nTarget);
+
+        pToken++;
+
+        // A negative literal is a constant, not a NEG
+        if (pToken->nType == TOKEN_NUMBER) return LoadConstant (Temporary (nTarget), -(pToken++)->nValue);
+
+        uint8_t nValue = Unary (nTarget);
+
+        Emit (Script_Encode (SCRIPT_NEG, Temporary (nTarget), nValue, 0));
+
+        return nTarget;
+    }
+
+    uint8_t Primary (uint8_t nTarget)
+    {
+        const Token& token = *pToken;
+
+        if (token.nType == TOKEN_NUMBER)
+        {
+            pToken++;
+            return LoadConstant (Temporary (nTarget), token.nValue);
+        }
+
+        if (token.strText == "(")
+        {
+            pToken++;
+
+            uint8_t nValue = Expression (nTarget);
+
+            if (pToken->strText != ")")
+                Error ("missing )");
+            else
+                pToken++;
+
+            return nValue;
+        }
+
+        if (token.nType != TOKEN_NAME)
+        {
+            Error ("value expected: ", token.strText.empty () ? "end of line" : token.strText.c_str ());
+            return Temporary (nTarget);
+        }
+
+        pToken++;
+
+        if (token.strText == "now")
+        {
+            Emit (Script_Encode (SCRIPT_NOW, Temporary (nTarget), 0, 0));
+            return nTarget;
+        }
+
+        std::map<std::string, uint8_t>::const_iterator variable = variables.find (token.strText);
+
+        if (variable != variables.end ()) return variable->second;
+
+        size_t nDot = token.strText.find ('.');
+        std::string strObject = token.strText.substr (0, nDot);
+        std::string strField = nDot == std::string::npos ? "" : token.strText.substr (nDot + 1);
+        int nVessel = VesselIndex (strObject);
+        int nPort = -1;
+        int nIndex = nVessel;
+
+        if (nVessel >= 0 && strField == "temp") nPort = SCRIPT_IN_TEMPERATURE;
+        if (nVessel >= 0 && strField == "volume") nPort = SCRIPT_IN_VOLUME;
+        if (nVessel >= 0 && nVessel < nControlLoops && strField == "setpoint") nPort = SCRIPT_IN_SETPOINT;
+        if (nVessel >= 0 && nVessel < nControlLoops && strField == "output") nPort = SCRIPT_IN_OUTPUT;
+        if (strObject == "fermenter" && strField == "gravity") nPort = SCRIPT_IN_GRAVITY, nIndex = 0;
+
+        if (strObject.compare (0, 4, "link") == 0 && strObject.size () > 4 && strField == "flow")
+        {
+            char* pszEnd;
+            long nLink = strtol (strObject.c_str () + 4, &pszEnd, 10);
+
+            if (*pszEnd == '\0' && nLink >= 0 && nLink <= 255) nPort = SCRIPT_IN_FLOW, nIndex = (int)nLink;
+        }
+
+        if (nPort < 0)
+        {
+            Error ("unknown variable or value: ", token.strText.c_str ());
+            return Temporary (nTarget);
+        }
+
+        Emit (Script_Encode (SCRIPT_READ, Temporary (nTarget), (uint8_t)nPort, (uint8_t)nIndex));
+
+        return nTarget;
+    }
+
+    bool Reserved (const std::string& strName) const
+    {
+        static const char* const reserved[] = {"now", "and", "or", "not", "until", "s", "min", "h"};
+
+        for (size_t nCount = 0; nCount < sizeof (reserved) / sizeof (reserved[0]); nCount++)
+        {
+            if (strName == reserved[nCount]) return true;
+        }
+
+        return strName.find ('.') != std::string::npos || VesselIndex (strName) >= 0;
+    }
+
+    /// Integers in 16 bits load inline, the rest from the pool
+    uint8_t LoadConstant (uint8_t nRegister, double nValue)
+    {
+        if (nValue >= 32767.5 || nValue <= -32768.5)
+        {
+            Error ("number out of the Q16.16 range: ", std::to_string (nValue).c_str ());
+            return nRegister;
+        }
+
+        if (nValue == (int)nValue && nValue >= -32768 && nValue <= 32767)
+        {
+            Emit (Script_EncodeBx (SCRIPT_LOADI, nRegister, (uint16_t)(int16_t)nValue));
+            return nRegister;
+        }
+
+        int32_t nRaw = Fixed (nValue).Raw ();
+        size_t nConstant = 0;
+
+        while (nConstant < constants.size () && constants[nConstant] != nRaw) nConstant++;
+
+        if (nConstant == constants.size ()) constants.push_back (nRaw);
+
+        Emit (Script_EncodeBx (SCRIPT_LOADK, nRegister, (uint16_t)nConstant));
+
+        return nRegister;
+    }
+
+    void Write (ScriptOutput nPort, uint8_t nIndex, uint8_t nValue)
+    {
+        Emit (Script_Encode (SCRIPT_WRITE, nValue, nPort, nIndex));
+    }
+
+    void Move (uint8_t nTarget, uint8_t nSource)
+    {
+        if (nTarget != nSource) Emit (Script_Encode (SCRIPT_MOVE, nTarget, nSource, 0));
+    }
+
+    /// Marks a register as used, reports running out of them
+    uint8_t Temporary (uint32_t nRegister)
+    {
+        if (nRegister >= SCRIPT_REGISTERS)
+        {
+            Error ("expression needs more than 16 registers");
+            return 0;
+        }
+
+        if (nRegister + 1 > nMaxRegister) nMaxRegister = nRegister + 1;
+
+        return (uint8_t)nRegister;
+    }
+
+    uint8_t nVariables () const
+    {
+        return (uint8_t)variables.size ();
+    }
+
+    size_t Emit (uint32_t nWord)
+    {
+        code.push_back (nWord);
+
+        return code.size () - 1;
+    }
+
+    /// Points the jump at nJump to the next instruction
+    void Patch (size_t nJump)
+    {
+        code[nJump] = (code[nJump] & 0xFFFF) | (uint32_t)code.size () << 16;
+    }
+
+    std::string strName;
+    std::vector<uint32_t> code;
+    std::vector<int32_t> constants;
+    std::map<std::string, uint8_t> variables;
+    std::vector<Block> blocks;
+    uint32_t nMaxRegister;
+    const Token* pToken;
+};
+
+static void WriteHeader (FILE* pFile, const std::vector<uint8_t>& blob, const char* pszSymbol)
+{
+    fprintf (pFile, "///\n/// Generated by host/ScriptCompiler from %s, do not edit\n///\n\n", pszInput);
+    fprintf (pFile, "#pragma once\n\n");
+    fprintf (pFile, "static const uint8_t %s[] PROGMEM __attribute__ ((aligned (4))) = {", pszSymbol);
+
+    for (size_t nCount = 0; nCount < blob.size (); nCount++)
+    {
+        fprintf (pFile, "%s0x%02X,", nCount % 12 == 0 ? "\n    " : " ", blob[nCount]);
+    }
+
+    fprintf (pFile, "\n};\n");
+}
+
+static void Disassemble (const ScriptView& view)
+{
+    static const char* const opcodeNames[] = {SCRIPT_OPCODES (SCRIPT_OPCODE_NAME)};
+    static const char* const inputNames[] = {"temperature", "volume", "setpoint", "output", "flow", "gravity"};
+    static const char* const outputNames[] = {"setpoint", "mode", "heater", "valve", "pump", "hops", "log"};
+
+    for (uint32_t nCount = 0; nCount < view.GetCodeSize (); nCount++)
+    {
+        uint32_t nWord = view.Code ()[nCount];
+        uint8_t nOpcode = nWord & 0xFF;
+        uint8_t nA = (nWord >> 8) & 0xFF;
+        uint8_t nB = (nWord >> 16) & 0xFF;
+        uint8_t nC = nWord >> 24;
+        uint16_t nBx = (uint16_t)(nWord >> 16);
+
+        printf ("%04u  %-10s", nCount, opcodeNames[nOpcode]);
+
+        switch (ScriptView::Operands (nOpcode))
+        {
+            case SCRIPT_OPERANDS_NONE:
+                break;
+
+            case SCRIPT_OPERANDS_A:
+                printf ("r%u", nA);
+                break;
+
+            case SCRIPT_OPERANDS_AB:
+                printf ("r%u, r%u", nA, nB);
+                break;
+
+            case SCRIPT_OPERANDS_ABC:
+                printf ("r%u, r%u, r%u", nA, nB, nC);
+                break;
+
+            case SCRIPT_OPERANDS_ASBX:
+                printf ("r%u, %d", nA, (int16_t)nBx);
+                break;
+
+            case SCRIPT_OPERANDS_ACONST:
+                printf ("r%u, %.5f", nA, Fixed::FromRaw (view.Constants ()[nBx]).ToDouble ());
+                break;
+
+            case SCRIPT_OPERANDS_JUMP:
+                printf ("%04u", nBx);
+                break;
+
+            case SCRIPT_OPERANDS_AJUMP:
+                printf ("r%u, %04u", nA, nBx);
+                break;
+
+            case SCRIPT_OPERANDS_AREAD:
+                printf ("r%u, %s %u", nA, inputNames[nB], nC);
+                break;
+
+            case SCRIPT_OPERANDS_AWRITE:
+                printf ("%s %u, r%u", outputNames[nB], nC, nA);
+                break;
+        }
+
+        printf ("\n");
+    }
+}
+
+static int Dump (const char* pszFile)
+{
+    FILE* pFile = fopen (pszFile, "rb");
+
+    if (pFile == NULL)
+    {
+        perror (pszFile);
+        return 1;
+    }
+
+    std::vector<uint32_t> words;
+    uint32_t nWord;
+
+    while (fread (&nWord, 1, sizeof (nWord), pFile) == sizeof (nWord)) words.push_back (nWord);
+
+    fclose (pFile);
+
+    ScriptView view = ScriptView::Open (words.data (), words.size () * 4);
+
+    if (view.IsValid () == false || view.Verify () == false)
+    {
+        fprintf (stderr, "%s: not a valid version %u script\n", pszFile, SCRIPT_VERSION);
+        return 1;
+    }
+
+    printf ("name       %s\n", view.GetName ());
+    printf ("registers  %u\n", view.GetRegisters ());
+    printf ("code       %u instructions\n", view.GetCodeSize ());
+    printf ("constants  %u\n", view.GetConstants ());
+    printf ("size       %u bytes\n\n", view.Header ().nSize);
+
+    Disassemble (view);
+
+    return 0;
+}
+
+/// Plant of the benchmark: a clock and nothing to read or write
+class BenchHost : public ScriptHost
+{
+public:
+    uint32_t GetTime () override
+    {
+        return nTime;
+    }
+
+    bool Read (uint8_t nPort, uint8_t nIndex, Fixed& nValue) override
+    {
+        nValue = Fixed (nIndex);
+        return true;
+    }
+
+    bool Write (uint8_t nPort, uint8_t nIndex, Fixed nValue) override
+    {
+        return true;
+    }
+
+    uint32_t nTime = 0;
+};
+
+static double Nanoseconds ()
+{
+    struct timespec ts;
+
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/// ns per instruction over nTotal instructions in slices of nBudget
+template <bool bThreaded>
+static double Bench (const ScriptView& view, uint64_t nTotal, uint32_t nBudget, Fixed& nSink)
+{
+    BenchHost host;
+    ScriptTask task;
+    uint64_t nDone = 0;
+    double nStart = Nanoseconds ();
+
+    task.Start (view, 0, 0);
+
+    while (nDone < nTotal)
+    {
+        uint32_t nBefore = task.GetInstructions ();
+        ScriptState nState = task.Execute<bThreaded> (host, nBudget);
+
+        nDone += task.GetInstructions () - nBefore;
+
+        if (nState == SCRIPT_DONE)
+        {
+            nSink += task.Register (1);
+            task.Start (view, 0, 0);
+        }
+    }
+
+    return (Nanoseconds () - nStart) / nDone;
+}
+
+static int Benchmark (double nMillions)
+{
+    static const char* const source[] = {
+        "name \"bench\"",
+        "let n = 0",
+        "let x = 0",
+        "while n < 1000",
+        "  let x = x + n * 0.5 - x / 3",
+        "  if x > mash.temp and n != 7",
+        "    let x = x - 1",
+        "  end",
+        "  let n = n + 1",
+        "end"};
+
+    FILE* pFile = tmpfile ();
+
+    for (size_t nCount = 0; nCount < sizeof (source) / sizeof (source[0]); nCount++) fprintf (pFile, "%s\n", source[nCount]);
+
+    rewind (pFile);
+
+    pszInput = "bench";
+
+    Compiler compiler;
+    bool bCompiled = compiler.Compile (pFile);
+
+    fclose (pFile);
+
+    if (bCompiled == false) return 1;
+
+    std::vector<uint8_t> blob = compiler.Build ();
+    ScriptView view = ScriptView::Open (blob.data (), blob.size ());
+
+    if (view.IsValid () == false) return 1;
+
+    uint64_t nTotal = (uint64_t)(nMillions * 1e6);
+    Fixed nSink;
+
+    printf ("Loop of %u instructions, %u registers, task %zu bytes\n", view.GetCodeSize (), view.GetRegisters (), sizeof (ScriptTask));
+
+    double nSwitch = Bench<false> (view, nTotal, 64, nSink);
+
+    printf ("Switch dispatch:   %6.2f ns per instruction, slices of 64\n", nSwitch);
+
+#if SCRIPT_THREADED
+    double nThreaded = Bench<true> (view, nTotal, 64, nSink);
+
+    printf ("Threaded dispatch: %6.2f ns per instruction, slices of 64 (%.2fx)\n", nThreaded, nSwitch / nThreaded);
+#endif
+
+    // Tasks that sleep cost a clock read and a compare
+    static ScriptTask sleepers[1024];
+    BenchHost host;
+    const uint32_t nRounds = 1000;
+
+    host.nTime = 0;
+
+    for (size_t nCount = 0; nCount < sizeof (sleepers) / sizeof (sleepers[0]); nCount++)
+    {
+        sleepers[nCount].Start (view, 0, 0);
+        sleepers[nCount].Run (host, 3);
+    }
+
+    double nStart = Nanoseconds ();
+
+    for (uint32_t nRound = 0; nRound < nRounds; nRound++)
+    {
+        for (size_t nCount = 0; nCount < sizeof (sleepers) / sizeof (sleepers[0]); nCount++) sleepers[nCount].Run (host, 0);
+    }
+
+    printf ("Idle task:         %6.2f ns per slice (%g)\n", (Nanoseconds () - nStart) / (nRounds * 1024.0), nSink.ToDouble () != 0 ? 1.0 : 0.0);
+
+    return 0;
+}
+
+int main (int argc, char** argv)
+{
+    const char* pszOutput = NULL;
+    const char* pszSymbol = NULL;
+
+    for (int nCount = 1; nCount < argc; nCount++)
+    {
+        if (strcmp (argv[nCount], "--dump") == 0 && nCount + 1 < argc)
+        {
+            return Dump (argv[nCount + 1]);
+        }
+        else if (strcmp (argv[nCount], "--bench") == 0)
+        {
+            return Benchmark (nCount + 1 < argc ? atof (argv[nCount + 1]) : 200);
+        }
+        else if (strcmp (argv[nCount], "-o") == 0 && nCount + 1 < argc)
+        {
+            pszOutput = argv[++nCount];
+        }
+        else if (strcmp (argv[nCount], "--header") == 0 && nCount + 1 < argc)
+        {
+            pszSymbol = argv[++nCount];
+        }
+        else if (argv[nCount][0] != '-' && pszInput[0] == '\0')
+        {
+            pszInput = argv[nCount];
+        }
+        else
+        {
+            pszInput = "";
+            break;
+        }
+    }
+
+    if (pszInput[0] == '\0')
+    {
+        fprintf (stderr, "Use: %s <input.script> [--header symbol] [-o output] | --dump <input.bin> | --bench [million instructions]\n", argv[0]);
+        return 1;
+    }
+
+    FILE* pFile = fopen (pszInput, "r");
+
+    if (pFile == NULL)
+    {
+        perror (pszInput);
+        return 1;
+    }
+
+    Compiler compiler;
+    bool bCompiled = compiler.Compile (pFile);
+
+    fclose (pFile);
+
+    if (bCompiled == false)
+    {
+        fprintf (stderr, "%s: %u error(s)\n", pszInput, nErrors);
+        return 1;
+    }
+
+    std::vector<uint8_t> blob = compiler.Build ();
+
+    // The blob must pass the device reader before it is written
+    ScriptView view = ScriptView::Open (blob.data (), blob.size ());
+
+    if (view.IsValid () == false || view.Verify () == false)
+    {
+        fprintf (stderr, "%s: internal error, built blob does not validate\n", pszInput);
+        return 1;
+    }
+
+    FILE* pOutput = pszOutput == NULL ? stdout : fopen (pszOutput, pszSymbol != NULL ? "w" : "wb");
+
+    if (pOutput == NULL)
+    {
+        perror (pszOutput);
+        return 1;
+    }
+
+    if (pszSymbol != NULL)
+        WriteHeader (pOutput, blob, pszSymbol);
+    else
+        fwrite (blob.data (), 1, blob.size (), pOutput);
+
+    if (pOutput != stdout) fclose (pOutput);
+
+    return 0;
+}
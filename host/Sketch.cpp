@@ -0,0 +1,41 @@
+///
+/// Compiles BrewerSim2.ino as a regular C++ translation unit, the
+/// prototypes below are the ones arduino-cli would generate.
+///
+/// brewersim --replay <file> replays an input recording instead of
+/// running the threads, see Replay.h.
+///
+
+void setup ();
+void loop ();
+void StackOverflowHandler ();
+
+#include "../BrewerSim2.ino"
+
+#include "Replay.h"
+
+void Host_Init ();
+bool Host_ParseOptions (int argc, char** argv);
+
+int main (int argc, char** argv)
+{
+    if (argc > 1 && strcmp (argv[1], "--replay") == 0)
+    {
+        Host_Init ();
+
+        return Replay_Main (argc, argv);
+    }
+
+    if (Host_ParseOptions (argc, argv) == false) return 1;
+
+    Host_Init ();
+
+    setup ();
+
+    while (true)
+    {
+        loop ();
+    }
+
+    return 0;
+}
@@ -0,0 +1,38 @@
+///
+/// Line reader shared by the host compilers
+///
+/// fgets splits a line longer than its buffer, the rest would then
+/// parse as lines of their own with wrong numbers and a cascade of
+/// bogus errors. Source_ReadLine flags such a line instead and skips
+/// what is left of it, so the caller reports one error at the real
+/// line and the next call starts on the next line.
+///
+
+#ifndef HOST_SOURCE_LINE_H
+#define HOST_SOURCE_LINE_H
+
+#include <stdio.h>
+#include <string.h>
+
+/// False at the end of input, bTooLong when the line did not fit
+inline bool Source_ReadLine (FILE* pFile, char* pszLine, int nSize, bool& bTooLong)
+{
+    bTooLong = false;
+
+    if (fgets (pszLine, nSize, pFile) == NULL) return false;
+
+    if (strchr (pszLine, '\n') != NULL) return true;
+
+    // Full buffer: a line of exactly nSize - 1 characters or a longer one
+    int nChar = fgetc (pFile);
+
+    if (nChar == EOF || nChar == '\n') return true;
+
+    bTooLong = true;
+
+    while (nChar != EOF && nChar != '\n') nChar = fgetc (pFile);
+
+    return true;
+}
+
+#endif
@@ -0,0 +1,248 @@
+///
+/// Vessel batch kernel for the host
+///
+/// N vessels of the double model in structure of arrays layout,
+/// advanced together. The AVX2 path keeps blocks of 16 vessels in
+/// registers for a whole run of steps, so memory is touched once per
+/// run and not once per step: a 100k sweep is bound by the divider,
+/// not by memory bandwidth; the scalar fallback calls VesselStep on each
+/// vessel. Both give bit-identical results to the single vessel path:
+/// the AVX2 kernel does the same IEEE operations in the same order,
+/// branches become blends and nothing is fused. Do not build it with
+/// FMA contraction (-mfma, -march=native), that would round
+/// differently from VesselStep.
+///
+
+#ifndef HOST_VESSEL_BATCH_H
+#define HOST_VESSEL_BATCH_H
+
+#include "Arduino.h"
+
+#include "../VesselModel.hpp"
+
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define VESSEL_BATCH_AVX2 1
+#endif
+
+class VesselBatch
+{
+public:
+    /// Lanes per vector, ranges passed to Run are multiples of it
+    static const size_t nLanes = 4;
+
+    explicit VesselBatch (size_t nVessels) : nCount (nVessels), nPadded ((nVessels + nLanes - 1) & ~(nLanes - 1))
+    {
+        // Padding lanes are valid vessels nobody reads
+        for (std::vector<double>* pArray : {&temperature, &volume, &duty, &extraPower, &evaporated, &energy, &heaterPower, &loss, &ambient})
+        {
+            pArray->assign (nPadded, 0.0);
+        }
+
+        capacity.assign (nPadded, 1.0);
+    }
+
+    void Set (size_t nIndex, const VesselParams<double>& params, const VesselState<double>& state)
+    {
+        temperature[nIndex] = state.nTemperature;
+        volume[nIndex] = state.nVolume;
+        capacity[nIndex] = state.nCapacity;
+        duty[nIndex] = state.nDuty;
+        extraPower[nIndex] = state.nExtraPower;
+        evaporated[nIndex] = state.nEvaporated;
+        energy[nIndex] = state.nEnergy;
+
+        heaterPower[nIndex] = params.nHeaterPower;
+        loss[nIndex] = params.nLoss;
+        ambient[nIndex] = params.nAmbient;
+    }
+
+    /// Shell capacity is not kept, it only matters on reset
+    void Get (size_t nIndex, VesselParams<double>& params, VesselState<double>& state) const
+    {
+        state.nTemperature = temperature[nIndex];
+        state.nVolume = volume[nIndex];
+        state.nCapacity = capacity[nIndex];
+        state.nDuty = duty[nIndex];
+        state.nExtraPower = extraPower[nIndex];
+        state.nEvaporated = evaporated[nIndex];
+        state.nEnergy = energy[nIndex];
+
+        params.nHeaterPower = heaterPower[nIndex];
+        params.nLoss = loss[nIndex];
+        params.nShellCapacity = 0;
+        params.nAmbient = ambient[nIndex];
+    }
+
+    double GetTemperature (size_t nIndex) const
+    {
+        return temperature[nIndex];
+    }
+
+    size_t GetCount () const
+    {
+        return nCount;
+    }
+
+    /// Vessel count rounded up to whole vectors
+    size_t GetPadded () const
+    {
+        return nPadded;
+    }
+
+    static bool HasAvx2 ()
+    {
+#ifdef VESSEL_BATCH_AVX2
+        return __builtin_cpu_supports ("avx2");
+#else
+        return false;
+#endif
+    }
+
+    /// nSteps fixed steps of nStep seconds for vessels [nFirst, nLast),
+    /// both multiples of nLanes; disjoint ranges can run on different
+    /// threads
+    void Run (uint32_t nSteps, double nStep, size_t nFirst, size_t nLast, bool bVector)
+    {
+#ifdef VESSEL_BATCH_AVX2
+        if (bVector && HasAvx2 ())
+        {
+            RunAvx2 (nSteps, nStep, nFirst, nLast);
+            return;
+        }
+#endif
+        RunScalar (nSteps, nStep, nFirst, nLast);
+    }
+
+    void Run (uint32_t nSteps, double nStep, bool bVector = true)
+    {
+        Run (nSteps, nStep, 0, nPadded, bVector);
+    }
+
+private:
+    void RunScalar (uint32_t nSteps, double nStep, size_t nFirst, size_t nLast)
+    {
+        VesselParams<double> params;
+        VesselState<double> state;
+
+        for (size_t nIndex = nFirst; nIndex < nLast; nIndex++)
+        {
+            Get (nIndex, params, state);
+
+            for (uint32_t nCount = 0; nCount < nSteps; nCount++)
+            {
+                VesselStep (state, params, nStep);
+            }
+
+            Set (nIndex, params, state);
+        }
+    }
+
+#ifdef VESSEL_BATCH_AVX2
+    /// VesselStep four lanes at a time, line by line. nBlock vectors
+    /// advance side by side: one vector alone waits on the latency of
+    /// its divisions, the temperature of a step needs the previous one
+    __attribute__ ((target ("avx2"))) void RunAvx2 (uint32_t nSteps, double nStep, size_t nFirst, size_t nLast)
+    {
+        size_t nIndex = nFirst;
+
+        for (; nIndex + nBlock * nLanes <= nLast; nIndex += nBlock * nLanes)
+        {
+            RunAvx2Block<nBlock> (nSteps, nStep, nIndex);
+        }
+
+        for (; nIndex < nLast; nIndex += nLanes)
+        {
+            RunAvx2Block<1> (nSteps, nStep, nIndex);
+        }
+    }
+
+    template <size_t nVectors>
+    __attribute__ ((target ("avx2"))) void RunAvx2Block (uint32_t nSteps, double nStep, size_t nIndex)
+    {
+        const __m256d vStep = _mm256_set1_pd (nStep);
+        const __m256d vLatent = _mm256_set1_pd (Physics::nLatentHeat);
+        const __m256d vWaterHeat = _mm256_set1_pd (Physics::nWaterHeat);
+        const __m256d vBoiling = _mm256_set1_pd (Physics::nBoilingPoint);
+        const __m256d vZero = _mm256_setzero_pd ();
+
+        __m256d vTemperature[nVectors], vVolume[nVectors], vCapacity[nVectors], vEvaporated[nVectors], vEnergy[nVectors];
+        __m256d vInput[nVectors], vLoss[nVectors], vAmbient[nVectors], vHeater[nVectors], vHeaterEnergy[nVectors];
+
+        for (size_t nVector = 0; nVector < nVectors; nVector++)
+        {
+            size_t nLane = nIndex + nVector * nLanes;
+
+            vTemperature[nVector] = _mm256_loadu_pd (&temperature[nLane]);
+            vVolume[nVector] = _mm256_loadu_pd (&volume[nLane]);
+            vCapacity[nVector] = _mm256_loadu_pd (&capacity[nLane]);
+            vEvaporated[nVector] = _mm256_loadu_pd (&evaporated[nLane]);
+            vEnergy[nVector] = _mm256_loadu_pd (&energy[nLane]);
+
+            vLoss[nVector] = _mm256_loadu_pd (&loss[nLane]);
+            vAmbient[nVector] = _mm256_loadu_pd (&ambient[nLane]);
+            vHeater[nVector] = _mm256_mul_pd (_mm256_loadu_pd (&heaterPower[nLane]), _mm256_loadu_pd (&duty[nLane]));
+
+            // Terms constant over the run, same operations as VesselStep
+            vInput[nVector] = _mm256_add_pd (vHeater[nVector], _mm256_loadu_pd (&extraPower[nLane]));
+            vHeaterEnergy[nVector] = _mm256_div_pd (_mm256_mul_pd (vHeater[nVector], vStep), _mm256_set1_pd (1000.0));
+        }
+
+        for (uint32_t nCount = 0; nCount < nSteps; nCount++)
+        {
+            for (size_t nVector = 0; nVector < nVectors; nVector++)
+            {
+                __m256d vPower = _mm256_sub_pd (vInput[nVector], _mm256_mul_pd (vLoss[nVector], _mm256_sub_pd (vTemperature[nVector], vAmbient[nVector])));
+                __m256d vHeat = _mm256_mul_pd (vPower, vStep);
+
+                vEnergy[nVector] = _mm256_add_pd (vEnergy[nVector], vHeaterEnergy[nVector]);
+
+                __m256d vBoil = _mm256_and_pd (_mm256_cmp_pd (vTemperature[nVector], vBoiling, _CMP_GE_OQ), _mm256_cmp_pd (vHeat, vZero, _CMP_GT_OQ));
+
+                // min (volume, boiled) is "if boiled > volume then volume"
+                __m256d vBoiled = _mm256_min_pd (vVolume[nVector], _mm256_div_pd (vHeat, vLatent));
+                __m256d vHeated = _mm256_add_pd (vTemperature[nVector], _mm256_div_pd (vHeat, vCapacity[nVector]));
+
+                vVolume[nVector] = _mm256_blendv_pd (vVolume[nVector], _mm256_sub_pd (vVolume[nVector], vBoiled), vBoil);
+                vEvaporated[nVector] = _mm256_blendv_pd (vEvaporated[nVector], _mm256_add_pd (vEvaporated[nVector], vBoiled), vBoil);
+                vCapacity[nVector] = _mm256_blendv_pd (vCapacity[nVector], _mm256_sub_pd (vCapacity[nVector], _mm256_mul_pd (vBoiled, vWaterHeat)), vBoil);
+                vTemperature[nVector] = _mm256_blendv_pd (vHeated, vBoiling, vBoil);
+            }
+        }
+
+        for (size_t nVector = 0; nVector < nVectors; nVector++)
+        {
+            size_t nLane = nIndex + nVector * nLanes;
+
+            _mm256_storeu_pd (&temperature[nLane], vTemperature[nVector]);
+            _mm256_storeu_pd (&volume[nLane], vVolume[nVector]);
+            _mm256_storeu_pd (&capacity[nLane], vCapacity[nVector]);
+            _mm256_storeu_pd (&evaporated[nLane], vEvaporated[nVector]);
+            _mm256_storeu_pd (&energy[nLane], vEnergy[nVector]);
+        }
+    }
+
+    static const size_t nBlock = 4;
+#endif
+
+    size_t nCount;
+    size_t nPadded;
+
+    // State
+    std::vector<double> temperature;
+    std::vector<double> volume;
+    std::vector<double> capacity;
+    std::vector<double> duty;
+    std::vector<double> extraPower;
+    std::vector<double> evaporated;
+    std::vector<double> energy;
+
+    // Parameters
+    std::vector<double> heaterPower;
+    std::vector<double> loss;
+    std::vector<double> ambient;
+};
+
+#endif
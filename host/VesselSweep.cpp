@@ -0,0 +1,220 @@
+///
+/// Vessel parameter sweep on the batch kernel
+///
+/// Heats N randomised kettles (heater power, loss, shell, ambient,
+/// volume) at full duty with the VesselBatch kernel and reports how
+/// long they take to boil and how much they evaporate. Steps run in
+/// chunks of one simulated minute, the time to boil is taken at
+/// chunk boundaries.
+///
+/// Use:
+///   vesselsweep [--vessels n] [--seconds n] [--threads n] [--seed n]
+///               [--scalar] [--check]
+///
+/// --scalar forces the scalar path, --check runs every vessel again
+/// through VesselStep and fails unless the results are bit-identical.
+///
+
+#include "Arduino.h"
+
+#include "VesselBatch.h"
+
+#include <time.h>
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+static const uint32_t nChunk = 60; // seconds between boil checks
+
+/// xorshift32, one stream per vessel
+static uint32_t NextRandom (uint32_t& nState)
+{
+    nState ^= nState << 13;
+    nState ^= nState >> 17;
+    nState ^= nState << 5;
+    return nState;
+}
+
+static double Uniform (uint32_t& nState, double nMin, double nMax)
+{
+    return nMin + (nMax - nMin) * (NextRandom (nState) / 4294967296.0);
+}
+
+static void Configure (size_t nVessel, uint32_t nSeed, VesselParams<double>& params, VesselState<double>& state)
+{
+    uint32_t nState = (uint32_t)(nSeed * 2654435761UL) ^ (uint32_t)(nVessel * 40503UL + 1);
+
+    NextRandom (nState);
+
+    params.nHeaterPower = Uniform (nState, 1.0, 6.0);
+    params.nLoss = Uniform (nState, 0.002, 0.012);
+    params.nShellCapacity = Uniform (nState, 6.0, 15.0);
+    params.nAmbient = Uniform (nState, 10.0, 25.0);
+
+    VesselReset (state, params, Uniform (nState, 10.0, 60.0), params.nAmbient);
+    state.nDuty = 1.0;
+}
+
+static double Percentile (std::vector<double>& values, double nFraction)
+{
+    if (values.empty ()) return 0;
+
+    size_t nIndex = (size_t)(nFraction * (values.size () - 1));
+
+    std::nth_element (values.begin (), values.begin () + nIndex, values.end ());
+
+    return values[nIndex];
+}
+
+static void Usage (const char* pszName)
+{
+    fprintf (stderr, "Use: %s [--vessels n] [--seconds n] [--threads n] [--seed n] [--scalar] [--check]\n", pszName);
+}
+
+int main (int argc, char** argv)
+{
+    size_t nVessels = 100000;
+    uint32_t nSeconds = 3 * 3600;
+    size_t nThreads = std::thread::hardware_concurrency ();
+    uint32_t nSeed = 1;
+    bool bVector = true;
+    bool bCheck = false;
+
+    for (int nCount = 1; nCount < argc; nCount++)
+    {
+        const char* pszValue = nCount + 1 < argc ? argv[nCount + 1] : "";
+
+        if (strcmp (argv[nCount], "--vessels") == 0)
+            nVessels = strtoul (pszValue, NULL, 10), nCount++;
+        else if (strcmp (argv[nCount], "--seconds") == 0)
+            nSeconds = strtoul (pszValue, NULL, 10), nCount++;
+        else if (strcmp (argv[nCount], "--threads") == 0)
+            nThreads = strtoul (pszValue, NULL, 10), nCount++;
+        else if (strcmp (argv[nCount], "--seed") == 0)
+            nSeed = strtoul (pszValue, NULL, 10), nCount++;
+        else if (strcmp (argv[nCount], "--scalar") == 0)
+            bVector = false;
+        else if (strcmp (argv[nCount], "--check") == 0)
+            bCheck = true;
+        else
+        {
+            Usage (argv[0]);
+            return 1;
+        }
+    }
+
+    if (nVessels == 0) nVessels = 1;
+    if (nThreads == 0) nThreads = 1;
+
+    VesselBatch batch (nVessels);
+    std::vector<uint32_t> boilTimes (nVessels, 0);
+
+    for (size_t nVessel = 0; nVessel < nVessels; nVessel++)
+    {
+        VesselParams<double> params;
+        VesselState<double> state;
+
+        Configure (nVessel, nSeed, params, state);
+        batch.Set (nVessel, params, state);
+    }
+
+    // Whole vectors per thread, the kernel range rule
+    size_t nVectors = batch.GetPadded () / VesselBatch::nLanes;
+    size_t nPerThread = (nVectors + nThreads - 1) / nThreads * VesselBatch::nLanes;
+    struct timespec tsStart, tsEnd;
+
+    clock_gettime (CLOCK_MONOTONIC, &tsStart);
+
+    std::vector<std::thread> workers;
+
+    for (size_t nCount = 0; nCount < nThreads; nCount++)
+    {
+        size_t nFirst = std::min (nCount * nPerThread, batch.GetPadded ());
+        size_t nLast = std::min (nFirst + nPerThread, batch.GetPadded ());
+
+        workers.push_back (std::thread ([&, nFirst, nLast] () {
+            for (uint32_t nTime = 0; nTime < nSeconds; nTime += nChunk)
+            {
+                batch.Run (std::min (nChunk, nSeconds - nTime), 1.0, nFirst, nLast, bVector);
+
+                for (size_t nVessel = nFirst; nVessel < std::min (nLast, nVessels); nVessel++)
+                {
+                    if (boilTimes[nVessel] == 0 && batch.GetTemperature (nVessel) >= Physics::nBoilingPoint) boilTimes[nVessel] = nTime + nChunk;
+                }
+            }
+        }));
+    }
+
+    for (size_t nCount = 0; nCount < workers.size (); nCount++)
+    {
+        workers[nCount].join ();
+    }
+
+    clock_gettime (CLOCK_MONOTONIC, &tsEnd);
+
+    std::vector<double> minutes;
+    double nEvaporated = 0, nEnergy = 0;
+    size_t nMismatches = 0;
+
+    for (size_t nVessel = 0; nVessel < nVessels; nVessel++)
+    {
+        VesselParams<double> params;
+        VesselState<double> state;
+
+        batch.Get (nVessel, params, state);
+
+        if (boilTimes[nVessel] > 0) minutes.push_back (boilTimes[nVessel] / 60.0);
+
+        nEvaporated += state.nEvaporated;
+        nEnergy += state.nEnergy;
+
+        if (bCheck)
+        {
+            VesselParams<double> refParams;
+            VesselState<double> reference;
+
+            Configure (nVessel, nSeed, refParams, reference);
+
+            for (uint32_t nTime = 0; nTime < nSeconds; nTime++)
+            {
+                VesselStep (reference, refParams, 1.0);
+            }
+
+            if (memcmp (&reference, &state, sizeof (state)) != 0) nMismatches++;
+        }
+    }
+
+    size_t nBoiled = minutes.size ();
+
+    printf ("vessels,seconds,boiled,boil_min_p10,boil_min_p50,boil_min_p90,evaporated_mean_l,energy_mean_mj\n");
+    printf ("%zu,%u,%zu,%.1f,%.1f,%.1f,%.3f,%.3f\n",
+            nVessels,
+            nSeconds,
+            nBoiled,
+            Percentile (minutes, 0.1),
+            Percentile (minutes, 0.5),
+            Percentile (minutes, 0.9),
+            nEvaporated / nVessels,
+            nEnergy / nVessels);
+
+    double nElapsed = (tsEnd.tv_sec - tsStart.tv_sec) + (tsEnd.tv_nsec - tsStart.tv_nsec) / 1e9;
+    double nVesselSteps = (double)nVessels * nSeconds;
+
+    fprintf (stderr, "%zu vessels x %u steps on %zu threads in %.3fs, %.0f M vessel steps per second, %s kernel\n",
+             nVessels,
+             nSeconds,
+             nThreads,
+             nElapsed,
+             nElapsed > 0 ? nVesselSteps / nElapsed / 1e6 : 0.0,
+             bVector && VesselBatch::HasAvx2 () ? "AVX2" : "scalar");
+
+    if (bCheck)
+    {
+        fprintf (stderr, "check: %zu of %zu vessels differ from VesselStep\n", nMismatches, nVessels);
+
+        if (nMismatches > 0) return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,10 @@
+///
+/// Linux host shim, no I2C devices are simulated
+///
+
+#ifndef HOST_WIRE_H
+#define HOST_WIRE_H
+
+#include "Arduino.h"
+
+#endif
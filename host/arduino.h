@@ -0,0 +1,5 @@
+///
+/// Linux host shim, case-insensitive alias used by the sketch
+///
+
+#include "Arduino.h"
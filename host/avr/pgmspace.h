@@ -0,0 +1,25 @@
+///
+/// Linux host shim, flash is plain memory on the host
+///
+
+#ifndef HOST_PGMSPACE_H
+#define HOST_PGMSPACE_H
+
+#include <stdint.h>
+#include <string.h>
+
+#define PROGMEM
+#define PGM_P const char*
+#define PSTR(string_literal) (string_literal)
+
+#define pgm_read_byte(pAddress) (*(const uint8_t*)(pAddress))
+#define pgm_read_word(pAddress) (*(const uint16_t*)(pAddress))
+#define pgm_read_dword(pAddress) (*(const uint32_t*)(pAddress))
+#define pgm_read_ptr(pAddress) (*(const void* const*)(pAddress))
+
+#define memcpy_P memcpy
+#define strlen_P strlen
+#define strcmp_P strcmp
+#define strncpy_P strncpy
+
+#endif
@@ -0,0 +1,15 @@
+///
+/// Linux host shim for the ESP8266 NONOS SDK calls
+///
+
+#ifndef HOST_USER_INTERFACE_H
+#define HOST_USER_INTERFACE_H
+
+#include <stdint.h>
+
+uint32_t system_get_free_heap_size (void);
+uint32_t system_get_chip_id (void);
+const char* system_get_sdk_version (void);
+uint8_t system_get_cpu_freq (void);
+
+#endif